@@ -0,0 +1,275 @@
+#pragma once
+
+#include <basalt/calibration/aprilgrid.h>
+#include <basalt/calibration/calibration_helper.h>
+#include <basalt/camera/generic_camera.hpp>
+#include <basalt/camera/project_batch.hpp>
+#include <basalt/utils/eigen_utils.hpp>
+
+#include <ceres/cost_function.h>
+#include <ceres/jet.h>
+
+#include <ceres_cost_function_helper.h>
+#include <ceres_lie_residuals.h>
+
+#include <sophus/se3.hpp>
+
+#include <algorithm>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+/// @brief Call f with the camera model.
+///
+/// Concrete camera models are passed on directly, a GenericCamera is
+/// dispatched to its model with std::visit. The reprojection residuals are
+/// instantiated per concrete model when they are added to the problem, so
+/// the std::visit overload is only used when they are constructed from a
+/// GenericCamera directly.
+template <class CamT, class Func>
+inline decltype(auto) visitCamera(const CamT& cam, Func&& f) {
+  return f(cam);
+}
+
+template <class Func>
+inline decltype(auto) visitCamera(const basalt::GenericCamera<double>& cam,
+                                  Func&& f) {
+  return std::visit(std::forward<Func>(f), cam.variant);
+}
+
+/// @brief The model CamT of a GenericCamera, which must hold CamT unless
+/// CamT is GenericCamera itself.
+template <class CamT>
+inline const CamT& cameraAs(const basalt::GenericCamera<double>& cam) {
+  if constexpr (std::is_same_v<CamT, basalt::GenericCamera<double>>) {
+    return cam;
+  } else {
+    return std::get<CamT>(cam.variant);
+  }
+}
+
+/// @brief Project a point with a camera model with double intrinsics.
+///
+/// @param[in] cam camera model
+/// @param[in] p3d point to project
+/// @param[out] proj result of projection
+/// @return if projection is valid
+template <class CamT>
+inline bool projectPoint(const CamT& cam, const Eigen::Vector4d& p3d,
+                         Eigen::Vector2d& proj) {
+  return cam.project(p3d, proj);
+}
+
+/// @brief Project a point given as jets with a camera model with double
+/// intrinsics.
+///
+/// The point is projected with its scalar part and the derivatives are
+/// chained with the Jacobian of the projection, instead of casting the
+/// intrinsics to jets and projecting with jet arithmetic.
+template <class CamT, int M>
+inline bool projectPoint(const CamT& cam,
+                         const Eigen::Matrix<ceres::Jet<double, M>, 4, 1>& p3d,
+                         Eigen::Matrix<ceres::Jet<double, M>, 2, 1>& proj) {
+  Eigen::Vector4d p;
+  for (int i = 0; i < 4; i++) p[i] = p3d[i].a;
+
+  Eigen::Vector2d proj_d;
+  Eigen::Matrix<double, 2, 4> d_proj_d_p3d;
+  if (!cam.project(p, proj_d, &d_proj_d_p3d)) return false;
+
+  for (int i = 0; i < 2; i++) {
+    proj[i].a = proj_d[i];
+    proj[i].v = d_proj_d_p3d(i, 0) * p3d[0].v + d_proj_d_p3d(i, 1) * p3d[1].v +
+                d_proj_d_p3d(i, 2) * p3d[2].v + d_proj_d_p3d(i, 3) * p3d[3].v;
+  }
+
+  return true;
+}
+
+/// @brief Transform a structure-of-arrays point set, T * p for every row p.
+inline basalt::PointsSoA<double, 3> transformPoints(
+    const Sophus::SE3d& T, const basalt::PointsSoA<double, 3>& p) {
+  return ((p.matrix() * T.so3().matrix().transpose()).rowwise() +
+          T.translation().transpose())
+      .array();
+}
+
+/// @brief Base of the reprojection residuals of one AprilGrid frame with
+/// analytic Jacobians.
+///
+/// The residuals are the reprojection errors of all detected corners of the
+/// frame in one or several cameras with the same timestamp, two per corner,
+/// zero for corners that can not be projected. Parameter blocks are the
+/// spline knots of the frame, KnotBlocks, followed by T_i_c of every camera.
+/// The corner positions and detections are gathered once per camera when it
+/// is added, in structure-of-arrays layout for the projectBatch of the
+/// camera. The derived cost function evaluates the spline pose and its
+/// Jacobians once per evaluation for all cameras and passes per-corner
+/// callbacks to projectCorners, which chains them with the Jacobian of the
+/// projection.
+///
+/// @tparam KnotBlocks BlockSizes of the knot parameter blocks
+/// @tparam CamT camera model of all cameras, e.g.
+/// basalt::DoubleSphereCamera<double>, or basalt::GenericCamera<double> to
+/// dispatch once per camera and evaluation
+template <class KnotBlocks, class CamT>
+class CalibReprojectionAnalyticCostFunction;
+
+template <int... Ns, class CamT>
+class CalibReprojectionAnalyticCostFunction<BlockSizes<Ns...>, CamT>
+    : public ceres::CostFunction {
+ public:
+  using Vec2 = Eigen::Matrix<double, 2, 1>;
+  using Vec3 = Eigen::Matrix<double, 3, 1>;
+  using Mat23 = Eigen::Matrix<double, 2, 3>;
+
+  /// Number of knot parameter blocks, T_i_c of camera c is block
+  /// kNumKnotBlocks + c.
+  static constexpr int kNumKnotBlocks = sizeof...(Ns);
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  CalibReprojectionAnalyticCostFunction(
+      const basalt::CalibCornerData* corners,
+      const basalt::AprilGrid* aprilgrid,
+      const CamT& cam) {
+    *this->mutable_parameter_block_sizes() = {Ns...};
+    this->set_num_residuals(0);
+    addCamera(corners, aprilgrid, cam);
+  }
+
+  /// @brief Add the corners of another camera observed at the same time.
+  ///
+  /// Appends a T_i_c parameter block and the residuals of the corners.
+  void addCamera(const basalt::CalibCornerData* corners,
+                 const basalt::AprilGrid* aprilgrid, const CamT& cam) {
+    cameras.emplace_back(corners, aprilgrid, cam, this->num_residuals());
+
+    this->mutable_parameter_block_sizes()->push_back(
+        Sophus::SE3d::num_parameters);
+    this->set_num_residuals(this->num_residuals() +
+                            2 * cameras.back().points_w.rows());
+  }
+
+  size_t numCameras() const { return cameras.size(); }
+
+ protected:
+  /// @brief Project all corners of camera c and write their residuals.
+  ///
+  /// For every corner that can be projected, corner(i, p_i, p_c, d_proj)
+  /// is called with the index i of its residual pair in the cost function,
+  /// the corner position in the IMU frame p_i and camera frame p_c and the
+  /// Jacobian d_proj of the projection with respect to p_c, if jacobians is
+  /// not nullptr. The Jacobian rows of the other corners and the rows of
+  /// camera c in the T_i_c blocks of the other cameras are set to zero.
+  ///
+  /// @param[in] T_i_w inverse of the IMU pose
+  /// @param[in] T_c_i inverse of the camera extrinsics
+  template <class Func>
+  void projectCorners(size_t c, const Sophus::SE3d& T_i_w,
+                      const Sophus::SE3d& T_c_i, double* residuals,
+                      double** jacobians, const Func& corner) const {
+    const Camera& camera = cameras[c];
+    const std::vector<int32_t>& block_sizes =
+        this->parameter_block_sizes();
+
+    const basalt::PointsSoA<double, 3> p_i =
+        transformPoints(T_i_w, camera.points_w);
+    const basalt::PointsSoA<double, 3> p_c = transformPoints(T_c_i, p_i);
+
+    basalt::PointsSoA<double, 2> proj;
+    basalt::ValidSoA valid;
+    basalt::ProjJacobiansSoA<double> d_proj_d_p3d;
+    camera.cam.projectBatch(p_c, proj, valid,
+                            jacobians ? &d_proj_d_p3d : nullptr);
+
+    const Eigen::Index num_corners = p_c.rows();
+    const size_t first = camera.first_residual / 2;
+
+    Eigen::Map<Eigen::Matrix<double, 2, Eigen::Dynamic>> r(
+        residuals + camera.first_residual, 2, num_corners);
+    r = (proj - camera.observations).matrix().transpose();
+
+    if (jacobians) {
+      for (size_t k = kNumKnotBlocks; k < block_sizes.size(); k++) {
+        if (k == kNumKnotBlocks + c || !jacobians[k]) continue;
+        std::fill_n(jacobians[k] + camera.first_residual * block_sizes[k],
+                    2 * num_corners * block_sizes[k], 0.0);
+      }
+    }
+
+    for (Eigen::Index i = 0; i < num_corners; i++) {
+      if (valid[i]) {
+        if (jacobians) {
+          Mat23 d_proj;
+          for (int k = 0; k < 6; k++) {
+            d_proj(k / 3, k % 3) = d_proj_d_p3d(i, k);
+          }
+          corner(first + i, p_i.row(i).transpose(), p_c.row(i).transpose(),
+                 d_proj);
+        }
+      } else {
+        r.col(i).setZero();
+        if (jacobians) {
+          for (size_t k = 0; k < block_sizes.size(); k++) {
+            if (!jacobians[k]) continue;
+            Eigen::Map<Eigen::Matrix<double, 2, Eigen::Dynamic,
+                                     Eigen::RowMajor>>(
+                jacobians[k] + 2 * (first + i) * block_sizes[k], 2,
+                block_sizes[k])
+                .setZero();
+          }
+        }
+      }
+    }
+  }
+
+  /// Jacobian rows of corner i in a parameter block of size SIZE.
+  template <int SIZE>
+  static inline Eigen::Map<Eigen::Matrix<double, 2, SIZE, Eigen::RowMajor>>
+  cornerRows(double* jacobian, size_t i) {
+    return Eigen::Map<Eigen::Matrix<double, 2, SIZE, Eigen::RowMajor>>(
+        jacobian + 2 * i * SIZE);
+  }
+
+ private:
+  /// Corners of the frame in one camera.
+  struct Camera {
+    Camera(const basalt::CalibCornerData* corners,
+           const basalt::AprilGrid* aprilgrid, const CamT& cam,
+           int first_residual)
+        : cam(cam),
+          points_w(corners->corner_ids.size(), 3),
+          observations(corners->corner_ids.size(), 2),
+          first_residual(first_residual) {
+      for (size_t i = 0; i < corners->corner_ids.size(); i++) {
+        const int id = corners->corner_ids[i];
+        points_w.row(i) =
+            aprilgrid->aprilgrid_corner_pos_3d[id].head<3>().transpose();
+        observations.row(i) = corners->corners[i].transpose();
+      }
+    }
+
+    CamT cam;
+
+    /// Corner positions in the AprilGrid frame.
+    basalt::PointsSoA<double, 3> points_w;
+
+    /// Detected corners.
+    basalt::PointsSoA<double, 2> observations;
+
+    /// Index of the first residual of the camera.
+    int first_residual;
+  };
+
+  std::vector<Camera, Eigen::aligned_allocator<Camera>> cameras;
+};
+
+/// Jacobian of exp(-e) p with respect to e for SE(3) tangent vectors [rho;
+/// phi], i.e. [-I, hat(p)].
+inline Eigen::Matrix<double, 3, 6> inversePerturbationJacobian(
+    const Eigen::Vector3d& p) {
+  Eigen::Matrix<double, 3, 6> res;
+  res.leftCols<3>() = -Eigen::Matrix3d::Identity();
+  res.rightCols<3>() = Sophus::SO3d::hat(p);
+  return res;
+}
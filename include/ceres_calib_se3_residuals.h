@@ -4,19 +4,41 @@
 #include <basalt/calibration/calibration_helper.h>
 #include <basalt/utils/common_types.h>
 
+#include <ceres_calib_reprojection.h>
+#include <ceres_lie_residuals.h>
+#include <ceres_spline_helper_group.h>
 #include <ceres_spline_helper_old.h>
 #include <basalt/calibration/calibration.hpp>
 
 template <int _N, bool OLD_TIME_DERIV>
-struct CalibGyroCostFunctorSE3 {
+struct CalibGyroCostFunctorSE3
+    : public LieSplineSegmentData<_N, Sophus::SE3, !OLD_TIME_DERIV> {
+  using Data = LieSplineSegmentData<_N, Sophus::SE3, !OLD_TIME_DERIV>;
+
+  static constexpr int kNumResiduals = 3;
+
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
   CalibGyroCostFunctorSE3(const Eigen::Vector3d& measurement, double u,
-                          double inv_dt, double inv_std = 1)
-      : measurement(measurement), u(u), inv_dt(inv_dt), inv_std(inv_std) {}
+                          double inv_dt, double inv_std = 1,
+                          const SplineCoeffs<_N>* coeffs = nullptr)
+      : measurement(measurement),
+        u(u),
+        inv_dt(inv_dt),
+        inv_std(inv_std),
+        coeffs(coeffs) {}
 
   template <class T>
   bool operator()(T const* const* sKnots, T* sResiduals) const {
+    typename Data::template SegmentData<T> data;
+    Data::computeSegmentData(sKnots, &data);
+    return (*this)(sKnots, data, sResiduals);
+  }
+
+  template <class T>
+  bool operator()(T const* const* sKnots,
+                  const typename Data::template SegmentData<T>& data,
+                  T* sResiduals) const {
     using Vec3 = Eigen::Matrix<T, 3, 1>;
     using Vec6 = Eigen::Matrix<T, 6, 1>;
 
@@ -28,8 +50,8 @@ struct CalibGyroCostFunctorSE3 {
       CeresSplineHelperOld<_N>::template evaluate_lie_vel_old<T, Sophus::SE3>(
           sKnots, u, inv_dt, nullptr, &rot_vel);
     } else {
-      CeresSplineHelper<_N>::template evaluate_lie<T, Sophus::SE3>(
-          sKnots, u, inv_dt, nullptr, &rot_vel, nullptr);
+      Data::template evaluate_lie<LIE_VEL, T>(sKnots, data, coeffs, u,
+                                              inv_dt, nullptr, &rot_vel);
     }
 
     Eigen::Map<Vec3 const> const bias(sKnots[_N]);
@@ -42,26 +64,46 @@ struct CalibGyroCostFunctorSE3 {
 
   Eigen::Vector3d measurement;
   double u, inv_dt, inv_std;
+
+  /// Precomputed blending coefficients at u or nullptr.
+  const SplineCoeffs<_N>* coeffs;
 };
 
 template <int _N, bool OLD_TIME_DERIV>
-struct CalibAccelerationCostFunctorSE3 {
+struct CalibAccelerationCostFunctorSE3
+    : public LieSplineSegmentData<_N, Sophus::SE3, !OLD_TIME_DERIV> {
   static constexpr int N = _N;  // Order of the spline.
 
   using VecN = Eigen::Matrix<double, _N, 1>;
 
+  using Data = LieSplineSegmentData<_N, Sophus::SE3, !OLD_TIME_DERIV>;
+
+  static constexpr int kNumResiduals = 3;
+
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   CalibAccelerationCostFunctorSE3(const Eigen::Vector3d& measurement, double u,
-                                  double inv_dt, double inv_std)
-      : measurement(measurement), u(u), inv_dt(inv_dt), inv_std(inv_std) {}
+                                  double inv_dt, double inv_std,
+                                  const SplineCoeffs<N>* coeffs = nullptr)
+      : measurement(measurement),
+        u(u),
+        inv_dt(inv_dt),
+        inv_std(inv_std),
+        coeffs(coeffs) {}
 
   template <class T>
   bool operator()(T const* const* sKnots, T* sResiduals) const {
+    typename Data::template SegmentData<T> data;
+    Data::computeSegmentData(sKnots, &data);
+    return (*this)(sKnots, data, sResiduals);
+  }
+
+  template <class T>
+  bool operator()(T const* const* sKnots,
+                  const typename Data::template SegmentData<T>& data,
+                  T* sResiduals) const {
     using Vector3 = Eigen::Matrix<T, 3, 1>;
     using Vector6 = Eigen::Matrix<T, 6, 1>;
 
-    using Matrix4 = Eigen::Matrix<T, 4, 4>;
-
     Eigen::Map<Vector3> residuals(sResiduals);
 
     Sophus::SE3<T> T_w_i;
@@ -71,22 +113,18 @@ struct CalibAccelerationCostFunctorSE3 {
       CeresSplineHelperOld<N>::template evaluate_lie_accel_old<T, Sophus::SE3>(
           sKnots, u, inv_dt, &T_w_i, &vel, &accel);
     } else {
-      CeresSplineHelper<N>::template evaluate_lie<T, Sophus::SE3>(
-          sKnots, u, inv_dt, &T_w_i, &vel, &accel);
+      Data::template evaluate_lie<LIE_VALUE | LIE_VEL | LIE_ACCEL, T>(
+          sKnots, data, coeffs, u, inv_dt, &T_w_i, &vel, &accel);
     }
 
-    Matrix4 vel_hat = Sophus::SE3<T>::hat(vel);
-    Matrix4 accel_hat = Sophus::SE3<T>::hat(accel);
-
-    Matrix4 ddpose = T_w_i.matrix() * (vel_hat * vel_hat + accel_hat);
-
-    Vector3 accel_w = ddpose.col(3).template head<3>();
+    Vector3 accel_i =
+        CeresSplineHelperGroup<N>::linear_accel_body(vel, accel);
 
     // Gravity
     Eigen::Map<Vector3 const> const g(sKnots[N]);
     Eigen::Map<Vector3 const> const bias(sKnots[N + 1]);
 
-    residuals = inv_std * (T_w_i.so3().inverse() * (accel_w + g) -
+    residuals = inv_std * (accel_i + T_w_i.so3().inverse() * g -
                            measurement.cast<T>() + bias);
 
     return true;
@@ -94,9 +132,405 @@ struct CalibAccelerationCostFunctorSE3 {
 
   Eigen::Vector3d measurement;
   double u, inv_dt, inv_std;
+
+  /// Precomputed blending coefficients at u or nullptr.
+  const SplineCoeffs<N>* coeffs;
+};
+
+/// @brief Gyroscope residual of the SE(3) spline with analytic Jacobians.
+///
+/// Same residual as CalibGyroCostFunctorSE3. Parameter blocks are the N
+/// knots and the gyroscope bias.
+template <int _N>
+class CalibGyroAnalyticCostFunctionSE3
+    : public SizedCostFunctionFor<
+          3, typename ConcatBlockSizes<RepeatedBlockSizes<_N, 7>,
+                                       BlockSizes<3>>::type>::type,
+      public SegmentKnotDeltas<_N, Sophus::SE3d> {
+ public:
+  static constexpr int N = _N;  // Order of the spline.
+
+  using Vec3 = Eigen::Matrix<double, 3, 1>;
+  using Mat3 = Eigen::Matrix<double, 3, 3, Eigen::RowMajor>;
+
+  using JacobianArray = typename CeresSplineHelperJacobian<
+      N>::template JacobianArray<Sophus::SE3>;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  CalibGyroAnalyticCostFunctionSE3(const Eigen::Vector3d& measurement,
+                                   double u, double inv_dt, double inv_std = 1,
+                                   const SplineCoeffs<N>* coeffs = nullptr)
+      : measurement(measurement),
+        u(u),
+        inv_dt(inv_dt),
+        inv_std(inv_std),
+        coeffs(coeffs) {}
+
+  bool Evaluate(double const* const* parameters, double* residuals,
+                double** jacobians) const override {
+    Sophus::Vector6d vel;
+    JacobianArray J;
+
+    if (coeffs) {
+      CeresSplineHelperJacobian<N>::template evaluate_lie<Sophus::SE3, 1>(
+          parameters, *coeffs, &vel, jacobians ? &J : nullptr,
+          this->knotDeltas());
+    } else {
+      CeresSplineHelperJacobian<N>::template evaluate_lie<Sophus::SE3, 1>(
+          parameters, u, inv_dt, &vel, jacobians ? &J : nullptr,
+          this->knotDeltas());
+    }
+
+    Eigen::Map<Vec3 const> const bias(parameters[N]);
+
+    Eigen::Map<Vec3> r(residuals);
+    r = inv_std * (vel.tail<3>() - measurement + bias);
+
+    if (jacobians) {
+      for (int i = 0; i < N; i++) {
+        if (jacobians[i]) {
+          setLieKnotJacobian<Sophus::SE3d>(
+              parameters[i], inv_std * J[i].template bottomRows<3>(),
+              jacobians[i]);
+        }
+      }
+      if (jacobians[N]) {
+        Eigen::Map<Mat3>{jacobians[N]} = inv_std * Mat3::Identity();
+      }
+    }
+
+    return true;
+  }
+
+  Eigen::Vector3d measurement;
+  double u, inv_dt, inv_std;
+
+  /// Precomputed blending coefficients at u or nullptr.
+  const SplineCoeffs<N>* coeffs;
 };
 
+/// @brief Accelerometer residual of the SE(3) spline with analytic
+/// Jacobians.
+///
+/// Same residual as CalibAccelerationCostFunctorSE3. Parameter blocks are the
+/// N knots, gravity and the accelerometer bias. The residual depends on the
+/// value, the velocity and the acceleration of the spline, which are
+/// evaluated with their Jacobians in one pass.
 template <int _N>
+class CalibAccelerationAnalyticCostFunctionSE3
+    : public SizedCostFunctionFor<
+          3, typename ConcatBlockSizes<RepeatedBlockSizes<_N, 7>,
+                                       BlockSizes<3, 3>>::type>::type,
+      public SegmentKnotDeltas<_N, Sophus::SE3d> {
+ public:
+  static constexpr int N = _N;  // Order of the spline.
+
+  using Vec3 = Eigen::Matrix<double, 3, 1>;
+  using Mat3 = Eigen::Matrix<double, 3, 3, Eigen::RowMajor>;
+
+  using JacobianArray = typename CeresSplineHelperJacobian<
+      N>::template JacobianArray<Sophus::SE3>;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  CalibAccelerationAnalyticCostFunctionSE3(
+      const Eigen::Vector3d& measurement, double u, double inv_dt,
+      double inv_std, const SplineCoeffs<N>* coeffs = nullptr)
+      : measurement(measurement),
+        u(u),
+        inv_dt(inv_dt),
+        inv_std(inv_std),
+        coeffs(coeffs) {}
+
+  bool Evaluate(double const* const* parameters, double* residuals,
+                double** jacobians) const override {
+    if (coeffs) return evaluate(*coeffs, parameters, residuals, jacobians);
+
+    const SplineCoeffs<N> c(u, inv_dt, 2);
+    return evaluate(c, parameters, residuals, jacobians);
+  }
+
+  Eigen::Vector3d measurement;
+  double u, inv_dt, inv_std;
+
+  /// Precomputed blending coefficients at u or nullptr.
+  const SplineCoeffs<N>* coeffs;
+
+ private:
+  bool evaluate(const SplineCoeffs<N>& c, double const* const* parameters,
+                double* residuals, double** jacobians) const {
+    bool knot_jacobians = false;
+    if (jacobians) {
+      for (int i = 0; i < N; i++) knot_jacobians |= jacobians[i] != nullptr;
+    }
+
+    Sophus::SE3d T_w_i;
+    Sophus::Vector6d vel, accel;
+    JacobianArray J_value, J_vel, J_accel;
+
+    constexpr int OUT = LIE_VALUE | LIE_VEL | LIE_ACCEL;
+    if (knot_jacobians) {
+      CeresSplineHelperJacobian<N>::template evaluate_lie<Sophus::SE3, OUT>(
+          parameters, c, &T_w_i, &vel, &accel, &J_value, &J_vel, &J_accel,
+          this->knotDeltas());
+    } else {
+      CeresSplineHelperJacobian<N>::template evaluate_lie<Sophus::SE3, OUT>(
+          parameters, c, &T_w_i, &vel, &accel, nullptr, nullptr, nullptr,
+          this->knotDeltas());
+    }
+
+    Eigen::Map<Vec3 const> const g(parameters[N]);
+    Eigen::Map<Vec3 const> const bias(parameters[N + 1]);
+
+    const Sophus::SO3d R_i_w = T_w_i.so3().inverse();
+    const Vec3 g_i = R_i_w * g;
+
+    Eigen::Map<Vec3> r(residuals);
+    r = inv_std * (CeresSplineHelperGroup<N>::linear_accel_body(vel, accel) +
+                   g_i - measurement + bias);
+
+    if (!jacobians) return true;
+
+    // With vel = [v; omega] the linear acceleration is omega x v + dv/dt,
+    // gravity in the body frame depends on the rotation of the value.
+    if (knot_jacobians) {
+      const Mat3 hat_omega = inv_std * Sophus::SO3d::hat(vel.tail<3>());
+      const Mat3 hat_v = inv_std * Sophus::SO3d::hat(vel.head<3>());
+      const Mat3 hat_g = inv_std * Sophus::SO3d::hat(g_i);
+
+      for (int i = 0; i < N; i++) {
+        if (!jacobians[i]) continue;
+
+        const Eigen::Matrix<double, 3, 6> d_r_d_knot =
+            hat_omega * J_vel[i].template topRows<3>() -
+            hat_v * J_vel[i].template bottomRows<3>() +
+            inv_std * J_accel[i].template topRows<3>() +
+            hat_g * J_value[i].template bottomRows<3>();
+
+        setLieKnotJacobian<Sophus::SE3d>(parameters[i], d_r_d_knot,
+                                         jacobians[i]);
+      }
+    }
+
+    if (jacobians[N]) {
+      Eigen::Map<Mat3>{jacobians[N]} = inv_std * R_i_w.matrix();
+    }
+    if (jacobians[N + 1]) {
+      Eigen::Map<Mat3>{jacobians[N + 1]} = inv_std * Mat3::Identity();
+    }
+
+    return true;
+  }
+};
+
+/// @brief Gyroscope and accelerometer residual of one IMU sample of the SE(3)
+/// spline.
+///
+/// Stacks the residuals of CalibGyroCostFunctorSE3 (rows 0-2) and
+/// CalibAccelerationCostFunctorSE3 (rows 3-5) for a gyroscope and an
+/// accelerometer sample with the same timestamp, such that the spline is
+/// evaluated once. Parameter blocks are the N knots, gravity, the
+/// accelerometer bias and the gyroscope bias.
+template <int _N>
+struct CalibImuCostFunctorSE3 : public LieSplineSegmentData<_N, Sophus::SE3> {
+  static constexpr int N = _N;  // Order of the spline.
+
+  using Data = LieSplineSegmentData<_N, Sophus::SE3>;
+
+  static constexpr int kNumResiduals = 6;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  CalibImuCostFunctorSE3(const Eigen::Vector3d& gyro_measurement,
+                         const Eigen::Vector3d& accel_measurement, double u,
+                         double inv_dt, double gyro_inv_std,
+                         double accel_inv_std,
+                         const SplineCoeffs<N>* coeffs = nullptr)
+      : gyro_measurement(gyro_measurement),
+        accel_measurement(accel_measurement),
+        u(u),
+        inv_dt(inv_dt),
+        gyro_inv_std(gyro_inv_std),
+        accel_inv_std(accel_inv_std),
+        coeffs(coeffs) {}
+
+  template <class T>
+  bool operator()(T const* const* sKnots, T* sResiduals) const {
+    typename Data::template SegmentData<T> data;
+    Data::computeSegmentData(sKnots, &data);
+    return (*this)(sKnots, data, sResiduals);
+  }
+
+  template <class T>
+  bool operator()(T const* const* sKnots,
+                  const typename Data::template SegmentData<T>& data,
+                  T* sResiduals) const {
+    using Vector3 = Eigen::Matrix<T, 3, 1>;
+    using Vector6 = Eigen::Matrix<T, 6, 1>;
+
+    Eigen::Map<Vector6> residuals(sResiduals);
+
+    Sophus::SE3<T> T_w_i;
+    Vector6 vel, accel;
+    Data::template evaluate_lie<LIE_VALUE | LIE_VEL | LIE_ACCEL, T>(
+        sKnots, data, coeffs, u, inv_dt, &T_w_i, &vel, &accel);
+
+    Vector3 accel_i = CeresSplineHelperGroup<N>::linear_accel_body(vel, accel);
+
+    Eigen::Map<Vector3 const> const g(sKnots[N]);
+    Eigen::Map<Vector3 const> const accel_bias(sKnots[N + 1]);
+    Eigen::Map<Vector3 const> const gyro_bias(sKnots[N + 2]);
+
+    residuals.template head<3>() =
+        gyro_inv_std * (vel.template tail<3>() - gyro_measurement.cast<T>() +
+                        gyro_bias);
+    residuals.template tail<3>() =
+        accel_inv_std * (accel_i + T_w_i.so3().inverse() * g -
+                         accel_measurement.cast<T>() + accel_bias);
+
+    return true;
+  }
+
+  Eigen::Vector3d gyro_measurement, accel_measurement;
+  double u, inv_dt, gyro_inv_std, accel_inv_std;
+
+  /// Precomputed blending coefficients at u or nullptr.
+  const SplineCoeffs<N>* coeffs;
+};
+
+/// @brief IMU residual of the SE(3) spline with analytic Jacobians.
+///
+/// Same residual and parameter blocks as CalibImuCostFunctorSE3. The
+/// gyroscope rows reuse the velocity and its Jacobians computed for the
+/// accelerometer rows.
+template <int _N>
+class CalibImuAnalyticCostFunctionSE3
+    : public SizedCostFunctionFor<
+          6, typename ConcatBlockSizes<RepeatedBlockSizes<_N, 7>,
+                                       BlockSizes<3, 3, 3>>::type>::type,
+      public SegmentKnotDeltas<_N, Sophus::SE3d> {
+ public:
+  static constexpr int N = _N;  // Order of the spline.
+
+  using Vec3 = Eigen::Matrix<double, 3, 1>;
+  using Vec6 = Eigen::Matrix<double, 6, 1>;
+  using Mat3 = Eigen::Matrix<double, 3, 3, Eigen::RowMajor>;
+  using Mat63 = Eigen::Matrix<double, 6, 3, Eigen::RowMajor>;
+
+  using JacobianArray = typename CeresSplineHelperJacobian<
+      N>::template JacobianArray<Sophus::SE3>;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  CalibImuAnalyticCostFunctionSE3(const Eigen::Vector3d& gyro_measurement,
+                                  const Eigen::Vector3d& accel_measurement,
+                                  double u, double inv_dt, double gyro_inv_std,
+                                  double accel_inv_std,
+                                  const SplineCoeffs<N>* coeffs = nullptr)
+      : gyro_measurement(gyro_measurement),
+        accel_measurement(accel_measurement),
+        u(u),
+        inv_dt(inv_dt),
+        gyro_inv_std(gyro_inv_std),
+        accel_inv_std(accel_inv_std),
+        coeffs(coeffs) {}
+
+  bool Evaluate(double const* const* parameters, double* residuals,
+                double** jacobians) const override {
+    if (coeffs) return evaluate(*coeffs, parameters, residuals, jacobians);
+
+    const SplineCoeffs<N> c(u, inv_dt, 2);
+    return evaluate(c, parameters, residuals, jacobians);
+  }
+
+  Eigen::Vector3d gyro_measurement, accel_measurement;
+  double u, inv_dt, gyro_inv_std, accel_inv_std;
+
+  /// Precomputed blending coefficients at u or nullptr.
+  const SplineCoeffs<N>* coeffs;
+
+ private:
+  bool evaluate(const SplineCoeffs<N>& c, double const* const* parameters,
+                double* residuals, double** jacobians) const {
+    bool knot_jacobians = false;
+    if (jacobians) {
+      for (int i = 0; i < N; i++) knot_jacobians |= jacobians[i] != nullptr;
+    }
+
+    Sophus::SE3d T_w_i;
+    Sophus::Vector6d vel, accel;
+    JacobianArray J_value, J_vel, J_accel;
+
+    constexpr int OUT = LIE_VALUE | LIE_VEL | LIE_ACCEL;
+    if (knot_jacobians) {
+      CeresSplineHelperJacobian<N>::template evaluate_lie<Sophus::SE3, OUT>(
+          parameters, c, &T_w_i, &vel, &accel, &J_value, &J_vel, &J_accel,
+          this->knotDeltas());
+    } else {
+      CeresSplineHelperJacobian<N>::template evaluate_lie<Sophus::SE3, OUT>(
+          parameters, c, &T_w_i, &vel, &accel, nullptr, nullptr, nullptr,
+          this->knotDeltas());
+    }
+
+    Eigen::Map<Vec3 const> const g(parameters[N]);
+    Eigen::Map<Vec3 const> const accel_bias(parameters[N + 1]);
+    Eigen::Map<Vec3 const> const gyro_bias(parameters[N + 2]);
+
+    const Sophus::SO3d R_i_w = T_w_i.so3().inverse();
+    const Vec3 g_i = R_i_w * g;
+
+    Eigen::Map<Vec6> r(residuals);
+    r.head<3>() =
+        gyro_inv_std * (vel.tail<3>() - gyro_measurement + gyro_bias);
+    r.tail<3>() =
+        accel_inv_std * (CeresSplineHelperGroup<N>::linear_accel_body(vel,
+                                                                      accel) +
+                         g_i - accel_measurement + accel_bias);
+
+    if (!jacobians) return true;
+
+    // See CalibAccelerationAnalyticCostFunctionSE3 for the accelerometer
+    // rows.
+    if (knot_jacobians) {
+      const Mat3 hat_omega = accel_inv_std * Sophus::SO3d::hat(vel.tail<3>());
+      const Mat3 hat_v = accel_inv_std * Sophus::SO3d::hat(vel.head<3>());
+      const Mat3 hat_g = accel_inv_std * Sophus::SO3d::hat(g_i);
+
+      for (int i = 0; i < N; i++) {
+        if (!jacobians[i]) continue;
+
+        Eigen::Matrix<double, 6, 6> d_r_d_knot;
+        d_r_d_knot.topRows<3>() =
+            gyro_inv_std * J_vel[i].template bottomRows<3>();
+        d_r_d_knot.bottomRows<3>() =
+            hat_omega * J_vel[i].template topRows<3>() -
+            hat_v * J_vel[i].template bottomRows<3>() +
+            accel_inv_std * J_accel[i].template topRows<3>() +
+            hat_g * J_value[i].template bottomRows<3>();
+
+        setLieKnotJacobian<Sophus::SE3d>(parameters[i], d_r_d_knot,
+                                         jacobians[i]);
+      }
+    }
+
+    if (jacobians[N]) {
+      Eigen::Map<Mat63> J(jacobians[N]);
+      J.topRows<3>().setZero();
+      J.bottomRows<3>() = accel_inv_std * R_i_w.matrix();
+    }
+    if (jacobians[N + 1]) {
+      Eigen::Map<Mat63> J(jacobians[N + 1]);
+      J.topRows<3>().setZero();
+      J.bottomRows<3>() = accel_inv_std * Mat3::Identity();
+    }
+    if (jacobians[N + 2]) {
+      Eigen::Map<Mat63> J(jacobians[N + 2]);
+      J.topRows<3>() = gyro_inv_std * Mat3::Identity();
+      J.bottomRows<3>().setZero();
+    }
+
+    return true;
+  }
+};
+
+template <int _N, class CamT = basalt::GenericCamera<double>>
 struct CalibReprojectionCostFunctorSE3 : public CeresSplineHelper<_N> {
   static constexpr int N = _N;        // Order of the spline.
   static constexpr int DEG = _N - 1;  // Degree of the spline.
@@ -110,8 +544,7 @@ struct CalibReprojectionCostFunctorSE3 : public CeresSplineHelper<_N> {
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   CalibReprojectionCostFunctorSE3(const basalt::CalibCornerData* corners,
                                   const basalt::AprilGrid* aprilgrid,
-                                  const basalt::GenericCamera<double>& cam,
-                                  double u, double inv_dt)
+                                  const CamT& cam, double u, double inv_dt)
       : corners(corners),
         aprilgrid(aprilgrid),
         cam(cam),
@@ -126,44 +559,140 @@ struct CalibReprojectionCostFunctorSE3 : public CeresSplineHelper<_N> {
     using Matrix4 = Eigen::Matrix<T, 4, 4>;
 
     Sophus::SE3<T> T_w_i;
-    CeresSplineHelper<N>::template evaluate_lie<T, Sophus::SE3>(sKnots, u,
-                                                                inv_dt, &T_w_i);
+    CeresSplineHelperGroup<N>::template evaluate_lie<LIE_VALUE, T, Sophus::SE3>(
+        sKnots, u, inv_dt, &T_w_i);
 
     Eigen::Map<Sophus::SE3<T> const> const T_i_c(sKnots[N]);
 
     Sophus::SE3<T> T_w_c = T_w_i * T_i_c;
     Matrix4 T_c_w_matrix = T_w_c.inverse().matrix();
 
-    basalt::GenericCamera<T> cam_t = cam.template cast<T>();
-
-    std::visit(
-        [&](const auto& cam_tt) {
-          for (size_t i = 0; i < corners->corner_ids.size(); i++) {
-            Vector4 p3d =
-                T_c_w_matrix *
-                aprilgrid->aprilgrid_corner_pos_3d[corners->corner_ids[i]]
-                    .cast<T>();
-
-            Vector2 proj;
-            bool success = cam_tt.project(p3d, proj);
-
-            if (success) {
-              sResiduals[2 * i + 0] = proj[0] - corners->corners[i][0];
-              sResiduals[2 * i + 1] = proj[1] - corners->corners[i][1];
-            } else {
-              sResiduals[2 * i + 0] = T(0);
-              sResiduals[2 * i + 1] = T(0);
-            }
-          }
-        },
-        cam_t.variant);
+    visitCamera(cam, [&](const auto& cam) {
+      for (size_t i = 0; i < corners->corner_ids.size(); i++) {
+        Vector4 p3d =
+            T_c_w_matrix *
+            aprilgrid->aprilgrid_corner_pos_3d[corners->corner_ids[i]]
+                .cast<T>();
+
+        Vector2 proj;
+        bool success = projectPoint(cam, p3d, proj);
+
+        if (success) {
+          sResiduals[2 * i + 0] = proj[0] - corners->corners[i][0];
+          sResiduals[2 * i + 1] = proj[1] - corners->corners[i][1];
+        } else {
+          sResiduals[2 * i + 0] = T(0);
+          sResiduals[2 * i + 1] = T(0);
+        }
+      }
+    });
 
     return true;
   }
 
   const basalt::CalibCornerData* corners;
   const basalt::AprilGrid* aprilgrid;
-  const basalt::GenericCamera<double> cam;
+  const CamT cam;
 
   double u, inv_dt;
 };
+
+/// @brief Reprojection residuals of one AprilGrid frame for the SE(3) spline
+/// with analytic Jacobians.
+///
+/// Same residuals as CalibReprojectionCostFunctorSE3, for one camera or,
+/// with addCamera, all cameras observed at the same time. The pose of the
+/// frame and its Jacobians with respect to the knots are evaluated once per
+/// evaluation for all cameras and chained with the projection Jacobian of
+/// each corner. Parameter blocks are the N knots and T_i_c of every camera.
+template <int _N, class CamT = basalt::GenericCamera<double>>
+class CalibReprojectionAnalyticCostFunctionSE3
+    : public CalibReprojectionAnalyticCostFunction<RepeatedBlockSizes<_N, 7>,
+                                                   CamT>,
+      public SegmentKnotDeltas<_N, Sophus::SE3d> {
+ public:
+  static constexpr int N = _N;  // Order of the spline.
+
+  using Base =
+      CalibReprojectionAnalyticCostFunction<RepeatedBlockSizes<_N, 7>, CamT>;
+  using typename Base::Mat23;
+  using typename Base::Vec3;
+
+  using JacobianArray = typename CeresSplineHelperJacobian<
+      N>::template JacobianArray<Sophus::SE3>;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  CalibReprojectionAnalyticCostFunctionSE3(
+      const basalt::CalibCornerData* corners,
+      const basalt::AprilGrid* aprilgrid,
+      const CamT& cam, double u, double inv_dt)
+      : Base(corners, aprilgrid, cam), coeffs(u, inv_dt, 0) {}
+
+  bool Evaluate(double const* const* parameters, double* residuals,
+                double** jacobians) const override {
+    bool knot_jacobians = false;
+    if (jacobians) {
+      for (int i = 0; i < N; i++) knot_jacobians |= jacobians[i] != nullptr;
+    }
+
+    Sophus::SE3d T_w_i;
+    JacobianArray J;
+    CeresSplineHelperJacobian<N>::template evaluate_lie<Sophus::SE3, 0>(
+        parameters, coeffs, &T_w_i, knot_jacobians ? &J : nullptr,
+        this->knotDeltas());
+
+    const Sophus::SE3d T_i_w = T_w_i.inverse();
+
+    // Parts of the Jacobians that are the same for all corners, mapped to
+    // the parameters.
+    std::array<Eigen::Matrix<double, 6, 7>, N> d_knot;
+    if (knot_jacobians) {
+      for (int j = 0; j < N; j++) {
+        if (jacobians[j]) {
+          d_knot[j] = J[j] * lieLocalToParams<Sophus::SE3d>(parameters[j]);
+        }
+      }
+    }
+
+    for (size_t c = 0; c < this->numCameras(); c++) {
+      double const* const ext = parameters[N + c];
+      double* const ext_jacobian = jacobians ? jacobians[N + c] : nullptr;
+
+      const Sophus::SE3d T_c_i =
+          Eigen::Map<Sophus::SE3d const>(ext).inverse();
+
+      Eigen::Matrix<double, 6, 7> d_ext;
+      if (ext_jacobian) d_ext = lieLocalToParams<Sophus::SE3d>(ext);
+
+      const Eigen::Matrix3d R_c_i = T_c_i.so3().matrix();
+
+      this->projectCorners(
+          c, T_i_w, T_c_i, residuals, jacobians,
+          [&](size_t i, const Vec3& p_i, const Vec3& p_c,
+              const Mat23& d_proj) {
+            // (T_w_i exp(e))^{-1} p = exp(-e) p_i
+            if (knot_jacobians) {
+              const Eigen::Matrix<double, 2, 6> d_proj_d_pose =
+                  d_proj * R_c_i * inversePerturbationJacobian(p_i);
+              for (int j = 0; j < N; j++) {
+                if (jacobians[j]) {
+                  Base::template cornerRows<7>(jacobians[j], i) =
+                      d_proj_d_pose * d_knot[j];
+                }
+              }
+            }
+
+            if (ext_jacobian) {
+              Base::template cornerRows<7>(ext_jacobian, i) =
+                  d_proj * inversePerturbationJacobian(p_c) * d_ext;
+            }
+          });
+    }
+
+    return true;
+  }
+
+ private:
+  /// Blending coefficients of the pose at u.
+  SplineCoeffs<N> coeffs;
+};
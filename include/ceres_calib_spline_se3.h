@@ -7,18 +7,56 @@
 
 #include <ceres/ceres.h>
 #include <ceres_calib_se3_residuals.h>
-
-template <int _N, bool OLD_TIME_DERIV = false>
+#include <ceres_cost_function_helper.h>
+#include <ceres_knot_delta_callback.h>
+#include <ceres_segment_batch.h>
+#include <ceres_spline_batch.h>
+#include <ceres_spline_file.h>
+#include <ceres_spline_helper_delta.h>
+#include <ceres_spline_subdivision.h>
+
+#include <array>
+#include <utility>
+#include <vector>
+
+/// @brief SE(3) calibration spline fitted with Ceres.
+///
+/// OLD_TIME_DERIV selects the time derivative formulation of
+/// CeresSplineHelperOld for the IMU residuals. ANALYTIC_JACOBIAN replaces
+/// the autodiff gyroscope, accelerometer and reprojection residuals by cost
+/// functions with hand-derived Jacobians.
+template <int _N, bool OLD_TIME_DERIV = false,
+          bool ANALYTIC_JACOBIAN = false>
 class CeresCalibrationSplineSe3 {
  public:
   static constexpr int N = _N;        // Order of the spline.
   static constexpr int DEG = _N - 1;  // Degree of the spline.
 
+  static_assert(!(OLD_TIME_DERIV && ANALYTIC_JACOBIAN),
+                "Analytic Jacobians use the new time derivatives.");
+
   static constexpr double ns_to_s = 1e-9;  ///< Nanosecond to second conversion
   static constexpr double s_to_ns = 1e9;   ///< Second to nanosecond conversion
 
-  CeresCalibrationSplineSe3(int64_t time_interval_ns, int64_t start_time_ns = 0)
-      : dt_ns(time_interval_ns), start_t_ns(start_time_ns) {
+  /// @param[in] time_interval_ns knot spacing
+  /// @param[in] start_time_ns start time of the spline
+  /// @param[in] enable_knot_delta_callback compute the knot differences once
+  /// per evaluation point for all residuals. The analytic residuals then
+  /// read the differences and the time independent parts of their Jacobians
+  /// from a KnotDeltaCallback of the problem, which computes them for all
+  /// knots before each evaluation, instead of once per residual. Only
+  /// affects residuals with ANALYTIC_JACOBIAN, the autodiff residuals need
+  /// the differences as jets. Without it the problem has no evaluation
+  /// callback and none of its overhead.
+  CeresCalibrationSplineSe3(int64_t time_interval_ns, int64_t start_time_ns = 0,
+                            bool enable_knot_delta_callback = false)
+      : dt_ns(time_interval_ns),
+        start_t_ns(start_time_ns),
+        coeff_table(time_interval_ns),
+        use_knot_delta_callback(enable_knot_delta_callback),
+        knot_delta_callback(knots),
+        problem(problemOptions(
+            use_knot_delta_callback ? &knot_delta_callback : nullptr)) {
     inv_dt = s_to_ns / dt_ns;
 
     accel_bias.setZero();
@@ -26,36 +64,122 @@ class CeresCalibrationSplineSe3 {
   };
 
   Sophus::SE3d getPose(int64_t time_ns) const {
-    int64_t st_ns = (time_ns - start_t_ns);
+    Sophus::SE3d res;
+    evaluate(time_ns, &res);
+    return res;
+  }
 
-    BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns " << time_ns
-                                              << " start_t_ns " << start_t_ns);
+  Eigen::Vector3d getGyro(int64_t time_ns) const {
+    Eigen::Vector3d gyro;
+    evaluate(time_ns, nullptr, &gyro);
+    return gyro;
+  }
 
-    int64_t s = st_ns / dt_ns;
-    double u = double(st_ns % dt_ns) / double(dt_ns);
+  Eigen::Vector3d getAccel(int64_t time_ns) const {
+    Eigen::Vector3d accel;
+    evaluate(time_ns, nullptr, nullptr, &accel);
+    return accel;
+  }
 
-    BASALT_ASSERT_STREAM(s >= 0, "s " << s);
-    BASALT_ASSERT_STREAM(size_t(s + N) <= knots.size(), "s " << s << " N " << N
-                                                             << " knots.size() "
-                                                             << knots.size());
+  /// @brief Evaluate pose and IMU measurements at many timestamps at once.
+  ///
+  /// The SE(3) spline and its derivatives are evaluated once per timestamp
+  /// for all requested outputs, with CeresSplineHelperSimd on groups of
+  /// timestamps if the knot delta cache or float queries are enabled.
+  /// Outputs that are nullptr are skipped, the others must have room for
+  /// num_times elements.
+  ///
+  /// @param[in] times_ns timestamps sorted in ascending order
+  /// @param[in] num_times number of timestamps
+  /// @param[out] pose_out if not nullptr poses T_w_i
+  /// @param[out] gyro_out if not nullptr rotational velocities in body frame
+  /// @param[out] accel_out if not nullptr accelerometer measurements
+  void evaluateBatch(const int64_t* times_ns, size_t num_times,
+                     Sophus::SE3d* pose_out,
+                     Eigen::Vector3d* gyro_out = nullptr,
+                     Eigen::Vector3d* accel_out = nullptr) const {
+    if (use_float_queries) {
+      evaluateBatchSimd<float>(times_ns, num_times, pose_out, gyro_out,
+                               accel_out);
+      return;
+    }
+    if (use_knot_delta_cache) {
+      evaluateBatchSimd<double>(times_ns, num_times, pose_out, gyro_out,
+                                accel_out);
+      return;
+    }
 
-    Sophus::SE3d res;
+    forEachSortedTime(times_ns, num_times, start_t_ns, dt_ns,
+                      [&](size_t i, int64_t s, double u) {
+                        evaluateSegment(s, u, nullptr,
+                                        pose_out ? &pose_out[i] : nullptr,
+                                        gyro_out ? &gyro_out[i] : nullptr,
+                                        accel_out ? &accel_out[i] : nullptr);
+                      });
+  }
 
-    Sophus::SO3d rot;
-    Eigen::Vector3d trans;
+  void init(const Sophus::SE3d& init, int num_knots) {
+    knots = Eigen::aligned_vector<Sophus::SE3d>(num_knots, init);
+    knot_delta_cache.invalidate();
 
-    std::vector<const double*> vec;
-    for (int i = 0; i < N; i++) {
-      vec.emplace_back(knots[s + i].data());
+    for (int i = 0; i < num_knots; i++) {
+      ceres::LocalParameterization* local_parameterization =
+          new LieLocalParameterization<Sophus::SE3d>();
+
+      problem.AddParameterBlock(knots[i].data(), Sophus::SE3d::num_parameters,
+                                local_parameterization);
     }
 
-    CeresSplineHelper<N>::template evaluate_lie<double, Sophus::SE3>(
-        &vec[0], u, inv_dt, &res);
+    // Local parametrization of T_i_c
+    for (size_t i = 0; i < calib.T_i_c.size(); i++) {
+      ceres::LocalParameterization* local_parameterization =
+          new LieLocalParameterization<Sophus::SE3d>();
 
-    return res;
+      problem.AddParameterBlock(calib.T_i_c[i].data(),
+                                Sophus::SE3d::num_parameters,
+                                local_parameterization);
+    }
   }
 
-  Eigen::Vector3d getGyro(int64_t time_ns) const {
+  /// @brief Initialize with the refined knots of a coarse spline.
+  ///
+  /// The spline must be constructed with half the knot spacing of coarse and
+  /// the same start time. The knots are computed by
+  /// CeresSplineSubdivision::subdivideLie. Gravity, biases, calibration and
+  /// the aprilgrid are copied from coarse.
+  void initSubdivided(const CeresCalibrationSplineSe3& coarse) {
+    BASALT_ASSERT_STREAM(
+        2 * dt_ns == coarse.dt_ns && start_t_ns == coarse.start_t_ns,
+        "dt_ns " << dt_ns << " coarse.dt_ns " << coarse.dt_ns);
+
+    knots = CeresSplineSubdivision<N>::subdivideLie(coarse.knots);
+    knot_delta_cache.invalidate();
+
+    g = coarse.g;
+    accel_bias = coarse.accel_bias;
+    gyro_bias = coarse.gyro_bias;
+    calib = coarse.calib;
+    aprilgrid = coarse.aprilgrid;
+
+    for (size_t i = 0; i < knots.size(); i++) {
+      ceres::LocalParameterization* local_parameterization =
+          new LieLocalParameterization<Sophus::SE3d>();
+
+      problem.AddParameterBlock(knots[i].data(), Sophus::SE3d::num_parameters,
+                                local_parameterization);
+    }
+
+    for (size_t i = 0; i < calib.T_i_c.size(); i++) {
+      ceres::LocalParameterization* local_parameterization =
+          new LieLocalParameterization<Sophus::SE3d>();
+
+      problem.AddParameterBlock(calib.T_i_c[i].data(),
+                                Sophus::SE3d::num_parameters,
+                                local_parameterization);
+    }
+  }
+
+  void addGyroMeasurement(const Eigen::Vector3d& meas, int64_t time_ns) {
     int64_t st_ns = (time_ns - start_t_ns);
 
     BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns " << time_ns
@@ -69,20 +193,33 @@ class CeresCalibrationSplineSe3 {
                                                              << " knots.size() "
                                                              << knots.size());
 
-    Sophus::Vector6d gyro;
+    const double inv_std = 1.0 / calib.dicrete_time_gyro_noise_std()[0];
+    const SplineCoeffs<N>* coeffs = coeff_table.row(st_ns % dt_ns);
 
-    std::vector<const double*> vec;
-    for (int i = 0; i < N; i++) {
-      vec.emplace_back(knots[s + i].data());
+    if (batch_segments) {
+      if constexpr (ANALYTIC_JACOBIAN) {
+        gyro_batches.get(s).add(withKnotDeltas(
+            new GyroCostFunction(meas, u, inv_dt, inv_std, coeffs), s));
+      } else {
+        gyro_batches.get(s).add(GyroFunctor(meas, u, inv_dt, inv_std, coeffs));
+      }
+      return;
     }
 
-    CeresSplineHelper<N>::template evaluate_lie<double, Sophus::SE3>(
-        &vec[0], u, inv_dt, nullptr, &gyro);
+    ceres::CostFunction* cost_function;
+
+    if constexpr (ANALYTIC_JACOBIAN) {
+      cost_function = withKnotDeltas(
+          new GyroCostFunction(meas, u, inv_dt, inv_std, coeffs), s);
+    } else {
+      cost_function = newAutoDiffCostFunction<3>(
+          new GyroFunctor(meas, u, inv_dt, inv_std, coeffs), GyroBlockSizes());
+    }
 
-    return gyro.tail<3>();
+    problem.AddResidualBlock(cost_function, NULL, gyroParameterBlocks(s));
   }
 
-  Eigen::Vector3d getAccel(int64_t time_ns) const {
+  void addAccelMeasurement(const Eigen::Vector3d& meas, int64_t time_ns) {
     int64_t st_ns = (time_ns - start_t_ns);
 
     BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns " << time_ns
@@ -96,54 +233,45 @@ class CeresCalibrationSplineSe3 {
                                                              << " knots.size() "
                                                              << knots.size());
 
-    Sophus::SE3d pose;
-    Sophus::Vector6d se3_vel, se3_accel;
+    const double inv_std = 1.0 / calib.dicrete_time_accel_noise_std()[0];
+    const SplineCoeffs<N>* coeffs = coeff_table.row(st_ns % dt_ns);
 
-    {
-      std::vector<const double*> vec;
-      for (int i = 0; i < N; i++) {
-        vec.emplace_back(knots[s + i].data());
+    if (batch_segments) {
+      if constexpr (ANALYTIC_JACOBIAN) {
+        accel_batches.get(s).add(withKnotDeltas(
+            new AccelCostFunction(meas, u, inv_dt, inv_std, coeffs), s));
+      } else {
+        accel_batches.get(s).add(
+            AccelFunctor(meas, u, inv_dt, inv_std, coeffs));
       }
-
-      CeresSplineHelper<N>::template evaluate_lie<double, Sophus::SE3>(
-          &vec[0], u, inv_dt, &pose, &se3_vel, &se3_accel);
+      return;
     }
 
-    Eigen::Matrix4d vel_hat = Sophus::SE3d::hat(se3_vel);
-    Eigen::Matrix4d accel_hat = Sophus::SE3d::hat(se3_accel);
-
-    Eigen::Matrix4d ddpose = pose.matrix() * (vel_hat * vel_hat + accel_hat);
+    ceres::CostFunction* cost_function;
 
-    Eigen::Vector3d accel_w = ddpose.col(3).template head<3>();
-
-    Eigen::Vector3d accel_meas = pose.so3().inverse() * (accel_w + g);
-
-    return accel_meas;
-  }
-
-  void init(const Sophus::SE3d& init, int num_knots) {
-    knots = Eigen::aligned_vector<Sophus::SE3d>(num_knots, init);
-
-    for (int i = 0; i < num_knots; i++) {
-      ceres::LocalParameterization* local_parameterization =
-          new LieLocalParameterization<Sophus::SE3d>();
-
-      problem.AddParameterBlock(knots[i].data(), Sophus::SE3d::num_parameters,
-                                local_parameterization);
+    if constexpr (ANALYTIC_JACOBIAN) {
+      cost_function = withKnotDeltas(
+          new AccelCostFunction(meas, u, inv_dt, inv_std, coeffs), s);
+    } else {
+      cost_function = newAutoDiffCostFunction<3>(
+          new AccelFunctor(meas, u, inv_dt, inv_std, coeffs),
+          AccelBlockSizes());
     }
 
-    // Local parametrization of T_i_c
-    for (size_t i = 0; i < calib.T_i_c.size(); i++) {
-      ceres::LocalParameterization* local_parameterization =
-          new LieLocalParameterization<Sophus::SE3d>();
+    problem.AddResidualBlock(cost_function, NULL, accelParameterBlocks(s));
+  }
 
-      problem.AddParameterBlock(calib.T_i_c[i].data(),
-                                Sophus::SE3d::num_parameters,
-                                local_parameterization);
+  /// @brief Add a gyroscope and an accelerometer sample with the same
+  /// timestamp as one residual, which evaluates the spline once for both.
+  /// With OLD_TIME_DERIV the samples are added as separate residuals.
+  void addImuMeasurement(const Eigen::Vector3d& gyro_meas,
+                         const Eigen::Vector3d& accel_meas, int64_t time_ns) {
+    if constexpr (OLD_TIME_DERIV) {
+      addGyroMeasurement(gyro_meas, time_ns);
+      addAccelMeasurement(accel_meas, time_ns);
+      return;
     }
-  }
 
-  void addGyroMeasurement(const Eigen::Vector3d& meas, int64_t time_ns) {
     int64_t st_ns = (time_ns - start_t_ns);
 
     BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns " << time_ns
@@ -157,30 +285,43 @@ class CeresCalibrationSplineSe3 {
                                                              << " knots.size() "
                                                              << knots.size());
 
-    using FunctorT = CalibGyroCostFunctorSE3<_N, OLD_TIME_DERIV>;
-
-    FunctorT* functor = new FunctorT(
-        meas, u, inv_dt, 1.0 / calib.dicrete_time_gyro_noise_std()[0]);
-
-    ceres::DynamicAutoDiffCostFunction<FunctorT>* cost_function =
-        new ceres::DynamicAutoDiffCostFunction<FunctorT>(functor);
-
-    for (int i = 0; i < N; i++) {
-      cost_function->AddParameterBlock(7);
+    const double gyro_inv_std = 1.0 / calib.dicrete_time_gyro_noise_std()[0];
+    const double accel_inv_std = 1.0 / calib.dicrete_time_accel_noise_std()[0];
+    const SplineCoeffs<N>* coeffs = coeff_table.row(st_ns % dt_ns);
+
+    if (batch_segments) {
+      if constexpr (ANALYTIC_JACOBIAN) {
+        imu_batches.get(s).add(withKnotDeltas(
+            new ImuCostFunction(gyro_meas, accel_meas, u, inv_dt,
+                                gyro_inv_std, accel_inv_std, coeffs),
+            s));
+      } else {
+        imu_batches.get(s).add(ImuFunctor(gyro_meas, accel_meas, u, inv_dt,
+                                          gyro_inv_std, accel_inv_std,
+                                          coeffs));
+      }
+      return;
     }
-    cost_function->AddParameterBlock(3);
-    cost_function->SetNumResiduals(3);
 
-    std::vector<double*> vec;
-    for (int i = 0; i < N; i++) {
-      vec.emplace_back(knots[s + i].data());
+    ceres::CostFunction* cost_function;
+
+    if constexpr (ANALYTIC_JACOBIAN) {
+      cost_function = withKnotDeltas(
+          new ImuCostFunction(gyro_meas, accel_meas, u, inv_dt, gyro_inv_std,
+                              accel_inv_std, coeffs),
+          s);
+    } else {
+      cost_function = newAutoDiffCostFunction<6>(
+          new ImuFunctor(gyro_meas, accel_meas, u, inv_dt, gyro_inv_std,
+                         accel_inv_std, coeffs),
+          ImuBlockSizes());
     }
-    vec.emplace_back(gyro_bias.data());
 
-    problem.AddResidualBlock(cost_function, NULL, vec);
+    problem.AddResidualBlock(cost_function, NULL, imuParameterBlocks(s));
   }
 
-  void addAccelMeasurement(const Eigen::Vector3d& meas, int64_t time_ns) {
+  void addCornersMeasurement(const basalt::CalibCornerData* corners, int cam_id,
+                             int64_t time_ns) {
     int64_t st_ns = (time_ns - start_t_ns);
 
     BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns " << time_ns
@@ -194,33 +335,74 @@ class CeresCalibrationSplineSe3 {
                                                              << " knots.size() "
                                                              << knots.size());
 
-    using FunctorT = CalibAccelerationCostFunctorSE3<N, OLD_TIME_DERIV>;
-
-    FunctorT* functor = new FunctorT(
-        meas, u, inv_dt, 1.0 / calib.dicrete_time_accel_noise_std()[0]);
-
-    ceres::DynamicAutoDiffCostFunction<FunctorT>* cost_function =
-        new ceres::DynamicAutoDiffCostFunction<FunctorT>(functor);
-
-    for (int i = 0; i < N; i++) {
-      cost_function->AddParameterBlock(7);
-    }
-    cost_function->AddParameterBlock(3);
-    cost_function->AddParameterBlock(3);
-    cost_function->SetNumResiduals(3);
+    // The number of residuals depends on the number of detected corners,
+    // parameter blocks are the knots and T_i_c. The residual is instantiated
+    // for the camera model, so evaluations don't dispatch on it.
+    ceres::CostFunction* cost_function = visitCamera(
+        calib.intrinsics[cam_id],
+        [&](const auto& cam) -> ceres::CostFunction* {
+          using CamT = std::decay_t<decltype(cam)>;
+
+          if constexpr (ANALYTIC_JACOBIAN) {
+            return withKnotDeltas(
+                new CalibReprojectionAnalyticCostFunctionSE3<N, CamT>(
+                    corners, aprilgrid.get(), cam, u, inv_dt),
+                s);
+          } else {
+            using FunctorT = CalibReprojectionCostFunctorSE3<N, CamT>;
+
+            FunctorT* functor =
+                new FunctorT(corners, aprilgrid.get(), cam, u, inv_dt);
+
+            return newAutoDiffCostFunction<ceres::DYNAMIC>(
+                functor, ReprojectionBlockSizes(),
+                corners->corner_ids.size() * 2);
+          }
+        });
 
     std::vector<double*> vec;
     for (int i = 0; i < N; i++) {
       vec.emplace_back(knots[s + i].data());
     }
-    vec.emplace_back(g.data());
-    vec.emplace_back(accel_bias.data());
+    vec.emplace_back(calib.T_i_c[cam_id].data());
 
     problem.AddResidualBlock(cost_function, NULL, vec);
+
+    //    {
+    //      Eigen::VectorXd residual;
+    //      residual.setZero(corners->corner_ids.size() * 2);
+
+    //      cost_function->Evaluate(&vec[0], residual.data(), NULL);
+    //      std::cerr << "residual " << residual.transpose() << std::endl;
+    //    }
   }
+  /// @brief Add the corners of all cameras observed at time_ns.
+  ///
+  /// With ANALYTIC_JACOBIAN this adds one residual for all cameras, which
+  /// evaluates the pose of the frame once and projects into each camera with
+  /// its own T_i_c. It is instantiated for the camera model if all cameras
+  /// share it, otherwise it dispatches once per camera and evaluation. The
+  /// rows of a camera are structural zeros in the T_i_c blocks of the
+  /// others, which the linear solver pays for, so this only pays off if the
+  /// pose is expensive compared to the projection of the corners. The
+  /// autodiff residuals evaluate the pose once per jet chunk anyway, so
+  /// without ANALYTIC_JACOBIAN one residual per camera is added as with
+  /// addCornersMeasurement.
+  ///
+  /// @param[in] cam_corners camera index and corners of every camera
+  void addSyncCornersMeasurement(
+      const std::vector<std::pair<int, const basalt::CalibCornerData*>>&
+          cam_corners,
+      int64_t time_ns) {
+    if constexpr (!ANALYTIC_JACOBIAN) {
+      for (const auto& [cam_id, corners] : cam_corners) {
+        addCornersMeasurement(corners, cam_id, time_ns);
+      }
+      return;
+    }
+
+    if (cam_corners.empty()) return;
 
-  void addCornersMeasurement(const basalt::CalibCornerData* corners, int cam_id,
-                             int64_t time_ns) {
     int64_t st_ns = (time_ns - start_t_ns);
 
     BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns " << time_ns
@@ -234,39 +416,44 @@ class CeresCalibrationSplineSe3 {
                                                              << " knots.size() "
                                                              << knots.size());
 
-    using FunctorT = CalibReprojectionCostFunctorSE3<N>;
+    auto make_cost_function = [&](const auto& cam) -> ceres::CostFunction* {
+      using CamT = std::decay_t<decltype(cam)>;
 
-    FunctorT* functor = new FunctorT(corners, aprilgrid.get(),
-                                     calib.intrinsics[cam_id], u, inv_dt);
+      auto* cost_function = new CalibReprojectionAnalyticCostFunctionSE3<
+          N, CamT>(cam_corners[0].second, aprilgrid.get(), cam, u, inv_dt);
+      for (size_t c = 1; c < cam_corners.size(); c++) {
+        cost_function->addCamera(
+            cam_corners[c].second, aprilgrid.get(),
+            cameraAs<CamT>(calib.intrinsics[cam_corners[c].first]));
+      }
+      return withKnotDeltas(cost_function, s);
+    };
 
-    ceres::DynamicAutoDiffCostFunction<FunctorT>* cost_function =
-        new ceres::DynamicAutoDiffCostFunction<FunctorT>(functor);
+    const basalt::GenericCamera<double>& cam0 =
+        calib.intrinsics[cam_corners[0].first];
 
-    for (int i = 0; i < N; i++) {
-      cost_function->AddParameterBlock(7);
+    bool same_model = true;
+    for (const auto& [cam_id, corners] : cam_corners) {
+      same_model &=
+          calib.intrinsics[cam_id].variant.index() == cam0.variant.index();
     }
-    // T_i_c
-    cost_function->AddParameterBlock(7);
 
-    cost_function->SetNumResiduals(corners->corner_ids.size() * 2);
+    ceres::CostFunction* cost_function =
+        same_model ? visitCamera(cam0, make_cost_function)
+                   : make_cost_function(cam0);
 
     std::vector<double*> vec;
     for (int i = 0; i < N; i++) {
       vec.emplace_back(knots[s + i].data());
     }
-    vec.emplace_back(calib.T_i_c[cam_id].data());
+    for (const auto& [cam_id, corners] : cam_corners) {
+      vec.emplace_back(calib.T_i_c[cam_id].data());
+    }
 
     problem.AddResidualBlock(cost_function, NULL, vec);
-
-    //    {
-    //      Eigen::VectorXd residual;
-    //      residual.setZero(corners->corner_ids.size() * 2);
-
-    //      cost_function->Evaluate(&vec[0], residual.data(), NULL);
-    //      std::cerr << "residual " << residual.transpose() << std::endl;
-    //    }
   }
 
+
   int64_t maxTimeNs() const {
     return start_t_ns + (knots.size() - N + 1) * dt_ns - 1;
   }
@@ -284,56 +471,32 @@ class CeresCalibrationSplineSe3 {
 
       if (time_ns < minTimeNs() || time_ns >= maxTimeNs()) continue;
 
-      int64_t st_ns = (time_ns - start_t_ns);
+      Sophus::SE3d T_c_w =
+          (getPose(time_ns) * calib.T_i_c[kv.first.cam_id]).inverse();
 
-      BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns "
-                                                << time_ns << " start_t_ns "
-                                                << start_t_ns);
+      const basalt::CalibCornerData& cd = kv.second;
 
-      int64_t s = st_ns / dt_ns;
-      double u = double(st_ns % dt_ns) / double(dt_ns);
-
-      BASALT_ASSERT_STREAM(s >= 0, "s " << s);
-      BASALT_ASSERT_STREAM(
-          size_t(s + N) <= knots.size(),
-          "s " << s << " N " << N << " knots.size() " << knots.size());
-
-      using FunctorT = CalibReprojectionCostFunctorSE3<N>;
-
-      FunctorT* functor =
-          new FunctorT(&kv.second, aprilgrid.get(),
-                       calib.intrinsics[kv.first.cam_id], u, inv_dt);
-
-      ceres::DynamicAutoDiffCostFunction<FunctorT>* cost_function =
-          new ceres::DynamicAutoDiffCostFunction<FunctorT>(functor);
-
-      for (int i = 0; i < N; i++) {
-        cost_function->AddParameterBlock(7);
-      }
-      // T_i_c
-      cost_function->AddParameterBlock(7);
-
-      cost_function->SetNumResiduals(kv.second.corner_ids.size() * 2);
-
-      std::vector<const double*> vec;
-      for (int i = 0; i < N; i++) {
-        vec.emplace_back(knots[s + i].data());
+      basalt::PointsSoA<double, 3> p_w(cd.corner_ids.size(), 3);
+      for (size_t i = 0; i < cd.corner_ids.size(); i++) {
+        p_w.row(i) = aprilgrid->aprilgrid_corner_pos_3d[cd.corner_ids[i]]
+                         .head<3>()
+                         .transpose();
       }
-      vec.emplace_back(calib.T_i_c[kv.first.cam_id].data());
 
-      {
-        Eigen::VectorXd residual;
-        residual.setZero(kv.second.corner_ids.size() * 2);
+      basalt::PointsSoA<double, 2> proj;
+      basalt::ValidSoA valid;
+      calib.intrinsics[kv.first.cam_id].projectBatch(
+          transformPoints(T_c_w, p_w), proj, valid);
 
-        cost_function->Evaluate(&vec[0], residual.data(), NULL);
+      for (size_t i = 0; i < cd.corner_ids.size(); i++) {
+        if (!valid[i]) continue;
 
-        for (size_t i = 0; i < kv.second.corner_ids.size(); i++) {
-          Eigen::Vector2d res_point = residual.segment<2>(2 * i);
+        Eigen::Vector2d res_point =
+            proj.row(i).matrix().transpose() - cd.corners[i];
 
-          if (res_point[0] != 0.0 && res_point[1] != 0.0) {
-            sum_error += res_point.norm();
-            num_points += 1;
-          }
+        if (res_point[0] != 0.0 && res_point[1] != 0.0) {
+          sum_error += res_point.norm();
+          num_points += 1;
         }
       }
     }
@@ -345,6 +508,8 @@ class CeresCalibrationSplineSe3 {
   }
 
   ceres::Solver::Summary optimize() {
+    addSegmentBatches();
+
     ceres::Solver::Options options;
     options.linear_solver_type = ceres::SPARSE_NORMAL_CHOLESKY;
     options.max_num_iterations = 50;
@@ -355,11 +520,20 @@ class CeresCalibrationSplineSe3 {
     Solve(options, &problem, &summary);
     std::cout << summary.FullReport() << std::endl;
 
+    knot_delta_cache.invalidate();
+
     return summary;
   }
 
   Sophus::SE3d getKnot(int i) const { return knots[i]; }
 
+  /// Set knot i. Invalidates the knot delta cache and the float knots
+  /// after writing it, so later queries see the new knot.
+  void setKnot(int i, const Sophus::SE3d& knot) {
+    knots[i] = knot;
+    knot_delta_cache.invalidate();
+  }
+
   size_t numKnots() { return knots.size(); }
 
   void setAprilgrid(std::shared_ptr<basalt::AprilGrid>& a) { aprilgrid = a; }
@@ -374,15 +548,290 @@ class CeresCalibrationSplineSe3 {
   Eigen::Vector3d getGyroBias() { return gyro_bias; }
   Eigen::Vector3d getAccelBias() { return accel_bias; }
 
+  /// @brief Write the knots, the calibration, gravity and the IMU biases to
+  /// a spline file, see MappedSpline.
+  bool save(const std::string& path) const {
+    SplineFileCalib file_calib;
+    file_calib.calib = calib;
+    file_calib.g = g;
+    file_calib.accel_bias = accel_bias;
+    file_calib.gyro_bias = gyro_bias;
+
+    return writeSplineFile(
+        path, SplineFileGroup::SE3, N, start_t_ns, dt_ns, knots.size(),
+        [&](size_t i, double* params) {
+          Eigen::Map<Sophus::SE3d>{params} = knots[i];
+        },
+        &file_calib);
+  }
+
+  /// @brief Cache the knot differences log(T_i^{-1} * T_{i+1}).
+  ///
+  /// With the cache enabled getPose, getGyro, getAccel, evaluateBatch and
+  /// meanReprojection reuse the differences instead of recomputing DEG log
+  /// maps per query. The cache is invalidated by init(), optimize() and
+  /// setKnot. Residuals are not affected.
+  void setKnotDeltaCache(bool enable) {
+    use_knot_delta_cache = enable;
+    knot_delta_cache.invalidate();
+  }
+
+  /// @brief Collect the IMU measurements per knot segment.
+  ///
+  /// With batching enabled optimize() adds one residual block per segment for
+  /// each of the gyro, accel and combined IMU measurements in it, which
+  /// share the knot differences. Affects measurements added after the call.
+  void setSegmentBatching(bool enable) { batch_segments = enable; }
+
+  /// @brief Evaluate evaluateBatch from a float copy of the knots.
+  ///
+  /// The float structure-of-arrays store is rebuilt from the double knots on
+  /// the first query after optimize() or setKnot and evaluated with the
+  /// float kernels of CeresSplineHelperSimd. The accelerometer model,
+  /// optimization and the single time queries stay in double.
+  void setFloatQueries(bool enable) { use_float_queries = enable; }
+
  private:
+  using GyroFunctor = CalibGyroCostFunctorSE3<N, OLD_TIME_DERIV>;
+  using AccelFunctor = CalibAccelerationCostFunctorSE3<N, OLD_TIME_DERIV>;
+  using GyroCostFunction = CalibGyroAnalyticCostFunctionSE3<N>;
+  using AccelCostFunction = CalibAccelerationAnalyticCostFunctionSE3<N>;
+  using ImuFunctor = CalibImuCostFunctorSE3<N>;
+  using ImuCostFunction = CalibImuAnalyticCostFunctionSE3<N>;
+
+  /// Parameter blocks of the N knots of a segment.
+  using KnotBlockSizes = RepeatedBlockSizes<N, Sophus::SE3d::num_parameters>;
+  using GyroBlockSizes =
+      typename ConcatBlockSizes<KnotBlockSizes, BlockSizes<3>>::type;
+  using AccelBlockSizes =
+      typename ConcatBlockSizes<KnotBlockSizes, BlockSizes<3, 3>>::type;
+  using ImuBlockSizes =
+      typename ConcatBlockSizes<KnotBlockSizes, BlockSizes<3, 3, 3>>::type;
+  using ReprojectionBlockSizes =
+      typename ConcatBlockSizes<KnotBlockSizes, BlockSizes<7>>::type;
+
+  std::vector<double*> gyroParameterBlocks(int64_t s) {
+    std::vector<double*> vec;
+    for (int i = 0; i < N; i++) {
+      vec.emplace_back(knots[s + i].data());
+    }
+    vec.emplace_back(gyro_bias.data());
+    return vec;
+  }
+
+  std::vector<double*> accelParameterBlocks(int64_t s) {
+    std::vector<double*> vec;
+    for (int i = 0; i < N; i++) {
+      vec.emplace_back(knots[s + i].data());
+    }
+    vec.emplace_back(g.data());
+    vec.emplace_back(accel_bias.data());
+    return vec;
+  }
+
+  /// Accelerometer blocks followed by the gyroscope bias.
+  std::vector<double*> imuParameterBlocks(int64_t s) {
+    std::vector<double*> vec = accelParameterBlocks(s);
+    vec.emplace_back(gyro_bias.data());
+    return vec;
+  }
+
+  /// IMU residuals of one segment, see setSegmentBatching.
+  template <class FunctorT, class Blocks>
+  using SegmentBatch =
+      std::conditional_t<ANALYTIC_JACOBIAN, StackedCostFunction<Blocks>,
+                         SegmentBatchCostFunctor<FunctorT>>;
+  using GyroBatch = SegmentBatch<GyroFunctor, GyroBlockSizes>;
+  using AccelBatch = SegmentBatch<AccelFunctor, AccelBlockSizes>;
+  using ImuBatch = SegmentBatch<ImuFunctor, ImuBlockSizes>;
+
+  /// Cost function of a collected batch, autodiff unless ANALYTIC_JACOBIAN.
+  template <class Blocks, class BatchT>
+  static ceres::CostFunction* batchCostFunction(BatchT* batch) {
+    if constexpr (ANALYTIC_JACOBIAN) {
+      return batch;
+    } else {
+      const int num_residuals = batch->numResiduals();
+      return newAutoDiffCostFunction<ceres::DYNAMIC>(batch, Blocks(),
+                                                     num_residuals);
+    }
+  }
+
+  /// Options of the problem with the knot delta callback, if enabled.
+  static ceres::Problem::Options problemOptions(
+      ceres::EvaluationCallback* callback) {
+    ceres::Problem::Options options;
+    options.evaluation_callback = callback;
+    return options;
+  }
+
+  /// Let the analytic residual of segment s read its knot differences from
+  /// the evaluation callback if enabled, see the constructor.
+  template <class CostFunctionT>
+  CostFunctionT* withKnotDeltas(CostFunctionT* cost_function, int64_t s) {
+    if (use_knot_delta_callback) {
+      cost_function->setKnotDeltas(knot_delta_callback.table(), s);
+    }
+    return cost_function;
+  }
+
+  /// Add the collected segment batches to the problem.
+  void addSegmentBatches() {
+    gyro_batches.release([&](int64_t s, GyroBatch* batch) {
+      problem.AddResidualBlock(batchCostFunction<GyroBlockSizes>(batch), NULL,
+                               gyroParameterBlocks(s));
+    });
+
+    accel_batches.release([&](int64_t s, AccelBatch* batch) {
+      problem.AddResidualBlock(batchCostFunction<AccelBlockSizes>(batch), NULL,
+                               accelParameterBlocks(s));
+    });
+
+    imu_batches.release([&](int64_t s, ImuBatch* batch) {
+      problem.AddResidualBlock(batchCostFunction<ImuBlockSizes>(batch), NULL,
+                               imuParameterBlocks(s));
+    });
+  }
+
+  /// evaluateBatch with CeresSplineHelperSimd in Scalar precision.
+  template <class Scalar>
+  void evaluateBatchSimd(const int64_t* times_ns, size_t num_times,
+                         Sophus::SE3d* pose_out, Eigen::Vector3d* gyro_out,
+                         Eigen::Vector3d* accel_out) const {
+    using Simd = CeresSplineHelperSimd<N, Scalar>;
+    using ArrD = Eigen::Array<double, Simd::Lanes, 1>;
+
+    const typename Simd::template SoA<Sophus::SE3>& soa =
+        knot_delta_cache.template getSoA<Scalar>(knots);
+
+    forEachSortedTimeLanes<Simd::Lanes>(
+        times_ns, num_times, start_t_ns, dt_ns,
+        [&](size_t i0, int num_valid, const int64_t* s, const double* u) {
+          BASALT_ASSERT_STREAM(size_t(s[num_valid - 1] + N) <= knots.size(),
+                               "s " << s[num_valid - 1] << " N " << N
+                                    << " knots.size() " << knots.size());
+
+          typename Simd::template ValueArr<Sophus::SE3> pose;
+          typename Simd::template TangentArr<Sophus::SE3> se3_vel, se3_accel;
+
+          Simd::template evaluate_lie<Sophus::SE3>(
+              soa, s, Eigen::Map<const ArrD>(u).template cast<Scalar>(),
+              inv_dt, &pose, (gyro_out || accel_out) ? &se3_vel : nullptr,
+              accel_out ? &se3_accel : nullptr);
+
+          for (int l = 0; l < num_valid; l++) {
+            Sophus::Vector7d params =
+                pose.row(l).transpose().template cast<double>();
+            if constexpr (!std::is_same<Scalar, double>::value) {
+              params.head<4>().normalize();
+            }
+            Sophus::SE3d T_w_i = Eigen::Map<Sophus::SE3d const>(params.data());
+
+            Sophus::Vector6d vel, accel;
+            if (gyro_out || accel_out) {
+              vel = se3_vel.row(l).transpose().template cast<double>();
+            }
+            if (accel_out) {
+              accel = se3_accel.row(l).transpose().template cast<double>();
+            }
+
+            if (pose_out) pose_out[i0 + l] = T_w_i;
+            if (gyro_out) gyro_out[i0 + l] = vel.tail<3>();
+            if (accel_out) {
+              accel_out[i0 + l] = accelMeasurement(T_w_i, vel, accel);
+            }
+          }
+        });
+  }
+
+  void evaluate(int64_t time_ns, Sophus::SE3d* pose_out,
+                Eigen::Vector3d* gyro_out = nullptr,
+                Eigen::Vector3d* accel_out = nullptr) const {
+    int64_t st_ns = (time_ns - start_t_ns);
+
+    BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns " << time_ns
+                                              << " start_t_ns " << start_t_ns);
+
+    int64_t s = st_ns / dt_ns;
+    double u = double(st_ns % dt_ns) / double(dt_ns);
+
+    const Sophus::Vector6d* deltas =
+        use_knot_delta_cache ? knot_delta_cache.get(knots) : nullptr;
+
+    evaluateSegment(s, u, deltas, pose_out, gyro_out, accel_out,
+                    coeff_table.find(st_ns % dt_ns));
+  }
+
+  /// Evaluate segment s at u. With knot differences the blending
+  /// coefficients are taken from coeffs if it is not nullptr.
+  void evaluateSegment(int64_t s, double u, const Sophus::Vector6d* deltas,
+                       Sophus::SE3d* pose_out, Eigen::Vector3d* gyro_out,
+                       Eigen::Vector3d* accel_out,
+                       const SplineCoeffs<N>* coeffs = nullptr) const {
+    BASALT_ASSERT_STREAM(s >= 0, "s " << s);
+    BASALT_ASSERT_STREAM(size_t(s + N) <= knots.size(), "s " << s << " N " << N
+                                                             << " knots.size() "
+                                                             << knots.size());
+
+    Sophus::SE3d pose;
+    Sophus::Vector6d se3_vel, se3_accel;
+
+    Sophus::Vector6d* vel_ptr = (gyro_out || accel_out) ? &se3_vel : nullptr;
+    Sophus::Vector6d* accel_ptr = accel_out ? &se3_accel : nullptr;
+
+    if (deltas && coeffs) {
+      CeresSplineHelperDelta<N>::template evaluate_lie<double, Sophus::SE3>(
+          knots[s].data(), deltas + s, *coeffs, &pose, vel_ptr, accel_ptr);
+    } else if (deltas) {
+      CeresSplineHelperDelta<N>::template evaluate_lie<double, Sophus::SE3>(
+          knots[s].data(), deltas + s, u, inv_dt, &pose, vel_ptr, accel_ptr);
+    } else {
+      std::array<const double*, N> vec;
+      for (int i = 0; i < N; i++) {
+        vec[i] = knots[s + i].data();
+      }
+
+      CeresSplineHelper<N>::template evaluate_lie<double, Sophus::SE3>(
+          vec.data(), u, inv_dt, &pose, vel_ptr, accel_ptr);
+    }
+
+    if (pose_out) *pose_out = pose;
+    if (gyro_out) *gyro_out = se3_vel.tail<3>();
+
+    if (accel_out) *accel_out = accelMeasurement(pose, se3_vel, se3_accel);
+  }
+
+  Eigen::Vector3d accelMeasurement(const Sophus::SE3d& pose,
+                                   const Sophus::Vector6d& se3_vel,
+                                   const Sophus::Vector6d& se3_accel) const {
+    return CeresSplineHelperGroup<N>::linear_accel_body(se3_vel, se3_accel) +
+           pose.so3().inverse() * g;
+  }
+
   int64_t dt_ns, start_t_ns;
   double inv_dt;
 
+  /// Blending coefficients of the IMU measurement times, see
+  /// SplineCoeffTable.
+  SplineCoeffTable<N> coeff_table;
+
   Eigen::aligned_vector<Sophus::SE3d> knots;
   Eigen::Vector3d g, accel_bias, gyro_bias;
   basalt::Calibration<double> calib;
 
   std::shared_ptr<basalt::AprilGrid> aprilgrid;
 
+  bool use_knot_delta_cache = false;
+  bool use_float_queries = false;
+  mutable KnotDeltaCache<Sophus::SE3d> knot_delta_cache;
+
+  bool batch_segments = false;
+  SegmentBatches<GyroBatch> gyro_batches;
+  SegmentBatches<AccelBatch> accel_batches;
+  SegmentBatches<ImuBatch> imu_batches;
+
+  const bool use_knot_delta_callback;
+  KnotDeltaCallback<Sophus::SE3d> knot_delta_callback;
+
   ceres::Problem problem;
 };
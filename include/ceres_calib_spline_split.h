@@ -7,19 +7,57 @@
 
 #include <ceres/ceres.h>
 #include <ceres_calib_split_residuals.h>
-
-template <int _N, bool OLD_TIME_DERIV = false>
+#include <ceres_cost_function_helper.h>
+#include <ceres_knot_delta_callback.h>
+#include <ceres_segment_batch.h>
+#include <ceres_spline_batch.h>
+#include <ceres_spline_file.h>
+#include <ceres_spline_helper_delta.h>
+#include <ceres_spline_subdivision.h>
+
+#include <array>
+#include <utility>
+#include <vector>
+
+/// @brief Split SO(3) and R^3 calibration spline fitted with Ceres.
+///
+/// OLD_TIME_DERIV selects the time derivative formulation of
+/// CeresSplineHelperOld for the IMU residuals. ANALYTIC_JACOBIAN replaces
+/// the autodiff gyroscope, accelerometer and reprojection residuals by cost
+/// functions with hand-derived Jacobians.
+template <int _N, bool OLD_TIME_DERIV = false,
+          bool ANALYTIC_JACOBIAN = false>
 class CeresCalibrationSplineSplit {
  public:
   static constexpr int N = _N;        // Order of the spline.
   static constexpr int DEG = _N - 1;  // Degree of the spline.
 
+  static_assert(!(OLD_TIME_DERIV && ANALYTIC_JACOBIAN),
+                "Analytic Jacobians use the new time derivatives.");
+
   static constexpr double ns_to_s = 1e-9;  ///< Nanosecond to second conversion
   static constexpr double s_to_ns = 1e9;   ///< Second to nanosecond conversion
 
+  /// @param[in] time_interval_ns knot spacing
+  /// @param[in] start_time_ns start time of the spline
+  /// @param[in] enable_knot_delta_callback compute the rotation knot
+  /// differences once per evaluation point for all residuals. The analytic
+  /// residuals then read the differences and the time independent parts of
+  /// their Jacobians from a KnotDeltaCallback of the problem, which computes
+  /// them for all knots before each evaluation, instead of once per
+  /// residual. Only affects residuals with ANALYTIC_JACOBIAN, the autodiff
+  /// residuals need the differences as jets. Without it the problem has no
+  /// evaluation callback and none of its overhead.
   CeresCalibrationSplineSplit(int64_t time_interval_ns,
-                              int64_t start_time_ns = 0)
-      : dt_ns(time_interval_ns), start_t_ns(start_time_ns) {
+                              int64_t start_time_ns = 0,
+                              bool enable_knot_delta_callback = false)
+      : dt_ns(time_interval_ns),
+        start_t_ns(start_time_ns),
+        coeff_table(time_interval_ns),
+        use_knot_delta_callback(enable_knot_delta_callback),
+        knot_delta_callback(so3_knots),
+        problem(problemOptions(
+            use_knot_delta_callback ? &knot_delta_callback : nullptr)) {
     inv_dt = s_to_ns / dt_ns;
 
     accel_bias.setZero();
@@ -27,50 +65,128 @@ class CeresCalibrationSplineSplit {
   };
 
   Sophus::SE3d getPose(int64_t time_ns) const {
-    int64_t st_ns = (time_ns - start_t_ns);
+    Sophus::SE3d res;
+    evaluate(time_ns, &res);
+    return res;
+  }
 
-    BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns " << time_ns
-                                              << " start_t_ns " << start_t_ns);
+  Eigen::Vector3d getGyro(int64_t time_ns) const {
+    Eigen::Vector3d gyro;
+    evaluate(time_ns, nullptr, &gyro);
+    return gyro;
+  }
 
-    int64_t s = st_ns / dt_ns;
-    double u = double(st_ns % dt_ns) / double(dt_ns);
+  Eigen::Vector3d getAccel(int64_t time_ns) const {
+    Eigen::Vector3d accel;
+    evaluate(time_ns, nullptr, nullptr, &accel);
+    return accel;
+  }
 
-    BASALT_ASSERT_STREAM(s >= 0, "s " << s);
-    BASALT_ASSERT_STREAM(
-        size_t(s + N) <= so3_knots.size(),
-        "s " << s << " N " << N << " knots.size() " << so3_knots.size());
+  /// @brief Evaluate pose and IMU measurements at many timestamps at once.
+  ///
+  /// The rotation spline is evaluated once per timestamp for all requested
+  /// outputs, with CeresSplineHelperSimd on groups of timestamps if the knot
+  /// delta cache or float queries are enabled. Outputs that are nullptr are
+  /// skipped, the others must have room for num_times elements.
+  ///
+  /// @param[in] times_ns timestamps sorted in ascending order
+  /// @param[in] num_times number of timestamps
+  /// @param[out] pose_out if not nullptr poses T_w_i
+  /// @param[out] gyro_out if not nullptr rotational velocities in body frame
+  /// @param[out] accel_out if not nullptr accelerometer measurements
+  void evaluateBatch(const int64_t* times_ns, size_t num_times,
+                     Sophus::SE3d* pose_out,
+                     Eigen::Vector3d* gyro_out = nullptr,
+                     Eigen::Vector3d* accel_out = nullptr) const {
+    if (use_float_queries) {
+      evaluateBatchSimd<float>(times_ns, num_times, pose_out, gyro_out,
+                               accel_out);
+      return;
+    }
+    if (use_knot_delta_cache) {
+      evaluateBatchSimd<double>(times_ns, num_times, pose_out, gyro_out,
+                                accel_out);
+      return;
+    }
 
-    Sophus::SE3d res;
+    forEachSortedTime(times_ns, num_times, start_t_ns, dt_ns,
+                      [&](size_t i, int64_t s, double u) {
+                        evaluateSegment(s, u, nullptr,
+                                        pose_out ? &pose_out[i] : nullptr,
+                                        gyro_out ? &gyro_out[i] : nullptr,
+                                        accel_out ? &accel_out[i] : nullptr);
+                      });
+  }
 
-    Sophus::SO3d rot;
-    Eigen::Vector3d trans;
+  void init(const Sophus::SE3d& init, int num_knots) {
+    so3_knots = Eigen::aligned_vector<Sophus::SO3d>(num_knots, init.so3());
+    trans_knots =
+        Eigen::aligned_vector<Eigen::Vector3d>(num_knots, init.translation());
+    knot_delta_cache.invalidate();
 
-    {
-      std::vector<const double*> vec;
-      for (int i = 0; i < N; i++) {
-        vec.emplace_back(so3_knots[s + i].data());
-      }
+    // Add local parametrization for SO(3) rotation
 
-      CeresSplineHelper<N>::template evaluate_lie<double, Sophus::SO3>(
-          &vec[0], u, inv_dt, &rot);
+    for (int i = 0; i < num_knots; i++) {
+      ceres::LocalParameterization* local_parameterization =
+          new LieLocalParameterization<Sophus::SO3d>();
+
+      problem.AddParameterBlock(so3_knots[i].data(),
+                                Sophus::SO3d::num_parameters,
+                                local_parameterization);
     }
 
-    {
-      std::vector<const double*> vec;
-      for (int i = 0; i < N; i++) {
-        vec.emplace_back(trans_knots[s + i].data());
-      }
+    // Local parametrization of T_i_c
+    for (size_t i = 0; i < calib.T_i_c.size(); i++) {
+      ceres::LocalParameterization* local_parameterization =
+          new LieLocalParameterization<Sophus::SE3d>();
+
+      problem.AddParameterBlock(calib.T_i_c[i].data(),
+                                Sophus::SE3d::num_parameters,
+                                local_parameterization);
+    }
+  }
+
+  /// @brief Initialize with the refined knots of a coarse spline.
+  ///
+  /// The spline must be constructed with half the knot spacing of coarse and
+  /// the same start time. The translation knots are refined exactly and the
+  /// rotation knots with CeresSplineSubdivision::subdivideLie. Gravity,
+  /// biases, calibration and the aprilgrid are copied from coarse.
+  void initSubdivided(const CeresCalibrationSplineSplit& coarse) {
+    BASALT_ASSERT_STREAM(
+        2 * dt_ns == coarse.dt_ns && start_t_ns == coarse.start_t_ns,
+        "dt_ns " << dt_ns << " coarse.dt_ns " << coarse.dt_ns);
 
-      CeresSplineHelper<N>::template evaluate<double, 3, 0>(&vec[0], u, inv_dt,
-                                                            &trans);
+    so3_knots = CeresSplineSubdivision<N>::subdivideLie(coarse.so3_knots);
+    trans_knots = CeresSplineSubdivision<N>::subdivide(coarse.trans_knots);
+    knot_delta_cache.invalidate();
+
+    g = coarse.g;
+    accel_bias = coarse.accel_bias;
+    gyro_bias = coarse.gyro_bias;
+    calib = coarse.calib;
+    aprilgrid = coarse.aprilgrid;
+
+    for (size_t i = 0; i < so3_knots.size(); i++) {
+      ceres::LocalParameterization* local_parameterization =
+          new LieLocalParameterization<Sophus::SO3d>();
+
+      problem.AddParameterBlock(so3_knots[i].data(),
+                                Sophus::SO3d::num_parameters,
+                                local_parameterization);
     }
 
-    res = Sophus::SE3d(rot, trans);
+    for (size_t i = 0; i < calib.T_i_c.size(); i++) {
+      ceres::LocalParameterization* local_parameterization =
+          new LieLocalParameterization<Sophus::SE3d>();
 
-    return res;
+      problem.AddParameterBlock(calib.T_i_c[i].data(),
+                                Sophus::SE3d::num_parameters,
+                                local_parameterization);
+    }
   }
 
-  Eigen::Vector3d getGyro(int64_t time_ns) const {
+  void addGyroMeasurement(const Eigen::Vector3d& meas, int64_t time_ns) {
     int64_t st_ns = (time_ns - start_t_ns);
 
     BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns " << time_ns
@@ -84,20 +200,33 @@ class CeresCalibrationSplineSplit {
         size_t(s + N) <= so3_knots.size(),
         "s " << s << " N " << N << " knots.size() " << so3_knots.size());
 
-    Eigen::Vector3d gyro;
+    const double inv_std = 1.0 / calib.dicrete_time_gyro_noise_std()[0];
+    const SplineCoeffs<N>* coeffs = coeff_table.row(st_ns % dt_ns);
 
-    std::vector<const double*> vec;
-    for (int i = 0; i < N; i++) {
-      vec.emplace_back(so3_knots[s + i].data());
+    if (batch_segments) {
+      if constexpr (ANALYTIC_JACOBIAN) {
+        gyro_batches.get(s).add(withKnotDeltas(
+            new GyroCostFunction(meas, u, inv_dt, inv_std, coeffs), s));
+      } else {
+        gyro_batches.get(s).add(GyroFunctor(meas, u, inv_dt, inv_std, coeffs));
+      }
+      return;
     }
 
-    CeresSplineHelper<N>::template evaluate_lie<double, Sophus::SO3>(
-        &vec[0], u, inv_dt, nullptr, &gyro);
+    ceres::CostFunction* cost_function;
 
-    return gyro;
+    if constexpr (ANALYTIC_JACOBIAN) {
+      cost_function = withKnotDeltas(
+          new GyroCostFunction(meas, u, inv_dt, inv_std, coeffs), s);
+    } else {
+      cost_function = newAutoDiffCostFunction<3>(
+          new GyroFunctor(meas, u, inv_dt, inv_std, coeffs), GyroBlockSizes());
+    }
+
+    problem.AddResidualBlock(cost_function, NULL, gyroParameterBlocks(s));
   }
 
-  Eigen::Vector3d getAccel(int64_t time_ns) const {
+  void addAccelMeasurement(const Eigen::Vector3d& meas, int64_t time_ns) {
     int64_t st_ns = (time_ns - start_t_ns);
 
     BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns " << time_ns
@@ -111,64 +240,46 @@ class CeresCalibrationSplineSplit {
         size_t(s + N) <= so3_knots.size(),
         "s " << s << " N " << N << " knots.size() " << so3_knots.size());
 
-    Eigen::Vector3d accel;
-
-    Sophus::SO3d rot;
-    Eigen::Vector3d trans_accel_world;
+    const double inv_std = 1.0 / calib.dicrete_time_accel_noise_std()[0];
+    const SplineCoeffs<N>* coeffs = coeff_table.row(st_ns % dt_ns);
 
-    {
-      std::vector<const double*> vec;
-      for (int i = 0; i < N; i++) {
-        vec.emplace_back(so3_knots[s + i].data());
+    if (batch_segments) {
+      if constexpr (ANALYTIC_JACOBIAN) {
+        accel_batches.get(s).add(withKnotDeltas(
+            new AccelCostFunction(meas, u, inv_dt, inv_std, coeffs), s));
+      } else {
+        accel_batches.get(s).add(
+            AccelFunctor(meas, u, inv_dt, inv_std, coeffs));
       }
-
-      CeresSplineHelper<N>::template evaluate_lie<double, Sophus::SO3>(
-          &vec[0], u, inv_dt, &rot);
+      return;
     }
 
-    {
-      std::vector<const double*> vec;
-      for (int i = 0; i < N; i++) {
-        vec.emplace_back(trans_knots[s + i].data());
-      }
+    ceres::CostFunction* cost_function;
 
-      CeresSplineHelper<N>::template evaluate<double, 3, 2>(&vec[0], u, inv_dt,
-                                                            &trans_accel_world);
+    if constexpr (ANALYTIC_JACOBIAN) {
+      cost_function = withKnotDeltas(
+          new AccelCostFunction(meas, u, inv_dt, inv_std, coeffs), s);
+    } else {
+      cost_function = newAutoDiffCostFunction<3>(
+          new AccelFunctor(meas, u, inv_dt, inv_std, coeffs),
+          AccelBlockSizes());
     }
 
-    accel = rot.inverse() * (trans_accel_world + g);
-
-    return accel;
+    problem.AddResidualBlock(cost_function, NULL, accelParameterBlocks(s));
   }
 
-  void init(const Sophus::SE3d& init, int num_knots) {
-    so3_knots = Eigen::aligned_vector<Sophus::SO3d>(num_knots, init.so3());
-    trans_knots =
-        Eigen::aligned_vector<Eigen::Vector3d>(num_knots, init.translation());
-
-    // Add local parametrization for SO(3) rotation
-
-    for (int i = 0; i < num_knots; i++) {
-      ceres::LocalParameterization* local_parameterization =
-          new LieLocalParameterization<Sophus::SO3d>();
-
-      problem.AddParameterBlock(so3_knots[i].data(),
-                                Sophus::SO3d::num_parameters,
-                                local_parameterization);
+  /// @brief Add a gyroscope and an accelerometer sample with the same
+  /// timestamp as one residual, which evaluates the rotation of the spline
+  /// once for both. With OLD_TIME_DERIV the samples are added as separate
+  /// residuals.
+  void addImuMeasurement(const Eigen::Vector3d& gyro_meas,
+                         const Eigen::Vector3d& accel_meas, int64_t time_ns) {
+    if constexpr (OLD_TIME_DERIV) {
+      addGyroMeasurement(gyro_meas, time_ns);
+      addAccelMeasurement(accel_meas, time_ns);
+      return;
     }
 
-    // Local parametrization of T_i_c
-    for (size_t i = 0; i < calib.T_i_c.size(); i++) {
-      ceres::LocalParameterization* local_parameterization =
-          new LieLocalParameterization<Sophus::SE3d>();
-
-      problem.AddParameterBlock(calib.T_i_c[i].data(),
-                                Sophus::SE3d::num_parameters,
-                                local_parameterization);
-    }
-  }
-
-  void addGyroMeasurement(const Eigen::Vector3d& meas, int64_t time_ns) {
     int64_t st_ns = (time_ns - start_t_ns);
 
     BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns " << time_ns
@@ -182,30 +293,43 @@ class CeresCalibrationSplineSplit {
         size_t(s + N) <= so3_knots.size(),
         "s " << s << " N " << N << " knots.size() " << so3_knots.size());
 
-    using FunctorT = CalibGyroCostFunctorSplit<N, Sophus::SO3, OLD_TIME_DERIV>;
-
-    FunctorT* functor = new FunctorT(
-        meas, u, inv_dt, 1.0 / calib.dicrete_time_gyro_noise_std()[0]);
-
-    ceres::DynamicAutoDiffCostFunction<FunctorT>* cost_function =
-        new ceres::DynamicAutoDiffCostFunction<FunctorT>(functor);
-
-    for (int i = 0; i < N; i++) {
-      cost_function->AddParameterBlock(4);
+    const double gyro_inv_std = 1.0 / calib.dicrete_time_gyro_noise_std()[0];
+    const double accel_inv_std = 1.0 / calib.dicrete_time_accel_noise_std()[0];
+    const SplineCoeffs<N>* coeffs = coeff_table.row(st_ns % dt_ns);
+
+    if (batch_segments) {
+      if constexpr (ANALYTIC_JACOBIAN) {
+        imu_batches.get(s).add(withKnotDeltas(
+            new ImuCostFunction(gyro_meas, accel_meas, u, inv_dt,
+                                gyro_inv_std, accel_inv_std, coeffs),
+            s));
+      } else {
+        imu_batches.get(s).add(ImuFunctor(gyro_meas, accel_meas, u, inv_dt,
+                                          gyro_inv_std, accel_inv_std,
+                                          coeffs));
+      }
+      return;
     }
-    cost_function->AddParameterBlock(3);
-    cost_function->SetNumResiduals(3);
 
-    std::vector<double*> vec;
-    for (int i = 0; i < N; i++) {
-      vec.emplace_back(so3_knots[s + i].data());
+    ceres::CostFunction* cost_function;
+
+    if constexpr (ANALYTIC_JACOBIAN) {
+      cost_function = withKnotDeltas(
+          new ImuCostFunction(gyro_meas, accel_meas, u, inv_dt, gyro_inv_std,
+                              accel_inv_std, coeffs),
+          s);
+    } else {
+      cost_function = newAutoDiffCostFunction<6>(
+          new ImuFunctor(gyro_meas, accel_meas, u, inv_dt, gyro_inv_std,
+                         accel_inv_std, coeffs),
+          ImuBlockSizes());
     }
-    vec.emplace_back(gyro_bias.data());
 
-    problem.AddResidualBlock(cost_function, NULL, vec);
+    problem.AddResidualBlock(cost_function, NULL, imuParameterBlocks(s));
   }
 
-  void addAccelMeasurement(const Eigen::Vector3d& meas, int64_t time_ns) {
+  void addCornersMeasurement(const basalt::CalibCornerData* corners, int cam_id,
+                             int64_t time_ns) {
     int64_t st_ns = (time_ns - start_t_ns);
 
     BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns " << time_ns
@@ -219,24 +343,32 @@ class CeresCalibrationSplineSplit {
         size_t(s + N) <= so3_knots.size(),
         "s " << s << " N " << N << " knots.size() " << so3_knots.size());
 
-    using FunctorT = CalibAccelerationCostFunctorSplit<N>;
-
-    FunctorT* functor = new FunctorT(
-        meas, u, inv_dt, 1.0 / calib.dicrete_time_accel_noise_std()[0]);
-
-    ceres::DynamicAutoDiffCostFunction<FunctorT>* cost_function =
-        new ceres::DynamicAutoDiffCostFunction<FunctorT>(functor);
-
-    for (int i = 0; i < N; i++) {
-      cost_function->AddParameterBlock(4);
-    }
-    for (int i = 0; i < N; i++) {
-      cost_function->AddParameterBlock(3);
-    }
-    cost_function->AddParameterBlock(3);
-    cost_function->AddParameterBlock(3);
-    cost_function->SetNumResiduals(3);
+    // The number of residuals depends on the number of detected corners,
+    // parameter blocks are the knots and T_i_c. The residual is instantiated
+    // for the camera model, so evaluations don't dispatch on it.
+    ceres::CostFunction* cost_function = visitCamera(
+        calib.intrinsics[cam_id],
+        [&](const auto& cam) -> ceres::CostFunction* {
+          using CamT = std::decay_t<decltype(cam)>;
+
+          if constexpr (ANALYTIC_JACOBIAN) {
+            return withKnotDeltas(
+                new CalibReprojectionAnalyticCostFunctionSplit<N, CamT>(
+                    corners, aprilgrid.get(), cam, u, inv_dt),
+                s);
+          } else {
+            using FunctorT = CalibReprojectionCostFunctorSplit<N, CamT>;
+
+            FunctorT* functor =
+                new FunctorT(corners, aprilgrid.get(), cam, u, inv_dt);
+
+            return newAutoDiffCostFunction<ceres::DYNAMIC>(
+                functor, ReprojectionBlockSizes(),
+                corners->corner_ids.size() * 2);
+          }
+        });
 
+    // Sophus .data() returns a pointer
     std::vector<double*> vec;
     for (int i = 0; i < N; i++) {
       vec.emplace_back(so3_knots[s + i].data());
@@ -244,14 +376,45 @@ class CeresCalibrationSplineSplit {
     for (int i = 0; i < N; i++) {
       vec.emplace_back(trans_knots[s + i].data());
     }
-    vec.emplace_back(g.data());
-    vec.emplace_back(accel_bias.data());
+    vec.emplace_back(calib.T_i_c[cam_id].data());
 
     problem.AddResidualBlock(cost_function, NULL, vec);
+
+    //    {
+    //      Eigen::VectorXd residual;
+    //      residual.setZero(corners->corner_ids.size() * 2);
+
+    //      cost_function->Evaluate(&vec[0], residual.data(), NULL);
+    //      std::cerr << "residual " << residual.transpose() << std::endl;
+    //    }
   }
+  /// @brief Add the corners of all cameras observed at time_ns.
+  ///
+  /// With ANALYTIC_JACOBIAN this adds one residual for all cameras, which
+  /// evaluates the pose of the frame once and projects into each camera with
+  /// its own T_i_c. It is instantiated for the camera model if all cameras
+  /// share it, otherwise it dispatches once per camera and evaluation. The
+  /// rows of a camera are structural zeros in the T_i_c blocks of the
+  /// others, which the linear solver pays for, so this only pays off if the
+  /// pose is expensive compared to the projection of the corners. The
+  /// autodiff residuals evaluate the pose once per jet chunk anyway, so
+  /// without ANALYTIC_JACOBIAN one residual per camera is added as with
+  /// addCornersMeasurement.
+  ///
+  /// @param[in] cam_corners camera index and corners of every camera
+  void addSyncCornersMeasurement(
+      const std::vector<std::pair<int, const basalt::CalibCornerData*>>&
+          cam_corners,
+      int64_t time_ns) {
+    if constexpr (!ANALYTIC_JACOBIAN) {
+      for (const auto& [cam_id, corners] : cam_corners) {
+        addCornersMeasurement(corners, cam_id, time_ns);
+      }
+      return;
+    }
+
+    if (cam_corners.empty()) return;
 
-  void addCornersMeasurement(const basalt::CalibCornerData* corners, int cam_id,
-                             int64_t time_ns) {
     int64_t st_ns = (time_ns - start_t_ns);
 
     BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns " << time_ns
@@ -265,28 +428,32 @@ class CeresCalibrationSplineSplit {
         size_t(s + N) <= so3_knots.size(),
         "s " << s << " N " << N << " knots.size() " << so3_knots.size());
 
-    using FunctorT = CalibReprojectionCostFunctorSplit<N>;
+    auto make_cost_function = [&](const auto& cam) -> ceres::CostFunction* {
+      using CamT = std::decay_t<decltype(cam)>;
 
-    // compute the residual
-    FunctorT* functor = new FunctorT(corners, aprilgrid.get(),
-                                     calib.intrinsics[cam_id], u, inv_dt);
+      auto* cost_function = new CalibReprojectionAnalyticCostFunctionSplit<
+          N, CamT>(cam_corners[0].second, aprilgrid.get(), cam, u, inv_dt);
+      for (size_t c = 1; c < cam_corners.size(); c++) {
+        cost_function->addCamera(
+            cam_corners[c].second, aprilgrid.get(),
+            cameraAs<CamT>(calib.intrinsics[cam_corners[c].first]));
+      }
+      return withKnotDeltas(cost_function, s);
+    };
 
-    ceres::DynamicAutoDiffCostFunction<FunctorT>* cost_function =
-        new ceres::DynamicAutoDiffCostFunction<FunctorT>(functor);
+    const basalt::GenericCamera<double>& cam0 =
+        calib.intrinsics[cam_corners[0].first];
 
-    // allocate the memory
-    for (int i = 0; i < N; i++) {
-      cost_function->AddParameterBlock(4);
-    }
-    for (int i = 0; i < N; i++) {
-      cost_function->AddParameterBlock(3);
+    bool same_model = true;
+    for (const auto& [cam_id, corners] : cam_corners) {
+      same_model &=
+          calib.intrinsics[cam_id].variant.index() == cam0.variant.index();
     }
-    // T_i_c
-    cost_function->AddParameterBlock(7);
 
-    cost_function->SetNumResiduals(corners->corner_ids.size() * 2);
+    ceres::CostFunction* cost_function =
+        same_model ? visitCamera(cam0, make_cost_function)
+                   : make_cost_function(cam0);
 
-    // Sophus .data() returns a pointer
     std::vector<double*> vec;
     for (int i = 0; i < N; i++) {
       vec.emplace_back(so3_knots[s + i].data());
@@ -294,19 +461,14 @@ class CeresCalibrationSplineSplit {
     for (int i = 0; i < N; i++) {
       vec.emplace_back(trans_knots[s + i].data());
     }
-    vec.emplace_back(calib.T_i_c[cam_id].data());
+    for (const auto& [cam_id, corners] : cam_corners) {
+      vec.emplace_back(calib.T_i_c[cam_id].data());
+    }
 
     problem.AddResidualBlock(cost_function, NULL, vec);
-
-    //    {
-    //      Eigen::VectorXd residual;
-    //      residual.setZero(corners->corner_ids.size() * 2);
-
-    //      cost_function->Evaluate(&vec[0], residual.data(), NULL);
-    //      std::cerr << "residual " << residual.transpose() << std::endl;
-    //    }
   }
 
+
   int64_t maxTimeNs() const {
     return start_t_ns + (so3_knots.size() - N + 1) * dt_ns - 1;
   }
@@ -324,62 +486,32 @@ class CeresCalibrationSplineSplit {
 
       if (time_ns < minTimeNs() || time_ns >= maxTimeNs()) continue;
 
-      int64_t st_ns = (time_ns - start_t_ns);
-
-      BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns "
-                                                << time_ns << " start_t_ns "
-                                                << start_t_ns);
-
-      int64_t s = st_ns / dt_ns;
-      double u = double(st_ns % dt_ns) / double(dt_ns);
+      Sophus::SE3d T_c_w =
+          (getPose(time_ns) * calib.T_i_c[kv.first.cam_id]).inverse();
 
-      BASALT_ASSERT_STREAM(s >= 0, "s " << s);
-      BASALT_ASSERT_STREAM(
-          size_t(s + N) <= so3_knots.size(),
-          "s " << s << " N " << N << " knots.size() " << so3_knots.size());
+      const basalt::CalibCornerData& cd = kv.second;
 
-      using FunctorT = CalibReprojectionCostFunctorSplit<N>;
-
-      FunctorT* functor =
-          new FunctorT(&kv.second, aprilgrid.get(),
-                       calib.intrinsics[kv.first.cam_id], u, inv_dt);
-
-      ceres::DynamicAutoDiffCostFunction<FunctorT>* cost_function =
-          new ceres::DynamicAutoDiffCostFunction<FunctorT>(functor);
-
-      for (int i = 0; i < N; i++) {
-        cost_function->AddParameterBlock(4);
-      }
-      for (int i = 0; i < N; i++) {
-        cost_function->AddParameterBlock(3);
-      }
-      // T_i_c
-      cost_function->AddParameterBlock(7);
-
-      cost_function->SetNumResiduals(kv.second.corner_ids.size() * 2);
-
-      std::vector<const double*> vec;
-      for (int i = 0; i < N; i++) {
-        vec.emplace_back(so3_knots[s + i].data());
-      }
-      for (int i = 0; i < N; i++) {
-        vec.emplace_back(trans_knots[s + i].data());
+      basalt::PointsSoA<double, 3> p_w(cd.corner_ids.size(), 3);
+      for (size_t i = 0; i < cd.corner_ids.size(); i++) {
+        p_w.row(i) = aprilgrid->aprilgrid_corner_pos_3d[cd.corner_ids[i]]
+                         .head<3>()
+                         .transpose();
       }
-      vec.emplace_back(calib.T_i_c[kv.first.cam_id].data());
 
-      {
-        Eigen::VectorXd residual;
-        residual.setZero(kv.second.corner_ids.size() * 2);
+      basalt::PointsSoA<double, 2> proj;
+      basalt::ValidSoA valid;
+      calib.intrinsics[kv.first.cam_id].projectBatch(
+          transformPoints(T_c_w, p_w), proj, valid);
 
-        cost_function->Evaluate(&vec[0], residual.data(), NULL);
+      for (size_t i = 0; i < cd.corner_ids.size(); i++) {
+        if (!valid[i]) continue;
 
-        for (size_t i = 0; i < kv.second.corner_ids.size(); i++) {
-          Eigen::Vector2d res_point = residual.segment<2>(2 * i);
+        Eigen::Vector2d res_point =
+            proj.row(i).matrix().transpose() - cd.corners[i];
 
-          if (res_point[0] != 0.0 && res_point[1] != 0.0) {
-            sum_error += res_point.norm();// thas wht it is called meanReprojection
-            num_points += 1;
-          }
+        if (res_point[0] != 0.0 && res_point[1] != 0.0) {
+          sum_error += res_point.norm();
+          num_points += 1;
         }
       }
     }
@@ -391,6 +523,8 @@ class CeresCalibrationSplineSplit {
   }
 
   ceres::Solver::Summary optimize() {
+    addSegmentBatches();
+
     ceres::Solver::Options options;
     options.linear_solver_type = ceres::SPARSE_NORMAL_CHOLESKY;
     options.max_num_iterations = 50;
@@ -401,6 +535,8 @@ class CeresCalibrationSplineSplit {
     Solve(options, &problem, &summary);
     std::cout << summary.FullReport() << std::endl;
 
+    knot_delta_cache.invalidate();
+
     return summary;
   }
 
@@ -408,6 +544,14 @@ class CeresCalibrationSplineSplit {
     return Sophus::SE3d(so3_knots[i], trans_knots[i]);
   }
 
+  /// Set knot i. Invalidates the knot delta cache and the float knots
+  /// after writing it, so later queries see the new knot.
+  void setKnot(int i, const Sophus::SE3d& knot) {
+    so3_knots[i] = knot.so3();
+    trans_knots[i] = knot.translation();
+    knot_delta_cache.invalidate();
+  }
+
   size_t numKnots() { return so3_knots.size(); }
 
   void setAprilgrid(std::shared_ptr<basalt::AprilGrid>& a) { aprilgrid = a; }
@@ -422,10 +566,298 @@ class CeresCalibrationSplineSplit {
   Eigen::Vector3d getGyroBias() { return gyro_bias; }
   Eigen::Vector3d getAccelBias() { return accel_bias; }
 
+  /// @brief Write the knots, the calibration, gravity and the IMU biases to
+  /// a spline file, see MappedSpline.
+  bool save(const std::string& path) const {
+    SplineFileCalib file_calib;
+    file_calib.calib = calib;
+    file_calib.g = g;
+    file_calib.accel_bias = accel_bias;
+    file_calib.gyro_bias = gyro_bias;
+
+    return writeSplineFile(
+        path, SplineFileGroup::SPLIT, N, start_t_ns, dt_ns, so3_knots.size(),
+        [&](size_t i, double* params) {
+          Eigen::Map<Sophus::SO3d>{params} = so3_knots[i];
+          Eigen::Map<Eigen::Vector3d>{params + 4} = trans_knots[i];
+        },
+        &file_calib);
+  }
+
+  /// @brief Cache the rotation knot differences log(R_i^{-1} * R_{i+1}).
+  ///
+  /// With the cache enabled getPose, getGyro, getAccel, evaluateBatch and
+  /// meanReprojection reuse the differences instead of recomputing DEG log
+  /// maps per query. The cache is invalidated by init(), optimize() and
+  /// setKnot. Residuals are not affected.
+  void setKnotDeltaCache(bool enable) {
+    use_knot_delta_cache = enable;
+    knot_delta_cache.invalidate();
+  }
+
+  /// @brief Collect the IMU measurements per knot segment.
+  ///
+  /// With batching enabled optimize() adds one residual block per segment for
+  /// each of the gyro, accel and combined IMU measurements in it, which
+  /// share the rotation knot differences. Affects measurements added after
+  /// the call.
+  void setSegmentBatching(bool enable) { batch_segments = enable; }
+
+  /// @brief Evaluate the rotation in evaluateBatch from a float copy of the
+  /// knots.
+  ///
+  /// The float structure-of-arrays store is rebuilt from the double knots on
+  /// the first query after optimize() or setKnot and evaluated with the
+  /// float kernels of CeresSplineHelperSimd. The translation, optimization
+  /// and the single time queries stay in double.
+  void setFloatQueries(bool enable) { use_float_queries = enable; }
+
  private:
+  using GyroFunctor = CalibGyroCostFunctorSplit<N, Sophus::SO3, OLD_TIME_DERIV>;
+  using AccelFunctor = CalibAccelerationCostFunctorSplit<N>;
+  using GyroCostFunction = CalibGyroAnalyticCostFunctionSplit<N>;
+  using AccelCostFunction = CalibAccelerationAnalyticCostFunctionSplit<N>;
+  using ImuFunctor = CalibImuCostFunctorSplit<N>;
+  using ImuCostFunction = CalibImuAnalyticCostFunctionSplit<N>;
+
+  /// Parameter blocks of the N rotation and translation knots of a segment.
+  using So3KnotBlockSizes = RepeatedBlockSizes<N, Sophus::SO3d::num_parameters>;
+  using TransKnotBlockSizes = RepeatedBlockSizes<N, 3>;
+  using GyroBlockSizes =
+      typename ConcatBlockSizes<So3KnotBlockSizes, BlockSizes<3>>::type;
+  using AccelBlockSizes =
+      typename ConcatBlockSizes<So3KnotBlockSizes, TransKnotBlockSizes,
+                                BlockSizes<3, 3>>::type;
+  using ImuBlockSizes =
+      typename ConcatBlockSizes<So3KnotBlockSizes, TransKnotBlockSizes,
+                                BlockSizes<3, 3, 3>>::type;
+  using ReprojectionBlockSizes =
+      typename ConcatBlockSizes<So3KnotBlockSizes, TransKnotBlockSizes,
+                                BlockSizes<7>>::type;
+
+  std::vector<double*> gyroParameterBlocks(int64_t s) {
+    std::vector<double*> vec;
+    for (int i = 0; i < N; i++) {
+      vec.emplace_back(so3_knots[s + i].data());
+    }
+    vec.emplace_back(gyro_bias.data());
+    return vec;
+  }
+
+  std::vector<double*> accelParameterBlocks(int64_t s) {
+    std::vector<double*> vec;
+    for (int i = 0; i < N; i++) {
+      vec.emplace_back(so3_knots[s + i].data());
+    }
+    for (int i = 0; i < N; i++) {
+      vec.emplace_back(trans_knots[s + i].data());
+    }
+    vec.emplace_back(g.data());
+    vec.emplace_back(accel_bias.data());
+    return vec;
+  }
+
+  /// Accelerometer blocks followed by the gyroscope bias.
+  std::vector<double*> imuParameterBlocks(int64_t s) {
+    std::vector<double*> vec = accelParameterBlocks(s);
+    vec.emplace_back(gyro_bias.data());
+    return vec;
+  }
+
+  /// IMU residuals of one segment, see setSegmentBatching.
+  template <class FunctorT, class Blocks>
+  using SegmentBatch =
+      std::conditional_t<ANALYTIC_JACOBIAN, StackedCostFunction<Blocks>,
+                         SegmentBatchCostFunctor<FunctorT>>;
+  using GyroBatch = SegmentBatch<GyroFunctor, GyroBlockSizes>;
+  using AccelBatch = SegmentBatch<AccelFunctor, AccelBlockSizes>;
+  using ImuBatch = SegmentBatch<ImuFunctor, ImuBlockSizes>;
+
+  /// Cost function of a collected batch, autodiff unless ANALYTIC_JACOBIAN.
+  template <class Blocks, class BatchT>
+  static ceres::CostFunction* batchCostFunction(BatchT* batch) {
+    if constexpr (ANALYTIC_JACOBIAN) {
+      return batch;
+    } else {
+      const int num_residuals = batch->numResiduals();
+      return newAutoDiffCostFunction<ceres::DYNAMIC>(batch, Blocks(),
+                                                     num_residuals);
+    }
+  }
+
+  /// Options of the problem with the knot delta callback, if enabled.
+  static ceres::Problem::Options problemOptions(
+      ceres::EvaluationCallback* callback) {
+    ceres::Problem::Options options;
+    options.evaluation_callback = callback;
+    return options;
+  }
+
+  /// Let the analytic residual of segment s read its knot differences from
+  /// the evaluation callback if enabled, see the constructor.
+  template <class CostFunctionT>
+  CostFunctionT* withKnotDeltas(CostFunctionT* cost_function, int64_t s) {
+    if (use_knot_delta_callback) {
+      cost_function->setKnotDeltas(knot_delta_callback.table(), s);
+    }
+    return cost_function;
+  }
+
+  /// Add the collected segment batches to the problem.
+  void addSegmentBatches() {
+    gyro_batches.release([&](int64_t s, GyroBatch* batch) {
+      problem.AddResidualBlock(batchCostFunction<GyroBlockSizes>(batch), NULL,
+                               gyroParameterBlocks(s));
+    });
+
+    accel_batches.release([&](int64_t s, AccelBatch* batch) {
+      problem.AddResidualBlock(batchCostFunction<AccelBlockSizes>(batch), NULL,
+                               accelParameterBlocks(s));
+    });
+
+    imu_batches.release([&](int64_t s, ImuBatch* batch) {
+      problem.AddResidualBlock(batchCostFunction<ImuBlockSizes>(batch), NULL,
+                               imuParameterBlocks(s));
+    });
+  }
+
+  /// evaluateBatch with the rotation from CeresSplineHelperSimd in Scalar
+  /// precision.
+  template <class Scalar>
+  void evaluateBatchSimd(const int64_t* times_ns, size_t num_times,
+                         Sophus::SE3d* pose_out, Eigen::Vector3d* gyro_out,
+                         Eigen::Vector3d* accel_out) const {
+    using Simd = CeresSplineHelperSimd<N, Scalar>;
+    using ArrD = Eigen::Array<double, Simd::Lanes, 1>;
+
+    const typename Simd::template SoA<Sophus::SO3>& soa =
+        knot_delta_cache.template getSoA<Scalar>(so3_knots);
+
+    forEachSortedTimeLanes<Simd::Lanes>(
+        times_ns, num_times, start_t_ns, dt_ns,
+        [&](size_t i0, int num_valid, const int64_t* s, const double* u) {
+          BASALT_ASSERT_STREAM(
+              size_t(s[num_valid - 1] + N) <= so3_knots.size(),
+              "s " << s[num_valid - 1] << " N " << N << " knots.size() "
+                   << so3_knots.size());
+
+          typename Simd::template ValueArr<Sophus::SO3> rot;
+          typename Simd::template TangentArr<Sophus::SO3> gyro;
+
+          Simd::template evaluate_lie<Sophus::SO3>(
+              soa, s, Eigen::Map<const ArrD>(u).template cast<Scalar>(),
+              inv_dt, &rot, gyro_out ? &gyro : nullptr);
+
+          for (int l = 0; l < num_valid; l++) {
+            Eigen::Vector4d params =
+                rot.row(l).transpose().template cast<double>();
+            if constexpr (!std::is_same<Scalar, double>::value) {
+              params.normalize();
+            }
+            Sophus::SO3d R = Eigen::Map<Sophus::SO3d const>(params.data());
+
+            if (gyro_out) {
+              gyro_out[i0 + l] =
+                  gyro.row(l).transpose().template cast<double>();
+            }
+
+            evaluateTranslation(s[l], u[l], R,
+                                pose_out ? &pose_out[i0 + l] : nullptr,
+                                accel_out ? &accel_out[i0 + l] : nullptr);
+          }
+        });
+  }
+
+  void evaluate(int64_t time_ns, Sophus::SE3d* pose_out,
+                Eigen::Vector3d* gyro_out = nullptr,
+                Eigen::Vector3d* accel_out = nullptr) const {
+    int64_t st_ns = (time_ns - start_t_ns);
+
+    BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns " << time_ns
+                                              << " start_t_ns " << start_t_ns);
+
+    int64_t s = st_ns / dt_ns;
+    double u = double(st_ns % dt_ns) / double(dt_ns);
+
+    const Sophus::Vector3d* rot_deltas =
+        use_knot_delta_cache ? knot_delta_cache.get(so3_knots) : nullptr;
+
+    evaluateSegment(s, u, rot_deltas, pose_out, gyro_out, accel_out,
+                    coeff_table.find(st_ns % dt_ns));
+  }
+
+  /// Evaluate segment s at u. The blending coefficients are taken from
+  /// coeffs if it is not nullptr, except for the rotation without knot
+  /// differences.
+  void evaluateSegment(int64_t s, double u, const Sophus::Vector3d* rot_deltas,
+                       Sophus::SE3d* pose_out, Eigen::Vector3d* gyro_out,
+                       Eigen::Vector3d* accel_out,
+                       const SplineCoeffs<N>* coeffs = nullptr) const {
+    BASALT_ASSERT_STREAM(s >= 0, "s " << s);
+    BASALT_ASSERT_STREAM(
+        size_t(s + N) <= so3_knots.size(),
+        "s " << s << " N " << N << " knots.size() " << so3_knots.size());
+
+    Sophus::SO3d rot;
+
+    if (rot_deltas && coeffs) {
+      CeresSplineHelperDelta<N>::template evaluate_lie<double, Sophus::SO3>(
+          so3_knots[s].data(), rot_deltas + s, *coeffs, &rot, gyro_out);
+    } else if (rot_deltas) {
+      CeresSplineHelperDelta<N>::template evaluate_lie<double, Sophus::SO3>(
+          so3_knots[s].data(), rot_deltas + s, u, inv_dt, &rot, gyro_out);
+    } else {
+      std::array<const double*, N> rot_vec;
+      for (int i = 0; i < N; i++) {
+        rot_vec[i] = so3_knots[s + i].data();
+      }
+
+      CeresSplineHelper<N>::template evaluate_lie<double, Sophus::SO3>(
+          rot_vec.data(), u, inv_dt, &rot, gyro_out);
+    }
+
+    evaluateTranslation(s, u, rot, pose_out, accel_out, coeffs);
+  }
+
+  void evaluateTranslation(int64_t s, double u, const Sophus::SO3d& rot,
+                           Sophus::SE3d* pose_out, Eigen::Vector3d* accel_out,
+                           const SplineCoeffs<N>* coeffs = nullptr) const {
+    std::array<const double*, N> trans_vec;
+    for (int i = 0; i < N; i++) {
+      trans_vec[i] = trans_knots[s + i].data();
+    }
+
+    if (pose_out) {
+      Eigen::Vector3d trans;
+      if (coeffs) {
+        coeffs->template evaluate<double, 3, 0>(trans_vec.data(), &trans);
+      } else {
+        CeresSplineHelper<N>::template evaluate<double, 3, 0>(
+            trans_vec.data(), u, inv_dt, &trans);
+      }
+      *pose_out = Sophus::SE3d(rot, trans);
+    }
+
+    if (accel_out) {
+      Eigen::Vector3d trans_accel_world;
+      if (coeffs) {
+        coeffs->template evaluate<double, 3, 2>(trans_vec.data(),
+                                                &trans_accel_world);
+      } else {
+        CeresSplineHelper<N>::template evaluate<double, 3, 2>(
+            trans_vec.data(), u, inv_dt, &trans_accel_world);
+      }
+      *accel_out = rot.inverse() * (trans_accel_world + g);
+    }
+  }
+
   int64_t dt_ns, start_t_ns;
   double inv_dt;
 
+  /// Blending coefficients of the IMU measurement times, see
+  /// SplineCoeffTable.
+  SplineCoeffTable<N> coeff_table;
+
   Eigen::aligned_vector<Sophus::SO3d> so3_knots;
   Eigen::aligned_vector<Eigen::Vector3d> trans_knots;
   Eigen::Vector3d g, accel_bias, gyro_bias;
@@ -433,5 +865,17 @@ class CeresCalibrationSplineSplit {
 
   std::shared_ptr<basalt::AprilGrid> aprilgrid;
 
+  bool use_knot_delta_cache = false;
+  bool use_float_queries = false;
+  mutable KnotDeltaCache<Sophus::SO3d> knot_delta_cache;
+
+  bool batch_segments = false;
+  SegmentBatches<GyroBatch> gyro_batches;
+  SegmentBatches<AccelBatch> accel_batches;
+  SegmentBatches<ImuBatch> imu_batches;
+
+  const bool use_knot_delta_callback;
+  KnotDeltaCallback<Sophus::SO3d> knot_delta_callback;
+
   ceres::Problem problem;
 };
@@ -3,11 +3,16 @@
 #include <basalt/calibration/aprilgrid.h>
 #include <basalt/calibration/calibration_helper.h>
 #include <basalt/utils/common_types.h>
+#include <ceres_calib_reprojection.h>
+#include <ceres_lie_residuals.h>
+#include <ceres_spline_helper_group.h>
 #include <ceres_spline_helper_old.h>
 #include <basalt/calibration/calibration.hpp>
 
 template <int _N>
-struct CalibAccelerationCostFunctorSplit : public CeresSplineHelper<_N> {
+struct CalibAccelerationCostFunctorSplit
+    : public CeresSplineHelper<_N>,
+      public LieSplineSegmentData<_N, Sophus::SO3> {
   static constexpr int N = _N;        // Order of the spline.
   static constexpr int DEG = _N - 1;  // Degree of the spline.
 
@@ -17,24 +22,46 @@ struct CalibAccelerationCostFunctorSplit : public CeresSplineHelper<_N> {
   using Vec3 = Eigen::Matrix<double, 3, 1>;
   using Mat3 = Eigen::Matrix<double, 3, 3>;
 
+  using Data = LieSplineSegmentData<_N, Sophus::SO3>;
+
+  static constexpr int kNumResiduals = 3;
+
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   CalibAccelerationCostFunctorSplit(const Eigen::Vector3d& measurement,
-                                    double u, double inv_dt, double inv_std)
-      : measurement(measurement), u(u), inv_dt(inv_dt), inv_std(inv_std) {}
+                                    double u, double inv_dt, double inv_std,
+                                    const SplineCoeffs<N>* coeffs = nullptr)
+      : measurement(measurement),
+        u(u),
+        inv_dt(inv_dt),
+        inv_std(inv_std),
+        coeffs(coeffs) {}
 
   template <class T>
   bool operator()(T const* const* sKnots, T* sResiduals) const {
+    typename Data::template SegmentData<T> data;
+    Data::computeSegmentData(sKnots, &data);
+    return (*this)(sKnots, data, sResiduals);
+  }
+
+  template <class T>
+  bool operator()(T const* const* sKnots,
+                  const typename Data::template SegmentData<T>& data,
+                  T* sResiduals) const {
     using Vector3 = Eigen::Matrix<T, 3, 1>;
 
     Eigen::Map<Vector3> residuals(sResiduals);
 
     Sophus::SO3<T> R_w_i;
-    CeresSplineHelper<N>::template evaluate_lie<T, Sophus::SO3>(sKnots, u,
-                                                                inv_dt, &R_w_i);
+    Data::template evaluate_lie<LIE_VALUE, T>(sKnots, data, coeffs, u, inv_dt,
+                                              &R_w_i);
 
     Vector3 accel_w;
-    CeresSplineHelper<N>::template evaluate<T, 3, 2>(sKnots + N, u, inv_dt,
-                                                     &accel_w);
+    if (coeffs) {
+      coeffs->template evaluate<T, 3, 2>(sKnots + N, &accel_w);
+    } else {
+      CeresSplineHelper<N>::template evaluate<T, 3, 2>(sKnots + N, u, inv_dt,
+                                                       &accel_w);
+    }
 
     // Gravity
     Eigen::Map<Vector3 const> const g(sKnots[2 * N]);
@@ -48,10 +75,15 @@ struct CalibAccelerationCostFunctorSplit : public CeresSplineHelper<_N> {
 
   Eigen::Vector3d measurement;
   double u, inv_dt, inv_std;
+
+  /// Precomputed blending coefficients at u or nullptr.
+  const SplineCoeffs<N>* coeffs;
 };
 
 template <int _N, template <class> class GroupT, bool OLD_TIME_DERIV>
-struct CalibGyroCostFunctorSplit : public CeresSplineHelper<_N> {
+struct CalibGyroCostFunctorSplit
+    : public CeresSplineHelper<_N>,
+      public LieSplineSegmentData<_N, GroupT, !OLD_TIME_DERIV> {
   static constexpr int N = _N;        // Order of the spline.
   static constexpr int DEG = _N - 1;  // Degree of the spline.
 
@@ -63,13 +95,31 @@ struct CalibGyroCostFunctorSplit : public CeresSplineHelper<_N> {
 
   using Tangentd = typename GroupT<double>::Tangent;
 
+  using Data = LieSplineSegmentData<_N, GroupT, !OLD_TIME_DERIV>;
+
+  static constexpr int kNumResiduals = GroupT<double>::DoF;
+
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   CalibGyroCostFunctorSplit(const Tangentd& measurement, double u,
-                            double inv_dt, double inv_std = 1)
-      : measurement(measurement), u(u), inv_dt(inv_dt), inv_std(inv_std) {}
+                            double inv_dt, double inv_std = 1,
+                            const SplineCoeffs<N>* coeffs = nullptr)
+      : measurement(measurement),
+        u(u),
+        inv_dt(inv_dt),
+        inv_std(inv_std),
+        coeffs(coeffs) {}
 
   template <class T>
   bool operator()(T const* const* sKnots, T* sResiduals) const {
+    typename Data::template SegmentData<T> data;
+    Data::computeSegmentData(sKnots, &data);
+    return (*this)(sKnots, data, sResiduals);
+  }
+
+  template <class T>
+  bool operator()(T const* const* sKnots,
+                  const typename Data::template SegmentData<T>& data,
+                  T* sResiduals) const {
     using Tangent = typename GroupT<T>::Tangent;
 
     Eigen::Map<Tangent> residuals(sResiduals);
@@ -80,8 +130,8 @@ struct CalibGyroCostFunctorSplit : public CeresSplineHelper<_N> {
       CeresSplineHelperOld<N>::template evaluate_lie_vel_old<T, GroupT>(
           sKnots, u, inv_dt, nullptr, &rot_vel);
     } else {
-      CeresSplineHelper<N>::template evaluate_lie<T, GroupT>(sKnots, u, inv_dt,
-                                                             nullptr, &rot_vel);
+      Data::template evaluate_lie<LIE_VEL, T>(sKnots, data, coeffs, u,
+                                              inv_dt, nullptr, &rot_vel);
     }
 
     Eigen::Map<Tangent const> const bias(sKnots[N]);
@@ -93,9 +143,406 @@ struct CalibGyroCostFunctorSplit : public CeresSplineHelper<_N> {
 
   Tangentd measurement;
   double u, inv_dt, inv_std;
+
+  /// Precomputed blending coefficients at u or nullptr.
+  const SplineCoeffs<N>* coeffs;
+};
+
+/// @brief Gyroscope residual of the split spline with analytic Jacobians.
+///
+/// Same residual as CalibGyroCostFunctorSplit for SO(3). Parameter blocks
+/// are the N rotation knots and the gyroscope bias.
+template <int _N>
+class CalibGyroAnalyticCostFunctionSplit
+    : public SizedCostFunctionFor<
+          3, typename ConcatBlockSizes<RepeatedBlockSizes<_N, 4>,
+                                       BlockSizes<3>>::type>::type,
+      public SegmentKnotDeltas<_N, Sophus::SO3d> {
+ public:
+  static constexpr int N = _N;  // Order of the spline.
+
+  using Vec3 = Eigen::Matrix<double, 3, 1>;
+  using Mat3 = Eigen::Matrix<double, 3, 3, Eigen::RowMajor>;
+
+  using JacobianArray = typename CeresSplineHelperJacobian<
+      N>::template JacobianArray<Sophus::SO3>;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  CalibGyroAnalyticCostFunctionSplit(const Eigen::Vector3d& measurement,
+                                     double u, double inv_dt, double inv_std,
+                                     const SplineCoeffs<N>* coeffs = nullptr)
+      : measurement(measurement),
+        u(u),
+        inv_dt(inv_dt),
+        inv_std(inv_std),
+        coeffs(coeffs) {}
+
+  bool Evaluate(double const* const* parameters, double* residuals,
+                double** jacobians) const override {
+    Vec3 rot_vel;
+    JacobianArray J;
+
+    if (coeffs) {
+      CeresSplineHelperJacobian<N>::template evaluate_lie<Sophus::SO3, 1>(
+          parameters, *coeffs, &rot_vel, jacobians ? &J : nullptr,
+          this->knotDeltas());
+    } else {
+      CeresSplineHelperJacobian<N>::template evaluate_lie<Sophus::SO3, 1>(
+          parameters, u, inv_dt, &rot_vel, jacobians ? &J : nullptr,
+          this->knotDeltas());
+    }
+
+    Eigen::Map<Vec3 const> const bias(parameters[N]);
+
+    Eigen::Map<Vec3> r(residuals);
+    r = inv_std * (rot_vel - measurement + bias);
+
+    if (jacobians) {
+      for (int i = 0; i < N; i++) {
+        if (jacobians[i]) {
+          setLieKnotJacobian<Sophus::SO3d>(parameters[i], inv_std * J[i],
+                                           jacobians[i]);
+        }
+      }
+      if (jacobians[N]) {
+        Eigen::Map<Mat3>{jacobians[N]} = inv_std * Mat3::Identity();
+      }
+    }
+
+    return true;
+  }
+
+  Eigen::Vector3d measurement;
+  double u, inv_dt, inv_std;
+
+  /// Precomputed blending coefficients at u or nullptr.
+  const SplineCoeffs<N>* coeffs;
+};
+
+/// @brief Accelerometer residual of the split spline with analytic
+/// Jacobians.
+///
+/// Same residual as CalibAccelerationCostFunctorSplit. Parameter blocks are
+/// the N rotation knots, the N translation knots, gravity and the
+/// accelerometer bias. The residual is linear in all blocks but the
+/// rotation knots, whose Jacobian is the one of the spline value.
+template <int _N>
+class CalibAccelerationAnalyticCostFunctionSplit
+    : public SizedCostFunctionFor<
+          3, typename ConcatBlockSizes<RepeatedBlockSizes<_N, 4>,
+                                       RepeatedBlockSizes<_N, 3>,
+                                       BlockSizes<3, 3>>::type>::type,
+      public SegmentKnotDeltas<_N, Sophus::SO3d> {
+ public:
+  static constexpr int N = _N;  // Order of the spline.
+
+  using Vec3 = Eigen::Matrix<double, 3, 1>;
+  using Mat3 = Eigen::Matrix<double, 3, 3, Eigen::RowMajor>;
+
+  using JacobianArray = typename CeresSplineHelperJacobian<
+      N>::template JacobianArray<Sophus::SO3>;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  CalibAccelerationAnalyticCostFunctionSplit(
+      const Eigen::Vector3d& measurement, double u, double inv_dt,
+      double inv_std, const SplineCoeffs<N>* coeffs = nullptr)
+      : measurement(measurement),
+        u(u),
+        inv_dt(inv_dt),
+        inv_std(inv_std),
+        coeffs(coeffs) {}
+
+  bool Evaluate(double const* const* parameters, double* residuals,
+                double** jacobians) const override {
+    if (coeffs) return evaluate(*coeffs, parameters, residuals, jacobians);
+
+    const SplineCoeffs<N> c(u, inv_dt, 2);
+    return evaluate(c, parameters, residuals, jacobians);
+  }
+
+  Eigen::Vector3d measurement;
+  double u, inv_dt, inv_std;
+
+  /// Precomputed blending coefficients at u or nullptr.
+  const SplineCoeffs<N>* coeffs;
+
+ private:
+  bool evaluate(const SplineCoeffs<N>& c, double const* const* parameters,
+                double* residuals, double** jacobians) const {
+    bool rot_jacobians = false;
+    if (jacobians) {
+      for (int i = 0; i < N; i++) rot_jacobians |= jacobians[i] != nullptr;
+    }
+
+    Sophus::SO3d R_w_i;
+    JacobianArray J;
+    CeresSplineHelperJacobian<N>::template evaluate_lie<Sophus::SO3, 0>(
+        parameters, c, &R_w_i, rot_jacobians ? &J : nullptr,
+        this->knotDeltas());
+
+    Vec3 accel_w;
+    c.template evaluate<double, 3, 2>(parameters + N, &accel_w);
+
+    Eigen::Map<Vec3 const> const g(parameters[2 * N]);
+    Eigen::Map<Vec3 const> const bias(parameters[2 * N + 1]);
+
+    const Sophus::SO3d R_i_w = R_w_i.inverse();
+    const Vec3 accel_i = R_i_w * (accel_w + g);
+
+    Eigen::Map<Vec3> r(residuals);
+    r = inv_std * (accel_i - measurement + bias);
+
+    if (!jacobians) return true;
+
+    // (R exp(e))^{-1} a ~ R^{-1} a + hat(R^{-1} a) e
+    if (rot_jacobians) {
+      const Mat3 d_r_d_rot = inv_std * Sophus::SO3d::hat(accel_i);
+      for (int i = 0; i < N; i++) {
+        if (jacobians[i]) {
+          setLieKnotJacobian<Sophus::SO3d>(parameters[i], d_r_d_rot * J[i],
+                                           jacobians[i]);
+        }
+      }
+    }
+
+    const Mat3 d_r_d_accel_w = inv_std * R_i_w.matrix();
+    for (int i = 0; i < N; i++) {
+      if (jacobians[N + i]) {
+        const double b = i + 1 < N ? c.ddcoeff[i] - c.ddcoeff[i + 1]
+                                   : c.ddcoeff[i];
+        Eigen::Map<Mat3>{jacobians[N + i]} = b * d_r_d_accel_w;
+      }
+    }
+
+    if (jacobians[2 * N]) Eigen::Map<Mat3>{jacobians[2 * N]} = d_r_d_accel_w;
+    if (jacobians[2 * N + 1]) {
+      Eigen::Map<Mat3>{jacobians[2 * N + 1]} = inv_std * Mat3::Identity();
+    }
+
+    return true;
+  }
+};
+
+/// @brief Gyroscope and accelerometer residual of one IMU sample of the
+/// split spline.
+///
+/// Stacks the residuals of CalibGyroCostFunctorSplit (rows 0-2) and
+/// CalibAccelerationCostFunctorSplit (rows 3-5) for a gyroscope and an
+/// accelerometer sample with the same timestamp, such that the rotation and
+/// its velocity are evaluated in one pass. Parameter blocks are the N
+/// rotation knots, the N translation knots, gravity, the accelerometer bias
+/// and the gyroscope bias.
+template <int _N>
+struct CalibImuCostFunctorSplit
+    : public CeresSplineHelper<_N>,
+      public LieSplineSegmentData<_N, Sophus::SO3> {
+  static constexpr int N = _N;        // Order of the spline.
+  static constexpr int DEG = _N - 1;  // Degree of the spline.
+
+  using Data = LieSplineSegmentData<_N, Sophus::SO3>;
+
+  static constexpr int kNumResiduals = 6;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  CalibImuCostFunctorSplit(const Eigen::Vector3d& gyro_measurement,
+                           const Eigen::Vector3d& accel_measurement, double u,
+                           double inv_dt, double gyro_inv_std,
+                           double accel_inv_std,
+                           const SplineCoeffs<N>* coeffs = nullptr)
+      : gyro_measurement(gyro_measurement),
+        accel_measurement(accel_measurement),
+        u(u),
+        inv_dt(inv_dt),
+        gyro_inv_std(gyro_inv_std),
+        accel_inv_std(accel_inv_std),
+        coeffs(coeffs) {}
+
+  template <class T>
+  bool operator()(T const* const* sKnots, T* sResiduals) const {
+    typename Data::template SegmentData<T> data;
+    Data::computeSegmentData(sKnots, &data);
+    return (*this)(sKnots, data, sResiduals);
+  }
+
+  template <class T>
+  bool operator()(T const* const* sKnots,
+                  const typename Data::template SegmentData<T>& data,
+                  T* sResiduals) const {
+    using Vector3 = Eigen::Matrix<T, 3, 1>;
+    using Vector6 = Eigen::Matrix<T, 6, 1>;
+
+    Eigen::Map<Vector6> residuals(sResiduals);
+
+    Sophus::SO3<T> R_w_i;
+    Vector3 rot_vel;
+    Data::template evaluate_lie<LIE_VALUE | LIE_VEL, T>(
+        sKnots, data, coeffs, u, inv_dt, &R_w_i, &rot_vel);
+
+    Vector3 accel_w;
+    if (coeffs) {
+      coeffs->template evaluate<T, 3, 2>(sKnots + N, &accel_w);
+    } else {
+      CeresSplineHelper<N>::template evaluate<T, 3, 2>(sKnots + N, u, inv_dt,
+                                                       &accel_w);
+    }
+
+    Eigen::Map<Vector3 const> const g(sKnots[2 * N]);
+    Eigen::Map<Vector3 const> const accel_bias(sKnots[2 * N + 1]);
+    Eigen::Map<Vector3 const> const gyro_bias(sKnots[2 * N + 2]);
+
+    residuals.template head<3>() =
+        gyro_inv_std * (rot_vel - gyro_measurement.cast<T>() + gyro_bias);
+    residuals.template tail<3>() =
+        accel_inv_std * (R_w_i.inverse() * (accel_w + g) -
+                         accel_measurement.cast<T>() + accel_bias);
+
+    return true;
+  }
+
+  Eigen::Vector3d gyro_measurement, accel_measurement;
+  double u, inv_dt, gyro_inv_std, accel_inv_std;
+
+  /// Precomputed blending coefficients at u or nullptr.
+  const SplineCoeffs<N>* coeffs;
 };
 
+/// @brief IMU residual of the split spline with analytic Jacobians.
+///
+/// Same residual and parameter blocks as CalibImuCostFunctorSplit. The
+/// rotation and its velocity share the knot differences, exponentials and
+/// their Jacobians.
 template <int _N>
+class CalibImuAnalyticCostFunctionSplit
+    : public SizedCostFunctionFor<
+          6, typename ConcatBlockSizes<RepeatedBlockSizes<_N, 4>,
+                                       RepeatedBlockSizes<_N, 3>,
+                                       BlockSizes<3, 3, 3>>::type>::type,
+      public SegmentKnotDeltas<_N, Sophus::SO3d> {
+ public:
+  static constexpr int N = _N;  // Order of the spline.
+
+  using Vec3 = Eigen::Matrix<double, 3, 1>;
+  using Vec6 = Eigen::Matrix<double, 6, 1>;
+  using Mat3 = Eigen::Matrix<double, 3, 3, Eigen::RowMajor>;
+  using Mat63 = Eigen::Matrix<double, 6, 3, Eigen::RowMajor>;
+
+  using JacobianArray = typename CeresSplineHelperJacobian<
+      N>::template JacobianArray<Sophus::SO3>;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  CalibImuAnalyticCostFunctionSplit(const Eigen::Vector3d& gyro_measurement,
+                                    const Eigen::Vector3d& accel_measurement,
+                                    double u, double inv_dt,
+                                    double gyro_inv_std, double accel_inv_std,
+                                    const SplineCoeffs<N>* coeffs = nullptr)
+      : gyro_measurement(gyro_measurement),
+        accel_measurement(accel_measurement),
+        u(u),
+        inv_dt(inv_dt),
+        gyro_inv_std(gyro_inv_std),
+        accel_inv_std(accel_inv_std),
+        coeffs(coeffs) {}
+
+  bool Evaluate(double const* const* parameters, double* residuals,
+                double** jacobians) const override {
+    if (coeffs) return evaluate(*coeffs, parameters, residuals, jacobians);
+
+    const SplineCoeffs<N> c(u, inv_dt, 2);
+    return evaluate(c, parameters, residuals, jacobians);
+  }
+
+  Eigen::Vector3d gyro_measurement, accel_measurement;
+  double u, inv_dt, gyro_inv_std, accel_inv_std;
+
+  /// Precomputed blending coefficients at u or nullptr.
+  const SplineCoeffs<N>* coeffs;
+
+ private:
+  bool evaluate(const SplineCoeffs<N>& c, double const* const* parameters,
+                double* residuals, double** jacobians) const {
+    bool rot_jacobians = false;
+    if (jacobians) {
+      for (int i = 0; i < N; i++) rot_jacobians |= jacobians[i] != nullptr;
+    }
+
+    Sophus::SO3d R_w_i;
+    Vec3 rot_vel;
+    JacobianArray J_value, J_vel;
+
+    constexpr int OUT = LIE_VALUE | LIE_VEL;
+    if (rot_jacobians) {
+      CeresSplineHelperJacobian<N>::template evaluate_lie<Sophus::SO3, OUT>(
+          parameters, c, &R_w_i, &rot_vel, nullptr, &J_value, &J_vel,
+          nullptr, this->knotDeltas());
+    } else {
+      CeresSplineHelperJacobian<N>::template evaluate_lie<Sophus::SO3, OUT>(
+          parameters, c, &R_w_i, &rot_vel, nullptr, nullptr, nullptr,
+          nullptr, this->knotDeltas());
+    }
+
+    Vec3 accel_w;
+    c.template evaluate<double, 3, 2>(parameters + N, &accel_w);
+
+    Eigen::Map<Vec3 const> const g(parameters[2 * N]);
+    Eigen::Map<Vec3 const> const accel_bias(parameters[2 * N + 1]);
+    Eigen::Map<Vec3 const> const gyro_bias(parameters[2 * N + 2]);
+
+    const Sophus::SO3d R_i_w = R_w_i.inverse();
+    const Vec3 accel_i = R_i_w * (accel_w + g);
+
+    Eigen::Map<Vec6> r(residuals);
+    r.head<3>() = gyro_inv_std * (rot_vel - gyro_measurement + gyro_bias);
+    r.tail<3>() = accel_inv_std * (accel_i - accel_measurement + accel_bias);
+
+    if (!jacobians) return true;
+
+    if (rot_jacobians) {
+      const Mat3 d_accel_d_rot = accel_inv_std * Sophus::SO3d::hat(accel_i);
+      for (int i = 0; i < N; i++) {
+        if (!jacobians[i]) continue;
+
+        Mat63 d_r_d_knot;
+        d_r_d_knot.topRows<3>() = gyro_inv_std * J_vel[i];
+        d_r_d_knot.bottomRows<3>() = d_accel_d_rot * J_value[i];
+        setLieKnotJacobian<Sophus::SO3d>(parameters[i], d_r_d_knot,
+                                         jacobians[i]);
+      }
+    }
+
+    // Only the accelerometer rows depend on the translation knots, gravity
+    // and the accelerometer bias, only the gyroscope rows on its bias.
+    const Mat3 d_accel_d_accel_w = accel_inv_std * R_i_w.matrix();
+    for (int i = 0; i < N; i++) {
+      if (jacobians[N + i]) {
+        const double b = i + 1 < N ? c.ddcoeff[i] - c.ddcoeff[i + 1]
+                                   : c.ddcoeff[i];
+        Eigen::Map<Mat63> J(jacobians[N + i]);
+        J.topRows<3>().setZero();
+        J.bottomRows<3>() = b * d_accel_d_accel_w;
+      }
+    }
+
+    if (jacobians[2 * N]) {
+      Eigen::Map<Mat63> J(jacobians[2 * N]);
+      J.topRows<3>().setZero();
+      J.bottomRows<3>() = d_accel_d_accel_w;
+    }
+    if (jacobians[2 * N + 1]) {
+      Eigen::Map<Mat63> J(jacobians[2 * N + 1]);
+      J.topRows<3>().setZero();
+      J.bottomRows<3>() = accel_inv_std * Mat3::Identity();
+    }
+    if (jacobians[2 * N + 2]) {
+      Eigen::Map<Mat63> J(jacobians[2 * N + 2]);
+      J.topRows<3>() = gyro_inv_std * Mat3::Identity();
+      J.bottomRows<3>().setZero();
+    }
+
+    return true;
+  }
+};
+
+template <int _N, class CamT = basalt::GenericCamera<double>>
 struct CalibReprojectionCostFunctorSplit : public CeresSplineHelper<_N> {
   static constexpr int N = _N;        // Order of the spline.
   static constexpr int DEG = _N - 1;  // Degree of the spline.
@@ -109,8 +556,8 @@ struct CalibReprojectionCostFunctorSplit : public CeresSplineHelper<_N> {
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   CalibReprojectionCostFunctorSplit(const basalt::CalibCornerData* corners,
                                     const basalt::AprilGrid* aprilgrid,
-                                    const basalt::GenericCamera<double>& cam,
-                                    double u, double inv_dt)
+                                    const CamT& cam, double u,
+                                    double inv_dt)
       : corners(corners),
         aprilgrid(aprilgrid),
         cam(cam),
@@ -126,8 +573,8 @@ struct CalibReprojectionCostFunctorSplit : public CeresSplineHelper<_N> {
     using Matrix4 = Eigen::Matrix<T, 4, 4>;
 
     Sophus::SO3<T> R_w_i;
-    CeresSplineHelper<N>::template evaluate_lie<T, Sophus::SO3>(sKnots, u,
-                                                                inv_dt, &R_w_i);
+    CeresSplineHelperGroup<N>::template evaluate_lie<LIE_VALUE, T, Sophus::SO3>(
+        sKnots, u, inv_dt, &R_w_i);
 
     Vector3 t_w_i;
     CeresSplineHelper<N>::template evaluate<T, 3, 0>(sKnots + N, u, inv_dt,
@@ -138,40 +585,161 @@ struct CalibReprojectionCostFunctorSplit : public CeresSplineHelper<_N> {
     Sophus::SE3<T> T_w_c = Sophus::SE3<T>(R_w_i, t_w_i) * T_i_c;
     Matrix4 T_c_w_matrix = T_w_c.inverse().matrix();
 
-    basalt::GenericCamera<T> cam_t = cam.template cast<T>();
-
-
     // through first camera 内参和外参 to get the 3d coordinate of corner point, then project it to the second camera
-    std::visit(
-        [&](const auto& cam_tt) {// anonymous function
-          for (size_t i = 0; i < corners->corner_ids.size(); i++) {
-            //3d coordinates of each corner point
-            Vector4 p3d =
-                T_c_w_matrix *
-                aprilgrid->aprilgrid_corner_pos_3d[corners->corner_ids[i]]
-                    .cast<T>();
-
-            Vector2 proj;
-            bool success = cam_tt.project(p3d, proj);
-
-            //compute the reprojection error
-            if (success) {
-              sResiduals[2 * i + 0] = proj[0] - corners->corners[i][0];
-              sResiduals[2 * i + 1] = proj[1] - corners->corners[i][1];
-            } else {
-              sResiduals[2 * i + 0] = T(0);//double(0)
-              sResiduals[2 * i + 1] = T(0);
-            }
-          }
-        },
-        cam_t.variant);
+    visitCamera(cam, [&](const auto& cam) {
+      for (size_t i = 0; i < corners->corner_ids.size(); i++) {
+        //3d coordinates of each corner point
+        Vector4 p3d =
+            T_c_w_matrix *
+            aprilgrid->aprilgrid_corner_pos_3d[corners->corner_ids[i]]
+                .cast<T>();
+
+        Vector2 proj;
+        bool success = projectPoint(cam, p3d, proj);
+
+        //compute the reprojection error
+        if (success) {
+          sResiduals[2 * i + 0] = proj[0] - corners->corners[i][0];
+          sResiduals[2 * i + 1] = proj[1] - corners->corners[i][1];
+        } else {
+          sResiduals[2 * i + 0] = T(0);//double(0)
+          sResiduals[2 * i + 1] = T(0);
+        }
+      }
+    });
 
     return true;
   }
 
   const basalt::CalibCornerData* corners;
   const basalt::AprilGrid* aprilgrid;
-  const basalt::GenericCamera<double> cam;
+  const CamT cam;
 
   double u, inv_dt;
 };
+
+/// @brief Reprojection residuals of one AprilGrid frame for the split spline
+/// with analytic Jacobians.
+///
+/// Same residuals as CalibReprojectionCostFunctorSplit, for one camera or,
+/// with addCamera, all cameras observed at the same time. The pose of the
+/// frame and the Jacobian of the rotation with respect to the rotation knots
+/// are evaluated once per evaluation for all cameras and chained with the
+/// projection Jacobian of each corner. Parameter blocks are the N rotation
+/// knots, the N translation knots and T_i_c of every camera.
+template <int _N, class CamT = basalt::GenericCamera<double>>
+class CalibReprojectionAnalyticCostFunctionSplit
+    : public CalibReprojectionAnalyticCostFunction<
+          typename ConcatBlockSizes<RepeatedBlockSizes<_N, 4>,
+                                    RepeatedBlockSizes<_N, 3>>::type, CamT>,
+      public SegmentKnotDeltas<_N, Sophus::SO3d> {
+ public:
+  static constexpr int N = _N;  // Order of the spline.
+
+  using Base = CalibReprojectionAnalyticCostFunction<
+      typename ConcatBlockSizes<RepeatedBlockSizes<_N, 4>,
+                                RepeatedBlockSizes<_N, 3>>::type, CamT>;
+  using typename Base::Mat23;
+  using typename Base::Vec3;
+
+  using Mat3 = Eigen::Matrix<double, 3, 3>;
+  using VecN = Eigen::Matrix<double, _N, 1>;
+
+  using JacobianArray = typename CeresSplineHelperJacobian<
+      N>::template JacobianArray<Sophus::SO3>;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  CalibReprojectionAnalyticCostFunctionSplit(
+      const basalt::CalibCornerData* corners,
+      const basalt::AprilGrid* aprilgrid,
+      const CamT& cam, double u, double inv_dt)
+      : Base(corners, aprilgrid, cam), coeffs(u, inv_dt, 0) {
+    for (int i = 0; i < N; i++) {
+      weights[i] = i + 1 < N ? coeffs.coeff[i] - coeffs.coeff[i + 1]
+                             : coeffs.coeff[i];
+    }
+  }
+
+  bool Evaluate(double const* const* parameters, double* residuals,
+                double** jacobians) const override {
+    bool rot_jacobians = false;
+    if (jacobians) {
+      for (int i = 0; i < N; i++) rot_jacobians |= jacobians[i] != nullptr;
+    }
+
+    Sophus::SO3d R_w_i;
+    JacobianArray J;
+    CeresSplineHelperJacobian<N>::template evaluate_lie<Sophus::SO3, 0>(
+        parameters, coeffs, &R_w_i, rot_jacobians ? &J : nullptr,
+        this->knotDeltas());
+
+    Vec3 t_w_i;
+    coeffs.template evaluate<double, 3, 0>(parameters + N, &t_w_i);
+
+    const Sophus::SE3d T_i_w = Sophus::SE3d(R_w_i, t_w_i).inverse();
+
+    // Parts of the Jacobians that are the same for all corners, mapped to
+    // the parameters.
+    std::array<Eigen::Matrix<double, 3, 4>, N> d_rot;
+    if (rot_jacobians) {
+      for (int j = 0; j < N; j++) {
+        if (jacobians[j]) {
+          d_rot[j] = J[j] * lieLocalToParams<Sophus::SO3d>(parameters[j]);
+        }
+      }
+    }
+
+    for (size_t c = 0; c < this->numCameras(); c++) {
+      double const* const ext = parameters[2 * N + c];
+      double* const ext_jacobian = jacobians ? jacobians[2 * N + c] : nullptr;
+
+      const Sophus::SE3d T_c_i =
+          Eigen::Map<Sophus::SE3d const>(ext).inverse();
+
+      Eigen::Matrix<double, 6, 7> d_ext;
+      if (ext_jacobian) d_ext = lieLocalToParams<Sophus::SE3d>(ext);
+
+      const Mat3 R_c_i = T_c_i.so3().matrix();
+      const Mat3 R_c_w = R_c_i * T_i_w.so3().matrix();
+
+      this->projectCorners(
+          c, T_i_w, T_c_i, residuals, jacobians,
+          [&](size_t i, const Vec3& p_i, const Vec3& p_c,
+              const Mat23& d_proj) {
+            // (R exp(e))^{-1} (p - t) = exp(-e) p_i
+            if (rot_jacobians) {
+              const Mat23 d_proj_d_rot =
+                  d_proj * R_c_i * Sophus::SO3d::hat(p_i);
+              for (int j = 0; j < N; j++) {
+                if (jacobians[j]) {
+                  Base::template cornerRows<4>(jacobians[j], i) =
+                      d_proj_d_rot * d_rot[j];
+                }
+              }
+            }
+
+            const Mat23 d_proj_d_trans = -d_proj * R_c_w;
+            for (int j = 0; j < N; j++) {
+              if (jacobians[N + j]) {
+                Base::template cornerRows<3>(jacobians[N + j], i) =
+                    weights[j] * d_proj_d_trans;
+              }
+            }
+
+            if (ext_jacobian) {
+              Base::template cornerRows<7>(ext_jacobian, i) =
+                  d_proj * inversePerturbationJacobian(p_c) * d_ext;
+            }
+          });
+    }
+
+    return true;
+  }
+
+ private:
+  /// Blending coefficients of the pose at u.
+  SplineCoeffs<N> coeffs;
+
+  /// Blending coefficients of the translation knots.
+  VecN weights;
+};
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <ceres/jet.h>
+#include <ceres/sized_cost_function.h>
+
+/// Compile time list of parameter block sizes.
+template <int... Ns>
+struct BlockSizes {};
+
+/// Concatenation of several BlockSizes lists.
+template <class... Lists>
+struct ConcatBlockSizes;
+
+template <int... Ns>
+struct ConcatBlockSizes<BlockSizes<Ns...>> {
+  using type = BlockSizes<Ns...>;
+};
+
+template <int... As, int... Bs, class... Rest>
+struct ConcatBlockSizes<BlockSizes<As...>, BlockSizes<Bs...>, Rest...>
+    : ConcatBlockSizes<BlockSizes<As..., Bs...>, Rest...> {};
+
+template <int Size, class Seq>
+struct RepeatedBlockSizesImpl;
+
+template <int Size, size_t... Is>
+struct RepeatedBlockSizesImpl<Size, std::index_sequence<Is...>> {
+  using type = BlockSizes<((void)Is, Size)...>;
+};
+
+/// Count parameter blocks of the same Size, e.g. the N knots of a segment.
+template <int Count, int Size>
+using RepeatedBlockSizes = typename RepeatedBlockSizesImpl<
+    Size, std::make_index_sequence<Count>>::type;
+
+/// ceres::SizedCostFunction with the parameter blocks of a BlockSizes list.
+template <int kNumResiduals, class Blocks>
+struct SizedCostFunctionFor;
+
+template <int kNumResiduals, int... Ns>
+struct SizedCostFunctionFor<kNumResiduals, BlockSizes<Ns...>> {
+  using type = ceres::SizedCostFunction<kNumResiduals, Ns...>;
+};
+
+/// @brief Autodiff cost function with parameter blocks known at compile time.
+///
+/// Takes the same functors as ceres::DynamicAutoDiffCostFunction, with all
+/// parameter blocks in one array, operator()(T const* const* params, T*
+/// residuals), and like it differentiates Stride parameters per functor call.
+/// Block sizes are template arguments, so there is no AddParameterBlock setup
+/// and all jets live on the stack, except the residuals for ceres::DYNAMIC.
+/// Short jets matter: one jet over all knots, as in
+/// ceres::AutoDiffCostFunction, is several times slower for the spline
+/// functors. Takes ownership of the functor.
+template <class Functor, int kNumResiduals, int Stride, int... Ns>
+class FixedSizeAutoDiffCostFunction
+    : public ceres::SizedCostFunction<kNumResiduals, Ns...> {
+ public:
+  static constexpr int kNumBlocks = sizeof...(Ns);
+  static constexpr int kNumParameters = (Ns + ...);
+
+  using JetT = ceres::Jet<double, Stride>;
+
+  explicit FixedSizeAutoDiffCostFunction(Functor* functor,
+                                         int num_residuals = kNumResiduals)
+      : functor(functor) {
+    if constexpr (kNumResiduals == ceres::DYNAMIC) {
+      this->set_num_residuals(num_residuals);
+    }
+  }
+
+  bool Evaluate(double const* const* parameters, double* residuals,
+                double** jacobians) const override {
+    if (!jacobians) return (*functor)(parameters, residuals);
+
+    constexpr int block_sizes[kNumBlocks] = {Ns...};
+
+    // Parameters with a requested Jacobian as (jet, block, index in block).
+    struct Active {
+      int param, block, k;
+    };
+
+    JetT param_jets[kNumParameters];
+    JetT const* block_jets[kNumBlocks];
+    Active active[kNumParameters];
+    int num_active = 0;
+
+    for (int i = 0, offset = 0; i < kNumBlocks; offset += block_sizes[i++]) {
+      block_jets[i] = param_jets + offset;
+      for (int k = 0; k < block_sizes[i]; k++) {
+        param_jets[offset + k].a = parameters[i][k];
+        if (jacobians[i]) active[num_active++] = {offset + k, i, k};
+      }
+    }
+
+    if (num_active == 0) return (*functor)(parameters, residuals);
+
+    const int num_residuals = this->num_residuals();
+
+    ResidualJets residual_jets{};
+    if constexpr (kNumResiduals == ceres::DYNAMIC) {
+      residual_jets.resize(num_residuals);
+    }
+
+    for (int start = 0; start < num_active; start += Stride) {
+      const int end = std::min(start + Stride, num_active);
+
+      for (int j = start; j < end; j++) {
+        param_jets[active[j].param].v[j - start] = 1.0;
+      }
+
+      if (!(*functor)(block_jets, residual_jets.data())) return false;
+
+      for (int j = start; j < end; j++) {
+        param_jets[active[j].param].v[j - start] = 0.0;
+      }
+
+      if (start == 0) {
+        for (int r = 0; r < num_residuals; r++) {
+          residuals[r] = residual_jets[r].a;
+        }
+      }
+
+      for (int j = start; j < end; j++) {
+        const Active& p = active[j];
+        double* jacobian = jacobians[p.block];
+        for (int r = 0; r < num_residuals; r++) {
+          jacobian[r * block_sizes[p.block] + p.k] =
+              residual_jets[r].v[j - start];
+        }
+      }
+    }
+
+    return true;
+  }
+
+ private:
+  using ResidualJets =
+      std::conditional_t<kNumResiduals == ceres::DYNAMIC, std::vector<JetT>,
+                         std::array<JetT, std::max(kNumResiduals, 1)>>;
+
+  std::unique_ptr<Functor> functor;
+};
+
+/// @brief Create a FixedSizeAutoDiffCostFunction for a spline functor.
+///
+/// @param[in] functor residual functor with the array interface, ownership is
+/// taken by the cost function
+/// @param[in] BlockSizes sizes of the parameter blocks
+/// @param[in] num_residuals number of residuals if kNumResiduals is
+/// ceres::DYNAMIC
+template <int kNumResiduals, int Stride = 4, class Functor, int... Ns>
+ceres::CostFunction* newAutoDiffCostFunction(
+    Functor* functor, BlockSizes<Ns...>, int num_residuals = kNumResiduals) {
+  return new FixedSizeAutoDiffCostFunction<Functor, kNumResiduals, Stride,
+                                           Ns...>(functor, num_residuals);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <basalt/utils/eigen_utils.hpp>
+
+#include <ceres/evaluation_callback.h>
+
+#include <ceres_spline_helper_jacobian.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+/// @brief Evaluation callback that computes the differences of consecutive
+/// knots of a Lie group spline once per evaluation point.
+///
+/// Residuals of the same segment, e.g. the gyroscope, accelerometer and
+/// corner residuals of the calibration splines, otherwise each compute the
+/// DEG knot inverses, log maps, right Jacobians and Adjoints of the segment.
+/// Ceres calls PrepareForEvaluation with the new knots before evaluating the
+/// residuals, which then read the differences of their segment from table(),
+/// see SegmentKnotDeltas. The Jacobian parts are only computed for
+/// evaluations with Jacobians.
+///
+/// Ceres copies the parameters to the user state before every evaluation of
+/// a problem with an evaluation callback and does not support inner
+/// iterations with it, so only register it with problems whose residuals
+/// read the table.
+template <class Groupd>
+class KnotDeltaCallback : public ceres::EvaluationCallback {
+ public:
+  using Table = Eigen::aligned_vector<LieKnotDelta<Groupd>>;
+
+  explicit KnotDeltaCallback(const Eigen::aligned_vector<Groupd>& knots)
+      : knots(knots) {}
+
+  const Table* table() const { return &deltas; }
+
+  void PrepareForEvaluation(bool evaluate_jacobians,
+                            bool new_evaluation_point) override {
+    if (new_evaluation_point) {
+      valid = false;
+      jacobians_valid = false;
+    }
+
+    if (valid && (jacobians_valid || !evaluate_jacobians)) return;
+
+    deltas.resize(knots.empty() ? 0 : knots.size() - 1);
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, deltas.size()),
+                      [&](const tbb::blocked_range<size_t>& r) {
+                        for (size_t i = r.begin(); i != r.end(); ++i) {
+                          deltas[i].compute(knots[i], knots[i + 1],
+                                            evaluate_jacobians);
+                        }
+                      });
+
+    valid = true;
+    jacobians_valid = evaluate_jacobians;
+  }
+
+ private:
+  const Eigen::aligned_vector<Groupd>& knots;
+
+  bool valid = false;
+  bool jacobians_valid = false;
+
+  Table deltas;
+};
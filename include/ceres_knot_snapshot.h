@@ -0,0 +1,196 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include <basalt/utils/assert.h>
+#include <basalt/utils/eigen_utils.hpp>
+
+#include <ceres/iteration_callback.h>
+
+/// Copy of the knots of a spline published by KnotSnapshots.
+template <class Groupd>
+struct KnotSnapshot {
+  using Tangentd = typename Groupd::Tangent;
+
+  Eigen::aligned_vector<Groupd> knots;
+
+  /// Differences log(k_i^{-1} * k_{i+1}) of the knots, or empty if they were
+  /// not requested when publishing.
+  Eigen::aligned_vector<Tangentd> deltas;
+
+  /// Solver iteration of the knots, -1 outside of the optimization.
+  int iteration = -1;
+
+  /// Number of snapshots published before this one, -1 for the empty
+  /// snapshot read before the first publication.
+  int64_t version = -1;
+};
+
+/// @brief Knot snapshots published by one writer and read by many threads.
+///
+/// The writer, e.g. the iteration callback of the optimization, copies the
+/// knots into a free slot and makes it current with one atomic exchange.
+/// Readers enter the current slot with one atomic increment of a word that
+/// packs the slot index and the number of readers that entered it, and leave
+/// it with one atomic increment of the slot's exit counter. Neither side
+/// ever waits: readers always get a complete snapshot, and if all other
+/// slots are still held by readers the writer skips the publication, or
+/// adds a slot for publications that must not be skipped. Slots are reused,
+/// so publishing allocates only while the number of knots or slots grows.
+template <class Groupd>
+class KnotSnapshots {
+  struct Slot;
+
+ public:
+  using Snapshot = KnotSnapshot<Groupd>;
+
+  /// Slots allocated up front, and the limit for publications that add
+  /// slots.
+  static constexpr int num_slots = 3;
+  static constexpr int max_slots = 16;
+
+  /// @brief Read access to the current snapshot, valid until destruction.
+  class Reader {
+   public:
+    Reader(Reader&& other) : slot(other.slot) { other.slot = nullptr; }
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    ~Reader() {
+      if (slot) slot->exits.fetch_add(1, std::memory_order_release);
+    }
+
+    const Snapshot& operator*() const { return slot->snapshot; }
+    const Snapshot* operator->() const { return &slot->snapshot; }
+
+   private:
+    friend class KnotSnapshots;
+
+    explicit Reader(Slot* slot) : slot(slot) {}
+
+    Slot* slot;
+  };
+
+  KnotSnapshots() : current(0) {
+    for (int i = 0; i < num_slots; i++) slots[i].reset(new Slot);
+  }
+
+  /// @brief Enter the current snapshot. Wait-free, may be called from any
+  /// thread. Before the first publication the snapshot is empty.
+  Reader read() const {
+    const uint64_t word = current.fetch_add(1, std::memory_order_acq_rel);
+    return Reader(slots[word >> index_shift].get());
+  }
+
+  /// @brief Publish a copy of knots. Only one thread may publish at a time.
+  ///
+  /// @param[in] knots knots to copy
+  /// @param[in] with_deltas also compute the knot differences
+  /// @param[in] iteration solver iteration, -1 outside of the optimization
+  /// @param[in] add_slot if no slot is free, add one up to max_slots
+  /// @return false if no slot was free and the snapshot was skipped
+  bool publish(const Eigen::aligned_vector<Groupd>& knots, bool with_deltas,
+               int iteration = -1, bool add_slot = false) {
+    const uint64_t current_index =
+        current.load(std::memory_order_relaxed) >> index_shift;
+
+    int free_index = -1;
+    for (int i = 0; i < num_allocated; i++) {
+      if (uint64_t(i) != current_index &&
+          slots[i]->exits.load(std::memory_order_acquire) == slots[i]->enters) {
+        free_index = i;
+        break;
+      }
+    }
+    if (free_index < 0) {
+      if (!add_slot || num_allocated == max_slots) return false;
+
+      // Readers only reach the new slot after the exchange below.
+      free_index = num_allocated++;
+      slots[free_index].reset(new Slot);
+    }
+
+    Slot& slot = *slots[free_index];
+    Snapshot& s = slot.snapshot;
+    s.knots = knots;
+    s.deltas.resize(with_deltas && !knots.empty() ? knots.size() - 1 : 0);
+    for (size_t i = 0; i < s.deltas.size(); i++) {
+      s.deltas[i] = (knots[i].inverse() * knots[i + 1]).log();
+    }
+    s.iteration = iteration;
+    s.version = num_published.load(std::memory_order_relaxed);
+
+    slot.enters = 0;
+    slot.exits.store(0, std::memory_order_relaxed);
+
+    const uint64_t old = current.exchange(uint64_t(free_index) << index_shift,
+                                          std::memory_order_acq_rel);
+    slots[old >> index_shift]->enters = int64_t(old & count_mask);
+
+    num_published.store(s.version + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  /// Number of published snapshots. May be called from any thread.
+  int64_t numPublished() const {
+    return num_published.load(std::memory_order_acquire);
+  }
+
+  /// Number of slots, grows with publications that add slots.
+  int numSlots() const { return num_allocated; }
+
+ private:
+  static constexpr int index_shift = 48;
+  static constexpr uint64_t count_mask = (uint64_t(1) << index_shift) - 1;
+
+  struct Slot {
+    Snapshot snapshot;
+
+    /// Readers that entered the slot while it was current. Set by the writer
+    /// when the slot is replaced.
+    int64_t enters = 0;
+
+    /// Readers that left the slot.
+    std::atomic<int64_t> exits{0};
+  };
+
+  /// Index of the current slot in the upper bits, number of readers that
+  /// entered it in the lower bits.
+  mutable std::atomic<uint64_t> current;
+
+  /// Slots 0..num_allocated-1 exist. Only the writer adds slots.
+  std::array<std::unique_ptr<Slot>, max_slots> slots;
+  int num_allocated = num_slots;
+
+  std::atomic<int64_t> num_published{0};
+};
+
+/// @brief Publish the knots after every accepted step of the solver.
+///
+/// Needs Solver::Options::update_state_every_iteration, so the parameter
+/// blocks hold the accepted state when the callback runs.
+template <class Groupd>
+class KnotSnapshotCallback : public ceres::IterationCallback {
+ public:
+  KnotSnapshotCallback(KnotSnapshots<Groupd>& snapshots,
+                       const Eigen::aligned_vector<Groupd>& knots,
+                       bool with_deltas)
+      : snapshots(snapshots), knots(knots), with_deltas(with_deltas) {}
+
+  ceres::CallbackReturnType operator()(
+      const ceres::IterationSummary& summary) override {
+    if (summary.iteration == 0 || summary.step_is_successful) {
+      snapshots.publish(knots, with_deltas, summary.iteration);
+    }
+    return ceres::SOLVER_CONTINUE;
+  }
+
+ private:
+  KnotSnapshots<Groupd>& snapshots;
+  const Eigen::aligned_vector<Groupd>& knots;
+  bool with_deltas;
+};
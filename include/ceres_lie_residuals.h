@@ -1,9 +1,14 @@
 #pragma once
 
+#include <ceres_cost_function_helper.h>
+#include <ceres_spline_helper_group.h>
+#include <ceres_spline_helper_jacobian.h>
 #include <ceres_spline_helper_old.h>
 
 template <int _N, template <class> class GroupT>
-struct LieGroupSplineValueCostFunctor : public CeresSplineHelper<_N> {
+struct LieGroupSplineValueCostFunctor
+    : public CeresSplineHelper<_N>,
+      public LieSplineSegmentData<_N, GroupT> {
   static constexpr int N = _N;        // Order of the spline.
   static constexpr int DEG = _N - 1;  // Degree of the spline.
 
@@ -15,18 +20,32 @@ struct LieGroupSplineValueCostFunctor : public CeresSplineHelper<_N> {
 
   using Groupd = GroupT<double>;
 
+  using Data = LieSplineSegmentData<_N, GroupT>;
+
+  static constexpr int kNumResiduals = Groupd::DoF;
+
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
-  LieGroupSplineValueCostFunctor(const Groupd& measurement, double u)
-      : measurement(measurement), u(u) {}
+  LieGroupSplineValueCostFunctor(const Groupd& measurement, double u,
+                                 const SplineCoeffs<N>* coeffs = nullptr)
+      : measurement(measurement), u(u), coeffs(coeffs) {}
 
   template <class T>
   bool operator()(T const* const* sKnots, T* sResiduals) const {
+    typename Data::template SegmentData<T> data;
+    Data::computeSegmentData(sKnots, &data);
+    return (*this)(sKnots, data, sResiduals);
+  }
+
+  template <class T>
+  bool operator()(T const* const* sKnots,
+                  const typename Data::template SegmentData<T>& data,
+                  T* sResiduals) const {
     using Group = GroupT<T>;
     using Tangent = typename GroupT<T>::Tangent;
 
     Group res;
-    CeresSplineHelper<N>::template evaluate_lie<T, GroupT>(sKnots, u, 1, &res,
-                                                           nullptr, nullptr);
+    Data::template evaluate_lie<LIE_VALUE, T>(sKnots, data, coeffs, u, 1,
+                                              &res);
 
     Eigen::Map<Tangent> residuals(sResiduals);
     residuals = (res * measurement.inverse()).log();
@@ -36,10 +55,15 @@ struct LieGroupSplineValueCostFunctor : public CeresSplineHelper<_N> {
 
   Groupd measurement;
   double u;
+
+  /// Precomputed blending coefficients at u or nullptr.
+  const SplineCoeffs<N>* coeffs;
 };
 
 template <int _N, template <class> class GroupT, bool OLD_TIME_DERIV>
-struct LieGroupSplineVelocityCostFunctor : public CeresSplineHelper<_N> {
+struct LieGroupSplineVelocityCostFunctor
+    : public CeresSplineHelper<_N>,
+      public LieSplineSegmentData<_N, GroupT, !OLD_TIME_DERIV> {
   static constexpr int N = _N;        // Order of the spline.
   static constexpr int DEG = _N - 1;  // Degree of the spline.
 
@@ -51,13 +75,31 @@ struct LieGroupSplineVelocityCostFunctor : public CeresSplineHelper<_N> {
 
   using Tangentd = typename GroupT<double>::Tangent;
 
+  using Data = LieSplineSegmentData<_N, GroupT, !OLD_TIME_DERIV>;
+
+  static constexpr int kNumResiduals = GroupT<double>::DoF;
+
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   LieGroupSplineVelocityCostFunctor(const Tangentd& measurement, double u,
-                                    double inv_dt, double inv_std = 1)
-      : measurement(measurement), u(u), inv_dt(inv_dt), inv_std(inv_std) {}
+                                    double inv_dt, double inv_std = 1,
+                                    const SplineCoeffs<N>* coeffs = nullptr)
+      : measurement(measurement),
+        u(u),
+        inv_dt(inv_dt),
+        inv_std(inv_std),
+        coeffs(coeffs) {}
 
   template <class T>
   bool operator()(T const* const* sKnots, T* sResiduals) const {
+    typename Data::template SegmentData<T> data;
+    Data::computeSegmentData(sKnots, &data);
+    return (*this)(sKnots, data, sResiduals);
+  }
+
+  template <class T>
+  bool operator()(T const* const* sKnots,
+                  const typename Data::template SegmentData<T>& data,
+                  T* sResiduals) const {
     using Tangent = typename GroupT<T>::Tangent;
 
     Eigen::Map<Tangent> residuals(sResiduals);
@@ -68,8 +110,8 @@ struct LieGroupSplineVelocityCostFunctor : public CeresSplineHelper<_N> {
       CeresSplineHelperOld<N>::template evaluate_lie_vel_old<T, GroupT>(
           sKnots, u, inv_dt, nullptr, &rot_vel);
     } else {
-      CeresSplineHelper<N>::template evaluate_lie<T, GroupT>(
-          sKnots, u, inv_dt, nullptr, &rot_vel, nullptr);
+      Data::template evaluate_lie<LIE_VEL, T>(sKnots, data, coeffs, u,
+                                              inv_dt, nullptr, &rot_vel);
     }
 
     residuals = inv_std * (rot_vel - measurement);
@@ -79,10 +121,15 @@ struct LieGroupSplineVelocityCostFunctor : public CeresSplineHelper<_N> {
 
   Tangentd measurement;
   double u, inv_dt, inv_std;
+
+  /// Precomputed blending coefficients at u or nullptr.
+  const SplineCoeffs<N>* coeffs;
 };
 
 template <int _N, template <class> class GroupT, bool OLD_TIME_DERIV>
-struct LieGroupSplineAccelerationCostFunctor : public CeresSplineHelper<_N> {
+struct LieGroupSplineAccelerationCostFunctor
+    : public CeresSplineHelper<_N>,
+      public LieSplineSegmentData<_N, GroupT, !OLD_TIME_DERIV> {
   static constexpr int N = _N;        // Order of the spline.
   static constexpr int DEG = _N - 1;  // Degree of the spline.
 
@@ -94,13 +141,27 @@ struct LieGroupSplineAccelerationCostFunctor : public CeresSplineHelper<_N> {
 
   using Tangentd = typename GroupT<double>::Tangent;
 
+  using Data = LieSplineSegmentData<_N, GroupT, !OLD_TIME_DERIV>;
+
+  static constexpr int kNumResiduals = GroupT<double>::DoF;
+
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   LieGroupSplineAccelerationCostFunctor(const Tangentd& measurement, double u,
-                                        double inv_dt)
-      : measurement(measurement), u(u), inv_dt(inv_dt) {}
+                                        double inv_dt,
+                                        const SplineCoeffs<N>* coeffs = nullptr)
+      : measurement(measurement), u(u), inv_dt(inv_dt), coeffs(coeffs) {}
 
   template <class T>
   bool operator()(T const* const* sKnots, T* sResiduals) const {
+    typename Data::template SegmentData<T> data;
+    Data::computeSegmentData(sKnots, &data);
+    return (*this)(sKnots, data, sResiduals);
+  }
+
+  template <class T>
+  bool operator()(T const* const* sKnots,
+                  const typename Data::template SegmentData<T>& data,
+                  T* sResiduals) const {
     using Tangent = typename GroupT<T>::Tangent;
 
     Eigen::Map<Tangent> residuals(sResiduals);
@@ -111,8 +172,8 @@ struct LieGroupSplineAccelerationCostFunctor : public CeresSplineHelper<_N> {
       CeresSplineHelperOld<N>::template evaluate_lie_accel_old<T, GroupT>(
           sKnots, u, inv_dt, nullptr, nullptr, &rot_accel);
     } else {
-      CeresSplineHelper<N>::template evaluate_lie<T, GroupT>(
-          sKnots, u, inv_dt, nullptr, nullptr, &rot_accel);
+      Data::template evaluate_lie<LIE_ACCEL, T>(
+          sKnots, data, coeffs, u, inv_dt, nullptr, nullptr, &rot_accel);
     }
 
     residuals = rot_accel - measurement;
@@ -122,4 +183,231 @@ struct LieGroupSplineAccelerationCostFunctor : public CeresSplineHelper<_N> {
 
   Tangentd measurement;
   double u, inv_dt;
+
+  /// Precomputed blending coefficients at u or nullptr.
+  const SplineCoeffs<N>* coeffs;
+};
+
+/// @brief Map from Jacobians with respect to the local parameterization of a
+/// Lie group knot to Jacobians with respect to its parameters.
+///
+/// Local Jacobians are taken with respect to the right perturbation of the
+/// knot (see LieLocalParameterization). Ceres expects them with respect to
+/// the global parameters and multiplies them with Dx_this_mul_exp_x_at_0, so
+/// they are mapped back with the pseudo inverse of that matrix. Its columns
+/// are orthogonal for SO(3) and SE(3).
+///
+/// @param[in] knot parameters of the knot
+/// @return pseudo inverse of Dx_this_mul_exp_x_at_0
+template <class Groupd>
+inline Eigen::Matrix<double, Groupd::DoF, Groupd::num_parameters>
+lieLocalToParams(double const* knot) {
+  Eigen::Map<Groupd const> const k(knot);
+
+  const Eigen::Matrix<double, Groupd::num_parameters, Groupd::DoF> Dx =
+      k.Dx_this_mul_exp_x_at_0();
+
+  return Dx.colwise().squaredNorm().cwiseInverse().asDiagonal() *
+         Dx.transpose();
+}
+
+/// @brief Write the Jacobian of a residual with respect to a Lie group knot.
+///
+/// @param[in] knot parameters of the knot
+/// @param[in] J_local Jacobian with respect to the local parameterization
+/// @param[out] jacobian row-major Jacobian with respect to the parameters
+template <class Groupd, class Derived>
+inline void setLieKnotJacobian(double const* knot,
+                               const Eigen::MatrixBase<Derived>& J_local,
+                               double* jacobian) {
+  Eigen::Map<Eigen::Matrix<double, Derived::RowsAtCompileTime,
+                           Groupd::num_parameters, Eigen::RowMajor>>
+      J(jacobian, J_local.rows(), Groupd::num_parameters);
+
+  J = J_local * lieLocalToParams<Groupd>(knot);
+}
+
+/// @brief Base of the cost functions with analytic Jacobians for residuals
+/// that depend on the N knots of one spline segment.
+///
+/// Jacobians are computed with respect to the local parameterization of the
+/// knots and mapped to the parameters with lieLocalToParams.
+template <int _N, template <class> class GroupT>
+class LieGroupSplineAnalyticCostFunction
+    : public SizedCostFunctionFor<
+          GroupT<double>::DoF,
+          RepeatedBlockSizes<_N, GroupT<double>::num_parameters>>::type {
+ public:
+  static constexpr int N = _N;        // Order of the spline.
+  static constexpr int DEG = _N - 1;  // Degree of the spline.
+
+  using Groupd = GroupT<double>;
+  using Tangentd = typename Groupd::Tangent;
+  using Adjointd = typename Groupd::Adjoint;
+
+  using JacobianArray =
+      typename CeresSplineHelperJacobian<N>::template JacobianArray<GroupT>;
+
+  static_assert(std::is_same<Groupd, Sophus::SO3d>::value ||
+                    std::is_same<Groupd, Sophus::SE3d>::value,
+                "Analytic Jacobians are implemented for SO3 and SE3.");
+
+ protected:
+  /// Write the Jacobians of the residual, left-multiplied by scale, for all
+  /// requested parameter blocks.
+  template <class Derived>
+  static inline void setJacobians(double const* const* parameters,
+                                  double** jacobians,
+                                  const Eigen::MatrixBase<Derived>& scale,
+                                  const JacobianArray& J) {
+    for (int i = 0; i < N; i++) {
+      if (jacobians[i]) {
+        setLieKnotJacobian<Groupd>(parameters[i], scale * J[i], jacobians[i]);
+      }
+    }
+  }
+};
+
+template <int _N, template <class> class GroupT>
+class LieGroupSplineValueAnalyticCostFunction
+    : public LieGroupSplineAnalyticCostFunction<_N, GroupT> {
+ public:
+  using Base = LieGroupSplineAnalyticCostFunction<_N, GroupT>;
+  using typename Base::Adjointd;
+  using typename Base::Groupd;
+  using typename Base::JacobianArray;
+  using typename Base::Tangentd;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  LieGroupSplineValueAnalyticCostFunction(
+      const Groupd& measurement, double u,
+      const SplineCoeffs<_N>* coeffs = nullptr)
+      : measurement(measurement), u(u), coeffs(coeffs) {}
+
+  bool Evaluate(double const* const* parameters, double* residuals,
+                double** jacobians) const override {
+    Groupd res;
+    JacobianArray J;
+
+    if (coeffs) {
+      CeresSplineHelperJacobian<_N>::template evaluate_lie<GroupT, 0>(
+          parameters, *coeffs, &res, jacobians ? &J : nullptr);
+    } else {
+      CeresSplineHelperJacobian<_N>::template evaluate_lie<GroupT, 0>(
+          parameters, u, 1, &res, jacobians ? &J : nullptr);
+    }
+
+    Eigen::Map<Tangentd> r(residuals);
+    r = (res * measurement.inverse()).log();
+
+    if (jacobians) {
+      // log(res exp(e) meas^{-1}) ~ r + Jr^{-1}(r) Adj(meas) e
+      Adjointd scale = LieGroupOps<Groupd>::rightJacobianInv(r) *
+                       measurement.Adj();
+      Base::setJacobians(parameters, jacobians, scale, J);
+    }
+
+    return true;
+  }
+
+  Groupd measurement;
+  double u;
+
+  /// Precomputed blending coefficients at u or nullptr.
+  const SplineCoeffs<_N>* coeffs;
+};
+
+template <int _N, template <class> class GroupT>
+class LieGroupSplineVelocityAnalyticCostFunction
+    : public LieGroupSplineAnalyticCostFunction<_N, GroupT> {
+ public:
+  using Base = LieGroupSplineAnalyticCostFunction<_N, GroupT>;
+  using typename Base::Adjointd;
+  using typename Base::JacobianArray;
+  using typename Base::Tangentd;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  LieGroupSplineVelocityAnalyticCostFunction(
+      const Tangentd& measurement, double u, double inv_dt,
+      double inv_std = 1, const SplineCoeffs<_N>* coeffs = nullptr)
+      : measurement(measurement),
+        u(u),
+        inv_dt(inv_dt),
+        inv_std(inv_std),
+        coeffs(coeffs) {}
+
+  bool Evaluate(double const* const* parameters, double* residuals,
+                double** jacobians) const override {
+    Tangentd rot_vel;
+    JacobianArray J;
+
+    if (coeffs) {
+      CeresSplineHelperJacobian<_N>::template evaluate_lie<GroupT, 1>(
+          parameters, *coeffs, &rot_vel, jacobians ? &J : nullptr);
+    } else {
+      CeresSplineHelperJacobian<_N>::template evaluate_lie<GroupT, 1>(
+          parameters, u, inv_dt, &rot_vel, jacobians ? &J : nullptr);
+    }
+
+    Eigen::Map<Tangentd> r(residuals);
+    r = inv_std * (rot_vel - measurement);
+
+    if (jacobians) {
+      Base::setJacobians(parameters, jacobians,
+                         inv_std * Adjointd::Identity(), J);
+    }
+
+    return true;
+  }
+
+  Tangentd measurement;
+  double u, inv_dt, inv_std;
+
+  /// Precomputed blending coefficients at u or nullptr.
+  const SplineCoeffs<_N>* coeffs;
+};
+
+template <int _N, template <class> class GroupT>
+class LieGroupSplineAccelerationAnalyticCostFunction
+    : public LieGroupSplineAnalyticCostFunction<_N, GroupT> {
+ public:
+  using Base = LieGroupSplineAnalyticCostFunction<_N, GroupT>;
+  using typename Base::Adjointd;
+  using typename Base::JacobianArray;
+  using typename Base::Tangentd;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  LieGroupSplineAccelerationAnalyticCostFunction(
+      const Tangentd& measurement, double u, double inv_dt,
+      const SplineCoeffs<_N>* coeffs = nullptr)
+      : measurement(measurement), u(u), inv_dt(inv_dt), coeffs(coeffs) {}
+
+  bool Evaluate(double const* const* parameters, double* residuals,
+                double** jacobians) const override {
+    Tangentd rot_accel;
+    JacobianArray J;
+
+    if (coeffs) {
+      CeresSplineHelperJacobian<_N>::template evaluate_lie<GroupT, 2>(
+          parameters, *coeffs, &rot_accel, jacobians ? &J : nullptr);
+    } else {
+      CeresSplineHelperJacobian<_N>::template evaluate_lie<GroupT, 2>(
+          parameters, u, inv_dt, &rot_accel, jacobians ? &J : nullptr);
+    }
+
+    Eigen::Map<Tangentd> r(residuals);
+    r = rot_accel - measurement;
+
+    if (jacobians) {
+      Base::setJacobians(parameters, jacobians, Adjointd::Identity(), J);
+    }
+
+    return true;
+  }
+
+  Tangentd measurement;
+  double u, inv_dt;
+
+  /// Precomputed blending coefficients at u or nullptr.
+  const SplineCoeffs<_N>* coeffs;
 };
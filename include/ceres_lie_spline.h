@@ -6,14 +6,32 @@
 #include <basalt/utils/eigen_utils.hpp>
 
 #include <ceres/ceres.h>
+#include <ceres_knot_snapshot.h>
 #include <ceres_lie_residuals.h>
-
-template <int _N, template <class> class GroupT, bool OLD_TIME_DERIV = false>
+#include <ceres_segment_batch.h>
+#include <ceres_spline_batch.h>
+#include <ceres_spline_file.h>
+#include <ceres_spline_helper_delta.h>
+#include <ceres_spline_subdivision.h>
+
+#include <array>
+
+/// @brief Lie group spline fitted with Ceres.
+///
+/// OLD_TIME_DERIV selects the time derivative formulation of
+/// CeresSplineHelperOld for the derivative residuals. ANALYTIC_JACOBIAN
+/// replaces the autodiff residuals by cost functions with hand-derived
+/// Jacobians (SO(3) and SE(3) only).
+template <int _N, template <class> class GroupT, bool OLD_TIME_DERIV = false,
+          bool ANALYTIC_JACOBIAN = false>
 class CeresLieGroupSpline {
  public:
   static constexpr int N = _N;        // Order of the spline.
   static constexpr int DEG = _N - 1;  // Degree of the spline.
 
+  static_assert(!(OLD_TIME_DERIV && ANALYTIC_JACOBIAN),
+                "Analytic Jacobians use the new time derivatives.");
+
   static constexpr double ns_to_s = 1e-9;  ///< Nanosecond to second conversion
   static constexpr double s_to_ns = 1e9;   ///< Second to nanosecond conversion
 
@@ -22,13 +40,16 @@ class CeresLieGroupSpline {
   using Transformationd = typename GroupT<double>::Transformation;
 
   CeresLieGroupSpline(int64_t time_interval_ns, int64_t start_time_ns = 0)
-      : dt_ns(time_interval_ns), start_t_ns(start_time_ns) {
+      : dt_ns(time_interval_ns),
+        start_t_ns(start_time_ns),
+        coeff_table(time_interval_ns) {
     inv_dt = s_to_ns / dt_ns;    //????what is inv_dt
     std::cout<<"CeresLieGroupSpline init:"<<inv_dt<<std::endl;
   };
 
   void init(const Groupd& init, int num_knots) {
     knots = Eigen::aligned_vector<Groupd>(num_knots, init);
+    knot_delta_cache.invalidate();
 
     for (int i = 0; i < num_knots; i++) {
       ceres::LocalParameterization* local_parameterization =
@@ -42,13 +63,14 @@ class CeresLieGroupSpline {
                                 local_parameterization);
                                 //// To create a least squares problem, use the AddResidualBlock() and
                                 // AddParameterBlock() methods.
-      std::cout<<"problem init:"<<knots[i].data<<",";//<<Groupd::numparameters<<","<<local_parameterization<<std::endl;
-
     }
+
+    publishKnots();
   }
 
   void initRandom(int num_knots) {
     knots = Eigen::aligned_vector<Groupd>(num_knots);
+    knot_delta_cache.invalidate();
 
     for (int i = 0; i < num_knots; i++) {
       knots[i] = Groupd::exp(Tangentd::Random());
@@ -60,6 +82,33 @@ class CeresLieGroupSpline {
                                 local_parameterization);
       //std::cout<<"problem initRandom:"<<i<<":"<<knots[i].data<<","<<Groupd::numparameters<<","<<local_parameterization<<std::endl;                          
     }
+
+    publishKnots();
+  }
+
+  /// @brief Initialize with the refined knots of a coarse spline.
+  ///
+  /// The spline must be constructed with half the knot spacing of coarse and
+  /// the same start time. The knots are computed by
+  /// CeresSplineSubdivision::subdivideLie, so the spline approximates the
+  /// coarse one over the same time range and can be optimized from there.
+  void initSubdivided(const CeresLieGroupSpline& coarse) {
+    BASALT_ASSERT_STREAM(
+        2 * dt_ns == coarse.dt_ns && start_t_ns == coarse.start_t_ns,
+        "dt_ns " << dt_ns << " coarse.dt_ns " << coarse.dt_ns);
+
+    knots = CeresSplineSubdivision<N>::subdivideLie(coarse.knots);
+    knot_delta_cache.invalidate();
+
+    for (size_t i = 0; i < knots.size(); i++) {
+      ceres::LocalParameterization* local_parameterization =
+          new LieLocalParameterization<Groupd>();
+
+      problem.AddParameterBlock(knots[i].data(), Groupd::num_parameters,
+                                local_parameterization);
+    }
+
+    publishKnots();
   }
 
   void addMeasurement(const Groupd& meas, int64_t time_ns) {
@@ -76,17 +125,31 @@ class CeresLieGroupSpline {
                                                              << " knots.size() "
                                                              << knots.size());
 
-    // set the cost Function, the deriv of ceres_spline_helper
-    using FunctorT = LieGroupSplineValueCostFunctor<N, GroupT>;
-    FunctorT* functor = new FunctorT(meas, u);
-
-    ceres::DynamicAutoDiffCostFunction<FunctorT>* cost_function =
-        new ceres::DynamicAutoDiffCostFunction<FunctorT>(functor);
+    const SplineCoeffs<N>* coeffs = coeff_table.row(st_ns % dt_ns);
+
+    if (batch_segments) {
+      if constexpr (ANALYTIC_JACOBIAN) {
+        value_batches.get(s).add(
+            new LieGroupSplineValueAnalyticCostFunction<N, GroupT>(meas, u,
+                                                                   coeffs));
+      } else {
+        value_batches.get(s).add(
+            LieGroupSplineValueCostFunctor<N, GroupT>(meas, u, coeffs));
+      }
+      return;
+    }
 
-    for (int i = 0; i < N; i++) {
-      cost_function->AddParameterBlock(Groupd::num_parameters);
+    // set the cost Function, the deriv of ceres_spline_helper
+    ceres::CostFunction* cost_function;
+
+    if constexpr (ANALYTIC_JACOBIAN) {
+      cost_function = new LieGroupSplineValueAnalyticCostFunction<N, GroupT>(
+          meas, u, coeffs);
+    } else {
+      using FunctorT = LieGroupSplineValueCostFunctor<N, GroupT>;
+      cost_function = newAutoDiffCostFunction<Groupd::DoF>(
+          new FunctorT(meas, u, coeffs), KnotBlockSizes());
     }
-    cost_function->SetNumResiduals(Groupd::DoF);
 
     std::vector<double*> vec;
     for (int i = 0; i < N; i++) {
@@ -111,18 +174,32 @@ class CeresLieGroupSpline {
                                                              << " knots.size() "
                                                              << knots.size());
 
-    using FunctorT =
-        LieGroupSplineVelocityCostFunctor<N, GroupT, OLD_TIME_DERIV>;
-
-    FunctorT* functor = new FunctorT(meas, u, inv_dt);
+    const SplineCoeffs<N>* coeffs = coeff_table.row(st_ns % dt_ns);
+
+    if (batch_segments) {
+      if constexpr (ANALYTIC_JACOBIAN) {
+        vel_batches.get(s).add(
+            new LieGroupSplineVelocityAnalyticCostFunction<N, GroupT>(
+                meas, u, inv_dt, 1, coeffs));
+      } else {
+        vel_batches.get(s).add(
+            LieGroupSplineVelocityCostFunctor<N, GroupT, OLD_TIME_DERIV>(
+                meas, u, inv_dt, 1, coeffs));
+      }
+      return;
+    }
 
-    ceres::DynamicAutoDiffCostFunction<FunctorT>* cost_function =
-        new ceres::DynamicAutoDiffCostFunction<FunctorT>(functor);
+    ceres::CostFunction* cost_function;
 
-    for (int i = 0; i < N; i++) {
-      cost_function->AddParameterBlock(Groupd::num_parameters);
+    if constexpr (ANALYTIC_JACOBIAN) {
+      cost_function = new LieGroupSplineVelocityAnalyticCostFunction<N, GroupT>(
+          meas, u, inv_dt, 1, coeffs);
+    } else {
+      using FunctorT =
+          LieGroupSplineVelocityCostFunctor<N, GroupT, OLD_TIME_DERIV>;
+      cost_function = newAutoDiffCostFunction<Groupd::DoF>(
+          new FunctorT(meas, u, inv_dt, 1, coeffs), KnotBlockSizes());
     }
-    cost_function->SetNumResiduals(Groupd::DoF);
 
     std::vector<double*> vec;
     for (int i = 0; i < N; i++) {
@@ -152,18 +229,33 @@ class CeresLieGroupSpline {
                                                              << " knots.size() "
                                                              << knots.size());
 
-    using FunctorT =
-        LieGroupSplineAccelerationCostFunctor<N, GroupT, OLD_TIME_DERIV>;
-
-    FunctorT* functor = new FunctorT(meas, u, inv_dt);
-
-    ceres::DynamicAutoDiffCostFunction<FunctorT>* cost_function =
-        new ceres::DynamicAutoDiffCostFunction<FunctorT>(functor);
+    const SplineCoeffs<N>* coeffs = coeff_table.row(st_ns % dt_ns);
+
+    if (batch_segments) {
+      if constexpr (ANALYTIC_JACOBIAN) {
+        accel_batches.get(s).add(
+            new LieGroupSplineAccelerationAnalyticCostFunction<N, GroupT>(
+                meas, u, inv_dt, coeffs));
+      } else {
+        accel_batches.get(s).add(
+            LieGroupSplineAccelerationCostFunctor<N, GroupT, OLD_TIME_DERIV>(
+                meas, u, inv_dt, coeffs));
+      }
+      return;
+    }
 
-    for (int i = 0; i < N; i++) {
-      cost_function->AddParameterBlock(Groupd::num_parameters);
+    ceres::CostFunction* cost_function;
+
+    if constexpr (ANALYTIC_JACOBIAN) {
+      cost_function =
+          new LieGroupSplineAccelerationAnalyticCostFunction<N, GroupT>(
+              meas, u, inv_dt, coeffs);
+    } else {
+      using FunctorT =
+          LieGroupSplineAccelerationCostFunctor<N, GroupT, OLD_TIME_DERIV>;
+      cost_function = newAutoDiffCostFunction<Groupd::DoF>(
+          new FunctorT(meas, u, inv_dt, coeffs), KnotBlockSizes());
     }
-    cost_function->SetNumResiduals(Groupd::DoF);
 
     std::vector<double*> vec;
     for (int i = 0; i < N; i++) {
@@ -180,82 +272,83 @@ class CeresLieGroupSpline {
   }
 
   Groupd getValue(int64_t time_ns) const {
-    int64_t st_ns = (time_ns - start_t_ns);
-
-    BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns " << time_ns
-                                              << " start_t_ns " << start_t_ns);
-
-    int64_t s = st_ns / dt_ns;
-    double u = double(st_ns % dt_ns) / double(dt_ns);
-
-    BASALT_ASSERT_STREAM(s >= 0, "s " << s);
-    BASALT_ASSERT_STREAM(size_t(s + N) <= knots.size(), "s " << s << " N " << N
-                                                             << " knots.size() "
-                                                             << knots.size());
-
-    std::vector<const double*> vec;
-    for (int i = 0; i < N; i++) {
-      vec.emplace_back(knots[s + i].data());
-    }
-
     Groupd res;
-    std::cout<<"tets1"<<*vec[0]<<std::endl;
-    CeresSplineHelper<N>::template evaluate_lie<double, GroupT>(&vec[0], u,
-                                                                inv_dt, &res);
-
+    evaluate(time_ns, &res);
     return res;
   }
 
   Tangentd getVel(int64_t time_ns) const {
-    int64_t st_ns = (time_ns - start_t_ns);
-
-    BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns " << time_ns
-                                              << " start_t_ns " << start_t_ns);
-
-    int64_t s = st_ns / dt_ns;
-    double u = double(st_ns % dt_ns) / double(dt_ns);
-
-    BASALT_ASSERT_STREAM(s >= 0, "s " << s);
-    BASALT_ASSERT_STREAM(size_t(s + N) <= knots.size(), "s " << s << " N " << N
-                                                             << " knots.size() "
-                                                             << knots.size());
-
-    std::vector<const double*> vec;
-    for (int i = 0; i < N; i++) {
-      vec.emplace_back(knots[s + i].data());
-    }
-
     Tangentd res;
-    CeresSplineHelper<N>::template evaluate_lie<double, GroupT>(
-        &vec[0], u, inv_dt, nullptr, &res);
-
+    evaluate(time_ns, nullptr, &res);
     return res;
   }
 
   Tangentd getAccel(int64_t time_ns) const {
-    int64_t st_ns = (time_ns - start_t_ns);
-
-    BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns " << time_ns
-                                              << " start_t_ns " << start_t_ns);
-
-    int64_t s = st_ns / dt_ns;
-    double u = double(st_ns % dt_ns) / double(dt_ns);
-
-    BASALT_ASSERT_STREAM(s >= 0, "s " << s);
-    BASALT_ASSERT_STREAM(size_t(s + N) <= knots.size(), "s " << s << " N " << N
-                                                             << " knots.size() "
-                                                             << knots.size());
+    Tangentd res;
+    evaluate(time_ns, nullptr, nullptr, &res);
+    return res;
+  }
 
-    std::vector<const double*> vec;
-    for (int i = 0; i < N; i++) {
-      vec.emplace_back(knots[s + i].data());
+  /// @brief Evaluate value and time derivatives at many timestamps at once.
+  ///
+  /// Value, velocity and acceleration are computed in one pass of
+  /// evaluate_lie per timestamp. With the knot delta cache enabled, SO(3) and
+  /// SE(3) splines are evaluated with CeresSplineHelperSimd on groups of
+  /// timestamps, in float with float queries enabled. Outputs that are
+  /// nullptr are skipped, the others must have room for num_times elements.
+  ///
+  /// @param[in] times_ns timestamps sorted in ascending order
+  /// @param[in] num_times number of timestamps
+  /// @param[out] value_out if not nullptr values of the spline
+  /// @param[out] vel_out if not nullptr velocities in the body frame
+  /// @param[out] accel_out if not nullptr accelerations in the body frame
+  void evaluateBatch(const int64_t* times_ns, size_t num_times,
+                     Groupd* value_out, Tangentd* vel_out = nullptr,
+                     Tangentd* accel_out = nullptr) const {
+    if (use_knot_snapshots) {
+      const auto snapshot = knot_snapshots.read();
+
+      // Before the first publication the knots are queried directly.
+      if (snapshot->version >= 0) {
+        const Tangentd* deltas =
+            snapshot->deltas.empty() ? nullptr : snapshot->deltas.data();
+
+        forEachSortedTime(
+            times_ns, num_times, start_t_ns, dt_ns,
+            [&](size_t i, int64_t s, double u) {
+              evaluateSegment(snapshot->knots, s, u, deltas,
+                              value_out ? &value_out[i] : nullptr,
+                              vel_out ? &vel_out[i] : nullptr,
+                              accel_out ? &accel_out[i] : nullptr);
+            });
+        return;
+      }
     }
 
-    Tangentd res, tmp;
-    CeresSplineHelper<N>::template evaluate_lie<double, GroupT>(
-        &vec[0], u, inv_dt, nullptr, &tmp, &res);
+    if constexpr (CeresSplineHelperSimd<N>::template supports<GroupT>()) {
+      if (use_float_queries) {
+        evaluateBatchSimd<float>(times_ns, num_times, value_out, vel_out,
+                                 accel_out);
+        return;
+      }
+      if (use_knot_delta_cache) {
+        evaluateBatchSimd<double>(times_ns, num_times, value_out, vel_out,
+                                  accel_out);
+        return;
+      }
+    }
 
-    return res;
+    const Tangentd* deltas =
+        use_knot_delta_cache ? knot_delta_cache.get(knots) : nullptr;
+
+    forEachSortedTime(
+        times_ns, num_times, start_t_ns, dt_ns,
+        [&](size_t i, int64_t s, double u) {
+          evaluateSegment(knots, s, u, deltas,
+                          value_out ? &value_out[i] : nullptr,
+                          vel_out ? &vel_out[i] : nullptr,
+                          accel_out ? &accel_out[i] : nullptr);
+        });
   }
 
   int64_t maxTimeNs() const {
@@ -265,6 +358,8 @@ class CeresLieGroupSpline {
   int64_t minTimeNs() const { return start_t_ns; }
 
   ceres::Solver::Summary optimize() {
+    addSegmentBatches();
+
     ceres::Solver::Options options;
     options.gradient_tolerance = 0.01 * Sophus::Constants<double>::epsilon();
     options.function_tolerance = 0.01 * Sophus::Constants<double>::epsilon();
@@ -272,22 +367,295 @@ class CeresLieGroupSpline {
     options.max_num_iterations = 200;
     options.num_threads = 1;
 
+    KnotSnapshotCallback<Groupd> snapshot_callback(knot_snapshots, knots,
+                                                   use_knot_delta_cache);
+    if (use_knot_snapshots) {
+      options.update_state_every_iteration = true;
+      options.callbacks.push_back(&snapshot_callback);
+    }
+
     // Solve
     ceres::Solver::Summary summary;
     Solve(options, &problem, &summary);
     std::cout << summary.FullReport() << std::endl;
 
+    knot_delta_cache.invalidate();
+
+    // Readers must see the final knots even if they hold all slots.
+    const bool published = publishKnots();
+    BASALT_ASSERT_MSG(published, "All knot snapshot slots are held");
+    UNUSED(published);
+
     return summary;
   }
 
   const Groupd& getKnot(int i) const { return knots[i]; }
-  Groupd& getKnot(int i) { return knots[i]; }
+
+  /// @brief Write the knots to a spline file, see MappedSpline.
+  ///
+  /// SO(3) and SE(3) only.
+  bool save(const std::string& path) const {
+    static_assert(std::is_same<Groupd, Sophus::SO3d>::value ||
+                      std::is_same<Groupd, Sophus::SE3d>::value,
+                  "Only SO3 and SE3.");
+
+    const SplineFileGroup group = Groupd::DoF == 3 ? SplineFileGroup::SO3
+                                                   : SplineFileGroup::SE3;
+
+    return writeSplineFile(path, group, N, start_t_ns, dt_ns, knots.size(),
+                           [&](size_t i, double* params) {
+                             Eigen::Map<Groupd>{params} = knots[i];
+                           });
+  }
+
+  /// Set knot i. Invalidates the knot delta cache and the float knots
+  /// after writing it, so later queries see the new knot.
+  void setKnot(int i, const Groupd& knot) {
+    knots[i] = knot;
+    knot_delta_cache.invalidate();
+  }
+
+  /// @brief Cache the knot differences log(k_i^{-1} * k_{i+1}) for queries.
+  ///
+  /// With the cache enabled getValue, getVel, getAccel and evaluateBatch
+  /// reuse the differences instead of recomputing DEG log maps per query. The
+  /// cache is invalidated by optimize() and by setKnot. Residuals are not
+  /// affected.
+  void setKnotDeltaCache(bool enable) {
+    use_knot_delta_cache = enable;
+    knot_delta_cache.invalidate();
+  }
+
+  /// @brief Collect the measurements of one kind per knot segment.
+  ///
+  /// With batching enabled the add*Measurement functions collect all
+  /// measurements of one kind that fall into the same segment, and optimize()
+  /// adds one residual block per segment and kind instead of one per
+  /// measurement. Autodiff residuals of a batch share the knot differences of
+  /// the segment. Affects measurements added after the call.
+  void setSegmentBatching(bool enable) { batch_segments = enable; }
+
+  /// @brief Evaluate evaluateBatch from a float copy of the knots.
+  ///
+  /// For SO(3) and SE(3) splines evaluateBatch then reads a float
+  /// structure-of-arrays knot store, rebuilt from the double knots on the
+  /// first query after optimize() or setKnot, and evaluates it
+  /// with the float kernels of CeresSplineHelperSimd. Optimization and the
+  /// single time queries stay in double. See eval_float_spline for the
+  /// accuracy compared to double.
+  void setFloatQueries(bool enable) { use_float_queries = enable; }
+
+  /// @brief Answer queries from published snapshots of the knots.
+  ///
+  /// With snapshots enabled optimize() publishes a copy of the knots after
+  /// every accepted solver step, see KnotSnapshots, and getValue, getVel,
+  /// getAccel and evaluateBatch read the latest snapshot instead of the knots
+  /// Ceres is modifying. Other threads can then query the spline while it is
+  /// optimized, without locks and always from the knots of one iteration.
+  /// With the knot delta cache enabled the snapshots include the knot
+  /// differences. Float queries are not used with snapshots.
+  void setKnotSnapshots(bool enable) {
+    use_knot_snapshots = enable;
+    publishKnots();
+  }
+
+  /// @brief Publish the current knots to the readers, e.g. after modifying
+  /// them through setKnot. init and optimize publish automatically.
+  ///
+  /// Adds a snapshot slot if readers hold all others.
+  ///
+  /// @return false if readers hold all KnotSnapshots::max_slots slots
+  bool publishKnots() {
+    if (use_knot_snapshots) {
+      return knot_snapshots.publish(knots, use_knot_delta_cache, -1, true);
+    }
+    return true;
+  }
+
+  /// @brief Latest published snapshot for several consistent queries.
+  ///
+  /// Holding the reader for a long time keeps its slot from being reused,
+  /// and the optimization skips snapshots of its iterations while no slot
+  /// is free. The snapshot is empty, with version -1, before the first
+  /// publication.
+  typename KnotSnapshots<Groupd>::Reader readKnotSnapshot() const {
+    return knot_snapshots.read();
+  }
 
  private:
+  /// Parameter blocks of the residuals: the N knots of a segment.
+  using KnotBlockSizes = RepeatedBlockSizes<N, Groupd::num_parameters>;
+
+  /// Residuals of one kind in one segment, see setSegmentBatching.
+  template <class FunctorT>
+  using SegmentBatch =
+      std::conditional_t<ANALYTIC_JACOBIAN, StackedCostFunction<KnotBlockSizes>,
+                         SegmentBatchCostFunctor<FunctorT>>;
+
+  /// Add the collected segment batches to the problem.
+  void addSegmentBatches() {
+    addSegmentBatches(value_batches);
+    addSegmentBatches(vel_batches);
+    addSegmentBatches(accel_batches);
+  }
+
+  template <class BatchT>
+  void addSegmentBatches(SegmentBatches<BatchT>& batches) {
+    batches.release([&](int64_t s, BatchT* batch) {
+      ceres::CostFunction* cost_function;
+
+      if constexpr (ANALYTIC_JACOBIAN) {
+        cost_function = batch;
+      } else {
+        const int num_residuals = batch->numResiduals();
+        cost_function = newAutoDiffCostFunction<ceres::DYNAMIC>(
+            batch, KnotBlockSizes(), num_residuals);
+      }
+
+      std::vector<double*> vec;
+      for (int i = 0; i < N; i++) {
+        vec.emplace_back(knots[s + i].data());
+      }
+
+      problem.AddResidualBlock(cost_function, NULL, vec);
+    });
+  }
+
+  /// evaluateBatch with CeresSplineHelperSimd in Scalar precision.
+  template <class Scalar>
+  void evaluateBatchSimd(const int64_t* times_ns, size_t num_times,
+                         Groupd* value_out, Tangentd* vel_out,
+                         Tangentd* accel_out) const {
+    using Simd = CeresSplineHelperSimd<N, Scalar>;
+    using ArrD = Eigen::Array<double, Simd::Lanes, 1>;
+
+    const typename Simd::template SoA<GroupT>& soa =
+        knot_delta_cache.template getSoA<Scalar>(knots);
+
+    forEachSortedTimeLanes<Simd::Lanes>(
+        times_ns, num_times, start_t_ns, dt_ns,
+        [&](size_t i0, int num_valid, const int64_t* s, const double* u) {
+          BASALT_ASSERT_STREAM(size_t(s[num_valid - 1] + N) <= knots.size(),
+                               "s " << s[num_valid - 1] << " N " << N
+                                    << " knots.size() " << knots.size());
+
+          typename Simd::template ValueArr<GroupT> value;
+          typename Simd::template TangentArr<GroupT> vel, accel;
+
+          Simd::template evaluate_lie<GroupT>(
+              soa, s, Eigen::Map<const ArrD>(u).template cast<Scalar>(),
+              inv_dt, value_out ? &value : nullptr, vel_out ? &vel : nullptr,
+              accel_out ? &accel : nullptr);
+
+          for (int l = 0; l < num_valid; l++) {
+            if (value_out) {
+              Eigen::Matrix<double, Groupd::num_parameters, 1> params =
+                  value.row(l).transpose().template cast<double>();
+              if constexpr (!std::is_same<Scalar, double>::value) {
+                // Renormalize the rounded quaternion.
+                params.template head<4>().normalize();
+              }
+              value_out[i0 + l] = Eigen::Map<Groupd const>(params.data());
+            }
+            if (vel_out) {
+              vel_out[i0 + l] = vel.row(l).transpose().template cast<double>();
+            }
+            if (accel_out) {
+              accel_out[i0 + l] =
+                  accel.row(l).transpose().template cast<double>();
+            }
+          }
+        });
+  }
+
+  void evaluate(int64_t time_ns, Groupd* value_out,
+                Tangentd* vel_out = nullptr,
+                Tangentd* accel_out = nullptr) const {
+    int64_t st_ns = (time_ns - start_t_ns);
+
+    BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns " << time_ns
+                                              << " start_t_ns " << start_t_ns);
+
+    int64_t s = st_ns / dt_ns;
+    double u = double(st_ns % dt_ns) / double(dt_ns);
+
+    if (use_knot_snapshots) {
+      const auto snapshot = knot_snapshots.read();
+
+      // Before the first publication the knots are queried directly.
+      if (snapshot->version >= 0) {
+        const Tangentd* deltas =
+            snapshot->deltas.empty() ? nullptr : snapshot->deltas.data();
+
+        evaluateSegment(snapshot->knots, s, u, deltas, value_out, vel_out,
+                        accel_out, coeff_table.find(st_ns % dt_ns));
+        return;
+      }
+    }
+
+    const Tangentd* deltas =
+        use_knot_delta_cache ? knot_delta_cache.get(knots) : nullptr;
+
+    evaluateSegment(knots, s, u, deltas, value_out, vel_out, accel_out,
+                    coeff_table.find(st_ns % dt_ns));
+  }
+
+  /// Evaluate segment s of query_knots, the knots or a snapshot, at u.
+  /// With knot differences the blending coefficients are taken from coeffs
+  /// if it is not nullptr.
+  void evaluateSegment(const Eigen::aligned_vector<Groupd>& query_knots,
+                       int64_t s, double u, const Tangentd* deltas,
+                       Groupd* value_out, Tangentd* vel_out,
+                       Tangentd* accel_out,
+                       const SplineCoeffs<N>* coeffs = nullptr) const {
+    BASALT_ASSERT_STREAM(s >= 0, "s " << s);
+    BASALT_ASSERT_STREAM(size_t(s + N) <= query_knots.size(),
+                         "s " << s << " N " << N << " knots.size() "
+                              << query_knots.size());
+
+    if (deltas && coeffs) {
+      CeresSplineHelperDelta<N>::template evaluate_lie<double, GroupT>(
+          query_knots[s].data(), deltas + s, *coeffs, value_out, vel_out,
+          accel_out);
+    } else if (deltas) {
+      CeresSplineHelperDelta<N>::template evaluate_lie<double, GroupT>(
+          query_knots[s].data(), deltas + s, u, inv_dt, value_out, vel_out,
+          accel_out);
+    } else {
+      std::array<const double*, N> vec;
+      for (int i = 0; i < N; i++) {
+        vec[i] = query_knots[s + i].data();
+      }
+
+      CeresSplineHelper<N>::template evaluate_lie<double, GroupT>(
+          vec.data(), u, inv_dt, value_out, vel_out, accel_out);
+    }
+  }
+
   int64_t dt_ns, start_t_ns;
   double inv_dt;
 
+  /// Blending coefficients of the measurement times, see SplineCoeffTable.
+  SplineCoeffTable<N> coeff_table;
+
   Eigen::aligned_vector<Groupd> knots;
 
+  bool use_knot_delta_cache = false;
+  bool use_float_queries = false;
+  mutable KnotDeltaCache<Groupd> knot_delta_cache;
+
+  bool use_knot_snapshots = false;
+  KnotSnapshots<Groupd> knot_snapshots;
+
+  bool batch_segments = false;
+  SegmentBatches<SegmentBatch<LieGroupSplineValueCostFunctor<N, GroupT>>>
+      value_batches;
+  SegmentBatches<SegmentBatch<
+      LieGroupSplineVelocityCostFunctor<N, GroupT, OLD_TIME_DERIV>>>
+      vel_batches;
+  SegmentBatches<SegmentBatch<
+      LieGroupSplineAccelerationCostFunctor<N, GroupT, OLD_TIME_DERIV>>>
+      accel_batches;
+
   ceres::Problem problem;
 };
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <basalt/utils/assert.h>
+#include <basalt/spline/ceres_local_param.hpp>
+#include <basalt/utils/eigen_utils.hpp>
+
+#include <ceres/ceres.h>
+#include <ceres_lie_residuals.h>
+#include <ceres_nonuniform_knots.h>
+
+#include <array>
+#include <deque>
+
+/// @brief Lie group spline with non-uniform knot spacing fitted with Ceres.
+///
+/// Same residuals as CeresLieGroupSpline, but segment s covers the time
+/// range given by NonUniformKnotTimes, e.g. from planKnotTimes, so static
+/// periods can be covered by few knots. The segment of a measurement is found
+/// by binary search and its blending coefficients are computed once when the
+/// measurement is added. SO(3) and SE(3) only, since the residuals take the
+/// coefficients through the quaternion kernels of CeresSplineHelperGroup.
+template <int _N, template <class> class GroupT>
+class CeresLieGroupSplineNonUniform {
+ public:
+  static constexpr int N = _N;        // Order of the spline.
+  static constexpr int DEG = _N - 1;  // Degree of the spline.
+
+  static_assert(CeresSplineHelperGroup<N>::template has_quat_kernel<GroupT>(),
+                "Only SO3 and SE3.");
+
+  static constexpr double s_to_ns = 1e9;  ///< Second to nanosecond conversion
+
+  using Groupd = GroupT<double>;
+  using Tangentd = typename GroupT<double>::Tangent;
+
+  /// @param[in] segment_times_ns segment times, see NonUniformKnotTimes
+  explicit CeresLieGroupSplineNonUniform(
+      std::vector<int64_t> segment_times_ns)
+      : knot_times(std::move(segment_times_ns)) {}
+
+  void init(const Groupd& init) {
+    knots = Eigen::aligned_vector<Groupd>(knot_times.numKnots(), init);
+    addParameterBlocks();
+  }
+
+  void initRandom() {
+    knots = Eigen::aligned_vector<Groupd>(knot_times.numKnots());
+    for (auto& k : knots) k = Groupd::exp(Tangentd::Random());
+    addParameterBlocks();
+  }
+
+  void addMeasurement(const Groupd& meas, int64_t time_ns) {
+    int64_t s;
+    double u, inv_dt;
+    const SplineCoeffs<N>* coeffs = addCoeffs(time_ns, 0, &s, &u, &inv_dt);
+
+    using FunctorT = LieGroupSplineValueCostFunctor<N, GroupT>;
+    addResidual(newAutoDiffCostFunction<Groupd::DoF>(
+                    new FunctorT(meas, u, coeffs), KnotBlockSizes()),
+                s);
+  }
+
+  void addVelMeasurement(const Tangentd& meas, int64_t time_ns) {
+    int64_t s;
+    double u, inv_dt;
+    const SplineCoeffs<N>* coeffs = addCoeffs(time_ns, 1, &s, &u, &inv_dt);
+
+    using FunctorT = LieGroupSplineVelocityCostFunctor<N, GroupT, false>;
+    addResidual(newAutoDiffCostFunction<Groupd::DoF>(
+                    new FunctorT(meas, u, inv_dt, 1, coeffs), KnotBlockSizes()),
+                s);
+  }
+
+  void addAccelMeasurement(const Tangentd& meas, int64_t time_ns) {
+    int64_t s;
+    double u, inv_dt;
+    const SplineCoeffs<N>* coeffs = addCoeffs(time_ns, 2, &s, &u, &inv_dt);
+
+    using FunctorT = LieGroupSplineAccelerationCostFunctor<N, GroupT, false>;
+    addResidual(newAutoDiffCostFunction<Groupd::DoF>(
+                    new FunctorT(meas, u, inv_dt, coeffs), KnotBlockSizes()),
+                s);
+  }
+
+  Groupd getValue(int64_t time_ns) const {
+    Groupd res;
+    evaluate<LIE_VALUE>(time_ns, &res);
+    return res;
+  }
+
+  Tangentd getVel(int64_t time_ns) const {
+    Tangentd res;
+    evaluate<LIE_VEL>(time_ns, nullptr, &res);
+    return res;
+  }
+
+  Tangentd getAccel(int64_t time_ns) const {
+    Tangentd res;
+    evaluate<LIE_ACCEL>(time_ns, nullptr, nullptr, &res);
+    return res;
+  }
+
+  int64_t maxTimeNs() const { return knot_times.maxTimeNs(); }
+
+  int64_t minTimeNs() const { return knot_times.minTimeNs(); }
+
+  size_t numKnots() const { return knots.size(); }
+
+  const NonUniformKnotTimes<N>& getKnotTimes() const { return knot_times; }
+
+  ceres::Solver::Summary optimize() {
+    ceres::Solver::Options options;
+    options.gradient_tolerance = 0.01 * Sophus::Constants<double>::epsilon();
+    options.function_tolerance = 0.01 * Sophus::Constants<double>::epsilon();
+    options.linear_solver_type = ceres::SPARSE_NORMAL_CHOLESKY;
+    options.max_num_iterations = 200;
+    options.num_threads = 1;
+
+    // Solve
+    ceres::Solver::Summary summary;
+    Solve(options, &problem, &summary);
+    std::cout << summary.FullReport() << std::endl;
+
+    return summary;
+  }
+
+  const Groupd& getKnot(int i) const { return knots[i]; }
+
+  Groupd& getKnot(int i) { return knots[i]; }
+
+ private:
+  /// Parameter blocks of the residuals: the N knots of a segment.
+  using KnotBlockSizes = RepeatedBlockSizes<N, Groupd::num_parameters>;
+
+  void addParameterBlocks() {
+    for (size_t i = 0; i < knots.size(); i++) {
+      ceres::LocalParameterization* local_parameterization =
+          new LieLocalParameterization<Groupd>();
+
+      problem.AddParameterBlock(knots[i].data(), Groupd::num_parameters,
+                                local_parameterization);
+    }
+  }
+
+  /// @brief Segment and blending coefficients of a measurement at time_ns.
+  ///
+  /// u and inv_dt are the normalized time and inverse length of the
+  /// segment, the residuals only use them without coefficients.
+  const SplineCoeffs<N>* addCoeffs(int64_t time_ns, int max_deriv,
+                                   int64_t* s, double* u, double* inv_dt) {
+    *s = knot_times.segment(time_ns);
+
+    const int64_t seg_start_ns = knot_times.segmentStartNs(*s);
+    const int64_t seg_dt_ns = knot_times.segmentStartNs(*s + 1) - seg_start_ns;
+
+    *u = double(time_ns - seg_start_ns) / double(seg_dt_ns);
+    *inv_dt = s_to_ns / seg_dt_ns;
+
+    coeffs.emplace_back(knot_times.coeffs(*s, time_ns, max_deriv));
+    return &coeffs.back();
+  }
+
+  void addResidual(ceres::CostFunction* cost_function, int64_t s) {
+    std::vector<double*> vec;
+    for (int i = 0; i < N; i++) {
+      vec.emplace_back(knots[s + i].data());
+    }
+
+    problem.AddResidualBlock(cost_function, NULL, vec);
+  }
+
+  template <int OUT>
+  void evaluate(int64_t time_ns, Groupd* value_out,
+                Tangentd* vel_out = nullptr,
+                Tangentd* accel_out = nullptr) const {
+    using Helper = CeresSplineHelperGroup<N>;
+
+    const int64_t s = knot_times.segment(time_ns);
+    const SplineCoeffs<N> c =
+        knot_times.coeffs(s, time_ns, Helper::template max_deriv<OUT>());
+
+    std::array<const double*, N> vec;
+    for (int i = 0; i < N; i++) {
+      vec[i] = knots[s + i].data();
+    }
+
+    typename Helper::template KnotDeltas<double, GroupT> deltas;
+    Helper::template knot_deltas<double, GroupT>(vec.data(), deltas.data());
+    Helper::template evaluate_lie_delta<OUT, double, GroupT>(
+        vec[0], deltas.data(), c, value_out, vel_out, accel_out);
+  }
+
+  NonUniformKnotTimes<N> knot_times;
+
+  Eigen::aligned_vector<Groupd> knots;
+
+  /// Blending coefficients of the measurements. The residuals point to them,
+  /// and a deque never moves its elements.
+  std::deque<SplineCoeffs<N>, Eigen::aligned_allocator<SplineCoeffs<N>>>
+      coeffs;
+
+  ceres::Problem problem;
+};
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <basalt/utils/assert.h>
+
+#include <Eigen/Core>
+
+#include <ceres_spline_coeff_table.h>
+
+/// @brief Segment times of a non-uniform B-spline of order N.
+///
+/// Segment s covers [times_ns[s], times_ns[s + 1]) and is blended from knots
+/// s to s + DEG, like segment s of a uniform spline, so S segments need
+/// S + DEG knots. The knot vector of the B-spline basis is extended by DEG
+/// virtual times before the first and after the last segment, repeating the
+/// first and last segment length. With equally spaced times the blending
+/// coefficients are those of the uniform spline.
+///
+/// coeffs() computes the cumulative blending coefficients and their time
+/// derivatives with the Cox-de Boor recursion, in the layout of SplineCoeffs,
+/// so the residual functors and evaluate_lie_delta of the uniform splines
+/// evaluate non-uniform splines without changes.
+template <int _N>
+class NonUniformKnotTimes {
+ public:
+  static constexpr int N = _N;        // Order of the spline.
+  static constexpr int DEG = _N - 1;  // Degree of the spline.
+
+  static constexpr double ns_to_s = 1e-9;  ///< Nanosecond to second conversion
+
+  NonUniformKnotTimes() = default;
+
+  /// @param[in] segment_times_ns strictly increasing start times of the
+  /// segments followed by the end time of the last segment
+  explicit NonUniformKnotTimes(std::vector<int64_t> segment_times_ns)
+      : times_ns(std::move(segment_times_ns)) {
+    BASALT_ASSERT_STREAM(times_ns.size() >= 2,
+                         "times_ns.size() " << times_ns.size());
+
+    for (size_t i = 1; i < times_ns.size(); i++) {
+      BASALT_ASSERT_STREAM(times_ns[i] > times_ns[i - 1],
+                           "times are not increasing at index " << i);
+    }
+
+    // Extended knot vector in seconds since the start of the spline.
+    const size_t num_times = times_ns.size();
+    const double dt_first = ns_to_s * (times_ns[1] - times_ns[0]);
+    const double dt_last =
+        ns_to_s * (times_ns[num_times - 1] - times_ns[num_times - 2]);
+
+    tau.resize(num_times + 2 * DEG);
+    for (int i = 0; i < DEG; i++) tau[i] = -(DEG - i) * dt_first;
+    for (size_t i = 0; i < num_times; i++) {
+      tau[DEG + i] = ns_to_s * (times_ns[i] - times_ns[0]);
+    }
+    for (int i = 1; i <= DEG; i++) {
+      tau[DEG + num_times - 1 + i] = tau[DEG + num_times - 1] + i * dt_last;
+    }
+  }
+
+  size_t numSegments() const { return times_ns.size() - 1; }
+
+  size_t numKnots() const { return numSegments() + DEG; }
+
+  int64_t minTimeNs() const { return times_ns.front(); }
+
+  int64_t maxTimeNs() const { return times_ns.back() - 1; }
+
+  /// Start time of segment s, s = numSegments() gives the end time.
+  int64_t segmentStartNs(int64_t s) const { return times_ns[s]; }
+
+  /// @brief Segment that contains time_ns, found by binary search.
+  int64_t segment(int64_t time_ns) const {
+    BASALT_ASSERT_STREAM(time_ns >= minTimeNs() && time_ns <= maxTimeNs(),
+                         "time_ns " << time_ns << " minTimeNs " << minTimeNs()
+                                    << " maxTimeNs " << maxTimeNs());
+
+    auto it = std::upper_bound(times_ns.begin(), times_ns.end(), time_ns);
+    return (it - times_ns.begin()) - 1;
+  }
+
+  /// @brief Cumulative blending coefficients of segment s at time_ns.
+  ///
+  /// Time derivatives are with respect to seconds, like those of
+  /// SplineCoeffs with inv_dt.
+  ///
+  /// @param[in] s segment that contains time_ns
+  /// @param[in] time_ns time of the evaluation
+  /// @param[in] max_deriv highest time derivative to compute, the
+  /// coefficients of higher derivatives are left uninitialized
+  SplineCoeffs<N> coeffs(int64_t s, int64_t time_ns, int max_deriv = 3) const {
+    BASALT_ASSERT_STREAM(time_ns >= times_ns[s] && time_ns < times_ns[s + 1],
+                         "time_ns " << time_ns << " s " << s);
+
+    const double t = ns_to_s * (time_ns - times_ns[0]);
+
+    // Basis functions of knots s..s + DEG and their derivatives, algorithm
+    // A2.3 of Piegl and Tiller, The NURBS Book.
+    const int span = s + DEG;
+    const int num_deriv = std::min(max_deriv, DEG);
+
+    double ndu[N][N], left[N], right[N];
+    ndu[0][0] = 1;
+    for (int j = 1; j <= DEG; j++) {
+      left[j] = t - tau[span + 1 - j];
+      right[j] = tau[span + j] - t;
+
+      double saved = 0;
+      for (int r = 0; r < j; r++) {
+        ndu[j][r] = right[r + 1] + left[j - r];
+        const double temp = ndu[r][j - 1] / ndu[j][r];
+        ndu[r][j] = saved + right[r + 1] * temp;
+        saved = left[j - r] * temp;
+      }
+      ndu[j][j] = saved;
+    }
+
+    double ders[4][N];
+    for (int j = 0; j <= DEG; j++) ders[0][j] = ndu[j][DEG];
+
+    double a[2][N];
+    for (int r = 0; r <= DEG; r++) {
+      int s1 = 0, s2 = 1;
+      a[0][0] = 1;
+
+      for (int k = 1; k <= num_deriv; k++) {
+        double d = 0;
+        const int rk = r - k;
+        const int pk = DEG - k;
+
+        if (r >= k) {
+          a[s2][0] = a[s1][0] / ndu[pk + 1][rk];
+          d = a[s2][0] * ndu[rk][pk];
+        }
+
+        const int j1 = rk >= -1 ? 1 : -rk;
+        const int j2 = r - 1 <= pk ? k - 1 : DEG - r;
+        for (int j = j1; j <= j2; j++) {
+          a[s2][j] = (a[s1][j] - a[s1][j - 1]) / ndu[pk + 1][rk + j];
+          d += a[s2][j] * ndu[rk + j][pk];
+        }
+
+        if (r <= pk) {
+          a[s2][k] = -a[s1][k - 1] / ndu[pk + 1][r];
+          d += a[s2][k] * ndu[r][pk];
+        }
+
+        ders[k][r] = d;
+        std::swap(s1, s2);
+      }
+    }
+
+    double factor = DEG;
+    for (int k = 1; k <= num_deriv; k++) {
+      for (int j = 0; j <= DEG; j++) ders[k][j] *= factor;
+      factor *= DEG - k;
+    }
+    for (int k = num_deriv + 1; k <= std::min(max_deriv, 3); k++) {
+      for (int j = 0; j <= DEG; j++) ders[k][j] = 0;
+    }
+
+    // Cumulative coefficients: sums of the basis functions from knot j on.
+    SplineCoeffs<N> res;
+    typename SplineCoeffs<N>::VecN* out[4] = {&res.coeff, &res.dcoeff,
+                                             &res.ddcoeff, &res.dddcoeff};
+    for (int k = 0; k <= std::min(max_deriv, 3); k++) {
+      double sum = 0;
+      for (int j = DEG; j >= 0; j--) {
+        sum += ders[k][j];
+        (*out[k])[j] = sum;
+      }
+    }
+
+    return res;
+  }
+
+ private:
+  std::vector<int64_t> times_ns;
+
+  /// Extended knot vector in seconds since times_ns[0].
+  std::vector<double> tau;
+};
+
+/// Parameters of planKnotTimes.
+struct KnotPlannerOptions {
+  /// Segment length at full excitation, also the planning resolution.
+  int64_t min_dt_ns = 10000000;
+  /// Segment length during static periods.
+  int64_t max_dt_ns = 160000000;
+  /// RMS angular velocity in rad/s that needs min_dt_ns segments.
+  double gyro_ref = 0.5;
+  /// RMS deviation of the specific force norm from gravity in m/s^2 that
+  /// needs min_dt_ns segments.
+  double accel_ref = 1.0;
+  double gravity_norm = 9.81;
+};
+
+/// @brief Choose segment times of a non-uniform spline from IMU data.
+///
+/// The time range is split into windows of min_dt_ns. The excitation of a
+/// window is the larger of the RMS gyro norm over gyro_ref and the RMS
+/// deviation of the accel norm from gravity over accel_ref. Segments are
+/// grown window by window until their summed excitation reaches one or their
+/// length reaches max_dt_ns, so the knot density follows the motion and long
+/// static periods are covered by few knots.
+///
+/// @param[in] gyro_data gyro samples sorted by time, with timestamp_ns and
+/// data members like basalt::GyroData
+/// @param[in] accel_data accel samples sorted by time, like basalt::AccelData
+/// @param[in] start_t_ns start time of the spline
+/// @param[in] end_t_ns last time the spline has to cover
+/// @return segment times for NonUniformKnotTimes
+template <class GyroVec, class AccelVec>
+std::vector<int64_t> planKnotTimes(const GyroVec& gyro_data,
+                                   const AccelVec& accel_data,
+                                   int64_t start_t_ns, int64_t end_t_ns,
+                                   const KnotPlannerOptions& options = {}) {
+  BASALT_ASSERT_STREAM(end_t_ns >= start_t_ns,
+                       "start_t_ns " << start_t_ns << " end_t_ns " << end_t_ns);
+  BASALT_ASSERT_STREAM(options.max_dt_ns >= options.min_dt_ns,
+                       "min_dt_ns " << options.min_dt_ns << " max_dt_ns "
+                                    << options.max_dt_ns);
+
+  const int64_t window_ns = options.min_dt_ns;
+  const size_t num_windows = (end_t_ns - start_t_ns) / window_ns + 1;
+
+  std::vector<double> gyro_sq(num_windows, 0), accel_sq(num_windows, 0);
+  std::vector<int> gyro_count(num_windows, 0), accel_count(num_windows, 0);
+
+  for (const auto& d : gyro_data) {
+    if (d.timestamp_ns < start_t_ns) continue;
+    const size_t w = (d.timestamp_ns - start_t_ns) / window_ns;
+    if (w >= num_windows) break;
+    gyro_sq[w] += d.data.squaredNorm();
+    gyro_count[w]++;
+  }
+
+  for (const auto& d : accel_data) {
+    if (d.timestamp_ns < start_t_ns) continue;
+    const size_t w = (d.timestamp_ns - start_t_ns) / window_ns;
+    if (w >= num_windows) break;
+    const double dev = d.data.norm() - options.gravity_norm;
+    accel_sq[w] += dev * dev;
+    accel_count[w]++;
+  }
+
+  std::vector<int64_t> times_ns{start_t_ns};
+  int64_t segment_start_ns = start_t_ns;
+  double excitation = 0;
+
+  for (size_t w = 0; w < num_windows; w++) {
+    const double gyro_rms =
+        gyro_count[w] > 0 ? std::sqrt(gyro_sq[w] / gyro_count[w]) : 0;
+    const double accel_rms =
+        accel_count[w] > 0 ? std::sqrt(accel_sq[w] / accel_count[w]) : 0;
+    excitation += std::max(gyro_rms / options.gyro_ref,
+                           accel_rms / options.accel_ref);
+
+    const int64_t window_end_ns = start_t_ns + (w + 1) * window_ns;
+
+    if (excitation >= 1 ||
+        window_end_ns - segment_start_ns >= options.max_dt_ns ||
+        w + 1 == num_windows) {
+      times_ns.emplace_back(window_end_ns);
+      segment_start_ns = window_end_ns;
+      excitation = 0;
+    }
+  }
+
+  return times_ns;
+}
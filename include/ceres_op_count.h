@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+
+#include <Eigen/Core>
+
+/// Arithmetic operations counted by OpCountScalar.
+struct OpCounts {
+  int64_t mul = 0;   ///< multiplications
+  int64_t add = 0;   ///< additions and subtractions
+  int64_t div = 0;   ///< divisions
+  int64_t func = 0;  ///< sqrt and transcendental function calls
+
+  OpCounts operator-(const OpCounts& other) const {
+    OpCounts res;
+    res.mul = mul - other.mul;
+    res.add = add - other.add;
+    res.div = div - other.div;
+    res.func = func - other.func;
+    return res;
+  }
+
+  bool operator==(const OpCounts& other) const {
+    return mul == other.mul && add == other.add && div == other.div &&
+           func == other.func;
+  }
+};
+
+/// @brief Scalar type that counts the arithmetic operations done on it.
+///
+/// Wraps a double and increments the counters of the current thread on
+/// every multiplication, addition, division and function call, so templated
+/// code like CeresSplineHelper::evaluate_lie can be instantiated with it to
+/// get exact, deterministic operation counts. Operations with double
+/// constants are counted as well, negation and comparisons are not. Use
+/// countOps to count the operations of a function call.
+struct OpCountScalar {
+  double v = 0;
+
+  OpCountScalar() = default;
+  OpCountScalar(double v) : v(v) {}
+
+  /// Counters of the current thread.
+  static OpCounts& counts() {
+    static thread_local OpCounts counts;
+    return counts;
+  }
+
+  OpCountScalar& operator+=(const OpCountScalar& o) {
+    return *this = *this + o;
+  }
+  OpCountScalar& operator-=(const OpCountScalar& o) {
+    return *this = *this - o;
+  }
+  OpCountScalar& operator*=(const OpCountScalar& o) {
+    return *this = *this * o;
+  }
+  OpCountScalar& operator/=(const OpCountScalar& o) {
+    return *this = *this / o;
+  }
+
+  friend OpCountScalar operator-(const OpCountScalar& a) { return -a.v; }
+
+  friend OpCountScalar operator+(const OpCountScalar& a,
+                                 const OpCountScalar& b) {
+    counts().add++;
+    return a.v + b.v;
+  }
+
+  friend OpCountScalar operator-(const OpCountScalar& a,
+                                 const OpCountScalar& b) {
+    counts().add++;
+    return a.v - b.v;
+  }
+
+  friend OpCountScalar operator*(const OpCountScalar& a,
+                                 const OpCountScalar& b) {
+    counts().mul++;
+    return a.v * b.v;
+  }
+
+  friend OpCountScalar operator/(const OpCountScalar& a,
+                                 const OpCountScalar& b) {
+    counts().div++;
+    return a.v / b.v;
+  }
+
+  // Overloads with double avoid ambiguities in mixed Eigen expressions.
+  friend OpCountScalar operator+(const OpCountScalar& a, double b) {
+    return a + OpCountScalar(b);
+  }
+  friend OpCountScalar operator+(double a, const OpCountScalar& b) {
+    return OpCountScalar(a) + b;
+  }
+  friend OpCountScalar operator-(const OpCountScalar& a, double b) {
+    return a - OpCountScalar(b);
+  }
+  friend OpCountScalar operator-(double a, const OpCountScalar& b) {
+    return OpCountScalar(a) - b;
+  }
+  friend OpCountScalar operator*(const OpCountScalar& a, double b) {
+    return a * OpCountScalar(b);
+  }
+  friend OpCountScalar operator*(double a, const OpCountScalar& b) {
+    return OpCountScalar(a) * b;
+  }
+  friend OpCountScalar operator/(const OpCountScalar& a, double b) {
+    return a / OpCountScalar(b);
+  }
+  friend OpCountScalar operator/(double a, const OpCountScalar& b) {
+    return OpCountScalar(a) / b;
+  }
+
+#define OP_COUNT_SCALAR_COMPARISON(op)                                     \
+  friend bool operator op(const OpCountScalar& a, const OpCountScalar& b) { \
+    return a.v op b.v;                                                     \
+  }                                                                        \
+  friend bool operator op(const OpCountScalar& a, double b) {              \
+    return a.v op b;                                                       \
+  }                                                                        \
+  friend bool operator op(double a, const OpCountScalar& b) {              \
+    return a op b.v;                                                       \
+  }
+
+  OP_COUNT_SCALAR_COMPARISON(<)
+  OP_COUNT_SCALAR_COMPARISON(<=)
+  OP_COUNT_SCALAR_COMPARISON(>)
+  OP_COUNT_SCALAR_COMPARISON(>=)
+  OP_COUNT_SCALAR_COMPARISON(==)
+  OP_COUNT_SCALAR_COMPARISON(!=)
+
+#undef OP_COUNT_SCALAR_COMPARISON
+
+  // Found by argument dependent lookup after "using std::sqrt;" etc.
+#define OP_COUNT_SCALAR_FUNCTION(name)                \
+  friend OpCountScalar name(const OpCountScalar& a) { \
+    counts().func++;                                  \
+    return std::name(a.v);                            \
+  }
+
+  OP_COUNT_SCALAR_FUNCTION(sqrt)
+  OP_COUNT_SCALAR_FUNCTION(sin)
+  OP_COUNT_SCALAR_FUNCTION(cos)
+  OP_COUNT_SCALAR_FUNCTION(tan)
+  OP_COUNT_SCALAR_FUNCTION(asin)
+  OP_COUNT_SCALAR_FUNCTION(acos)
+  OP_COUNT_SCALAR_FUNCTION(atan)
+  OP_COUNT_SCALAR_FUNCTION(exp)
+  OP_COUNT_SCALAR_FUNCTION(log)
+
+#undef OP_COUNT_SCALAR_FUNCTION
+
+  friend OpCountScalar atan2(const OpCountScalar& a, const OpCountScalar& b) {
+    counts().func++;
+    return std::atan2(a.v, b.v);
+  }
+
+  friend OpCountScalar pow(const OpCountScalar& a, const OpCountScalar& b) {
+    counts().func++;
+    return std::pow(a.v, b.v);
+  }
+
+  friend OpCountScalar abs(const OpCountScalar& a) { return std::abs(a.v); }
+
+  friend bool isfinite(const OpCountScalar& a) { return std::isfinite(a.v); }
+
+  friend std::ostream& operator<<(std::ostream& os, const OpCountScalar& a) {
+    return os << a.v;
+  }
+};
+
+/// Operations done on OpCountScalar by fn() in the current thread.
+template <class Func>
+OpCounts countOps(const Func& fn) {
+  const OpCounts start = OpCountScalar::counts();
+  fn();
+  return OpCountScalar::counts() - start;
+}
+
+namespace Eigen {
+
+template <>
+struct NumTraits<OpCountScalar> : GenericNumTraits<OpCountScalar> {
+  using Real = OpCountScalar;
+  using NonInteger = OpCountScalar;
+  using Nested = OpCountScalar;
+  using Literal = OpCountScalar;
+
+  enum {
+    IsComplex = 0,
+    IsInteger = 0,
+    IsSigned = 1,
+    RequireInitialization = 1,
+    ReadCost = 1,
+    AddCost = 1,
+    MulCost = 1
+  };
+
+  static inline Real epsilon() {
+    return std::numeric_limits<double>::epsilon();
+  }
+  static inline Real dummy_precision() {
+    return NumTraits<double>::dummy_precision();
+  }
+  static inline Real highest() { return std::numeric_limits<double>::max(); }
+  static inline Real lowest() { return -std::numeric_limits<double>::max(); }
+  static inline int digits10() { return NumTraits<double>::digits10(); }
+};
+
+// Allow products of OpCountScalar matrices with double blending coefficients.
+template <typename BinaryOp>
+struct ScalarBinaryOpTraits<OpCountScalar, double, BinaryOp> {
+  using ReturnType = OpCountScalar;
+};
+
+template <typename BinaryOp>
+struct ScalarBinaryOpTraits<double, OpCountScalar, BinaryOp> {
+  using ReturnType = OpCountScalar;
+};
+
+}  // namespace Eigen
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <ceres/cost_function.h>
+#include <ceres/sized_cost_function.h>
+
+#include <ceres_cost_function_helper.h>
+
+/// @brief Autodiff functor for all samples of one kind that fall into the
+/// same spline segment.
+///
+/// SampleFunctor is a residual functor that splits its evaluation into data
+/// that only depends on the parameter blocks, e.g. the knot differences of
+/// the segment, and the residual of one sample. It provides
+/// - kNumResiduals, the number of residuals of one sample
+/// - SegmentData<T>, computed once per evaluation by
+///   computeSegmentData(params, &data)
+/// - operator()(params, data, residuals) for one sample.
+/// The residuals of sample j are stored at residuals + j * kNumResiduals.
+template <class SampleFunctor>
+class SegmentBatchCostFunctor {
+ public:
+  void add(const SampleFunctor& functor) { functors.emplace_back(functor); }
+
+  int numResiduals() const {
+    return SampleFunctor::kNumResiduals * functors.size();
+  }
+
+  template <class T>
+  bool operator()(T const* const* params, T* residuals) const {
+    typename SampleFunctor::template SegmentData<T> data;
+    SampleFunctor::computeSegmentData(params, &data);
+
+    for (size_t j = 0; j < functors.size(); j++) {
+      if (!functors[j](params, data,
+                       residuals + j * SampleFunctor::kNumResiduals)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+ private:
+  std::vector<SampleFunctor, Eigen::aligned_allocator<SampleFunctor>> functors;
+};
+
+/// @brief Cost functions with the same parameter blocks stacked into one
+/// residual block.
+///
+/// Used for the analytic residuals of one spline segment, which share
+/// per-segment data through a KnotDeltaCallback if at all. Takes ownership
+/// of the added cost functions.
+template <class Blocks>
+class StackedCostFunction;
+
+template <int... Ns>
+class StackedCostFunction<BlockSizes<Ns...>>
+    : public ceres::SizedCostFunction<ceres::DYNAMIC, Ns...> {
+ public:
+  StackedCostFunction() { this->set_num_residuals(0); }
+
+  void add(ceres::CostFunction* cost_function) {
+    this->set_num_residuals(this->num_residuals() +
+                            cost_function->num_residuals());
+    cost_functions.emplace_back(cost_function);
+  }
+
+  bool Evaluate(double const* const* parameters, double* residuals,
+                double** jacobians) const override {
+    constexpr int block_sizes[] = {Ns...};
+
+    double* stacked_jacobians[sizeof...(Ns)];
+    int row = 0;
+
+    for (const auto& cost_function : cost_functions) {
+      if (jacobians) {
+        for (size_t i = 0; i < sizeof...(Ns); i++) {
+          stacked_jacobians[i] =
+              jacobians[i] ? jacobians[i] + row * block_sizes[i] : nullptr;
+        }
+      }
+
+      if (!cost_function->Evaluate(parameters, residuals + row,
+                                   jacobians ? stacked_jacobians : nullptr)) {
+        return false;
+      }
+
+      row += cost_function->num_residuals();
+    }
+
+    return true;
+  }
+
+ private:
+  std::vector<std::unique_ptr<ceres::CostFunction>> cost_functions;
+};
+
+/// @brief Residual batches collected per spline segment until they are added
+/// to the problem.
+template <class Batch>
+class SegmentBatches {
+ public:
+  /// Batch of segment s, created with args on first use.
+  template <class... Args>
+  Batch& get(int64_t s, Args&&... args) {
+    std::unique_ptr<Batch>& batch = batches[s];
+    if (!batch) batch.reset(new Batch(std::forward<Args>(args)...));
+    return *batch;
+  }
+
+  /// Call fn(s, batch) for all segments in ascending order, passing
+  /// ownership of the batches, and clear.
+  template <class Func>
+  void release(const Func& fn) {
+    for (auto& kv : batches) fn(kv.first, kv.second.release());
+    batches.clear();
+  }
+
+ private:
+  std::map<int64_t, std::unique_ptr<Batch>> batches;
+};
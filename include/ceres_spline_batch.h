@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include <basalt/utils/assert.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+/// @brief Iterate over a sorted array of timestamps segment by segment.
+///
+/// The range is split into TBB chunks. Each chunk computes the segment index
+/// of its first timestamp and only recomputes it when a sample leaves the
+/// current segment, so consecutive samples that fall into the same segment do
+/// not pay for an integer division.
+/// fn(i, s, u) is called for every timestamp with its segment index s and
+/// normalized time u in [0, 1).
+///
+/// @param[in] times_ns timestamps sorted in ascending order
+/// @param[in] num_times number of timestamps
+/// @param[in] start_t_ns start time of the spline
+/// @param[in] dt_ns knot spacing of the spline
+/// @param[in] fn functor called as fn(size_t i, int64_t s, double u)
+template <class Func>
+inline void forEachSortedTime(const int64_t* times_ns, size_t num_times,
+                              int64_t start_t_ns, int64_t dt_ns,
+                              const Func& fn) {
+  constexpr size_t grain_size = 256;
+
+  tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, num_times, grain_size),
+      [&](const tbb::blocked_range<size_t>& r) {
+        int64_t st_ns = times_ns[r.begin()] - start_t_ns;
+
+        BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns "
+                                                  << times_ns[r.begin()]
+                                                  << " start_t_ns "
+                                                  << start_t_ns);
+
+        int64_t s = st_ns / dt_ns;
+        int64_t seg_start_ns = s * dt_ns;
+
+        for (size_t i = r.begin(); i != r.end(); ++i) {
+          st_ns = times_ns[i] - start_t_ns;
+
+          BASALT_ASSERT_STREAM(st_ns >= seg_start_ns,
+                               "timestamps are not sorted at index " << i);
+
+          if (st_ns - seg_start_ns >= dt_ns) {
+            s = st_ns / dt_ns;
+            seg_start_ns = s * dt_ns;
+          }
+
+          double u = double(st_ns - seg_start_ns) / double(dt_ns);
+
+          fn(i, s, u);
+        }
+      });
+}
+
+/// @brief Iterate over a sorted array of timestamps in groups of Lanes.
+///
+/// Same as forEachSortedTime, but fn(i0, num_valid, s, u) receives the segment
+/// indices and normalized times of up to Lanes consecutive timestamps starting
+/// at index i0. If fewer than Lanes timestamps remain, the unused lanes repeat
+/// the last valid one, so kernels can always process full lanes.
+///
+/// @param[in] times_ns timestamps sorted in ascending order
+/// @param[in] num_times number of timestamps
+/// @param[in] start_t_ns start time of the spline
+/// @param[in] dt_ns knot spacing of the spline
+/// @param[in] fn functor called as fn(size_t i0, int num_valid,
+/// const int64_t* s, const double* u)
+template <int Lanes, class Func>
+inline void forEachSortedTimeLanes(const int64_t* times_ns, size_t num_times,
+                                   int64_t start_t_ns, int64_t dt_ns,
+                                   const Func& fn) {
+  constexpr size_t grain_size = 32 * Lanes;
+
+  size_t num_groups = (num_times + Lanes - 1) / Lanes;
+
+  tbb::parallel_for(
+      tbb::blocked_range<size_t>(0, num_groups, grain_size / Lanes),
+      [&](const tbb::blocked_range<size_t>& r) {
+        int64_t s[Lanes];
+        double u[Lanes];
+
+        size_t i0 = r.begin() * Lanes;
+        int64_t st_ns = times_ns[i0] - start_t_ns;
+
+        BASALT_ASSERT_STREAM(st_ns >= 0, "st_ns " << st_ns << " time_ns "
+                                                  << times_ns[i0]
+                                                  << " start_t_ns "
+                                                  << start_t_ns);
+
+        int64_t seg = st_ns / dt_ns;
+        int64_t seg_start_ns = seg * dt_ns;
+
+        for (size_t g = r.begin(); g != r.end(); ++g) {
+          i0 = g * Lanes;
+          int num_valid = int(std::min<size_t>(Lanes, num_times - i0));
+
+          for (int l = 0; l < num_valid; l++) {
+            st_ns = times_ns[i0 + l] - start_t_ns;
+
+            BASALT_ASSERT_STREAM(st_ns >= seg_start_ns,
+                                 "timestamps are not sorted at index "
+                                     << i0 + l);
+
+            if (st_ns - seg_start_ns >= dt_ns) {
+              seg = st_ns / dt_ns;
+              seg_start_ns = seg * dt_ns;
+            }
+
+            s[l] = seg;
+            u[l] = double(st_ns - seg_start_ns) / double(dt_ns);
+          }
+
+          for (int l = num_valid; l < Lanes; l++) {
+            s[l] = s[num_valid - 1];
+            u[l] = u[num_valid - 1];
+          }
+
+          fn(i0, num_valid, s, u);
+        }
+      });
+}
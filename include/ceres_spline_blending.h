@@ -0,0 +1,165 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include <Eigen/Core>
+
+namespace spline_blending_detail {
+
+template <class F, int... I>
+EIGEN_ALWAYS_INLINE void static_for_impl(F& f,
+                                         std::integer_sequence<int, I...>) {
+  (f(std::integral_constant<int, I>()), ...);
+}
+
+template <int N>
+using IntTable = std::array<std::array<int64_t, N>, N>;
+
+constexpr int64_t ipow(int64_t base, int exp) {
+  int64_t r = 1;
+  for (int i = 0; i < exp; i++) r *= base;
+  return r;
+}
+
+constexpr int64_t binomial(int n, int k) {
+  if (k < 0 || k > n) return 0;
+  int64_t r = 1;
+  for (int d = 1; d <= k; d++) r = r * (n - d + 1) / d;
+  return r;
+}
+
+constexpr int64_t factorial(int n) {
+  int64_t r = 1;
+  for (int i = 2; i <= n; i++) r *= i;
+  return r;
+}
+
+/// Blending matrix times (N - 1)!, same as basalt::computeBlendingMatrix.
+template <int N>
+constexpr IntTable<N> blendingNumerators(bool cumulative) {
+  IntTable<N> m{};
+
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      int64_t sum = 0;
+      for (int s = j; s < N; s++) {
+        const int64_t sign = (s - j) % 2 == 0 ? 1 : -1;
+        sum += sign * binomial(N, s - j) * ipow(N - s - 1, N - 1 - i);
+      }
+      m[j][i] = binomial(N - 1, N - 1 - i) * sum;
+    }
+  }
+
+  if (cumulative) {
+    for (int i = 0; i < N; i++) {
+      for (int j = i + 1; j < N; j++) {
+        for (int k = 0; k < N; k++) m[i][k] += m[j][k];
+      }
+    }
+  }
+
+  return m;
+}
+
+/// @brief Polynomial coefficients of the cumulative blending coefficients.
+///
+/// Entry [d][m][j] is the coefficient of u^m in the d-th derivative of the
+/// cumulative coefficient of knot j, i.e. row j of the cumulative blending
+/// matrix times the d-th derivative of [1, u, ..., u^{N-1}]. The
+/// coefficients of one power of u are contiguous.
+template <int N>
+constexpr std::array<std::array<std::array<double, N>, N>, N>
+cumulativePolynomials() {
+  constexpr IntTable<N> m = blendingNumerators<N>(true);
+  constexpr double inv_factorial = 1.0 / factorial(N - 1);
+
+  std::array<std::array<std::array<double, N>, N>, N> res{};
+  for (int d = 0; d < N; d++) {
+    for (int j = 0; j < N; j++) {
+      for (int k = d; k < N; k++) {
+        res[d][k - d][j] = double(m[j][k]) *
+                           double(factorial(k) / factorial(k - d)) *
+                           inv_factorial;
+      }
+    }
+  }
+  return res;
+}
+
+}  // namespace spline_blending_detail
+
+/// @brief Call f(std::integral_constant<int, I>()) for I = 0, ..., COUNT - 1.
+///
+/// Unrolls a loop at compile time, the index is a constant expression in the
+/// body, e.g. constexpr int i = decltype(idx)::value.
+template <int COUNT, class F>
+EIGEN_ALWAYS_INLINE void static_for(F&& f) {
+  spline_blending_detail::static_for_impl(
+      f, std::make_integer_sequence<int, COUNT>());
+}
+
+/// @brief Compile time blending coefficients of uniform B-splines of order N.
+///
+/// CeresSplineHelper computes its blending matrices at runtime and evaluates
+/// [1, u, ..., u^{N-1}] and the matrix product in loops over N. Here the
+/// cumulative blending matrix is folded into one polynomial per knot and
+/// derivative, computed at compile time, and cumulativeCoeffs evaluates the
+/// polynomials of all knots at once with an unrolled Horner scheme on
+/// vectors of N coefficients.
+template <int _N>
+struct SplineBlending {
+  static constexpr int N = _N;        // Order of the spline.
+  static constexpr int DEG = _N - 1;  // Degree of the spline.
+
+  static_assert(N >= 2 && N <= 10, "Order out of range.");
+
+  using VecN = Eigen::Matrix<double, _N, 1>;
+
+  /// See spline_blending_detail::cumulativePolynomials.
+  static constexpr auto cumulative_polynomials =
+      spline_blending_detail::cumulativePolynomials<_N>();
+
+  /// @brief Cumulative blending coefficients of time derivative DERIV.
+  ///
+  /// Same as scale * cumulative_blending_matrix_ * p, with p from
+  /// CeresSplineHelper::baseCoeffsWithTime<DERIV>(p, u).
+  ///
+  /// @param[in] u normalized time
+  /// @param[in] scale factor of the result, usually inv_dt^DERIV
+  /// @param[out] out array of N coefficients, zero for DERIV >= N
+  template <int DERIV>
+  EIGEN_ALWAYS_INLINE static void cumulativeCoeffs(double u, double scale,
+                                                   double* out) {
+    static_assert(DERIV >= 0, "Negative derivative.");
+
+    Eigen::Map<VecN> res(out);
+
+    if constexpr (DERIV >= N) {
+      res.setZero();
+    } else {
+      // Highest power of u in the polynomials.
+      constexpr int top = N - 1 - DERIV;
+
+      VecN r = power<DERIV, top>();
+      static_for<top>([&](auto idx) {
+        r = r * u + power<DERIV, top - 1 - decltype(idx)::value>();
+      });
+
+      if constexpr (DERIV == 0) {
+        res = r;
+      } else {
+        res = scale * r;
+      }
+    }
+  }
+
+ private:
+  /// Coefficients of u^M in the polynomials of all knots.
+  template <int DERIV, int M>
+  EIGEN_ALWAYS_INLINE static Eigen::Map<const VecN> power() {
+    return Eigen::Map<const VecN>(cumulative_polynomials[DERIV][M].data());
+  }
+};
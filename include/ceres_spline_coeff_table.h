@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+
+#include <basalt/spline/ceres_spline_helper.h>
+#include <basalt/utils/assert.h>
+
+#include <Eigen/Core>
+
+#include <ceres_spline_blending.h>
+
+using namespace basalt;
+
+/// @brief Cumulative blending coefficients of a B-spline of order N at one
+/// normalized time u.
+///
+/// coeff are the coefficients of the value, dcoeff, ddcoeff and dddcoeff
+/// those of the first three time derivatives, already scaled by inv_dt,
+/// inv_dt^2 and inv_dt^3 as in CeresSplineHelper::evaluate_lie. They only
+/// depend on u and inv_dt, not on the knots, and are computed with the
+/// unrolled compile time polynomials of SplineBlending.
+template <int _N>
+struct SplineCoeffs {
+  static constexpr int N = _N;  // Order of the spline.
+
+  using VecN = Eigen::Matrix<double, _N, 1>;
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  SplineCoeffs() = default;
+
+  /// @brief Compute the coefficients up to derivative max_deriv.
+  ///
+  /// @param[in] u normalized time in [0, 1)
+  /// @param[in] inv_dt inverse of the time spacing in seconds between spline
+  /// knots
+  /// @param[in] max_deriv highest time derivative to compute, the
+  /// coefficients of higher derivatives are left uninitialized
+  SplineCoeffs(double u, double inv_dt, int max_deriv = 3) {
+    using Blending = SplineBlending<N>;
+
+    Blending::template cumulativeCoeffs<0>(u, 1, coeff.data());
+
+    if (max_deriv >= 1) {
+      Blending::template cumulativeCoeffs<1>(u, inv_dt, dcoeff.data());
+    }
+    if (max_deriv >= 2) {
+      Blending::template cumulativeCoeffs<2>(u, inv_dt * inv_dt,
+                                             ddcoeff.data());
+    }
+    if (max_deriv >= 3) {
+      Blending::template cumulativeCoeffs<3>(u, inv_dt * inv_dt * inv_dt,
+                                             dddcoeff.data());
+    }
+  }
+
+  /// Coefficients of time derivative DERIV.
+  template <int DERIV>
+  const VecN& get() const {
+    static_assert(DERIV >= 0 && DERIV <= 3, "Only up to jerk.");
+
+    if constexpr (DERIV == 0) return coeff;
+    if constexpr (DERIV == 1) return dcoeff;
+    if constexpr (DERIV == 2) return ddcoeff;
+    if constexpr (DERIV == 3) return dddcoeff;
+  }
+
+  /// @brief Evaluate a Euclidean B-spline or one of its time derivatives.
+  ///
+  /// Same as CeresSplineHelper::evaluate. The blending coefficient of knot i
+  /// is the difference of the cumulative coefficients i and i + 1.
+  ///
+  /// @param[in] sKnots array of pointers of the spline knots. The size of
+  /// each knot should be DIM.
+  /// @param[out] transform_out value or time derivative of the spline
+  template <class T, int DIM, int DERIV>
+  void evaluate(T const* const* sKnots,
+                Eigen::Matrix<T, DIM, 1>* transform_out) const {
+    const VecN& c = get<DERIV>();
+
+    transform_out->setZero();
+
+    static_for<N>([&](auto idx) {
+      constexpr int i = decltype(idx)::value;
+      Eigen::Map<Eigen::Matrix<T, DIM, 1> const> const p(sKnots[i]);
+
+      const double b = i + 1 < N ? c[i] - c[i + 1] : c[i];
+      (*transform_out) += b * p;
+    });
+  }
+
+  VecN coeff, dcoeff, ddcoeff, dddcoeff;
+};
+
+/// @brief Blending coefficients shared by all samples at the same position in
+/// their spline segment.
+///
+/// With regularly sampled measurements, e.g. a 200 Hz IMU on a spline with
+/// 10 ms knot spacing, only a few distinct offsets st_ns % dt_ns occur. The
+/// table computes the SplineCoeffs of each distinct offset once, and residuals
+/// keep a pointer to the row instead of recomputing the coefficients on every
+/// evaluation. Rows are never moved, so the pointers stay valid for the
+/// lifetime of the table.
+///
+/// Irregular timestamps rarely share a row. Once max_rows offsets are in the
+/// table, row() returns nullptr for new offsets and callers compute the
+/// coefficients from u as before.
+template <int _N>
+class SplineCoeffTable {
+ public:
+  static constexpr int N = _N;  // Order of the spline.
+
+  static constexpr double s_to_ns = 1e9;  ///< Second to nanosecond conversion
+
+  /// @param[in] dt_ns time spacing between spline knots
+  /// @param[in] max_rows maximum number of distinct offsets in the table
+  explicit SplineCoeffTable(int64_t dt_ns, size_t max_rows = 1024)
+      : dt_ns(dt_ns), inv_dt(s_to_ns / dt_ns), max_rows(max_rows) {}
+
+  /// @brief Row of a sample at offset_ns in its segment, added if needed.
+  ///
+  /// @param[in] offset_ns time since the start of the segment, st_ns % dt_ns
+  /// @return coefficients for u = offset_ns / dt_ns, or nullptr if the table
+  /// is full
+  const SplineCoeffs<N>* row(int64_t offset_ns) {
+    BASALT_ASSERT_STREAM(offset_ns >= 0 && offset_ns < dt_ns,
+                         "offset_ns " << offset_ns << " dt_ns " << dt_ns);
+
+    auto it = index.find(offset_ns);
+    if (it != index.end()) return &rows[it->second];
+
+    if (rows.size() >= max_rows) return nullptr;
+
+    index.emplace(offset_ns, rows.size());
+    rows.emplace_back(double(offset_ns) / double(dt_ns), inv_dt);
+
+    return &rows.back();
+  }
+
+  /// Existing row of offset_ns or nullptr. Does not modify the table, so
+  /// const queries may call it concurrently.
+  const SplineCoeffs<N>* find(int64_t offset_ns) const {
+    auto it = index.find(offset_ns);
+    return it != index.end() ? &rows[it->second] : nullptr;
+  }
+
+  size_t size() const { return rows.size(); }
+
+ private:
+  int64_t dt_ns;
+  double inv_dt;
+  size_t max_rows;
+
+  std::unordered_map<int64_t, size_t> index;
+  std::deque<SplineCoeffs<N>, Eigen::aligned_allocator<SplineCoeffs<N>>> rows;
+};
@@ -0,0 +1,338 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <basalt/calibration/calibration.hpp>
+#include <basalt/serialization/headers_serialization.h>
+#include <basalt/spline/ceres_spline_helper.h>
+#include <basalt/utils/assert.h>
+
+#include <cereal/archives/binary.hpp>
+
+#include <sophus/se3.hpp>
+
+using namespace basalt;
+
+/// Knot types of the splines in a spline file.
+enum class SplineFileGroup : uint32_t {
+  SO3 = 0,    ///< Sophus::SO3d knots, 4 parameters
+  SE3 = 1,    ///< Sophus::SE3d knots, 7 parameters
+  SPLIT = 2,  ///< SO(3) and R^3 splines, 7 parameters like SE3
+};
+
+/// @brief Header at the start of a spline file.
+///
+/// The file is the header, the knot parameters as contiguous doubles at
+/// knots_offset and an optional calibration block at calib_offset, all in
+/// native byte order. knots_offset is a multiple of the page size, so
+/// mapped knots are aligned for any vector load.
+struct SplineFileHeader {
+  static constexpr char file_magic[8] = {'S', 'P', 'L', 'I',
+                                         'N', 'E', 'B', '\0'};
+  static constexpr uint32_t file_version = 1;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t order;
+  SplineFileGroup group;
+  uint32_t knot_size;  ///< Number of doubles per knot.
+  int64_t start_t_ns;
+  int64_t dt_ns;
+  uint64_t num_knots;
+  uint64_t knots_offset;
+  uint64_t calib_offset;
+  uint64_t calib_size;  ///< Zero if the file has no calibration block.
+};
+
+/// Calibration stored with a spline.
+struct SplineFileCalib {
+  basalt::Calibration<double> calib;
+  Eigen::Vector3d g, accel_bias, gyro_bias;
+
+  template <class Archive>
+  void serialize(Archive& ar) {
+    ar(calib, g, accel_bias, gyro_bias);
+  }
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+/// @brief Write a spline file.
+///
+/// @param[in] path file to write
+/// @param[in] group knot type
+/// @param[in] order order N of the spline
+/// @param[in] start_t_ns start time of the spline
+/// @param[in] dt_ns knot spacing
+/// @param[in] num_knots number of knots
+/// @param[in] knot functor called as knot(i, double* params) that writes
+/// the parameters of knot i
+/// @param[in] calib calibration block or nullptr
+/// @return false if the file could not be written
+template <class KnotFunc>
+bool writeSplineFile(const std::string& path, SplineFileGroup group,
+                     int order, int64_t start_t_ns, int64_t dt_ns,
+                     size_t num_knots, const KnotFunc& knot,
+                     const SplineFileCalib* calib = nullptr) {
+  const uint32_t knot_size = group == SplineFileGroup::SO3 ? 4 : 7;
+  const uint64_t page_size = sysconf(_SC_PAGESIZE);
+
+  std::string calib_data;
+  if (calib) {
+    std::ostringstream os;
+    {
+      cereal::BinaryOutputArchive archive(os);
+      archive(*calib);
+    }
+    calib_data = os.str();
+  }
+
+  SplineFileHeader header;
+  std::memcpy(header.magic, SplineFileHeader::file_magic,
+              sizeof(header.magic));
+  header.version = SplineFileHeader::file_version;
+  header.order = order;
+  header.group = group;
+  header.knot_size = knot_size;
+  header.start_t_ns = start_t_ns;
+  header.dt_ns = dt_ns;
+  header.num_knots = num_knots;
+  header.knots_offset =
+      (sizeof(SplineFileHeader) + page_size - 1) / page_size * page_size;
+  header.calib_offset =
+      header.knots_offset + num_knots * knot_size * sizeof(double);
+  header.calib_size = calib_data.size();
+
+  std::ofstream os(path, std::ios::binary);
+  if (!os.good()) {
+    std::cerr << "Could not open " << path << " for writing" << std::endl;
+    return false;
+  }
+
+  os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  const std::string padding(header.knots_offset - sizeof(header), '\0');
+  os.write(padding.data(), padding.size());
+
+  double params[7];
+  for (size_t i = 0; i < num_knots; i++) {
+    knot(i, params);
+    os.write(reinterpret_cast<const char*>(params),
+             knot_size * sizeof(double));
+  }
+
+  os.write(calib_data.data(), calib_data.size());
+
+  return os.good();
+}
+
+/// @brief Spline read from a memory-mapped spline file.
+///
+/// open() maps the file read-only and checks the header, the knots are
+/// never copied or deserialized: queries evaluate the spline directly from
+/// the mapped parameters, so a long trajectory is ready immediately and only
+/// the pages of the queried segments are read from disk. The order N must
+/// match the file. The calibration block is deserialized on request.
+template <int _N>
+class MappedSpline {
+ public:
+  static constexpr int N = _N;        // Order of the spline.
+  static constexpr int DEG = _N - 1;  // Degree of the spline.
+
+  static constexpr double s_to_ns = 1e9;  ///< Second to nanosecond conversion
+
+  MappedSpline() = default;
+  MappedSpline(const MappedSpline&) = delete;
+  MappedSpline& operator=(const MappedSpline&) = delete;
+
+  ~MappedSpline() { close(); }
+
+  /// @brief Map a spline file.
+  ///
+  /// @return false with an error message on std::cerr if the file can not be
+  /// mapped or is not a spline file of order N
+  bool open(const std::string& path) {
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      std::cerr << "Could not open " << path << std::endl;
+      return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(SplineFileHeader)) {
+      std::cerr << "Could not read " << path << std::endl;
+      ::close(fd);
+      return false;
+    }
+
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (data == MAP_FAILED) {
+      std::cerr << "Could not map " << path << std::endl;
+      return false;
+    }
+
+    map_data = static_cast<const char*>(data);
+    map_size = st.st_size;
+    header = reinterpret_cast<const SplineFileHeader*>(map_data);
+
+    // The offsets and sizes are checked without overflow, such that a
+    // corrupted header can not make queries read outside of the mapping.
+    std::string error;
+    if (std::memcmp(header->magic, SplineFileHeader::file_magic,
+                    sizeof(header->magic)) != 0) {
+      error = "not a spline file";
+    } else if (header->version != SplineFileHeader::file_version) {
+      error = "unsupported version " + std::to_string(header->version);
+    } else if (header->order != uint32_t(N)) {
+      error = "order " + std::to_string(header->order) + " instead of " +
+              std::to_string(N);
+    } else if ((header->group != SplineFileGroup::SO3 &&
+                header->group != SplineFileGroup::SE3 &&
+                header->group != SplineFileGroup::SPLIT) ||
+               header->knot_size !=
+                   (header->group == SplineFileGroup::SO3 ? 4u : 7u)) {
+      error = "invalid knot type";
+    } else if (header->dt_ns <= 0) {
+      error = "invalid knot spacing " + std::to_string(header->dt_ns);
+    } else if (header->knots_offset < sizeof(SplineFileHeader) ||
+               header->knots_offset % alignof(double) != 0) {
+      error = "invalid knots offset " + std::to_string(header->knots_offset);
+    } else if (header->num_knots < size_t(N) ||
+               header->calib_offset > map_size ||
+               header->calib_size > map_size - header->calib_offset ||
+               header->knots_offset > header->calib_offset ||
+               header->num_knots >
+                   (header->calib_offset - header->knots_offset) /
+                       (header->knot_size * sizeof(double))) {
+      error = "truncated file";
+    }
+
+    if (!error.empty()) {
+      std::cerr << path << ": " << error << std::endl;
+      close();
+      return false;
+    }
+
+    knots = reinterpret_cast<const double*>(map_data + header->knots_offset);
+    inv_dt = s_to_ns / header->dt_ns;
+
+    return true;
+  }
+
+  void close() {
+    if (map_data) munmap(const_cast<char*>(map_data), map_size);
+    map_data = nullptr;
+    header = nullptr;
+    knots = nullptr;
+  }
+
+  SplineFileGroup group() const { return header->group; }
+
+  size_t numKnots() const { return header->num_knots; }
+
+  int64_t minTimeNs() const { return header->start_t_ns; }
+
+  int64_t maxTimeNs() const {
+    return header->start_t_ns + (header->num_knots - N + 1) * header->dt_ns -
+           1;
+  }
+
+  /// Parameters of knot i in the mapped file.
+  const double* knot(size_t i) const {
+    return knots + i * header->knot_size;
+  }
+
+  /// Pose at time_ns, the rotation with zero translation for SO(3) splines.
+  Sophus::SE3d getPose(int64_t time_ns) const {
+    double u;
+    std::array<const double*, N> vec = segment(time_ns, &u);
+
+    Sophus::SE3d res;
+    if (header->group == SplineFileGroup::SE3) {
+      CeresSplineHelper<N>::template evaluate_lie<double, Sophus::SE3>(
+          vec.data(), u, inv_dt, &res);
+    } else {
+      Sophus::SO3d rot;
+      CeresSplineHelper<N>::template evaluate_lie<double, Sophus::SO3>(
+          vec.data(), u, inv_dt, &rot);
+      res.so3() = rot;
+
+      if (header->group == SplineFileGroup::SPLIT) {
+        for (auto& p : vec) p += 4;
+        CeresSplineHelper<N>::template evaluate<double, 3, 0>(
+            vec.data(), u, inv_dt, &res.translation());
+      }
+    }
+    return res;
+  }
+
+  /// Rotational velocity in the body frame at time_ns.
+  Eigen::Vector3d getRotVel(int64_t time_ns) const {
+    double u;
+    const std::array<const double*, N> vec = segment(time_ns, &u);
+
+    if (header->group == SplineFileGroup::SE3) {
+      Sophus::Vector6d vel;
+      CeresSplineHelper<N>::template evaluate_lie<double, Sophus::SE3>(
+          vec.data(), u, inv_dt, nullptr, &vel);
+      return vel.tail<3>();
+    }
+
+    Eigen::Vector3d vel;
+    CeresSplineHelper<N>::template evaluate_lie<double, Sophus::SO3>(
+        vec.data(), u, inv_dt, nullptr, &vel);
+    return vel;
+  }
+
+  bool hasCalib() const { return header->calib_size > 0; }
+
+  /// Deserialize the calibration block. Returns false if there is none.
+  bool getCalib(SplineFileCalib* calib) const {
+    if (!hasCalib()) return false;
+
+    std::istringstream is(
+        std::string(map_data + header->calib_offset, header->calib_size));
+    cereal::BinaryInputArchive archive(is);
+    archive(*calib);
+    return true;
+  }
+
+ private:
+  /// Knot pointers of the segment of time_ns and the normalized time u.
+  std::array<const double*, N> segment(int64_t time_ns, double* u) const {
+    const int64_t st_ns = time_ns - header->start_t_ns;
+    const int64_t s = st_ns / header->dt_ns;
+
+    BASALT_ASSERT_STREAM(st_ns >= 0 && size_t(s + N) <= header->num_knots,
+                         "time_ns " << time_ns << " minTimeNs " << minTimeNs()
+                                    << " maxTimeNs " << maxTimeNs());
+
+    *u = double(st_ns % header->dt_ns) / double(header->dt_ns);
+
+    std::array<const double*, N> vec;
+    for (int i = 0; i < N; i++) vec[i] = knot(s + i);
+    return vec;
+  }
+
+  const char* map_data = nullptr;
+  size_t map_size = 0;
+
+  const SplineFileHeader* header = nullptr;
+  const double* knots = nullptr;
+  double inv_dt = 0;
+};
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <type_traits>
+
+#include <basalt/spline/ceres_spline_helper.h>
+#include <basalt/utils/eigen_utils.hpp>
+
+#include <ceres_spline_coeff_table.h>
+#include <ceres_spline_helper_simd.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+using namespace basalt;
+
+/// @brief Lie group spline evaluation from precomputed knot differences.
+///
+/// evaluate_lie of CeresSplineHelper computes the DEG differences
+/// log(p_i^{-1} * p_{i+1}) of the segment knots on every call. This helper
+/// splits evaluation into computing those deltas and evaluating the
+/// cumulative spline from the first knot and the deltas, such that the deltas
+/// can be shared between calls.
+template <int _N>
+struct CeresSplineHelperDelta : public CeresSplineHelper<_N> {
+  static constexpr int N = _N;        // Order of the spline.
+  static constexpr int DEG = _N - 1;  // Degree of the spline.
+
+  using MatN = Eigen::Matrix<double, _N, _N>;
+  using VecN = Eigen::Matrix<double, _N, 1>;
+
+  /// @brief Evaluate Lie group cummulative B-spline and time derivatives from
+  /// knot differences.
+  ///
+  /// Same as CeresSplineHelper::evaluate_lie, but takes the first knot of the
+  /// segment and the DEG differences log(p_i^{-1} * p_{i+1}) of its knots.
+  ///
+  /// @param[in] sKnot0 first knot of the segment
+  /// @param[in] deltas array of DEG knot differences
+  /// @param[in] u normalized time to compute value of the spline
+  /// @param[in] inv_dt inverse of the time spacing in seconds between spline
+  /// knots
+  /// @param[out] transform_out if not nullptr return the value of the spline
+  /// @param[out] vel_out if not nullptr velocity (first time derivative) in the
+  /// body frame
+  /// @param[out] accel_out if not nullptr acceleration (second time derivative)
+  /// in the body frame
+  template <class T, template <class> class GroupT>
+  static inline void evaluate_lie(
+      T const* sKnot0, typename GroupT<T>::Tangent const* deltas,
+      const double u, const double inv_dt, GroupT<T>* transform_out = nullptr,
+      typename GroupT<T>::Tangent* vel_out = nullptr,
+      typename GroupT<T>::Tangent* accel_out = nullptr) {
+    const SplineCoeffs<N> coeffs(u, inv_dt, accel_out ? 2 : vel_out ? 1 : 0);
+    evaluate_lie<T, GroupT>(sKnot0, deltas, coeffs, transform_out, vel_out,
+                            accel_out);
+  }
+
+  /// @brief Same as evaluate_lie, with precomputed blending coefficients,
+  /// e.g. a row of a SplineCoeffTable.
+  ///
+  /// @param[in] coeffs coefficients at least up to the highest requested
+  /// derivative
+  template <class T, template <class> class GroupT>
+  static inline void evaluate_lie(
+      T const* sKnot0, typename GroupT<T>::Tangent const* deltas,
+      const SplineCoeffs<N>& coeffs, GroupT<T>* transform_out = nullptr,
+      typename GroupT<T>::Tangent* vel_out = nullptr,
+      typename GroupT<T>::Tangent* accel_out = nullptr) {
+    using Group = GroupT<T>;
+    using Tangent = typename GroupT<T>::Tangent;
+    using Adjoint = typename GroupT<T>::Adjoint;
+
+    const VecN& coeff = coeffs.coeff;
+    const VecN& dcoeff = coeffs.dcoeff;
+    const VecN& ddcoeff = coeffs.ddcoeff;
+
+    if (transform_out) {
+      Eigen::Map<Group const> const p00(sKnot0);
+      *transform_out = p00;
+    }
+
+    Tangent rot_vel, rot_accel;
+
+    if (vel_out || accel_out) rot_vel.setZero();
+    if (accel_out) rot_accel.setZero();
+
+    for (int i = 0; i < DEG; i++) {
+      const Tangent& delta = deltas[i];
+
+      Group exp_kdelta = Group::exp(delta * coeff[i + 1]);
+
+      if (transform_out) (*transform_out) *= exp_kdelta;
+
+      if (vel_out || accel_out) {
+        Adjoint A = exp_kdelta.inverse().Adj();
+
+        rot_vel = A * rot_vel;
+        Tangent rot_vel_current = delta * dcoeff[i + 1];
+        rot_vel += rot_vel_current;
+
+        if (accel_out) {
+          rot_accel = A * rot_accel;
+          Tangent accel_lie_bracket =
+              Group::lieBracket(rot_vel, rot_vel_current);
+          rot_accel += ddcoeff[i + 1] * delta + accel_lie_bracket;
+        }
+      }
+    }
+
+    if (vel_out) *vel_out = rot_vel;
+    if (accel_out) *accel_out = rot_accel;
+  }
+};
+
+/// @brief Lazily computed differences log(k_i^{-1} * k_{i+1}) of all
+/// consecutive knots of a Lie group spline.
+///
+/// The owner calls invalidate() whenever knots might have changed. get() and
+/// getSoA() recompute the cached data on first use after invalidation and may
+/// be called from several threads concurrently.
+template <class Groupd>
+class KnotDeltaCache {
+ public:
+  using Tangentd = typename Groupd::Tangent;
+
+  KnotDeltaCache() : valid(false), soa_valid(false), soa_float_valid(false) {}
+
+  void invalidate() {
+    valid.store(false, std::memory_order_release);
+    soa_valid.store(false, std::memory_order_release);
+    soa_float_valid.store(false, std::memory_order_release);
+  }
+
+  const Tangentd* get(const Eigen::aligned_vector<Groupd>& knots) {
+    if (!valid.load(std::memory_order_acquire)) {
+      std::lock_guard<std::mutex> lock(mutex);
+      updateDeltas(knots);
+    }
+
+    return deltas.data();
+  }
+
+  /// Structure-of-arrays copy of the knots and differences for
+  /// CeresSplineHelperSimd. The float copy is rounded from the double knots
+  /// and differences.
+  template <class Scalar = double>
+  const LieSplineSoA<Groupd, Scalar>& getSoA(
+      const Eigen::aligned_vector<Groupd>& knots) {
+    LieSplineSoA<Groupd, Scalar>* res;
+    std::atomic<bool>* res_valid;
+
+    if constexpr (std::is_same<Scalar, float>::value) {
+      res = &soa_float;
+      res_valid = &soa_float_valid;
+    } else {
+      res = &soa;
+      res_valid = &soa_valid;
+    }
+
+    if (!res_valid->load(std::memory_order_acquire)) {
+      std::lock_guard<std::mutex> lock(mutex);
+      updateDeltas(knots);
+
+      if (!res_valid->load(std::memory_order_relaxed)) {
+        res->update(knots, deltas.data());
+        res_valid->store(true, std::memory_order_release);
+      }
+    }
+
+    return *res;
+  }
+
+ private:
+  // Must be called with the mutex locked.
+  void updateDeltas(const Eigen::aligned_vector<Groupd>& knots) {
+    if (valid.load(std::memory_order_relaxed)) return;
+
+    deltas.resize(knots.empty() ? 0 : knots.size() - 1);
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, deltas.size()),
+                      [&](const tbb::blocked_range<size_t>& r) {
+                        for (size_t i = r.begin(); i != r.end(); ++i) {
+                          deltas[i] = (knots[i].inverse() * knots[i + 1]).log();
+                        }
+                      });
+
+    valid.store(true, std::memory_order_release);
+  }
+
+  std::atomic<bool> valid, soa_valid, soa_float_valid;
+  std::mutex mutex;
+
+  Eigen::aligned_vector<Tangentd> deltas;
+  LieSplineSoA<Groupd> soa;
+  LieSplineSoA<Groupd, float> soa_float;
+};
@@ -0,0 +1,507 @@
+#pragma once
+
+#include <array>
+#include <type_traits>
+
+#include <basalt/spline/ceres_spline_helper.h>
+
+#include <ceres_spline_blending.h>
+#include <ceres_spline_coeff_table.h>
+
+#include <sophus/se3.hpp>
+#include <sophus/so3.hpp>
+
+using namespace basalt;
+
+/// Outputs of CeresSplineHelperGroup::evaluate_lie, combined as bit flags.
+enum LieSplineOutput : int {
+  LIE_VALUE = 1,
+  LIE_VEL = 2,
+  LIE_ACCEL = 4,
+};
+
+/// @brief Closed-form evaluation of SO(3) and SE(3) cumulative B-splines.
+///
+/// Computes the same quantities as CeresSplineHelper::evaluate_lie, but
+/// works on unit quaternions directly: the Adjoint of exp(k * delta)^{-1} is
+/// applied by rotating the tangent vectors with the quaternion instead of
+/// building a 3x3 or 6x6 matrix, and exp/log use Taylor expansions for small
+/// angles instead of trigonometric functions. The requested outputs are a
+/// compile time parameter, so no work is spent on unused derivatives, and
+/// the loops over the segment are unrolled with static_for.
+/// knot_deltas and evaluate_lie_delta split the evaluation, such that the
+/// knot differences can be shared by several evaluations of a segment.
+///
+/// Other groups fall back to CeresSplineHelper::evaluate_lie.
+template <int _N>
+struct CeresSplineHelperGroup : public CeresSplineHelper<_N> {
+  static constexpr int N = _N;        // Order of the spline.
+  static constexpr int DEG = _N - 1;  // Degree of the spline.
+
+  using MatN = Eigen::Matrix<double, _N, _N>;
+  using VecN = Eigen::Matrix<double, _N, 1>;
+
+  /// Below this squared angle the rotation exp and log use Taylor expansions.
+  /// The first omitted terms are far below double precision.
+  static constexpr double small_angle_sq = 1e-6;
+
+  /// Below this squared angle the coefficients of the SE(3) left Jacobian and
+  /// its inverse use Taylor expansions. The closed forms lose about
+  /// log10(1 / theta^2) digits to cancellation for small angles.
+  static constexpr double small_angle_jacobian_sq = 1e-2;
+
+  /// @brief Evaluate Lie group cummulative B-spline and time derivatives.
+  ///
+  /// @param OUT combination of LieSplineOutput flags to compute
+  /// @param[in] sKnots array of pointers of the spline knots. The size of each
+  /// knot should be GroupT::num_parameters: 4 for SO(3) and 7 for SE(3).
+  /// @param[in] u normalized time to compute value of the spline
+  /// @param[in] inv_dt inverse of the time spacing in seconds between spline
+  /// knots
+  /// @param[out] transform_out value of the spline, used if OUT has LIE_VALUE
+  /// @param[out] vel_out velocity (first time derivative) in the body frame,
+  /// used if OUT has LIE_VEL
+  /// @param[out] accel_out acceleration (second time derivative) in the body
+  /// frame, used if OUT has LIE_ACCEL
+  template <int OUT, class T, template <class> class GroupT>
+  static inline void evaluate_lie(
+      T const* const* sKnots, const double u, const double inv_dt,
+      GroupT<T>* transform_out = nullptr,
+      typename GroupT<T>::Tangent* vel_out = nullptr,
+      typename GroupT<T>::Tangent* accel_out = nullptr) {
+    if constexpr (has_quat_kernel<GroupT>()) {
+      typename GroupT<T>::Tangent deltas[DEG];
+      knot_deltas<T, GroupT>(sKnots, deltas);
+      evaluate_lie_delta<OUT, T, GroupT>(sKnots[0], deltas, u, inv_dt,
+                                         transform_out, vel_out, accel_out);
+    } else {
+      CeresSplineHelper<N>::template evaluate_lie<T, GroupT>(
+          sKnots, u, inv_dt, (OUT & LIE_VALUE) ? transform_out : nullptr,
+          (OUT & LIE_VEL) ? vel_out : nullptr,
+          (OUT & LIE_ACCEL) ? accel_out : nullptr);
+    }
+  }
+
+  /// Knot differences of a segment, see knot_deltas.
+  template <class T, template <class> class GroupT>
+  using KnotDeltas = std::array<typename GroupT<T>::Tangent, DEG>;
+
+  /// Highest time derivative in a combination of LieSplineOutput flags.
+  template <int OUT>
+  static constexpr int max_deriv() {
+    return (OUT & LIE_ACCEL) ? 2 : (OUT & LIE_VEL) ? 1 : 0;
+  }
+
+  /// True for the groups with quaternion kernels, SO(3) and SE(3).
+  template <template <class> class GroupT>
+  static constexpr bool has_quat_kernel() {
+    return std::is_same<GroupT<double>, Sophus::SO3d>::value ||
+           std::is_same<GroupT<double>, Sophus::SE3d>::value;
+  }
+
+  /// @brief Differences log(p_i^{-1} * p_{i+1}) of the N knots of a segment.
+  ///
+  /// They only depend on the knots, so residuals evaluating the same segment
+  /// at several times compute them once and call evaluate_lie_delta.
+  ///
+  /// @param[in] sKnots array of pointers of the spline knots
+  /// @param[out] deltas array of DEG knot differences
+  template <class T, template <class> class GroupT>
+  static inline void knot_deltas(T const* const* sKnots,
+                                 typename GroupT<T>::Tangent* deltas) {
+    static_assert(has_quat_kernel<GroupT>(), "Only SO3 and SE3.");
+
+    constexpr bool is_se3 = GroupT<T>::DoF == 6;
+
+    Quat<T> q_prev(sKnots[0]);
+    Vec3<T> t_prev;
+    if constexpr (is_se3) t_prev = Eigen::Map<Vec3<T> const>(sKnots[0] + 4);
+
+    static_for<DEG>([&](auto idx) {
+      constexpr int i = decltype(idx)::value;
+
+      Quat<T> q_next(sKnots[i + 1]);
+      Quat<T> q_rel = q_prev.conjugate() * q_next;
+
+      if constexpr (is_se3) {
+        Vec3<T> t_next = Eigen::Map<Vec3<T> const>(sKnots[i + 1] + 4);
+        Vec3<T> t_rel = q_prev.conjugate() * (t_next - t_prev);
+
+        Vec3<T> d_rot, d_trans;
+        logSE3(q_rel, t_rel, d_rot, d_trans);
+        deltas[i] << d_trans, d_rot;
+
+        t_prev = t_next;
+      } else {
+        deltas[i] = logSO3(q_rel);
+      }
+      q_prev = q_next;
+    });
+  }
+
+  /// @brief Evaluate the spline from the first knot and the knot differences
+  /// of knot_deltas.
+  ///
+  /// @param OUT combination of LieSplineOutput flags to compute
+  /// @param[in] sKnot0 first knot of the segment, only used for LIE_VALUE
+  /// @param[in] deltas array of DEG knot differences
+  /// @param[in] u normalized time to compute value of the spline
+  /// @param[in] inv_dt inverse of the time spacing in seconds between spline
+  /// knots
+  /// @param[out] transform_out value of the spline, used if OUT has LIE_VALUE
+  /// @param[out] vel_out velocity in the body frame, used if OUT has LIE_VEL
+  /// @param[out] accel_out acceleration in the body frame, used if OUT has
+  /// LIE_ACCEL
+  template <int OUT, class T, template <class> class GroupT>
+  static inline void evaluate_lie_delta(
+      T const* sKnot0, typename GroupT<T>::Tangent const* deltas,
+      const double u, const double inv_dt, GroupT<T>* transform_out = nullptr,
+      typename GroupT<T>::Tangent* vel_out = nullptr,
+      typename GroupT<T>::Tangent* accel_out = nullptr) {
+    const SplineCoeffs<N> coeffs(u, inv_dt, max_deriv<OUT>());
+    evaluate_lie_delta<OUT, T, GroupT>(sKnot0, deltas, coeffs, transform_out,
+                                       vel_out, accel_out);
+  }
+
+  /// @brief Same as evaluate_lie_delta, with precomputed blending
+  /// coefficients, e.g. a row of a SplineCoeffTable.
+  ///
+  /// @param[in] coeffs coefficients at least up to the highest requested
+  /// derivative
+  template <int OUT, class T, template <class> class GroupT>
+  static inline void evaluate_lie_delta(
+      T const* sKnot0, typename GroupT<T>::Tangent const* deltas,
+      const SplineCoeffs<N>& coeffs, GroupT<T>* transform_out = nullptr,
+      typename GroupT<T>::Tangent* vel_out = nullptr,
+      typename GroupT<T>::Tangent* accel_out = nullptr) {
+    static_assert(has_quat_kernel<GroupT>(), "Only SO3 and SE3.");
+
+    evaluate_quat<OUT, T, GroupT<T>::DoF == 6>(
+        sKnot0, deltas, coeffs,
+        (OUT & LIE_VALUE) ? transform_out->data() : nullptr,
+        (OUT & LIE_VEL) ? vel_out->data() : nullptr,
+        (OUT & LIE_ACCEL) ? accel_out->data() : nullptr);
+  }
+
+  /// @brief Linear acceleration of an SE(3) spline in the body frame.
+  ///
+  /// The second time derivative of T_w_i is T_w_i * (hat(vel)^2 +
+  /// hat(accel)), whose translation column is R_w_i * (omega x v + dv/dt)
+  /// for vel = [v; omega]. Computing it directly avoids the 4x4 matrix
+  /// products.
+  ///
+  /// @param[in] vel velocity of the spline in the body frame
+  /// @param[in] accel acceleration of the spline in the body frame
+  /// @return R_w_i^T * d^2/dt^2 (t_w_i)
+  template <class T>
+  static inline Eigen::Matrix<T, 3, 1> linear_accel_body(
+      const Eigen::Matrix<T, 6, 1>& vel, const Eigen::Matrix<T, 6, 1>& accel) {
+    return vel.template tail<3>().cross(vel.template head<3>()) +
+           accel.template head<3>();
+  }
+
+  /// @brief Linear acceleration of an SE(3) spline in the world frame.
+  ///
+  /// @param[in] T_w_i value of the spline
+  /// @param[in] vel velocity of the spline in the body frame
+  /// @param[in] accel acceleration of the spline in the body frame
+  /// @return d^2/dt^2 (t_w_i)
+  template <class T>
+  static inline Eigen::Matrix<T, 3, 1> linear_accel_world(
+      const Sophus::SE3<T>& T_w_i, const Eigen::Matrix<T, 6, 1>& vel,
+      const Eigen::Matrix<T, 6, 1>& accel) {
+    return T_w_i.so3() * linear_accel_body(vel, accel);
+  }
+
+ private:
+  template <class T>
+  using Vec3 = Eigen::Matrix<T, 3, 1>;
+
+  template <class T>
+  using Quat = Eigen::Quaternion<T>;
+
+  /// Implementation for SO(3) (IS_SE3 = false) and SE(3). Tangent vectors of
+  /// SE(3) are [upsilon; omega] with the rotational part last, values are
+  /// stored in the Sophus parameter layout.
+  template <int OUT, class T, bool IS_SE3>
+  static inline void evaluate_quat(
+      T const* sKnot0, Eigen::Matrix<T, IS_SE3 ? 6 : 3, 1> const* deltas,
+      const SplineCoeffs<N>& coeffs, T* value_out, T* vel_out, T* accel_out) {
+    constexpr bool need_value = OUT & LIE_VALUE;
+    constexpr bool need_accel = OUT & LIE_ACCEL;
+    constexpr bool need_vel = (OUT & LIE_VEL) || need_accel;
+
+    constexpr int rot_idx = IS_SE3 ? 3 : 0;
+
+    const VecN& coeff = coeffs.coeff;
+    const VecN& dcoeff = coeffs.dcoeff;
+    const VecN& ddcoeff = coeffs.ddcoeff;
+
+    Quat<T> q_out;
+    Vec3<T> t_out;
+    if constexpr (need_value) {
+      q_out = Quat<T>(sKnot0);
+      if constexpr (IS_SE3) t_out = Eigen::Map<Vec3<T> const>(sKnot0 + 4);
+    }
+
+    Vec3<T> w_vel, w_accel, v_vel, v_accel;
+    if constexpr (need_vel) {
+      w_vel.setZero();
+      if constexpr (IS_SE3) v_vel.setZero();
+    }
+    if constexpr (need_accel) {
+      w_accel.setZero();
+      if constexpr (IS_SE3) v_accel.setZero();
+    }
+
+    static_for<DEG>([&](auto idx) {
+      constexpr int i = decltype(idx)::value;
+
+      const Vec3<T> d_rot = deltas[i].template tail<3>();
+      Vec3<T> d_trans;
+      if constexpr (IS_SE3) d_trans = deltas[i].template head<3>();
+
+      // exp(k * delta)
+      const double k = coeff[i + 1];
+      Quat<T> q_exp;
+      Vec3<T> t_exp;
+      if constexpr (IS_SE3) {
+        expSE3(Vec3<T>(k * d_rot), Vec3<T>(k * d_trans), q_exp, t_exp);
+      } else {
+        q_exp = expSO3(Vec3<T>(k * d_rot));
+      }
+
+      if constexpr (need_value) {
+        if constexpr (IS_SE3) t_out += q_out * t_exp;
+        q_out = q_out * q_exp;
+      }
+
+      if constexpr (need_vel) {
+        // Adj(exp(k * delta)^{-1}) [v; w] = [R^T (v - t x w); R^T w]
+        const Quat<T> q_exp_inv = q_exp.conjugate();
+        const double dk = dcoeff[i + 1];
+
+        Vec3<T> w_vel_current = dk * d_rot;
+        Vec3<T> v_vel_current;
+
+        if constexpr (IS_SE3) {
+          v_vel_current = dk * d_trans;
+          v_vel = q_exp_inv * (v_vel - t_exp.cross(w_vel)) + v_vel_current;
+        }
+        w_vel = q_exp_inv * w_vel + w_vel_current;
+
+        if constexpr (need_accel) {
+          const double ddk = ddcoeff[i + 1];
+
+          // Lie bracket [vel, vel_current] added to the acceleration.
+          if constexpr (IS_SE3) {
+            v_accel = q_exp_inv * (v_accel - t_exp.cross(w_accel)) +
+                      ddk * d_trans + w_vel.cross(v_vel_current) +
+                      v_vel.cross(w_vel_current);
+          }
+          w_accel = q_exp_inv * w_accel + ddk * d_rot +
+                    w_vel.cross(w_vel_current);
+        }
+      }
+    });
+
+    if constexpr (need_value) {
+      Eigen::Map<Eigen::Matrix<T, 4, 1>> q_map(value_out);
+      q_map = q_out.coeffs();
+      if constexpr (IS_SE3) Eigen::Map<Vec3<T>>{value_out + 4} = t_out;
+    }
+    if constexpr (bool(OUT & LIE_VEL)) {
+      Eigen::Map<Vec3<T>>{vel_out + rot_idx} = w_vel;
+      if constexpr (IS_SE3) Eigen::Map<Vec3<T>>{vel_out} = v_vel;
+    }
+    if constexpr (need_accel) {
+      Eigen::Map<Vec3<T>>{accel_out + rot_idx} = w_accel;
+      if constexpr (IS_SE3) Eigen::Map<Vec3<T>>{accel_out} = v_accel;
+    }
+  }
+
+  /// Quaternion exp of a rotation vector. Optionally returns sin(theta) /
+  /// theta, (1 - cos(theta)) / theta^2 and theta^2 for the SE(3) left
+  /// Jacobian.
+  template <class T>
+  static inline Quat<T> expSO3(const Vec3<T>& omega, T* sin_by_theta = nullptr,
+                               T* one_minus_cos_by_theta_sq = nullptr,
+                               T* theta_sq_out = nullptr) {
+    using std::cos;
+    using std::sin;
+    using std::sqrt;
+
+    const T theta_sq = omega.squaredNorm();
+
+    T imag_factor, real_factor;
+
+    if (theta_sq < small_angle_sq) {
+      imag_factor = T(0.5) - T(1.0 / 48.0) * theta_sq +
+                    T(1.0 / 3840.0) * theta_sq * theta_sq;
+      real_factor = T(1) - T(1.0 / 8.0) * theta_sq +
+                    T(1.0 / 384.0) * theta_sq * theta_sq;
+    } else {
+      const T theta = sqrt(theta_sq);
+      const T half_theta = T(0.5) * theta;
+      imag_factor = sin(half_theta) / theta;
+      real_factor = cos(half_theta);
+    }
+
+    if (sin_by_theta) {
+      // sin(theta) = 2 sin(theta / 2) cos(theta / 2),
+      // 1 - cos(theta) = 2 sin(theta / 2)^2
+      *sin_by_theta = T(2) * imag_factor * real_factor;
+      *one_minus_cos_by_theta_sq = T(2) * imag_factor * imag_factor;
+      *theta_sq_out = theta_sq;
+    }
+
+    return Quat<T>(real_factor, imag_factor * omega.x(),
+                   imag_factor * omega.y(), imag_factor * omega.z());
+  }
+
+  /// SE(3) exp: rotation and V(omega) * upsilon.
+  template <class T>
+  static inline void expSE3(const Vec3<T>& omega, const Vec3<T>& upsilon,
+                            Quat<T>& q, Vec3<T>& t) {
+    T sin_by_theta, one_minus_cos_by_theta_sq, theta_sq;
+    q = expSO3(omega, &sin_by_theta, &one_minus_cos_by_theta_sq, &theta_sq);
+
+    // (theta - sin(theta)) / theta^3
+    T c2;
+    if (theta_sq < small_angle_jacobian_sq) {
+      const T theta_po4 = theta_sq * theta_sq;
+      c2 = T(1.0 / 6.0) - T(1.0 / 120.0) * theta_sq +
+           T(1.0 / 5040.0) * theta_po4 -
+           T(1.0 / 362880.0) * theta_po4 * theta_sq +
+           T(1.0 / 39916800.0) * theta_po4 * theta_po4;
+    } else {
+      c2 = (T(1) - sin_by_theta) / theta_sq;
+    }
+
+    const Vec3<T> w_x_v = omega.cross(upsilon);
+    t = upsilon + one_minus_cos_by_theta_sq * w_x_v + c2 * omega.cross(w_x_v);
+  }
+
+  /// Quaternion log. Returns the rotation vector and optionally |vec(q)|^2,
+  /// the real part of q (chosen >= 0) and theta^2.
+  template <class T>
+  static inline Vec3<T> logSO3(const Quat<T>& q_in, T* squared_n_out = nullptr,
+                               T* w_out = nullptr, T* theta_sq_out = nullptr) {
+    using std::atan2;
+    using std::sqrt;
+
+    // q and -q represent the same rotation, pick the one with angle <= pi.
+    const bool flip = q_in.w() < T(0);
+    const Vec3<T> vec = flip ? Vec3<T>(-q_in.vec()) : Vec3<T>(q_in.vec());
+    const T w = flip ? T(-q_in.w()) : q_in.w();
+
+    const T squared_n = vec.squaredNorm();
+
+    T two_atan_nbyw_by_n;
+    if (squared_n < small_angle_sq) {
+      const T squared_w = w * w;
+      two_atan_nbyw_by_n = T(2) / w -
+                           T(2.0 / 3.0) * squared_n / (w * squared_w) +
+                           T(2.0 / 5.0) * squared_n * squared_n /
+                               (w * squared_w * squared_w);
+    } else {
+      const T n = sqrt(squared_n);
+      two_atan_nbyw_by_n = T(2) * atan2(n, w) / n;
+    }
+
+    const Vec3<T> omega = two_atan_nbyw_by_n * vec;
+
+    if (squared_n_out) {
+      *squared_n_out = squared_n;
+      *w_out = w;
+      *theta_sq_out = omega.squaredNorm();
+    }
+
+    return omega;
+  }
+
+  /// SE(3) log: rotation vector and V(omega)^{-1} * t.
+  template <class T>
+  static inline void logSE3(const Quat<T>& q, const Vec3<T>& t, Vec3<T>& omega,
+                            Vec3<T>& upsilon) {
+    T squared_n, w, theta_sq;
+    omega = logSO3(q, &squared_n, &w, &theta_sq);
+
+    // (1 - theta sin(theta) / (2 (1 - cos(theta)))) / theta^2, with
+    // sin(theta) = 2 n w and 1 - cos(theta) = 2 n^2.
+    T c;
+    if (theta_sq < small_angle_jacobian_sq) {
+      const T theta_po4 = theta_sq * theta_sq;
+      c = T(1.0 / 12.0) + T(1.0 / 720.0) * theta_sq +
+          T(1.0 / 30240.0) * theta_po4 +
+          T(1.0 / 1209600.0) * theta_po4 * theta_sq +
+          T(1.0 / 47900160.0) * theta_po4 * theta_po4;
+    } else {
+      using std::sqrt;
+      const T theta = sqrt(theta_sq);
+      c = (T(1) - theta * w / (T(2) * sqrt(squared_n))) / theta_sq;
+    }
+
+    const Vec3<T> w_x_t = omega.cross(t);
+    upsilon = t - T(0.5) * w_x_t + c * omega.cross(w_x_t);
+  }
+};
+
+/// @brief Per-segment data of residual functors evaluating a Lie group spline,
+/// see SegmentBatchCostFunctor.
+///
+/// For SO(3) and SE(3) with USE_DELTAS this is the array of knot differences,
+/// such that functors evaluating the same segment at several times compute
+/// them once. Otherwise it is empty and evaluate_lie computes everything from
+/// the knots.
+template <int _N, template <class> class GroupT, bool USE_DELTAS = true>
+struct LieSplineSegmentData {
+  using Helper = CeresSplineHelperGroup<_N>;
+
+  static constexpr bool use_deltas =
+      USE_DELTAS && Helper::template has_quat_kernel<GroupT>();
+
+  struct Empty {};
+
+  template <class T>
+  using SegmentData =
+      std::conditional_t<use_deltas,
+                         typename Helper::template KnotDeltas<T, GroupT>,
+                         Empty>;
+
+  template <class T>
+  static inline void computeSegmentData(T const* const* sKnots,
+                                        SegmentData<T>* data) {
+    if constexpr (use_deltas) {
+      Helper::template knot_deltas<T, GroupT>(sKnots, data->data());
+    }
+  }
+
+  /// @brief CeresSplineHelperGroup::evaluate_lie using the segment data.
+  ///
+  /// With knot differences and coeffs not nullptr the blending coefficients
+  /// are taken from coeffs, e.g. a row of a SplineCoeffTable, otherwise they
+  /// are computed from u and inv_dt.
+  template <int OUT, class T>
+  static inline void evaluate_lie(
+      T const* const* sKnots, const SegmentData<T>& data,
+      const SplineCoeffs<_N>* coeffs, const double u, const double inv_dt,
+      GroupT<T>* transform_out = nullptr,
+      typename GroupT<T>::Tangent* vel_out = nullptr,
+      typename GroupT<T>::Tangent* accel_out = nullptr) {
+    if constexpr (use_deltas) {
+      if (coeffs) {
+        Helper::template evaluate_lie_delta<OUT, T, GroupT>(
+            sKnots[0], data.data(), *coeffs, transform_out, vel_out,
+            accel_out);
+      } else {
+        Helper::template evaluate_lie_delta<OUT, T, GroupT>(
+            sKnots[0], data.data(), u, inv_dt, transform_out, vel_out,
+            accel_out);
+      }
+    } else {
+      Helper::template evaluate_lie<OUT, T, GroupT>(
+          sKnots, u, inv_dt, transform_out, vel_out, accel_out);
+    }
+  }
+};
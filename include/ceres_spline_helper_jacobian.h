@@ -0,0 +1,416 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+#include <basalt/spline/ceres_spline_helper.h>
+#include <basalt/utils/eigen_utils.hpp>
+#include <basalt/utils/sophus_utils.hpp>
+
+#include <ceres_spline_coeff_table.h>
+#include <ceres_spline_helper_group.h>
+
+#include <sophus/se3.hpp>
+#include <sophus/so3.hpp>
+
+using namespace basalt;
+
+/// @brief Tangent space operators of SO(3) and SE(3) needed for analytic
+/// spline Jacobians.
+///
+/// ad(v) is the matrix of the Lie bracket, ad(a) * b = lieBracket(a, b).
+/// rightJacobian(v) satisfies exp(v + e) ~ exp(v) exp(rightJacobian(v) * e),
+/// rightJacobianInv(v) satisfies log(exp(v) exp(e)) ~ v +
+/// rightJacobianInv(v) * e.
+template <class Groupd>
+struct LieGroupOps;
+
+template <>
+struct LieGroupOps<Sophus::SO3d> {
+  using Tangent = Sophus::SO3d::Tangent;
+  using Adjoint = Sophus::SO3d::Adjoint;
+
+  static inline Adjoint ad(const Tangent& v) { return Sophus::SO3d::hat(v); }
+
+  static inline Adjoint rightJacobian(const Tangent& v) {
+    Adjoint J;
+    Sophus::rightJacobianSO3(v, J);
+    return J;
+  }
+
+  static inline Adjoint rightJacobianInv(const Tangent& v) {
+    Adjoint J;
+    Sophus::rightJacobianInvSO3(v, J);
+    return J;
+  }
+};
+
+/// SE(3) tangent vectors are [upsilon; omega]. The Jacobians follow Barfoot,
+/// "State Estimation for Robotics", section 7.1.5.
+template <>
+struct LieGroupOps<Sophus::SE3d> {
+  using Tangent = Sophus::SE3d::Tangent;
+  using Adjoint = Sophus::SE3d::Adjoint;
+  using Vec3 = Eigen::Vector3d;
+  using Mat3 = Eigen::Matrix3d;
+
+  static inline Adjoint ad(const Tangent& v) {
+    Adjoint res;
+    res.topLeftCorner<3, 3>() = Sophus::SO3d::hat(v.tail<3>());
+    res.topRightCorner<3, 3>() = Sophus::SO3d::hat(v.head<3>());
+    res.bottomLeftCorner<3, 3>().setZero();
+    res.bottomRightCorner<3, 3>() = res.topLeftCorner<3, 3>();
+    return res;
+  }
+
+  static inline Adjoint rightJacobian(const Tangent& v) {
+    Mat3 Jr = Mat3::Zero();
+    Sophus::rightJacobianSO3(v.tail<3>(), Jr);
+
+    Adjoint res;
+    res.topLeftCorner<3, 3>() = Jr;
+    res.topRightCorner<3, 3>() = Q(-v.head<3>(), -v.tail<3>());
+    res.bottomLeftCorner<3, 3>().setZero();
+    res.bottomRightCorner<3, 3>() = Jr;
+    return res;
+  }
+
+  static inline Adjoint rightJacobianInv(const Tangent& v) {
+    Mat3 Jr_inv = Mat3::Zero();
+    Sophus::rightJacobianInvSO3(v.tail<3>(), Jr_inv);
+
+    Adjoint res;
+    res.topLeftCorner<3, 3>() = Jr_inv;
+    res.topRightCorner<3, 3>() =
+        -Jr_inv * Q(-v.head<3>(), -v.tail<3>()) * Jr_inv;
+    res.bottomLeftCorner<3, 3>().setZero();
+    res.bottomRightCorner<3, 3>() = Jr_inv;
+    return res;
+  }
+
+ private:
+  /// Upper right block of the left Jacobian of SE(3).
+  static inline Mat3 Q(const Vec3& rho, const Vec3& phi) {
+    const double theta_sq = phi.squaredNorm();
+
+    double c1, c2, c3;
+    if (theta_sq < 1e-2) {
+      const double theta_po4 = theta_sq * theta_sq;
+      c1 = 1.0 / 6.0 - theta_sq / 120.0 + theta_po4 / 5040.0;
+      c2 = 1.0 / 24.0 - theta_sq / 720.0 + theta_po4 / 40320.0;
+      c3 = 1.0 / 120.0 - theta_sq / 2520.0 + theta_po4 / 120960.0;
+    } else {
+      const double theta = std::sqrt(theta_sq);
+      const double s = std::sin(theta), c = std::cos(theta);
+      c1 = (theta - s) / (theta_sq * theta);
+      c2 = (theta_sq + 2 * c - 2) / (2 * theta_sq * theta_sq);
+      c3 = (2 * theta - 3 * s + theta * c) / (2 * theta_sq * theta_sq * theta);
+    }
+
+    const Mat3 rho_hat = Sophus::SO3d::hat(rho);
+    const Mat3 phi_hat = Sophus::SO3d::hat(phi);
+    const Mat3 phi_rho = phi_hat * rho_hat;
+    const Mat3 rho_phi = rho_hat * phi_hat;
+    const Mat3 phi_rho_phi = phi_rho * phi_hat;
+    const Mat3 phi_phi_rho = phi_hat * phi_rho;
+
+    return 0.5 * rho_hat + c1 * (phi_rho + rho_phi + phi_rho_phi) +
+           c2 * (phi_phi_rho + rho_phi * phi_hat - 3 * phi_rho_phi) +
+           c3 * (phi_rho_phi * phi_hat + phi_hat * phi_rho_phi);
+  }
+};
+
+/// @brief Time independent parts of the difference d = log(k_0^{-1} k_1) of
+/// two consecutive knots, see CeresSplineHelperJacobian.
+///
+/// The Jacobian parts are only set if compute is called with
+/// with_jacobians.
+template <class Groupd>
+struct LieKnotDelta {
+  using Tangent = typename Groupd::Tangent;
+  using Adjoint = typename Groupd::Adjoint;
+
+  Tangent delta;
+  Adjoint Jr_inv;       ///< rightJacobianInv(delta)
+  Adjoint r01_inv_adj;  ///< Adj((k_0^{-1} k_1)^{-1})
+
+  void compute(const Groupd& k0, const Groupd& k1, bool with_jacobians) {
+    const Groupd r01 = k0.inverse() * k1;
+    delta = r01.log();
+
+    if (with_jacobians) {
+      Jr_inv = LieGroupOps<Groupd>::rightJacobianInv(delta);
+      r01_inv_adj = r01.inverse().Adj();
+    }
+  }
+};
+
+/// @brief Lie group spline evaluation with Jacobians with respect to knots.
+///
+/// Jacobians are taken with respect to right perturbations k_i * exp(e_i) of
+/// the N segment knots, which matches LieLocalParameterization. For the value
+/// the Jacobian is of the right perturbation of the value, for derivatives of
+/// the derivative vector itself.
+///
+/// Uses the same recursion over knot differences as
+/// CeresSplineHelper::evaluate_lie. With d_j = log(k_{j-1}^{-1} k_j), A_j =
+/// exp(c_j d_j) and P_j = Adj((A_{j+1} ... A_DEG)^{-1}) the value,
+/// velocity and acceleration derivatives with respect to d_j are
+/// - value: P_j c_j Jr(c_j d_j)
+/// - velocity: P_j (ad(w_j) c_j Jr(c_j d_j) + c'_j I), w_j = Adj(A_j^{-1})
+///   vel_{j-1}
+/// - acceleration: P_j G_j - ad(s_j) P_j (...) with the velocity term above,
+///   s_j = sum_{i > j} P_i c'_i d_i
+/// and d_j depends on the knots through Jr^{-1}(d_j) (e_j - Adj(exp(-d_j))
+/// e_{j-1}).
+template <int _N>
+struct CeresSplineHelperJacobian : public CeresSplineHelper<_N> {
+  static constexpr int N = _N;        // Order of the spline.
+  static constexpr int DEG = _N - 1;  // Degree of the spline.
+
+  using MatN = Eigen::Matrix<double, _N, _N>;
+  using VecN = Eigen::Matrix<double, _N, 1>;
+
+  template <template <class> class GroupT>
+  using JacobianArray =
+      std::array<typename GroupT<double>::Adjoint, static_cast<size_t>(_N)>;
+
+  template <template <class> class GroupT>
+  using KnotDelta = LieKnotDelta<GroupT<double>>;
+
+  /// @brief Evaluate Lie group cummulative B-spline or one of its time
+  /// derivatives together with the Jacobians with respect to the knots.
+  ///
+  /// @param DERIV 0 for value, 1 for velocity, 2 for acceleration in the body
+  /// frame
+  /// @param[in] sKnots array of pointers of the spline knots
+  /// @param[in] u normalized time to compute value of the spline
+  /// @param[in] inv_dt inverse of the time spacing in seconds between spline
+  /// knots
+  /// @param[out] out value (GroupT) for DERIV=0, otherwise tangent vector
+  /// @param[out] J if not nullptr Jacobians with respect to the N knots
+  /// @param[in] knot_deltas if not nullptr the DEG differences of the segment
+  /// knots, with Jacobian parts if J is not nullptr
+  template <template <class> class GroupT, int DERIV>
+  static inline void evaluate_lie(
+      double const* const* sKnots, const double u, const double inv_dt,
+      std::conditional_t<DERIV == 0, GroupT<double>,
+                         typename GroupT<double>::Tangent>* out,
+      JacobianArray<GroupT>* J = nullptr,
+      const KnotDelta<GroupT>* knot_deltas = nullptr) {
+    const SplineCoeffs<N> coeffs(u, inv_dt, DERIV);
+    evaluate_lie<GroupT, DERIV>(sKnots, coeffs, out, J, knot_deltas);
+  }
+
+  /// @brief Same as evaluate_lie, with precomputed blending coefficients,
+  /// e.g. a row of a SplineCoeffTable.
+  ///
+  /// @param[in] coeffs coefficients at least up to derivative DERIV
+  template <template <class> class GroupT, int DERIV>
+  static inline void evaluate_lie(
+      double const* const* sKnots, const SplineCoeffs<N>& coeffs,
+      std::conditional_t<DERIV == 0, GroupT<double>,
+                         typename GroupT<double>::Tangent>* out,
+      JacobianArray<GroupT>* J = nullptr,
+      const KnotDelta<GroupT>* knot_deltas = nullptr) {
+    static_assert(DERIV >= 0 && DERIV <= 2, "Only up to acceleration.");
+
+    if constexpr (DERIV == 0) {
+      evaluate_lie<GroupT, LIE_VALUE>(sKnots, coeffs, out, nullptr, nullptr,
+                                      J, nullptr, nullptr, knot_deltas);
+    } else if constexpr (DERIV == 1) {
+      evaluate_lie<GroupT, LIE_VEL>(sKnots, coeffs, nullptr, out, nullptr,
+                                    nullptr, J, nullptr, knot_deltas);
+    } else {
+      evaluate_lie<GroupT, LIE_ACCEL>(sKnots, coeffs, nullptr, nullptr, out,
+                                      nullptr, nullptr, J, knot_deltas);
+    }
+  }
+
+  /// @brief Evaluate several outputs and their Jacobians in one pass.
+  ///
+  /// Value, velocity and acceleration share the knot differences, the
+  /// exponentials and the Jacobians of the differences with respect to the
+  /// knots, e.g. for the accelerometer residual of an SE(3) spline, which
+  /// depends on all three.
+  ///
+  /// @param OUT outputs as LieSplineOutput flags. Outputs and Jacobians of
+  /// flags that are not set must be nullptr, the others may be nullptr.
+  /// @param[in] coeffs coefficients at least up to the highest derivative in
+  /// OUT
+  /// @param[in] knot_deltas if not nullptr the DEG differences of the segment
+  /// knots, e.g. from a KnotDeltaCallback, with Jacobian parts if any
+  /// Jacobian is requested
+  template <template <class> class GroupT, int OUT>
+  static inline void evaluate_lie(
+      double const* const* sKnots, const SplineCoeffs<N>& coeffs,
+      GroupT<double>* value_out, typename GroupT<double>::Tangent* vel_out,
+      typename GroupT<double>::Tangent* accel_out,
+      JacobianArray<GroupT>* J_value, JacobianArray<GroupT>* J_vel,
+      JacobianArray<GroupT>* J_accel,
+      const KnotDelta<GroupT>* knot_deltas = nullptr) {
+    static_assert(OUT > 0 && OUT <= (LIE_VALUE | LIE_VEL | LIE_ACCEL),
+                  "Invalid outputs.");
+
+    // Highest derivative that is computed.
+    constexpr int DERIV = (OUT & LIE_ACCEL) ? 2 : (OUT & LIE_VEL) ? 1 : 0;
+    constexpr bool need_value = OUT & LIE_VALUE;
+
+    using Group = GroupT<double>;
+    using Tangent = typename Group::Tangent;
+    using Adjoint = typename Group::Adjoint;
+    using Ops = LieGroupOps<Group>;
+
+    const VecN& coeff = coeffs.coeff;
+    const VecN& dcoeff = coeffs.dcoeff;
+    const VecN& ddcoeff = coeffs.ddcoeff;
+
+    const bool need_J = J_value || J_vel || J_accel;
+
+    Tangent delta[DEG];
+    Adjoint A_inv[DEG];
+    Group r01_inv[DEG];
+
+    // Velocity and acceleration before (pre) and after adding segment i.
+    Tangent vel_pre[DEG], vel[DEG], accel_pre[DEG];
+
+    Group value;
+    if constexpr (need_value) value = Eigen::Map<Group const>(sKnots[0]);
+
+    Tangent rot_vel, rot_accel;
+    rot_vel.setZero();
+    rot_accel.setZero();
+
+    for (int i = 0; i < DEG; i++) {
+      if (knot_deltas) {
+        delta[i] = knot_deltas[i].delta;
+      } else {
+        Eigen::Map<Group const> const p0(sKnots[i]);
+        Eigen::Map<Group const> const p1(sKnots[i + 1]);
+
+        Group r01 = p0.inverse() * p1;
+        r01_inv[i] = r01.inverse();
+        delta[i] = r01.log();
+      }
+
+      Group exp_kdelta = Group::exp(delta[i] * coeff[i + 1]);
+
+      if constexpr (need_value) value *= exp_kdelta;
+
+      if (need_J || DERIV >= 1) A_inv[i] = exp_kdelta.inverse().Adj();
+
+      if constexpr (DERIV >= 1) {
+        vel_pre[i] = A_inv[i] * rot_vel;
+        Tangent rot_vel_current = delta[i] * dcoeff[i + 1];
+        rot_vel = vel_pre[i] + rot_vel_current;
+        vel[i] = rot_vel;
+
+        if constexpr (DERIV >= 2) {
+          accel_pre[i] = A_inv[i] * rot_accel;
+          rot_accel = accel_pre[i] + ddcoeff[i + 1] * delta[i] +
+                      Group::lieBracket(rot_vel, rot_vel_current);
+        }
+      }
+    }
+
+    if (value_out) *value_out = value;
+    if (vel_out) *vel_out = rot_vel;
+    if (accel_out) *accel_out = rot_accel;
+
+    if (!need_J) return;
+
+    for (JacobianArray<GroupT>* J : {J_value, J_vel, J_accel}) {
+      if (J) {
+        for (int i = 0; i < N; i++) (*J)[i].setZero();
+      }
+    }
+
+    Adjoint P = Adjoint::Identity();
+    Tangent s = Tangent::Zero();
+
+    for (int i = DEG - 1; i >= 0; i--) {
+      const Adjoint Jr_inv = knot_deltas ? knot_deltas[i].Jr_inv
+                                         : Ops::rightJacobianInv(delta[i]);
+      const Adjoint r01_inv_adj =
+          knot_deltas ? knot_deltas[i].r01_inv_adj : r01_inv[i].Adj();
+
+      // Chain d_out_d_delta with the derivative of delta with respect to the
+      // knots i and i + 1.
+      auto add = [&](JacobianArray<GroupT>* J, const Adjoint& d_out_d_delta) {
+        const Adjoint H = d_out_d_delta * Jr_inv;
+        (*J)[i + 1] += H;
+        (*J)[i] -= H * r01_inv_adj;
+      };
+
+      const double k = coeff[i + 1];
+      const Adjoint k_Jr = k * Ops::rightJacobian(k * delta[i]);
+
+      if (J_value) add(J_value, P * k_Jr);
+
+      if constexpr (DERIV >= 1) {
+        const double dk = dcoeff[i + 1];
+
+        Adjoint d_vel = Ops::ad(vel_pre[i]) * k_Jr;
+        d_vel.diagonal().array() += dk;
+
+        if (J_vel) add(J_vel, P * d_vel);
+
+        if constexpr (DERIV >= 2) {
+          const double ddk = ddcoeff[i + 1];
+
+          Adjoint d_accel = Ops::ad(accel_pre[i]) * k_Jr +
+                            dk * Ops::ad(vel[i]) -
+                            dk * Ops::ad(delta[i]) * d_vel;
+          d_accel.diagonal().array() += ddk;
+
+          if (J_accel) add(J_accel, P * d_accel - Ops::ad(s) * P * d_vel);
+
+          s += P * (dk * delta[i]);
+        }
+      }
+
+      P = P * A_inv[i];
+    }
+
+    if (J_value) (*J_value)[0] += P;
+  }
+};
+
+/// @brief Base of analytic residuals of segment s that can read the knot
+/// differences of their segment from a table of all knots, e.g. of a
+/// KnotDeltaCallback, instead of computing them.
+///
+/// Entry i of the table is the difference of knots i and i + 1. The table
+/// must be up to date whenever the residual is evaluated, which a
+/// KnotDeltaCallback guarantees for evaluations by the problem. Evaluating
+/// the cost function directly at other parameters, e.g. the numeric
+/// differentiation of ceres::GradientChecker or
+/// Solver::Options::check_gradients, reads stale differences, so gradients
+/// must be checked without a table.
+template <int _N, class Groupd>
+class SegmentKnotDeltas {
+ public:
+  using Table = Eigen::aligned_vector<LieKnotDelta<Groupd>>;
+
+  void setKnotDeltas(const Table* table, int64_t s) {
+    knot_delta_table = table;
+    segment = s;
+  }
+
+ protected:
+  /// Differences of the segment knots, or nullptr without a table or while
+  /// it does not cover the segment, e.g. before the first evaluation. The
+  /// residual then computes the differences itself.
+  const LieKnotDelta<Groupd>* knotDeltas() const {
+    if (!knot_delta_table ||
+        knot_delta_table->size() < size_t(segment + _N - 1)) {
+      return nullptr;
+    }
+    return knot_delta_table->data() + segment;
+  }
+
+ private:
+  const Table* knot_delta_table = nullptr;
+  int64_t segment = 0;
+};
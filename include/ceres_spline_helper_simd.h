@@ -0,0 +1,374 @@
+#pragma once
+
+#include <type_traits>
+
+#include <basalt/spline/ceres_spline_helper.h>
+#include <basalt/utils/eigen_utils.hpp>
+
+#include <sophus/se3.hpp>
+#include <sophus/so3.hpp>
+
+using namespace basalt;
+
+/// Number of time instants evaluated at once by CeresSplineHelperSimd. Matches
+/// the number of doubles in a vector register of the target architecture.
+#if defined(__AVX512F__)
+constexpr int SPLINE_SIMD_LANES = 8;
+#elif defined(__AVX__)
+constexpr int SPLINE_SIMD_LANES = 4;
+#else
+constexpr int SPLINE_SIMD_LANES = 2;
+#endif
+
+/// Number of Scalars in a vector register, twice SPLINE_SIMD_LANES for float.
+template <class Scalar>
+constexpr int spline_simd_lanes =
+    SPLINE_SIMD_LANES * int(sizeof(double) / sizeof(Scalar));
+
+/// @brief Structure-of-arrays copy of the knots of a Lie group spline and of
+/// the differences log(k_i^{-1} * k_{i+1}) of consecutive knots.
+///
+/// Row c of knots holds parameter c of all knots (Sophus data layout), row c
+/// of deltas holds tangent component c of all knot differences. With Scalar
+/// float the double knots and differences are rounded once on update, which
+/// halves the memory of the store.
+template <class Groupd, class Scalar = double>
+struct LieSplineSoA {
+  static constexpr int num_parameters = Groupd::num_parameters;
+  static constexpr int DoF = Groupd::DoF;
+
+  void update(const Eigen::aligned_vector<Groupd>& k,
+              const typename Groupd::Tangent* d) {
+    knots.resize(num_parameters, k.size());
+    deltas.resize(DoF, k.empty() ? 0 : k.size() - 1);
+
+    for (size_t i = 0; i < k.size(); i++) {
+      knots.col(i) = Eigen::Map<const Eigen::Matrix<double, num_parameters, 1>>(
+                         k[i].data())
+                         .template cast<Scalar>();
+    }
+    for (int i = 0; i < deltas.cols(); i++) {
+      deltas.col(i) = d[i].template cast<Scalar>();
+    }
+  }
+
+  Eigen::Matrix<Scalar, num_parameters, Eigen::Dynamic, Eigen::RowMajor> knots;
+  Eigen::Matrix<Scalar, DoF, Eigen::Dynamic, Eigen::RowMajor> deltas;
+};
+
+/// @brief Evaluation of SO(3) and SE(3) cumulative B-splines at several time
+/// instants at once.
+///
+/// Every lane evaluates the same math as CeresSplineHelperDelta::evaluate_lie
+/// for its own segment and normalized time. All quantities are stored as
+/// arrays over lanes, such that blending coefficients, exp maps, quaternion
+/// products and Adjoint actions compile to vector instructions.
+///
+/// With Scalar float the kernels read a float LieSplineSoA and process twice
+/// as many lanes per instruction, at about 1e-7 relative accuracy.
+template <int _N, class _Scalar = double,
+          int _Lanes = spline_simd_lanes<_Scalar>>
+struct CeresSplineHelperSimd : public CeresSplineHelper<_N> {
+  static constexpr int N = _N;        // Order of the spline.
+  static constexpr int DEG = _N - 1;  // Degree of the spline.
+  static constexpr int Lanes = _Lanes;
+
+  using Scalar = _Scalar;
+
+  using Arr = Eigen::Array<Scalar, Lanes, 1>;
+  using ArrN = Eigen::Array<Scalar, Lanes, N>;
+  using Arr3 = Eigen::Array<Scalar, Lanes, 3>;
+
+  template <template <class> class GroupT>
+  using ValueArr = Eigen::Array<Scalar, Lanes, GroupT<double>::num_parameters>;
+
+  template <template <class> class GroupT>
+  using TangentArr = Eigen::Array<Scalar, Lanes, GroupT<double>::DoF>;
+
+  /// Knot store read by evaluate_lie.
+  template <template <class> class GroupT>
+  using SoA = LieSplineSoA<GroupT<double>, Scalar>;
+
+  /// True for the groups supported by evaluate_lie.
+  template <template <class> class GroupT>
+  static constexpr bool supports() {
+    return std::is_same<GroupT<double>, Sophus::SO3d>::value ||
+           std::is_same<GroupT<double>, Sophus::SE3d>::value;
+  }
+
+  /// @brief Cumulative blending coefficients of all lanes.
+  ///
+  /// Column i of the result is the coefficient of knot difference i - 1,
+  /// scaled by pow_inv_dt for the requested derivative.
+  template <int Derivative>
+  static inline ArrN cumulativeCoeffs(const Arr& u, double pow_inv_dt) {
+    ArrN p;
+    p.setZero();
+
+    if (Derivative < N) {
+      p.col(Derivative).setConstant(Scalar(
+          CeresSplineHelper<N>::base_coefficients_(Derivative, Derivative)));
+
+      Arr _t = u;
+      for (int j = Derivative + 1; j < N; j++) {
+        p.col(j) =
+            Scalar(CeresSplineHelper<N>::base_coefficients_(Derivative, j)) *
+            _t;
+        _t = _t * u;
+      }
+    }
+
+    ArrN coeff = Scalar(pow_inv_dt) *
+                 (p.matrix() * CeresSplineHelper<N>::cumulative_blending_matrix_
+                                   .transpose()
+                                   .template cast<Scalar>())
+                     .array();
+    return coeff;
+  }
+
+  /// @brief Evaluate the spline value and body frame time derivatives.
+  ///
+  /// @param[in] soa structure-of-arrays knots and knot differences
+  /// @param[in] s segment index of every lane
+  /// @param[in] u normalized time of every lane
+  /// @param[in] inv_dt inverse of the time spacing in seconds between spline
+  /// knots
+  /// @param[out] value_out if not nullptr values, one row of Sophus
+  /// parameters per lane
+  /// @param[out] vel_out if not nullptr velocities in the body frame
+  /// @param[out] accel_out if not nullptr accelerations in the body frame
+  template <template <class> class GroupT>
+  static inline void evaluate_lie(const SoA<GroupT>& soa,
+                                  const int64_t* s, const Arr& u,
+                                  const double inv_dt,
+                                  ValueArr<GroupT>* value_out = nullptr,
+                                  TangentArr<GroupT>* vel_out = nullptr,
+                                  TangentArr<GroupT>* accel_out = nullptr) {
+    static_assert(supports<GroupT>(), "Only SO3 and SE3 are supported.");
+
+    constexpr bool is_se3 =
+        std::is_same<GroupT<double>, Sophus::SE3d>::value;
+
+    // Offset of the rotational part in the tangent vector.
+    constexpr int rot_idx = is_se3 ? 3 : 0;
+
+    const bool need_vel = vel_out || accel_out;
+
+    ArrN coeff = ArrN::Zero();
+    ArrN dcoeff = ArrN::Zero();
+    ArrN ddcoeff = ArrN::Zero();
+    coeff = cumulativeCoeffs<0>(u, 1.0);
+    if (need_vel) dcoeff = cumulativeCoeffs<1>(u, inv_dt);
+    if (accel_out) ddcoeff = cumulativeCoeffs<2>(u, inv_dt * inv_dt);
+
+    // Value: quaternion (x, y, z, w) and translation.
+    Arr qx, qy, qz, qw;
+    Arr3 t;
+
+    if (value_out) {
+      qx = gather(soa.knots, 0, s, 0);
+      qy = gather(soa.knots, 1, s, 0);
+      qz = gather(soa.knots, 2, s, 0);
+      qw = gather(soa.knots, 3, s, 0);
+
+      if constexpr (is_se3) {
+        for (int c = 0; c < 3; c++) t.col(c) = gather(soa.knots, 4 + c, s, 0);
+      }
+    }
+
+    // Velocity and acceleration: rotational part and, for SE(3), translational
+    // part.
+    Arr3 w_vel, w_accel, v_vel, v_accel;
+    if (need_vel) {
+      w_vel.setZero();
+      if constexpr (is_se3) v_vel.setZero();
+    }
+    if (accel_out) {
+      w_accel.setZero();
+      if constexpr (is_se3) v_accel.setZero();
+    }
+
+    for (int i = 0; i < DEG; i++) {
+      Arr3 d_rot, d_trans;
+      for (int c = 0; c < 3; c++) {
+        d_rot.col(c) = gather(soa.deltas, rot_idx + c, s, i);
+        if constexpr (is_se3) d_trans.col(c) = gather(soa.deltas, c, s, i);
+      }
+
+      const Arr k = coeff.col(i + 1);
+
+      // exp(k * delta)
+      Arr3 omega = d_rot.colwise() * k;
+      Arr ex, ey, ez, ew;
+      Arr3 et;
+      expSO3(omega, ex, ey, ez, ew);
+
+      if constexpr (is_se3) {
+        Arr3 upsilon = d_trans.colwise() * k;
+        expSE3Translation(omega, upsilon, et);
+      }
+
+      if (value_out) {
+        if constexpr (is_se3) {
+          t += rotate(qx, qy, qz, qw, et);
+        }
+        quatMultiply(qx, qy, qz, qw, ex, ey, ez, ew);
+      }
+
+      if (need_vel) {
+        const Arr dk = dcoeff.col(i + 1);
+
+        // A = Adj(exp(k * delta)^{-1}) applied to the accumulated derivatives.
+        Arr3 w_vel_current = d_rot.colwise() * dk;
+        Arr3 v_vel_current;
+
+        if constexpr (is_se3) {
+          v_vel_current = d_trans.colwise() * dk;
+          v_vel = rotateInverse(ex, ey, ez, ew, v_vel - cross(et, w_vel)) +
+                  v_vel_current;
+        }
+        w_vel = rotateInverse(ex, ey, ez, ew, w_vel) + w_vel_current;
+
+        if (accel_out) {
+          const Arr ddk = ddcoeff.col(i + 1);
+
+          if constexpr (is_se3) {
+            v_accel =
+                rotateInverse(ex, ey, ez, ew, v_accel - cross(et, w_accel)) +
+                d_trans.colwise() * ddk + cross(w_vel, v_vel_current) +
+                cross(v_vel, w_vel_current);
+          }
+          w_accel = rotateInverse(ex, ey, ez, ew, w_accel) +
+                    d_rot.colwise() * ddk + cross(w_vel, w_vel_current);
+        }
+      }
+    }
+
+    if (value_out) {
+      value_out->col(0) = qx;
+      value_out->col(1) = qy;
+      value_out->col(2) = qz;
+      value_out->col(3) = qw;
+      if constexpr (is_se3) value_out->template rightCols<3>() = t;
+    }
+
+    if (vel_out) {
+      vel_out->template middleCols<3>(rot_idx) = w_vel;
+      if constexpr (is_se3) vel_out->template leftCols<3>() = v_vel;
+    }
+
+    if (accel_out) {
+      accel_out->template middleCols<3>(rot_idx) = w_accel;
+      if constexpr (is_se3) accel_out->template leftCols<3>() = v_accel;
+    }
+  }
+
+ private:
+  template <class Derived>
+  static inline Arr gather(const Eigen::MatrixBase<Derived>& m, int row,
+                           const int64_t* s, int offset) {
+    Arr res;
+    for (int l = 0; l < Lanes; l++) res[l] = m(row, s[l] + offset);
+    return res;
+  }
+
+  static inline Arr3 cross(const Arr3& a, const Arr3& b) {
+    Arr3 res;
+    res.col(0) = a.col(1) * b.col(2) - a.col(2) * b.col(1);
+    res.col(1) = a.col(2) * b.col(0) - a.col(0) * b.col(2);
+    res.col(2) = a.col(0) * b.col(1) - a.col(1) * b.col(0);
+    return res;
+  }
+
+  /// Rotate v by the unit quaternion (x, y, z, w).
+  static inline Arr3 rotate(const Arr& x, const Arr& y, const Arr& z,
+                            const Arr& w, const Arr3& v) {
+    Arr3 q;
+    q << x, y, z;
+    Arr3 uv = cross(q, v);
+    Arr3 uuv = cross(q, uv);
+    return v + Scalar(2) * (uv.colwise() * w + uuv);
+  }
+
+  /// Rotate v by the inverse of the unit quaternion (x, y, z, w).
+  static inline Arr3 rotateInverse(const Arr& x, const Arr& y, const Arr& z,
+                                   const Arr& w, const Arr3& v) {
+    Arr3 q;
+    q << x, y, z;
+    Arr3 uv = cross(q, v);
+    Arr3 uuv = cross(q, uv);
+    return v + Scalar(2) * (uuv - uv.colwise() * w);
+  }
+
+  /// a = a * b for unit quaternions (x, y, z, w).
+  static inline void quatMultiply(Arr& ax, Arr& ay, Arr& az, Arr& aw,
+                                  const Arr& bx, const Arr& by, const Arr& bz,
+                                  const Arr& bw) {
+    Arr x = aw * bx + ax * bw + ay * bz - az * by;
+    Arr y = aw * by - ax * bz + ay * bw + az * bx;
+    Arr z = aw * bz + ax * by - ay * bx + az * bw;
+    Arr w = aw * bw - ax * bx - ay * by - az * bz;
+    ax = x;
+    ay = y;
+    az = z;
+    aw = w;
+  }
+
+  /// Quaternion of exp(omega), see Sophus::SO3::expAndTheta.
+  static inline void expSO3(const Arr3& omega, Arr& x, Arr& y, Arr& z,
+                            Arr& w) {
+    const Arr theta_sq = omega.square().rowwise().sum();
+    const Arr theta = theta_sq.sqrt();
+    const Arr theta_po4 = theta_sq * theta_sq;
+
+    const auto small =
+        theta_sq < Sophus::Constants<Scalar>::epsilon() *
+                       Sophus::Constants<Scalar>::epsilon();
+
+    const Arr safe_theta = small.select(Arr::Ones(), theta);
+    const Arr half_theta = Scalar(0.5) * safe_theta;
+
+    const Arr imag_factor =
+        small.select(Scalar(0.5) - Scalar(1.0 / 48.0) * theta_sq +
+                         Scalar(1.0 / 3840.0) * theta_po4,
+                     half_theta.sin() / safe_theta);
+    w = small.select(Scalar(1) - Scalar(1.0 / 8.0) * theta_sq +
+                         Scalar(1.0 / 384.0) * theta_po4,
+                     half_theta.cos());
+
+    x = imag_factor * omega.col(0);
+    y = imag_factor * omega.col(1);
+    z = imag_factor * omega.col(2);
+  }
+
+  /// Translation of exp([upsilon, omega]), see Sophus::SE3::exp.
+  static inline void expSE3Translation(const Arr3& omega, const Arr3& upsilon,
+                                       Arr3& t) {
+    const Arr theta_sq = omega.square().rowwise().sum();
+    const Arr theta_po4 = theta_sq * theta_sq;
+
+    // Below this threshold the Taylor expansions are more accurate than the
+    // closed form with its cancellation in 1 - cos(theta). The cancellation
+    // costs about log10(1 / theta^2) digits, so float switches much later.
+    const Scalar small_angle_sq =
+        std::is_same<Scalar, float>::value ? Scalar(1e-2) : Scalar(1e-6);
+    const auto small = theta_sq < small_angle_sq;
+
+    const Arr safe_theta_sq = small.select(Arr::Ones(), theta_sq);
+    const Arr safe_theta = safe_theta_sq.sqrt();
+
+    const Arr b = small.select(
+        Scalar(0.5) - Scalar(1.0 / 24.0) * theta_sq +
+            Scalar(1.0 / 720.0) * theta_po4,
+        (Scalar(1) - safe_theta.cos()) / safe_theta_sq);
+    const Arr c = small.select(
+        Scalar(1.0 / 6.0) - Scalar(1.0 / 120.0) * theta_sq +
+            Scalar(1.0 / 5040.0) * theta_po4,
+        (safe_theta - safe_theta.sin()) / (safe_theta_sq * safe_theta));
+
+    Arr3 w_x_u = cross(omega, upsilon);
+    Arr3 w_x_w_x_u = cross(omega, w_x_u);
+
+    t = upsilon + w_x_u.colwise() * b + w_x_w_x_u.colwise() * c;
+  }
+};
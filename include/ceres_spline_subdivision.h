@@ -0,0 +1,223 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include <basalt/utils/assert.h>
+#include <basalt/utils/eigen_utils.hpp>
+
+#include <Eigen/Core>
+#include <Eigen/SparseCholesky>
+
+#include <ceres_spline_helper_jacobian.h>
+
+/// @brief Knot insertion for uniform B-splines: halve the knot spacing.
+///
+/// A B-spline of order N with knot spacing dt is exactly a B-spline with
+/// spacing dt / 2, and the fine knots follow from the refinement equation of
+/// the B-spline basis: fine knot j is 2^-DEG * sum_i C(N, j - 2i + DEG) * P_i
+/// for coarse knots P_i. The fine spline starts at the same time and covers
+/// the same time range, so K coarse knots give 2K - DEG fine knots.
+///
+/// Euclidean knots are refined exactly. For Lie group knots the same weights
+/// are applied to the tangent vectors log(P_ref^{-1} * P_i) relative to the
+/// coarse knot with the largest weight. This is exact if the knots lie on a
+/// one-parameter subgroup, e.g. rotations about a fixed axis. Otherwise the
+/// fine knots are refined with a few Gauss-Newton steps that fit the values
+/// and velocities of the fine spline to samples of the coarse one, such that
+/// it follows the coarse curve as closely as the finer spacing allows.
+template <int _N>
+struct CeresSplineSubdivision {
+  static constexpr int N = _N;        // Order of the spline.
+  static constexpr int DEG = _N - 1;  // Degree of the spline.
+
+  /// Number of fine knots for num_knots coarse knots.
+  static size_t numFineKnots(size_t num_knots) {
+    BASALT_ASSERT_STREAM(num_knots >= size_t(N), "num_knots " << num_knots);
+    return 2 * num_knots - DEG;
+  }
+
+  /// @brief Weight of coarse knot i in fine knot j, zero outside of the
+  /// support.
+  static double weight(int j, int i) {
+    const int k = j - 2 * i + DEG;
+    if (k < 0 || k > N) return 0;
+
+    // Binomial coefficient C(N, k) / 2^DEG.
+    double res = 1;
+    for (int l = 1; l <= k; l++) res = res * (N - k + l) / l;
+    return res / (1 << DEG);
+  }
+
+  /// Refine Euclidean knots, e.g. Eigen vectors.
+  template <class Knot>
+  static Eigen::aligned_vector<Knot> subdivide(
+      const Eigen::aligned_vector<Knot>& knots) {
+    Eigen::aligned_vector<Knot> res(numFineKnots(knots.size()));
+
+    for (size_t j = 0; j < res.size(); j++) {
+      int i0, i1;
+      coarseRange(j, &i0, &i1);
+
+      res[j] = weight(j, i0) * knots[i0];
+      for (int i = i0 + 1; i <= i1; i++) res[j] += weight(j, i) * knots[i];
+    }
+
+    return res;
+  }
+
+  /// Refine Lie group knots, e.g. Sophus::SO3d or Sophus::SE3d.
+  template <class Groupd>
+  static Eigen::aligned_vector<Groupd> subdivideLie(
+      const Eigen::aligned_vector<Groupd>& knots) {
+    using Tangentd = typename Groupd::Tangent;
+
+    Eigen::aligned_vector<Groupd> res(numFineKnots(knots.size()));
+
+    for (size_t j = 0; j < res.size(); j++) {
+      int i0, i1;
+      coarseRange(j, &i0, &i1);
+
+      int ref = i0;
+      for (int i = i0 + 1; i <= i1; i++) {
+        if (weight(j, i) > weight(j, ref)) ref = i;
+      }
+
+      const Groupd ref_inv = knots[ref].inverse();
+
+      Tangentd delta = Tangentd::Zero();
+      for (int i = i0; i <= i1; i++) {
+        if (i != ref) delta += weight(j, i) * (ref_inv * knots[i]).log();
+      }
+
+      res[j] = knots[ref] * Groupd::exp(delta);
+    }
+
+    refineLie(knots, res);
+
+    return res;
+  }
+
+ private:
+  /// Samples of the coarse curve per fine segment in refineLie.
+  static constexpr int kSamplesPerSegment = 4;
+
+  /// Maximum number of Gauss-Newton steps of refineLie and the largest
+  /// knot update at which it stops.
+  static constexpr int kMaxRefineIterations = 5;
+  static constexpr double kRefineTolerance = 1e-10;
+
+  /// @brief Fit the fine knots to the coarse spline.
+  ///
+  /// Minimizes the squared norms of log(C(t)^{-1} F(t)) and of the velocity
+  /// differences at kSamplesPerSegment times per fine segment, with the
+  /// analytic Jacobians of CeresSplineHelperJacobian. Every fine knot has
+  /// samples in its support, so the normal equations are positive definite.
+  template <template <class> class GroupT>
+  static void refineLie(const Eigen::aligned_vector<GroupT<double>>& coarse,
+                        Eigen::aligned_vector<GroupT<double>>& fine) {
+    using Groupd = GroupT<double>;
+    using Tangentd = typename Groupd::Tangent;
+    using Adjointd = typename Groupd::Adjoint;
+    using Helper = CeresSplineHelperJacobian<N>;
+    using JacobianArray = typename Helper::template JacobianArray<GroupT>;
+    constexpr int DOF = Groupd::DoF;
+
+    const int num_unknowns = DOF * int(fine.size());
+
+    // Knots j and j + d share segments for d < N, so the normal equations
+    // are block banded. Block (j, j + d) is stored at band[N * j + d].
+    Eigen::aligned_vector<Adjointd> band(N * fine.size());
+
+    for (int iter = 0; iter < kMaxRefineIterations; iter++) {
+      std::fill(band.begin(), band.end(), Adjointd::Zero());
+      Eigen::VectorXd b = Eigen::VectorXd::Zero(num_unknowns);
+
+      for (size_t s = 0; s + N <= fine.size(); s++) {
+        std::array<const double*, N> fine_ptrs, coarse_ptrs;
+        for (int i = 0; i < N; i++) {
+          fine_ptrs[i] = fine[s + i].data();
+          coarse_ptrs[i] = coarse[s / 2 + i].data();
+        }
+
+        // Add residual r with Jacobians J_r with respect to the segment
+        // knots to the normal equations.
+        auto add = [&](const Tangentd& r,
+                       const std::array<Adjointd, N>& J_r) {
+          for (int i = 0; i < N; i++) {
+            b.template segment<DOF>(DOF * (s + i)) -= J_r[i].transpose() * r;
+
+            for (int k = i; k < N; k++) {
+              band[N * (s + i) + k - i].noalias() +=
+                  J_r[i].transpose() * J_r[k];
+            }
+          }
+        };
+
+        for (int m = 0; m < kSamplesPerSegment; m++) {
+          // Fine segment s is one half of coarse segment s / 2. Times are in
+          // units of the coarse knot spacing.
+          const double u = (m + 0.5) / kSamplesPerSegment;
+          const double u_coarse = 0.5 * (s % 2 + u);
+
+          Groupd value_coarse, value_fine;
+          Tangentd vel_coarse, vel_fine;
+          JacobianArray J_value, J_vel;
+
+          CeresSplineHelper<N>::template evaluate_lie<double, GroupT>(
+              coarse_ptrs.data(), u_coarse, 1.0, &value_coarse, &vel_coarse);
+          Helper::template evaluate_lie<GroupT, 0>(fine_ptrs.data(), u, 2.0,
+                                                   &value_fine, &J_value);
+          Helper::template evaluate_lie<GroupT, 1>(fine_ptrs.data(), u, 2.0,
+                                                   &vel_fine, &J_vel);
+
+          // log(C^{-1} F exp(J e)) ~ r + Jr^{-1}(r) J e
+          const Tangentd r = (value_coarse.inverse() * value_fine).log();
+          const Adjointd Jr_inv = LieGroupOps<Groupd>::rightJacobianInv(r);
+          for (int i = 0; i < N; i++) J_value[i] = Jr_inv * J_value[i];
+
+          add(r, J_value);
+          add(vel_fine - vel_coarse, J_vel);
+        }
+      }
+
+      std::vector<Eigen::Triplet<double>> triplets;
+      triplets.reserve(band.size() * DOF * DOF);
+      for (size_t j = 0; j < fine.size(); j++) {
+        for (int d = 0; d < N && j + d < fine.size(); d++) {
+          const Adjointd& H = band[N * j + d];
+          for (int x = 0; x < DOF; x++) {
+            for (int y = 0; y < DOF; y++) {
+              // Upper triangle, which SimplicialLDLT reads.
+              if (d > 0 || y >= x) {
+                triplets.emplace_back(DOF * j + x, DOF * (j + d) + y, H(x, y));
+              }
+            }
+          }
+        }
+      }
+
+      Eigen::SparseMatrix<double> H(num_unknowns, num_unknowns);
+      H.setFromTriplets(triplets.begin(), triplets.end());
+
+      Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>, Eigen::Upper> solver(
+          H);
+      if (solver.info() != Eigen::Success) return;
+
+      const Eigen::VectorXd dx = solver.solve(b);
+      for (size_t j = 0; j < fine.size(); j++) {
+        fine[j] *= Groupd::exp(dx.template segment<DOF>(DOF * j));
+      }
+
+      if (dx.template lpNorm<Eigen::Infinity>() < kRefineTolerance) return;
+    }
+  }
+
+  /// Coarse knots i0..i1 with non-zero weight in fine knot j.
+  static void coarseRange(size_t j, int* i0, int* i1) {
+    *i0 = int(j) / 2;
+    *i1 = (int(j) + DEG) / 2;
+  }
+};
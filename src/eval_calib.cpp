@@ -1,10 +1,13 @@
 
 #include <ceres_calib_spline_se3.h>
 #include <ceres_calib_spline_split.h>
+#include <ceres_nonuniform_knots.h>
+#include <ceres_spline_subdivision.h>
 
 #include <basalt/io/dataset_io_euroc.h>
 #include <basalt/optimization/spline_optimize.h>
 #include <basalt/spline/so3_spline.h>
+#include <basalt/utils/assert.h>
 #include <basalt/utils/common_types.h>
 
 #include <basalt/serialization/headers_serialization.h>
@@ -14,6 +17,13 @@
 
 #include <sophus/average.hpp>
 
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
 basalt::Calibration<double> calib;
 
 std::unordered_map<basalt::TimeCamId, basalt::CalibCornerData> calib_corners,
@@ -32,39 +42,17 @@ struct CalibResults {
   double opt_time_s;
   int num_iter;
 
+  /// Optimization time and iterations per level of the coarse-to-fine
+  /// methods, coarsest first.
+  std::vector<double> level_opt_time_s;
+  std::vector<int> level_num_iter;
+
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW;
 };
 
-template <class SplineT>
-void run_calibration(const basalt::VioDatasetPtr& vio_dataset,
-                     std::shared_ptr<basalt::AprilGrid>& aprilgrid,
-                     const std::string& method_name,
-                     Eigen::aligned_vector<CalibResults>& results) {
-  std::cout << "=============================================" << std::endl;
-  std::cout << "Running calibration with " << method_name << " method"
-            << std::endl;
-
-  constexpr int N = SplineT::N;
-  const int64_t dt_ns = 1e7;
-
-  int64_t start_t_ns =
-      std::max(vio_dataset->get_image_timestamps().front(),
-               vio_dataset->get_gyro_data().front().timestamp_ns);
-
-  int64_t end_t_ns = std::min(vio_dataset->get_image_timestamps().back(),
-                              vio_dataset->get_gyro_data().back().timestamp_ns);
-
-  SplineT calib_spline(dt_ns, start_t_ns);
-  calib_spline.setAprilgrid(aprilgrid);
-  calib_spline.setCalib(calib);
-
-  basalt::TimeCamId tcid_init(vio_dataset->get_image_timestamps().front(), 0);
-  Sophus::SE3d T_w_i_init =
-      calib_init_poses.at(tcid_init).T_a_c * calib.T_i_c[0].inverse();
-
-  calib_spline.init(T_w_i_init, (end_t_ns - start_t_ns) / dt_ns + N);
-
-  // Initialize gravity
+/// Gravity in the aprilgrid frame from the first accelerometer sample close
+/// to an image with an initial pose.
+Eigen::Vector3d initial_gravity(const basalt::VioDatasetPtr& vio_dataset) {
   bool g_initialized = false;
   Eigen::Vector3d g_a_init;
 
@@ -75,7 +63,6 @@ void run_calibration(const basalt::VioDatasetPtr& vio_dataset,
     const auto cp_it = calib_init_poses.find(tcid);
 
     if (cp_it != calib_init_poses.end()) {
-      // linear interpolation
       Sophus::SE3d T_a_i = cp_it->second.T_a_c * calib.T_i_c[0].inverse();
 
       if (!g_initialized) {
@@ -92,47 +79,112 @@ void run_calibration(const basalt::VioDatasetPtr& vio_dataset,
       }
     }
   }
-  // set gravity
-  calib_spline.setG(g_a_init);
 
+  return g_a_init;
+}
+
+/// Timestamps of every decimation-th image.
+std::unordered_set<int64_t> decimated_frames(
+    const basalt::VioDatasetPtr& vio_dataset, int decimation) {
+  std::unordered_set<int64_t> res;
+  const auto& timestamps = vio_dataset->get_image_timestamps();
+  for (size_t j = 0; j < timestamps.size(); j += decimation) {
+    res.emplace(timestamps[j]);
+  }
+  return res;
+}
+
+/// Add every decimation-th gyro and accel sample and the corners of every
+/// decimation-th image in [start_t_ns, end_t_ns) to the spline. Gyro and
+/// accel samples with the same timestamp, e.g. from EurocIO, are added as one
+/// IMU residual. With sync_cameras the corners of all cameras of an image are
+/// added as one residual, see addSyncCornersMeasurement.
+template <class SplineT>
+void add_measurements(SplineT& calib_spline,
+                      const basalt::VioDatasetPtr& vio_dataset,
+                      int64_t start_t_ns, int64_t end_t_ns, int decimation,
+                      bool sync_cameras = false) {
   int num_gyro = 0;
   int num_accel = 0;
+  int num_imu = 0;
   int num_corner = 0;
   int num_frames = 0;
 
-  for (const auto& v : vio_dataset->get_gyro_data()) {
-    if (v.timestamp_ns >= start_t_ns && v.timestamp_ns < end_t_ns) {
-      calib_spline.addGyroMeasurement(v.data, v.timestamp_ns);
-      num_gyro++;
+  auto in_range = [&](int64_t t_ns) {
+    return t_ns >= start_t_ns && t_ns < end_t_ns;
+  };
+
+  const auto& gyro_data = vio_dataset->get_gyro_data();
+  const auto& accel_data = vio_dataset->get_accel_data();
+  const size_t num_samples = std::max(gyro_data.size(), accel_data.size());
+  for (size_t i = 0; i < num_samples; i += decimation) {
+    const bool has_gyro =
+        i < gyro_data.size() && in_range(gyro_data[i].timestamp_ns);
+    const bool has_accel =
+        i < accel_data.size() && in_range(accel_data[i].timestamp_ns);
+
+    if (has_gyro && has_accel &&
+        gyro_data[i].timestamp_ns == accel_data[i].timestamp_ns) {
+      calib_spline.addImuMeasurement(gyro_data[i].data, accel_data[i].data,
+                                     gyro_data[i].timestamp_ns);
+      num_imu++;
+      continue;
     }
-  }
 
-  for (const auto& v : vio_dataset->get_accel_data()) {
-    if (v.timestamp_ns >= start_t_ns && v.timestamp_ns < end_t_ns) {
-      calib_spline.addAccelMeasurement(v.data, v.timestamp_ns);
+    if (has_gyro) {
+      calib_spline.addGyroMeasurement(gyro_data[i].data,
+                                      gyro_data[i].timestamp_ns);
+      num_gyro++;
+    }
+    if (has_accel) {
+      calib_spline.addAccelMeasurement(accel_data[i].data,
+                                       accel_data[i].timestamp_ns);
       num_accel++;
     }
   }
 
-  // done
+  const std::unordered_set<int64_t> frames =
+      decimated_frames(vio_dataset, decimation);
+
+  // Corners of all cameras per frame.
+  using CamCorners = std::pair<int, const basalt::CalibCornerData*>;
+  std::map<int64_t, std::vector<CamCorners>> frame_corners;
   for (const auto& kv : calib_corners) {
-    if (kv.first.frame_id >= start_t_ns && kv.first.frame_id < end_t_ns) {
-      calib_spline.addCornersMeasurement(&kv.second, kv.first.cam_id,
-                                         kv.first.frame_id);
+    if (kv.first.frame_id >= start_t_ns && kv.first.frame_id < end_t_ns &&
+        frames.count(kv.first.frame_id)) {
+      frame_corners[kv.first.frame_id].emplace_back(kv.first.cam_id,
+                                                    &kv.second);
 
       num_corner += kv.second.corner_ids.size();
       num_frames++;
     }
   }
 
-  calib_spline.meanReprojection(calib_corners);
-  ceres::Solver::Summary summary = calib_spline.optimize();
-
-  double mean_reproj = calib_spline.meanReprojection(calib_corners);
+  for (auto& kv : frame_corners) {
+    std::sort(kv.second.begin(), kv.second.end());
+    if (sync_cameras) {
+      calib_spline.addSyncCornersMeasurement(kv.second, kv.first);
+    } else {
+      for (const auto& [cam_id, corners] : kv.second) {
+        calib_spline.addCornersMeasurement(corners, cam_id, kv.first);
+      }
+    }
+  }
 
   std::cout << "num_gyro " << num_gyro << " num_accel " << num_accel
-            << " num_corner " << num_corner << " num_frames " << num_frames
-            << " duration " << (end_t_ns - start_t_ns) * 1e-9 << std::endl;
+            << " num_imu " << num_imu << " num_corner " << num_corner
+            << " num_frames " << num_frames << " duration "
+            << (end_t_ns - start_t_ns) * 1e-9 << std::endl;
+}
+
+/// Print the calibration, export the IMU measurements of the spline, save
+/// the spline file and store the results.
+template <class SplineT>
+void finish_calibration(SplineT& calib_spline, const std::string& method_name,
+                        int64_t start_t_ns, int64_t end_t_ns,
+                        CalibResults& r,
+                        Eigen::aligned_vector<CalibResults>& results) {
+  double mean_reproj = calib_spline.meanReprojection(calib_corners);
 
   std::cout << "g: " << calib_spline.getG().transpose() << std::endl;
   std::cout << "accel_bias: " << calib_spline.getAccelBias().transpose()
@@ -144,25 +196,32 @@ void run_calibration(const basalt::VioDatasetPtr& vio_dataset,
               << calib_spline.getCalib().T_i_c[i].matrix() << std::endl;
   }
 
-  std::ofstream f(method_name + ".csv");
-
+  std::vector<int64_t> export_t_ns;
   for (int64_t t_ns = start_t_ns; t_ns < end_t_ns; t_ns += 1e6) {
-    Eigen::Vector3d gyro, accel;
+    export_t_ns.emplace_back(t_ns);
+  }
 
-    gyro = calib_spline.getGyro(t_ns);
-    accel = calib_spline.getAccel(t_ns);
+  Eigen::aligned_vector<Eigen::Vector3d> export_gyro(export_t_ns.size()),
+      export_accel(export_t_ns.size());
+  calib_spline.evaluateBatch(export_t_ns.data(), export_t_ns.size(), nullptr,
+                             export_gyro.data(), export_accel.data());
 
-    f << t_ns << "," << gyro[0] << "," << gyro[1] << "," << gyro[2] << ","
-      << accel[0] << "," << accel[1] << "," << accel[2] << std::endl;
+  std::ofstream f(method_name + ".csv");
+
+  for (size_t i = 0; i < export_t_ns.size(); i++) {
+    const Eigen::Vector3d& gyro = export_gyro[i];
+    const Eigen::Vector3d& accel = export_accel[i];
+
+    f << export_t_ns[i] << "," << gyro[0] << "," << gyro[1] << "," << gyro[2]
+      << "," << accel[0] << "," << accel[1] << "," << accel[2] << std::endl;
   }
   f.close();
 
-  CalibResults r;
+  calib_spline.save(method_name + ".spline");
+
   r.calib = calib_spline.getCalib();
   r.g = calib_spline.getG();
-  r.opt_time_s = summary.total_time_in_seconds;
   r.method_name = method_name;
-  r.num_iter = summary.num_successful_steps;
   r.accel_bias = calib_spline.getAccelBias();
   r.gyro_bias = calib_spline.getGyroBias();
   r.mean_reproj = mean_reproj;
@@ -170,6 +229,195 @@ void run_calibration(const basalt::VioDatasetPtr& vio_dataset,
   results.emplace_back(r);
 }
 
+template <class SplineT>
+void run_calibration(const basalt::VioDatasetPtr& vio_dataset,
+                     std::shared_ptr<basalt::AprilGrid>& aprilgrid,
+                     const std::string& method_name,
+                     Eigen::aligned_vector<CalibResults>& results,
+                     bool batch_segments = false, bool sync_cameras = false,
+                     bool knot_delta_callback = false) {
+  std::cout << "=============================================" << std::endl;
+  std::cout << "Running calibration with " << method_name << " method"
+            << std::endl;
+
+  constexpr int N = SplineT::N;
+  const int64_t dt_ns = 1e7;
+
+  int64_t start_t_ns =
+      std::max(vio_dataset->get_image_timestamps().front(),
+               vio_dataset->get_gyro_data().front().timestamp_ns);
+
+  int64_t end_t_ns = std::min(vio_dataset->get_image_timestamps().back(),
+                              vio_dataset->get_gyro_data().back().timestamp_ns);
+
+  SplineT calib_spline(dt_ns, start_t_ns, knot_delta_callback);
+  calib_spline.setAprilgrid(aprilgrid);
+  calib_spline.setCalib(calib);
+  calib_spline.setKnotDeltaCache(true);
+  calib_spline.setSegmentBatching(batch_segments);
+
+  basalt::TimeCamId tcid_init(vio_dataset->get_image_timestamps().front(), 0);
+  Sophus::SE3d T_w_i_init =
+      calib_init_poses.at(tcid_init).T_a_c * calib.T_i_c[0].inverse();
+
+  calib_spline.init(T_w_i_init, (end_t_ns - start_t_ns) / dt_ns + N);
+  Eigen::Vector3d g_a_init = initial_gravity(vio_dataset);
+  calib_spline.setG(g_a_init);
+
+  add_measurements(calib_spline, vio_dataset, start_t_ns, end_t_ns, 1,
+                   sync_cameras);
+
+  calib_spline.meanReprojection(calib_corners);
+  ceres::Solver::Summary summary = calib_spline.optimize();
+
+  CalibResults r;
+  r.opt_time_s = summary.total_time_in_seconds;
+  r.num_iter = summary.num_successful_steps;
+
+  finish_calibration(calib_spline, method_name, start_t_ns, end_t_ns, r,
+                     results);
+}
+
+/// @brief Coarse-to-fine calibration.
+///
+/// Level l solves with knot spacing 2^l * 1e7 ns on every 2^l-th IMU sample
+/// and image, starting at the coarsest level from a constant pose. Each finer
+/// level starts from the subdivided knots of the previous one
+/// (initSubdivided), and level 0 uses all data at the target spacing.
+template <class SplineT>
+void run_calibration_pyramid(const basalt::VioDatasetPtr& vio_dataset,
+                             std::shared_ptr<basalt::AprilGrid>& aprilgrid,
+                             const std::string& method_name,
+                             Eigen::aligned_vector<CalibResults>& results,
+                             int num_levels = 3) {
+  std::cout << "=============================================" << std::endl;
+  std::cout << "Running calibration with " << method_name << " method"
+            << std::endl;
+
+  constexpr int N = SplineT::N;
+  const int64_t dt_ns = 1e7;
+
+  int64_t start_t_ns =
+      std::max(vio_dataset->get_image_timestamps().front(),
+               vio_dataset->get_gyro_data().front().timestamp_ns);
+
+  int64_t end_t_ns = std::min(vio_dataset->get_image_timestamps().back(),
+                              vio_dataset->get_gyro_data().back().timestamp_ns);
+
+  CalibResults r;
+  r.opt_time_s = 0;
+  r.num_iter = 0;
+
+  std::unique_ptr<SplineT> calib_spline;
+
+  for (int level = num_levels - 1; level >= 0; level--) {
+    const int64_t level_dt_ns = dt_ns << level;
+
+    std::unique_ptr<SplineT> level_spline(
+        new SplineT(level_dt_ns, start_t_ns));
+    level_spline->setAprilgrid(aprilgrid);
+    level_spline->setCalib(calib);
+    level_spline->setKnotDeltaCache(true);
+
+    if (!calib_spline) {
+      basalt::TimeCamId tcid_init(vio_dataset->get_image_timestamps().front(),
+                                  0);
+      Sophus::SE3d T_w_i_init =
+          calib_init_poses.at(tcid_init).T_a_c * calib.T_i_c[0].inverse();
+
+      level_spline->init(T_w_i_init,
+                         (end_t_ns - start_t_ns) / level_dt_ns + N);
+      Eigen::Vector3d g_a_init = initial_gravity(vio_dataset);
+      level_spline->setG(g_a_init);
+    } else {
+      level_spline->initSubdivided(*calib_spline);
+    }
+
+    add_measurements(*level_spline, vio_dataset, start_t_ns, end_t_ns,
+                     1 << level);
+
+    ceres::Solver::Summary summary = level_spline->optimize();
+
+    std::cout << "level " << level << " dt_ns " << level_dt_ns << " time "
+              << summary.total_time_in_seconds << " num_iter "
+              << summary.num_successful_steps << std::endl;
+
+    r.level_opt_time_s.emplace_back(summary.total_time_in_seconds);
+    r.level_num_iter.emplace_back(summary.num_successful_steps);
+    r.opt_time_s += summary.total_time_in_seconds;
+    r.num_iter += summary.num_successful_steps;
+
+    calib_spline = std::move(level_spline);
+  }
+
+  finish_calibration(*calib_spline, method_name, start_t_ns, end_t_ns, r,
+                     results);
+}
+
+/// Number of spline segments chosen by planKnotTimes for the dataset
+/// compared to the uniform 10 ms knot spacing of the calibration runs.
+void report_knot_plan(const basalt::VioDatasetPtr& vio_dataset) {
+  int64_t start_t_ns =
+      std::max(vio_dataset->get_image_timestamps().front(),
+               vio_dataset->get_gyro_data().front().timestamp_ns);
+
+  int64_t end_t_ns = std::min(vio_dataset->get_image_timestamps().back(),
+                              vio_dataset->get_gyro_data().back().timestamp_ns);
+
+  KnotPlannerOptions options;
+  const std::vector<int64_t> times_ns =
+      planKnotTimes(vio_dataset->get_gyro_data(),
+                    vio_dataset->get_accel_data(), start_t_ns, end_t_ns,
+                    options);
+
+  const int64_t num_uniform = (end_t_ns - start_t_ns) / options.min_dt_ns + 1;
+
+  std::cout << "=============================================" << std::endl;
+  std::cout << "Non-uniform knot plan: " << times_ns.size() - 1
+            << " segments instead of " << num_uniform << " with "
+            << options.min_dt_ns << " ns spacing" << std::endl;
+}
+
+/// Print the calibration of a basalt::SplineOptimization and store the
+/// results, the counterpart of finish_calibration.
+template <class SplineOptimizationT>
+void finish_calibration_custom(const SplineOptimizationT& spline_opt,
+                               const std::string& method_name,
+                               double mean_reproj, CalibResults& r,
+                               Eigen::aligned_vector<CalibResults>& results) {
+  std::cout << "reprojection error: " << mean_reproj << std::endl;
+
+  std::cout << "g: " << spline_opt.getG().transpose() << std::endl;
+
+  Eigen::Vector3d accel_bias;
+  Eigen::Matrix3d accel_scale;
+  spline_opt.calib->calib_accel_bias.getBiasAndScale(accel_bias, accel_scale);
+
+  std::cout << "accel_bias: " << accel_bias.transpose() << "\naccel_scale:\n"
+            << Eigen::Matrix3d::Identity() + accel_scale << std::endl;
+
+  Eigen::Vector3d gyro_bias;
+  Eigen::Matrix3d gyro_scale;
+  spline_opt.calib->calib_gyro_bias.getBiasAndScale(gyro_bias, gyro_scale);
+
+  std::cout << "gyro_bias: " << gyro_bias.transpose() << "\ngyro_scale:\n"
+            << Eigen::Matrix3d::Identity() + gyro_scale << std::endl;
+
+  for (size_t i = 0; i < spline_opt.calib->T_i_c.size(); i++) {
+    std::cout << "T_i_c" << i << ":\n"
+              << spline_opt.calib->T_i_c[i].matrix() << std::endl;
+  }
+
+  r.calib = *(spline_opt.calib);
+  r.g = spline_opt.getG();
+  r.method_name = method_name;
+  r.accel_bias = accel_bias;
+  r.gyro_bias = gyro_bias;
+  r.mean_reproj = mean_reproj;
+
+  results.emplace_back(r);
+}
+
 void run_calibration_custom(const basalt::VioDatasetPtr& vio_dataset,
                             std::shared_ptr<basalt::AprilGrid>& aprilgrid,
                             Eigen::aligned_vector<CalibResults>& results) {
@@ -199,35 +447,7 @@ void run_calibration_custom(const basalt::VioDatasetPtr& vio_dataset,
       calib_init_poses.at(tcid_init).T_a_c * calib.T_i_c[0].inverse();
 
   spline_opt.initSpline(T_w_i_init, (end_t_ns - start_t_ns) / dt_ns + N);
-
-  // Initialize gravity
-  bool g_initialized = false;
-  Eigen::Vector3d g_a_init;
-
-  for (size_t j = 0; j < vio_dataset->get_image_timestamps().size(); ++j) {
-    int64_t timestamp_ns = vio_dataset->get_image_timestamps()[j];
-
-    basalt::TimeCamId tcid(timestamp_ns, 0);
-    const auto cp_it = calib_init_poses.find(tcid);
-
-    if (cp_it != calib_init_poses.end()) {
-      Sophus::SE3d T_a_i = cp_it->second.T_a_c * calib.T_i_c[0].inverse();
-
-      if (!g_initialized) {
-        for (size_t i = 0;
-             i < vio_dataset->get_accel_data().size() && !g_initialized; i++) {
-          const basalt::AccelData& ad = vio_dataset->get_accel_data()[i];
-          if (std::abs(ad.timestamp_ns - timestamp_ns) < 3000000) {
-            g_a_init = T_a_i.so3() * ad.data;
-            g_initialized = true;
-            std::cout << "g_a initialized with " << g_a_init.transpose()
-                      << std::endl;
-          }
-        }
-      }
-    }
-  }
-  spline_opt.setG(g_a_init);
+  spline_opt.setG(initial_gravity(vio_dataset));
 
   for (const auto& v : vio_dataset->get_gyro_data()) {
     if (v.timestamp_ns >= start_t_ns && v.timestamp_ns < end_t_ns)
@@ -274,31 +494,6 @@ void run_calibration_custom(const basalt::VioDatasetPtr& vio_dataset,
   std::cout << "time: " << opt_time_ms << "ms." << std::endl;
 
   std::cout << "num_iter " << opt_iter << std::endl;
-  std::cout << "reprojection error: " << reprojection_error / num_points
-            << std::endl;
-
-  // calib_spline.meanReprojection(calib_corners);
-
-  std::cout << "g: " << spline_opt.getG().transpose() << std::endl;
-
-  Eigen::Vector3d accel_bias;
-  Eigen::Matrix3d accel_scale;
-  spline_opt.calib->calib_accel_bias.getBiasAndScale(accel_bias, accel_scale);
-
-  std::cout << "accel_bias: " << accel_bias.transpose() << "\naccel_scale:\n"
-            << Eigen::Matrix3d::Identity() + accel_scale << std::endl;
-
-  Eigen::Vector3d gyro_bias;
-  Eigen::Matrix3d gyro_scale;
-  spline_opt.calib->calib_gyro_bias.getBiasAndScale(gyro_bias, gyro_scale);
-
-  std::cout << "gyro_bias: " << gyro_bias.transpose() << "\ngyro_scale:\n"
-            << Eigen::Matrix3d::Identity() + gyro_scale << std::endl;
-
-  for (size_t i = 0; i < spline_opt.calib->T_i_c.size(); i++) {
-    std::cout << "T_i_c" << i << ":\n"
-              << spline_opt.calib->T_i_c[i].matrix() << std::endl;
-  }
 
   // std::ofstream f("generated_imu.csv");
 
@@ -314,16 +509,154 @@ void run_calibration_custom(const basalt::VioDatasetPtr& vio_dataset,
   //  f.close();
 
   CalibResults r;
-  r.calib = *(spline_opt.calib);
-  r.g = spline_opt.getG();
   r.opt_time_s = opt_time_ms / 1000.0;
-  r.method_name = "custom_split";
   r.num_iter = opt_iter;
-  r.accel_bias = accel_bias;
-  r.gyro_bias = gyro_bias;
-  r.mean_reproj = reprojection_error / num_points;
 
-  results.emplace_back(r);
+  finish_calibration_custom(spline_opt, "custom_split",
+                            reprojection_error / num_points, r, results);
+}
+
+/// Se3Spline with half the knot spacing of coarse, see
+/// CeresSplineSubdivision.
+template <int N>
+basalt::Se3Spline<N> subdivide_spline(const basalt::Se3Spline<N>& coarse) {
+  Eigen::aligned_vector<Sophus::SO3d> so3_knots;
+  Eigen::aligned_vector<Eigen::Vector3d> pos_knots;
+  for (size_t i = 0; i < coarse.numKnots(); i++) {
+    so3_knots.emplace_back(coarse.getKnotSO3(i));
+    pos_knots.emplace_back(coarse.getKnotPos(i));
+  }
+
+  so3_knots = CeresSplineSubdivision<N>::subdivideLie(so3_knots);
+  pos_knots = CeresSplineSubdivision<N>::subdivide(pos_knots);
+
+  basalt::Se3Spline<N> fine(coarse.getDtNs() / 2, coarse.minTimeNs());
+  fine.setKnots(Sophus::SE3d(), so3_knots.size());
+  for (size_t i = 0; i < so3_knots.size(); i++) {
+    fine.getKnotSO3(i) = so3_knots[i];
+    fine.getKnotPos(i) = pos_knots[i];
+  }
+
+  return fine;
+}
+
+/// Coarse-to-fine calibration with basalt::SplineOptimization, see
+/// run_calibration_pyramid.
+void run_calibration_custom_pyramid(
+    const basalt::VioDatasetPtr& vio_dataset,
+    std::shared_ptr<basalt::AprilGrid>& aprilgrid,
+    Eigen::aligned_vector<CalibResults>& results, int num_levels = 3) {
+  std::cout << "=============================================" << std::endl;
+  std::cout << "Running calibration with custom_split_pyramid method"
+            << std::endl;
+
+  constexpr int N = 5;
+  const int64_t dt_ns = 1e7;
+
+  using SplineOptimization = basalt::SplineOptimization<N, double>;
+
+  int64_t start_t_ns =
+      std::max(vio_dataset->get_image_timestamps().front(),
+               vio_dataset->get_gyro_data().front().timestamp_ns);
+
+  int64_t end_t_ns = std::min(vio_dataset->get_image_timestamps().back(),
+                              vio_dataset->get_gyro_data().back().timestamp_ns);
+
+  BASALT_ASSERT(num_levels >= 1);
+
+  CalibResults r;
+  r.opt_time_s = 0;
+  r.num_iter = 0;
+
+  double error = 0, reprojection_error = 0;
+  int num_points = 0;
+
+  std::unique_ptr<SplineOptimization> spline_opt;
+
+  for (int level = num_levels - 1; level >= 0; level--) {
+    const int64_t level_dt_ns = dt_ns << level;
+    const int decimation = 1 << level;
+
+    std::unique_ptr<SplineOptimization> level_opt(
+        new SplineOptimization(level_dt_ns, 1e-6));
+
+    level_opt->setAprilgridCorners3d(aprilgrid->aprilgrid_corner_pos_3d);
+    level_opt->resetMocapCalib();
+
+    if (!spline_opt) {
+      level_opt->calib.reset(new basalt::Calibration<double>(calib));
+
+      basalt::TimeCamId tcid_init(vio_dataset->get_image_timestamps().front(),
+                                  0);
+      Sophus::SE3d T_w_i_init =
+          calib_init_poses.at(tcid_init).T_a_c * calib.T_i_c[0].inverse();
+
+      level_opt->initSpline(T_w_i_init,
+                            (end_t_ns - start_t_ns) / level_dt_ns + N);
+      level_opt->setG(initial_gravity(vio_dataset));
+    } else {
+      level_opt->calib.reset(
+          new basalt::Calibration<double>(*spline_opt->calib));
+      level_opt->setSpline(subdivide_spline(spline_opt->getSpline()));
+      level_opt->setG(spline_opt->getG());
+    }
+
+    const auto& gyro_data = vio_dataset->get_gyro_data();
+    for (size_t i = 0; i < gyro_data.size(); i += decimation) {
+      const auto& v = gyro_data[i];
+      if (v.timestamp_ns >= start_t_ns && v.timestamp_ns < end_t_ns)
+        level_opt->addGyroMeasurement(v.timestamp_ns - start_t_ns, v.data);
+    }
+
+    const auto& accel_data = vio_dataset->get_accel_data();
+    for (size_t i = 0; i < accel_data.size(); i += decimation) {
+      const auto& v = accel_data[i];
+      if (v.timestamp_ns >= start_t_ns && v.timestamp_ns < end_t_ns)
+        level_opt->addAccelMeasurement(v.timestamp_ns - start_t_ns, v.data);
+    }
+
+    const std::unordered_set<int64_t> frames =
+        decimated_frames(vio_dataset, decimation);
+
+    for (const auto& kv : calib_corners) {
+      if (kv.first.frame_id >= start_t_ns && kv.first.frame_id < end_t_ns &&
+          frames.count(kv.first.frame_id))
+        level_opt->addAprilgridMeasurement(kv.first.frame_id - start_t_ns,
+                                           kv.first.cam_id, kv.second.corners,
+                                           kv.second.corner_ids);
+    }
+
+    level_opt->init();
+
+    bool converged = false;
+    int opt_iter = 0;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    while (!converged) {
+      converged = level_opt->optimize(false, false, true, false, false, false,
+                                      100.0, 1e-9, error, num_points,
+                                      reprojection_error, false);
+      opt_iter++;
+    }
+
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    double opt_time_s = std::chrono::duration<double>(stop - start).count();
+
+    std::cout << "level " << level << " dt_ns " << level_dt_ns << " time "
+              << opt_time_s << " num_iter " << opt_iter << std::endl;
+
+    r.level_opt_time_s.emplace_back(opt_time_s);
+    r.level_num_iter.emplace_back(opt_iter);
+    r.opt_time_s += opt_time_s;
+    r.num_iter += opt_iter;
+
+    spline_opt = std::move(level_opt);
+  }
+
+  finish_calibration_custom(*spline_opt, "custom_split_pyramid",
+                            reprojection_error / num_points, r, results);
 }
 
 int main() {
@@ -407,17 +740,43 @@ int main() {
 
   Eigen::aligned_vector<CalibResults> results;
 
+  report_knot_plan(vio_dataset);
+
   run_calibration_custom(vio_dataset, aprilgrid, results);
+  run_calibration_custom_pyramid(vio_dataset, aprilgrid, results);
 
   run_calibration<CeresCalibrationSplineSplit<5>>(vio_dataset, aprilgrid,
                                                   "ceres_split", results);
+  run_calibration<CeresCalibrationSplineSplit<5>>(
+      vio_dataset, aprilgrid, "ceres_split_batched", results, true);
   run_calibration<CeresCalibrationSplineSplit<5, true>>(
       vio_dataset, aprilgrid, "ceres_split_old", results);
+  run_calibration<CeresCalibrationSplineSplit<5, false, true>>(
+      vio_dataset, aprilgrid, "ceres_split_analytic", results);
+  run_calibration<CeresCalibrationSplineSplit<5, false, true>>(
+      vio_dataset, aprilgrid, "ceres_split_analytic_sync", results, false,
+      true);
+  run_calibration<CeresCalibrationSplineSplit<5, false, true>>(
+      vio_dataset, aprilgrid, "ceres_split_analytic_cached", results, false,
+      false, true);
+  run_calibration_pyramid<CeresCalibrationSplineSplit<5>>(
+      vio_dataset, aprilgrid, "ceres_split_pyramid", results);
 
   run_calibration<CeresCalibrationSplineSe3<5>>(vio_dataset, aprilgrid,
                                                 "ceres_se3", results);
+  run_calibration<CeresCalibrationSplineSe3<5>>(
+      vio_dataset, aprilgrid, "ceres_se3_batched", results, true);
   run_calibration<CeresCalibrationSplineSe3<5, true>>(vio_dataset, aprilgrid,
                                                       "ceres_se3_old", results);
+  run_calibration<CeresCalibrationSplineSe3<5, false, true>>(
+      vio_dataset, aprilgrid, "ceres_se3_analytic", results);
+  run_calibration<CeresCalibrationSplineSe3<5, false, true>>(
+      vio_dataset, aprilgrid, "ceres_se3_analytic_sync", results, false, true);
+  run_calibration<CeresCalibrationSplineSe3<5, false, true>>(
+      vio_dataset, aprilgrid, "ceres_se3_analytic_cached", results, false,
+      false, true);
+  run_calibration_pyramid<CeresCalibrationSplineSe3<5>>(
+      vio_dataset, aprilgrid, "ceres_se3_pyramid", results);
 
   Eigen::Vector3d g_mean(0, 0, 0), accel_bias_mean(0, 0, 0),
       gyro_bias_mean(0, 0, 0), t_i_c0_mean(0, 0, 0), t_i_c1_mean(0, 0, 0);
@@ -434,7 +793,13 @@ int main() {
 
   for (const auto& r : results) {
     std::cout << r.method_name << "\t: opt_time " << r.opt_time_s
-              << "\tnum_iter " << r.num_iter << std::endl;
+              << "\tnum_iter " << r.num_iter;
+    for (size_t i = 0; i < r.level_num_iter.size(); i++) {
+      std::cout << "\tlevel " << r.level_num_iter.size() - 1 - i << " "
+                << r.level_opt_time_s[i] << "s " << r.level_num_iter[i]
+                << " iter";
+    }
+    std::cout << std::endl;
 
     g_mean += r.g;
     accel_bias_mean += r.accel_bias;
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include <sophus/se3.hpp>
+
+#include <ceres_lie_spline.h>
+
+/// Errors of the float queries compared to double and batch evaluation times.
+struct FloatReport {
+  double rot_max = 0, rot_rms = 0;      // rad
+  double trans_max = 0, trans_rms = 0;  // m
+  double vel_max = 0, vel_rel = 0;
+  double accel_max = 0, accel_rel = 0;
+  double time_double = 0, time_float = 0;  // s
+};
+
+template <class Func>
+double minTime(const Func& fn, int repetitions = 5) {
+  double best = std::numeric_limits<double>::max();
+  for (int r = 0; r < repetitions; r++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    fn();
+    auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, std::chrono::duration<double>(end - start).count());
+  }
+  return best;
+}
+
+/// Evaluate a random spline with knots translated by offset_m at dense
+/// timestamps with double and float queries.
+template <int N, template <class> class GroupT>
+FloatReport evaluate_float_accuracy(double offset_m) {
+  using Groupd = GroupT<double>;
+  using Tangentd = typename GroupT<double>::Tangent;
+
+  constexpr bool is_se3 = std::is_same<Groupd, Sophus::SE3d>::value;
+
+  const int NUM_KNOTS = 1000 + N;
+  const int64_t dt_ns = 1e8;
+  const int64_t query_dt_ns = 1e6;
+
+  CeresLieGroupSpline<N, GroupT> spline(dt_ns);
+  spline.initRandom(NUM_KNOTS);
+
+  for (int i = 0; i < NUM_KNOTS; i++) {
+    Groupd knot = Groupd::exp(0.3 * Tangentd::Random());
+    if constexpr (is_se3) {
+      knot.translation() += Eigen::Vector3d::Constant(offset_m);
+    }
+    spline.setKnot(i, knot);
+  }
+
+  std::vector<int64_t> times_ns;
+  for (int64_t t_ns = 0; t_ns <= spline.maxTimeNs(); t_ns += query_dt_ns) {
+    times_ns.emplace_back(t_ns);
+  }
+  const size_t n = times_ns.size();
+
+  Eigen::aligned_vector<Groupd> value_d(n), value_f(n);
+  Eigen::aligned_vector<Tangentd> vel_d(n), vel_f(n), accel_d(n), accel_f(n);
+
+  FloatReport res;
+
+  spline.setKnotDeltaCache(true);
+  res.time_double = minTime([&] {
+    spline.evaluateBatch(times_ns.data(), n, value_d.data(), vel_d.data(),
+                         accel_d.data());
+  });
+
+  spline.setFloatQueries(true);
+  res.time_float = minTime([&] {
+    spline.evaluateBatch(times_ns.data(), n, value_f.data(), vel_f.data(),
+                         accel_f.data());
+  });
+
+  double vel_norm = 0, accel_norm = 0;
+
+  for (size_t i = 0; i < n; i++) {
+    const Groupd diff = value_d[i].inverse() * value_f[i];
+
+    double rot_err, trans_err = 0;
+    if constexpr (is_se3) {
+      rot_err = diff.so3().log().norm();
+      trans_err = (value_d[i].translation() - value_f[i].translation()).norm();
+    } else {
+      rot_err = diff.log().norm();
+    }
+
+    res.rot_max = std::max(res.rot_max, rot_err);
+    res.rot_rms += rot_err * rot_err;
+    res.trans_max = std::max(res.trans_max, trans_err);
+    res.trans_rms += trans_err * trans_err;
+
+    res.vel_max = std::max(res.vel_max, (vel_d[i] - vel_f[i]).norm());
+    res.accel_max = std::max(res.accel_max, (accel_d[i] - accel_f[i]).norm());
+
+    vel_norm = std::max(vel_norm, vel_d[i].norm());
+    accel_norm = std::max(accel_norm, accel_d[i].norm());
+  }
+
+  res.rot_rms = std::sqrt(res.rot_rms / n);
+  res.trans_rms = std::sqrt(res.trans_rms / n);
+  res.vel_rel = res.vel_max / vel_norm;
+  res.accel_rel = res.accel_max / accel_norm;
+
+  return res;
+}
+
+int main(int, char**) {
+  std::map<std::string, FloatReport> results;
+
+  results["SO3 order 4"] = evaluate_float_accuracy<4, Sophus::SO3>(0);
+  results["SO3 order 5"] = evaluate_float_accuracy<5, Sophus::SO3>(0);
+  results["SO3 order 6"] = evaluate_float_accuracy<6, Sophus::SO3>(0);
+
+  for (double offset_m : {1.0, 100.0, 1000.0}) {
+    const std::string offset = " at " + std::to_string(int(offset_m)) + "m";
+    results["SE3 order 4" + offset] =
+        evaluate_float_accuracy<4, Sophus::SE3>(offset_m);
+    results["SE3 order 5" + offset] =
+        evaluate_float_accuracy<5, Sophus::SE3>(offset_m);
+    results["SE3 order 6" + offset] =
+        evaluate_float_accuracy<6, Sophus::SE3>(offset_m);
+  }
+
+  std::cout << "Float query accuracy compared to double (max and RMS rotation "
+               "error in rad, max and RMS translation error in mm, max "
+               "velocity and acceleration error absolute and relative to the "
+               "largest value, batch evaluation time double and float)"
+            << std::endl;
+
+  for (const auto& kv : results) {
+    const FloatReport& r = kv.second;
+    std::cout << kv.first << ": " << std::scientific << std::setprecision(2)
+              << "rot " << r.rot_max << " " << r.rot_rms << " trans "
+              << 1e3 * r.trans_max << " " << 1e3 * r.trans_rms << " vel "
+              << r.vel_max << " " << r.vel_rel << " accel " << r.accel_max
+              << " " << r.accel_rel << std::fixed << std::setprecision(4)
+              << " time " << r.time_double << "s " << r.time_float << "s "
+              << std::setprecision(2) << r.time_double / r.time_float << "x"
+              << std::endl;
+  }
+
+  return 0;
+}
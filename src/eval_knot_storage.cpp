@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+#include <basalt/optimization/spline_optimize.h>
+#include <basalt/spline/se3_spline.h>
+
+#include <tbb/global_control.h>
+
+/// Timings of the spline operations that depend on the knot storage of
+/// basalt::So3Spline and basalt::RdSpline: evaluation, a sliding window,
+/// copies as in the LM step backup and the full SplineOptimization.
+
+template <class Func>
+double minTime(const Func& fn, int repetitions = 5) {
+  double best = std::numeric_limits<double>::max();
+  for (int r = 0; r < repetitions; r++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    fn();
+    auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, std::chrono::duration<double>(end - start).count());
+  }
+  return best;
+}
+
+/// Smooth trajectory with rotations below pi, such that the IMU
+/// measurements of a spline through its poses are well behaved.
+Sophus::SE3d trajectory(double t) {
+  const Eigen::Vector3d rot(0.4 * std::sin(0.9 * t), 0.3 * std::cos(0.7 * t),
+                            0.5 * std::sin(1.3 * t));
+  const Eigen::Vector3d pos(std::sin(0.5 * t), std::cos(0.3 * t),
+                            0.2 * std::sin(t));
+  return Sophus::SE3d(Sophus::SO3d::exp(rot), pos);
+}
+
+template <int N>
+basalt::Se3Spline<N> trajectorySpline(int64_t dt_ns, int num_knots) {
+  basalt::Se3Spline<N> spline(dt_ns);
+  for (int i = 0; i < num_knots; i++) {
+    spline.knotsPushBack(trajectory(i * dt_ns * 1e-9));
+  }
+  return spline;
+}
+
+template <int N>
+void benchmark_evaluation() {
+  const int64_t dt_ns = 1e7;
+  const int64_t query_dt_ns = 1e6;
+
+  const basalt::Se3Spline<N> spline = trajectorySpline<N>(dt_ns, 10000);
+
+  double sink = 0;
+
+  const double t_eval = minTime([&] {
+    for (int64_t t_ns = 0; t_ns < spline.maxTimeNs(); t_ns += query_dt_ns) {
+      sink += spline.pose(t_ns).translation()[0];
+      sink += spline.rotVelBody(t_ns)[0];
+      sink += spline.transAccelWorld(t_ns)[0];
+    }
+  });
+
+  // Window of 100 knots moved over 100000 knots, evaluated at its end after
+  // every step as in a sliding window estimator.
+  const int window_size = 100;
+  const double t_window = minTime([&] {
+    basalt::Se3Spline<N> window = trajectorySpline<N>(dt_ns, window_size);
+    for (int i = window_size; i < 100000; i++) {
+      window.knotsPushBack(window.getKnot(i % window_size));
+      window.knotsPopFront();
+      sink += window.pose(window.maxTimeNs()).translation()[0];
+    }
+  });
+
+  basalt::Se3Spline<N> copy(dt_ns);
+  const double t_copy = minTime([&] {
+    for (int i = 0; i < 100; i++) {
+      copy = spline;
+      sink += copy.getKnotPos(i)[0];
+    }
+  });
+
+  if (!std::isfinite(sink)) std::cout << "Invalid result" << std::endl;
+
+  std::cout << "order " << N << ": evaluation " << std::fixed
+            << std::setprecision(4) << t_eval << "s. sliding window "
+            << t_window << "s. 100 copies of " << spline.numKnots()
+            << " knots " << t_copy << "s." << std::endl;
+}
+
+/// SplineOptimization of 60 s of synthetic pose, gyroscope and accelerometer
+/// measurements with a 10 ms spline.
+template <int N>
+void benchmark_calibration() {
+  using SplineOptimization = basalt::SplineOptimization<N, double>;
+
+  const int64_t dt_ns = 1e7;
+  const int64_t end_t_ns = 60e9;
+  const Eigen::Vector3d g(0, 0, -9.81);
+
+  const basalt::Se3Spline<N> gt =
+      trajectorySpline<N>(dt_ns, end_t_ns / dt_ns + N + 2);
+
+  SplineOptimization spline_opt(dt_ns);
+  spline_opt.resetCalib(0, {});
+
+  for (int64_t t_ns = 0; t_ns < end_t_ns; t_ns += 5e7) {
+    spline_opt.addPoseMeasurement(t_ns, gt.pose(t_ns));
+  }
+  for (int64_t t_ns = 0; t_ns < end_t_ns; t_ns += 5e6) {
+    const Sophus::SO3d R_w_i = gt.pose(t_ns).so3();
+    spline_opt.addGyroMeasurement(t_ns, gt.rotVelBody(t_ns));
+    spline_opt.addAccelMeasurement(
+        t_ns, R_w_i.inverse() * (gt.transAccelWorld(t_ns) - g));
+  }
+
+  spline_opt.initSpline(Sophus::SE3d(), end_t_ns / dt_ns + N);
+  spline_opt.setG(g);
+  spline_opt.init();
+
+  const int num_iter = 10;
+  double error, reprojection_error;
+  int num_points;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < num_iter; i++) {
+    spline_opt.optimize(false, true, false, false, false, false, 100.0, 1e-9,
+                        error, num_points, reprojection_error, false);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+
+  std::cout << "order " << N << ": " << num_iter << " iterations with "
+            << spline_opt.getSpline().numKnots() << " knots " << std::fixed
+            << std::setprecision(3)
+            << std::chrono::duration<double>(end - start).count()
+            << "s. error " << std::scientific << error << std::defaultfloat
+            << std::endl;
+}
+
+int main(int, char**) {
+  tbb::global_control c(tbb::global_control::max_allowed_parallelism, 1);
+
+  std::cout << "Spline evaluation" << std::endl;
+  benchmark_evaluation<4>();
+  benchmark_evaluation<5>();
+  benchmark_evaluation<6>();
+
+  std::cout << "Calibration" << std::endl;
+  benchmark_calibration<4>();
+  benchmark_calibration<5>();
+  benchmark_calibration<6>();
+
+  return 0;
+}
@@ -1,7 +1,11 @@
 
 #include <ceres/ceres.h>
+#include <array>
+#include <chrono>
+#include <cmath>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <sophus/se3.hpp>
 
 #include <basalt/spline/se3_spline.h>
@@ -9,10 +13,103 @@
 
 #include <ceres_lie_spline.h>
 
+/// Times of the runtime and compile time blending coefficients and of the
+/// runtime loop and unrolled SE(3) evaluation.
+using KernelTimings = std::array<double, 4>;
+
+template <class Func>
+double minTime(const Func& fn, int repetitions = 5) {
+  double best = std::numeric_limits<double>::max();
+  for (int r = 0; r < repetitions; r++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    fn();
+    auto end = std::chrono::high_resolution_clock::now();
+    best = std::min(best, std::chrono::duration<double>(end - start).count());
+  }
+  return best;
+}
+
+template <int N>
+void benchmark_kernels(std::map<int, KernelTimings>& res_map) {
+  using Helper = CeresSplineHelper<N>;
+  using VecN = typename Helper::VecN;
+
+  const int num_evals = 200000;
+  const double inv_dt = 10;
+
+  Eigen::aligned_vector<Sophus::SE3d> knots;
+  std::array<const double*, N> vec;
+  for (int i = 0; i < N; i++) {
+    knots.emplace_back(Sophus::SE3d::exp(0.3 * Sophus::Vector6d::Random()));
+  }
+  for (int i = 0; i < N; i++) vec[i] = knots[i].data();
+
+  KernelTimings& t = res_map[N];
+
+  Eigen::aligned_vector<SplineCoeffs<N>> coeffs(num_evals);
+
+  t[0] = minTime([&] {
+    for (int e = 0; e < num_evals; e++) {
+      const double u = double(e) / num_evals;
+      VecN p;
+      Helper::template baseCoeffsWithTime<0>(p, u);
+      coeffs[e].coeff = Helper::cumulative_blending_matrix_ * p;
+      Helper::template baseCoeffsWithTime<1>(p, u);
+      coeffs[e].dcoeff = inv_dt * Helper::cumulative_blending_matrix_ * p;
+      Helper::template baseCoeffsWithTime<2>(p, u);
+      coeffs[e].ddcoeff =
+          inv_dt * inv_dt * Helper::cumulative_blending_matrix_ * p;
+    }
+  });
+
+  t[1] = minTime([&] {
+    for (int e = 0; e < num_evals; e++) {
+      const double u = double(e) / num_evals;
+      using Blending = SplineBlending<N>;
+      Blending::template cumulativeCoeffs<0>(u, 1, coeffs[e].coeff.data());
+      Blending::template cumulativeCoeffs<1>(u, inv_dt,
+                                             coeffs[e].dcoeff.data());
+      Blending::template cumulativeCoeffs<2>(u, inv_dt * inv_dt,
+                                             coeffs[e].ddcoeff.data());
+    }
+  });
+
+  // Keeps the compiler from removing the evaluations.
+  double sink = coeffs.back().ddcoeff.sum();
+
+  t[2] = minTime([&] {
+    for (int e = 0; e < num_evals / 10; e++) {
+      Sophus::SE3d pose;
+      Sophus::Vector6d vel, accel;
+      Helper::template evaluate_lie<double, Sophus::SE3>(
+          vec.data(), double(e) / (num_evals / 10), inv_dt, &pose, &vel,
+          &accel);
+      sink += pose.translation()[0] + vel[0] + accel[0];
+    }
+  });
+
+  t[3] = minTime([&] {
+    for (int e = 0; e < num_evals / 10; e++) {
+      Sophus::SE3d pose;
+      Sophus::Vector6d vel, accel;
+      CeresSplineHelperGroup<N>::template evaluate_lie<
+          LIE_VALUE | LIE_VEL | LIE_ACCEL, double, Sophus::SE3>(
+          vec.data(), double(e) / (num_evals / 10), inv_dt, &pose, &vel,
+          &accel);
+      sink += pose.translation()[0] + vel[0] + accel[0];
+    }
+  });
+
+  if (!std::isfinite(sink)) std::cout << "Invalid result" << std::endl;
+}
+
+/// Solver times of the autodiff, segment-batched autodiff, analytic and old
+/// time derivative splines.
+using Timings = std::array<double, 4>;
+
 template <int N, template <class> class GroupT>
-void test_optimization(
-    const std::string& group_name, bool use_accel,
-    std::map<std::string, std::pair<double, double>>& res_map) {
+void test_optimization(const std::string& group_name, bool use_accel,
+                       std::map<std::string, Timings>& res_map) {
   using Groupd = GroupT<double>;
   using Tangentd = typename GroupT<double>::Tangent;
 
@@ -28,24 +125,34 @@ void test_optimization(
 
   CeresLieGroupSpline<N, GroupT> gt_spline(dt);
   CeresLieGroupSpline<N, GroupT> spline_new(dt);
+  CeresLieGroupSpline<N, GroupT> spline_batched(dt);
+  CeresLieGroupSpline<N, GroupT, false, true> spline_analytic(dt);
   CeresLieGroupSpline<N, GroupT, true> spline_old(dt);
 
   gt_spline.initRandom(NUM_KNOTS);
+  gt_spline.setKnotDeltaCache(true);
   spline_new.initRandom(NUM_KNOTS);
+  spline_batched.initRandom(NUM_KNOTS);
+  spline_batched.setSegmentBatching(true);
+  spline_analytic.initRandom(NUM_KNOTS);
   spline_old.initRandom(NUM_KNOTS);
 
   for (int i = 0; i < NUM_KNOTS; i++) {
     Groupd noisy_knot =
         gt_spline.getKnot(i) * Groupd::exp(Tangentd::Random() / 3.1);
 
-    spline_new.getKnot(i) = noisy_knot;
-    spline_old.getKnot(i) = noisy_knot;
+    spline_new.setKnot(i, noisy_knot);
+    spline_batched.setKnot(i, noisy_knot);
+    spline_analytic.setKnot(i, noisy_knot);
+    spline_old.setKnot(i, noisy_knot);
   }
 
   for (int64_t t_ns = pose_meas_t_ns / 2; t_ns < gt_spline.maxTimeNs();
        t_ns += pose_meas_t_ns) {
     num_pose_meas++;
     spline_new.addMeasurement(gt_spline.getValue(t_ns), t_ns);
+    spline_batched.addMeasurement(gt_spline.getValue(t_ns), t_ns);
+    spline_analytic.addMeasurement(gt_spline.getValue(t_ns), t_ns);
     spline_old.addMeasurement(gt_spline.getValue(t_ns), t_ns);
   }
 
@@ -54,9 +161,13 @@ void test_optimization(
     num_deriv_meas++;
     if (use_accel) {
       spline_new.addAccelMeasurement(gt_spline.getAccel(t_ns), t_ns);
+      spline_batched.addAccelMeasurement(gt_spline.getAccel(t_ns), t_ns);
+      spline_analytic.addAccelMeasurement(gt_spline.getAccel(t_ns), t_ns);
       spline_old.addAccelMeasurement(gt_spline.getAccel(t_ns), t_ns);
     } else {
       spline_new.addVelMeasurement(gt_spline.getVel(t_ns), t_ns);
+      spline_batched.addVelMeasurement(gt_spline.getVel(t_ns), t_ns);
+      spline_analytic.addVelMeasurement(gt_spline.getVel(t_ns), t_ns);
       spline_old.addVelMeasurement(gt_spline.getVel(t_ns), t_ns);
     }
   }
@@ -70,19 +181,44 @@ void test_optimization(
             << std::endl;
 
   auto summary_new = spline_new.optimize();
+  auto summary_batched = spline_batched.optimize();
+  auto summary_analytic = spline_analytic.optimize();
   auto summary_old = spline_old.optimize();
 
   res_map[group_name + " order " + std::to_string(N) +
-          (use_accel ? " acc" : " vel")] =
-      std::make_pair(summary_new.total_time_in_seconds,
-                     summary_old.total_time_in_seconds);
+          (use_accel ? " acc" : " vel")] = {
+      summary_new.total_time_in_seconds,
+      summary_batched.total_time_in_seconds,
+      summary_analytic.total_time_in_seconds,
+      summary_old.total_time_in_seconds};
 
   std::cout << "===============================================" << std::endl;
 }
 
 int main(int, char**) {
-  std::map<std::string, std::pair<double, double>> results;
-  
+  std::map<int, KernelTimings> kernel_results;
+
+  benchmark_kernels<4>(kernel_results);
+  benchmark_kernels<5>(kernel_results);
+  benchmark_kernels<6>(kernel_results);
+  benchmark_kernels<7>(kernel_results);
+  benchmark_kernels<8>(kernel_results);
+
+  std::cout << "Blending coefficients up to acceleration (runtime matrices, "
+               "compile time polynomials) and SE3 evaluation (runtime loop, "
+               "unrolled), speedups"
+            << std::endl;
+
+  for (auto kv : kernel_results) {
+    const KernelTimings& t = kv.second;
+    std::cout << "order " << kv.first << ": " << std::fixed
+              << std::setprecision(4) << t[0] << "s. " << t[1] << "s. "
+              << t[2] << "s. " << t[3] << "s. " << std::setprecision(2)
+              << t[0] / t[1] << "x " << t[2] / t[3] << "x" << std::endl;
+  }
+
+  std::map<std::string, Timings> results;
+
   test_optimization<4, Sophus::SO3>("SO3", false, results);
   test_optimization<4, Sophus::SO3>("SO3", true, results);
 
@@ -101,12 +237,28 @@ int main(int, char**) {
   test_optimization<6, Sophus::SE3>("SE3", false, results);
   test_optimization<6, Sophus::SE3>("SE3", true, results);
 
-  std::cout << "Overall Summary" << std::endl;
+  test_optimization<7, Sophus::SO3>("SO3", false, results);
+  test_optimization<7, Sophus::SO3>("SO3", true, results);
+
+  test_optimization<7, Sophus::SE3>("SE3", false, results);
+  test_optimization<7, Sophus::SE3>("SE3", true, results);
+
+  test_optimization<8, Sophus::SO3>("SO3", false, results);
+  test_optimization<8, Sophus::SO3>("SO3", true, results);
+
+  test_optimization<8, Sophus::SE3>("SE3", false, results);
+  test_optimization<8, Sophus::SE3>("SE3", true, results);
+
+  std::cout << "Overall Summary (autodiff, batched autodiff, analytic, old "
+               "time derivative, speedup of the first three over old)"
+            << std::endl;
 
   for (auto kv : results) {
+    const Timings& t = kv.second;
     std::cout << kv.first << ": " << std::fixed << std::setprecision(3)
-              << kv.second.first << "s. " << kv.second.second << "s. "
-              << kv.second.second / kv.second.first << "x" << std::endl;
+              << t[0] << "s. " << t[1] << "s. " << t[2] << "s. " << t[3]
+              << "s. " << t[3] / t[0] << "x " << t[3] / t[1] << "x "
+              << t[3] / t[2] << "x" << std::endl;
   }
 
   return 0;
@@ -0,0 +1,156 @@
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sophus/se3.hpp>
+
+#include <basalt/utils/eigen_utils.hpp>
+
+#include <ceres_op_count.h>
+#include <ceres_spline_helper_group.h>
+#include <ceres_spline_helper_old.h>
+
+/// Print the operation counts of one evaluation.
+void print_counts(const std::string& group_name, int order,
+                  const std::string& deriv_name,
+                  const std::string& method_name, const OpCounts& c) {
+  std::cout << std::setw(4) << group_name << std::setw(3) << order
+            << std::setw(7) << deriv_name << std::setw(11) << method_name
+            << std::setw(8) << c.mul << std::setw(8) << c.add << std::setw(6)
+            << c.div << std::setw(6) << c.func << std::endl;
+}
+
+/// Count the operations of one evaluation of the spline value and its time
+/// derivatives with the recursive evaluate_lie, the quaternion kernel of
+/// CeresSplineHelperGroup and the old time derivative helpers.
+template <int N, template <class> class GroupT>
+void count_evaluate_lie(const std::string& group_name) {
+  using T = OpCountScalar;
+  using Group = GroupT<T>;
+  using Tangent = typename Group::Tangent;
+  using Groupd = GroupT<double>;
+  using Tangentd = typename Groupd::Tangent;
+
+  using Helper = CeresSplineHelper<N>;
+  using HelperGroup = CeresSplineHelperGroup<N>;
+  using HelperOld = CeresSplineHelperOld<N>;
+
+  const double u = 0.3;
+  const double inv_dt = 2.0;
+
+  Eigen::aligned_vector<Group> knots;
+  for (int i = 0; i < N; i++) {
+    knots.emplace_back(
+        Groupd::exp(Tangentd::Random()).template cast<OpCountScalar>());
+  }
+
+  std::vector<const T*> vec;
+  for (const auto& k : knots) vec.emplace_back(k.data());
+  const T* const* sKnots = vec.data();
+
+  Group value;
+  Tangent vel, accel, jerk;
+
+  print_counts(group_name, N, "value", "recursive", countOps([&] {
+                 Helper::template evaluate_lie<T, GroupT>(sKnots, u, inv_dt,
+                                                          &value);
+               }));
+  print_counts(group_name, N, "value", "group", countOps([&] {
+                 HelperGroup::template evaluate_lie<LIE_VALUE, T, GroupT>(
+                     sKnots, u, inv_dt, &value);
+               }));
+
+  print_counts(group_name, N, "vel", "recursive", countOps([&] {
+                 Helper::template evaluate_lie<T, GroupT>(sKnots, u, inv_dt,
+                                                          &value, &vel);
+               }));
+  print_counts(group_name, N, "vel", "group", countOps([&] {
+                 HelperGroup::template evaluate_lie<LIE_VALUE | LIE_VEL, T,
+                                                    GroupT>(sKnots, u, inv_dt,
+                                                            &value, &vel);
+               }));
+  print_counts(group_name, N, "vel", "old", countOps([&] {
+                 HelperOld::template evaluate_lie_vel_old<T, GroupT>(
+                     sKnots, u, inv_dt, &value, &vel);
+               }));
+
+  print_counts(group_name, N, "accel", "recursive", countOps([&] {
+                 Helper::template evaluate_lie<T, GroupT>(
+                     sKnots, u, inv_dt, &value, &vel, &accel);
+               }));
+  print_counts(group_name, N, "accel", "group", countOps([&] {
+                 HelperGroup::template evaluate_lie<
+                     LIE_VALUE | LIE_VEL | LIE_ACCEL, T, GroupT>(
+                     sKnots, u, inv_dt, &value, &vel, &accel);
+               }));
+  print_counts(group_name, N, "accel", "old", countOps([&] {
+                 HelperOld::template evaluate_lie_accel_old<T, GroupT>(
+                     sKnots, u, inv_dt, &value, &vel, &accel);
+               }));
+
+  print_counts(group_name, N, "jerk", "recursive", countOps([&] {
+                 Helper::template evaluate_lie<T, GroupT>(
+                     sKnots, u, inv_dt, &value, &vel, &accel, &jerk);
+               }));
+}
+
+/// Count the operations of the world frame linear acceleration of an SE(3)
+/// spline from the 4x4 matrix form and the closed form.
+void count_linear_accel() {
+  using T = OpCountScalar;
+  using Vector6 = Eigen::Matrix<T, 6, 1>;
+  using Matrix4 = Eigen::Matrix<T, 4, 4>;
+
+  const Sophus::SE3<T> T_w_i =
+      Sophus::SE3d::exp(Sophus::Vector6d::Random()).cast<T>();
+  const Vector6 vel = Sophus::Vector6d::Random().cast<T>();
+  const Vector6 accel = Sophus::Vector6d::Random().cast<T>();
+
+  Eigen::Matrix<T, 3, 1> accel_w;
+
+  print_counts("SE3", 0, "lin", "hat", countOps([&] {
+                 Matrix4 vel_hat = Sophus::SE3<T>::hat(vel);
+                 Matrix4 accel_hat = Sophus::SE3<T>::hat(accel);
+                 Matrix4 ddpose =
+                     T_w_i.matrix() * (vel_hat * vel_hat + accel_hat);
+                 accel_w = ddpose.col(3).template head<3>();
+               }));
+  print_counts("SE3", 0, "lin", "closed", countOps([&] {
+                 accel_w = CeresSplineHelperGroup<4>::linear_accel_world(
+                     T_w_i, vel, accel);
+               }));
+}
+
+template <template <class> class GroupT>
+void count_orders(const std::string& group_name) {
+  count_evaluate_lie<4, GroupT>(group_name);
+  count_evaluate_lie<5, GroupT>(group_name);
+  count_evaluate_lie<6, GroupT>(group_name);
+  count_evaluate_lie<7, GroupT>(group_name);
+  count_evaluate_lie<8, GroupT>(group_name);
+}
+
+int main(int, char**) {
+  std::cout << "Operations of one spline evaluation. The derivative column is "
+               "the highest time derivative computed together with the value. "
+               "recursive: CeresSplineHelper::evaluate_lie, group: "
+               "CeresSplineHelperGroup::evaluate_lie, old: "
+               "CeresSplineHelperOld."
+            << std::endl;
+
+  std::cout << std::setw(4) << "" << std::setw(3) << "N" << std::setw(7)
+            << "deriv" << std::setw(11) << "method" << std::setw(8) << "mul"
+            << std::setw(8) << "add" << std::setw(6) << "div" << std::setw(6)
+            << "func" << std::endl;
+
+  count_orders<Sophus::SO3>("SO3");
+  count_orders<Sophus::SE3>("SE3");
+
+  std::cout << "World frame linear acceleration of SE3 splines from vel and "
+               "accel (N is not used)."
+            << std::endl;
+  count_linear_accel();
+
+  return 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include <ceres/cost_function.h>
+
+#include <sophus/se3.hpp>
+
+// Residuals and Jacobians of a cost function with respect to the local
+// parameterization of the Lie group blocks and the parameters of the others.
+// Blocks with the size of SE3d are poses, e.g. T_i_c, blocks with the size
+// of Groupd knots.
+template <class Groupd>
+void localJacobians(const ceres::CostFunction& cost_function,
+                    const std::vector<const double*>& params,
+                    Eigen::VectorXd& residuals,
+                    std::vector<Eigen::MatrixXd>& J_local) {
+  using RowMajorMat =
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+  const std::vector<int32_t>& sizes = cost_function.parameter_block_sizes();
+  const int num_residuals = cost_function.num_residuals();
+  const size_t n = params.size();
+
+  residuals.resize(num_residuals);
+
+  std::vector<RowMajorMat> J(n);
+  std::vector<double*> J_ptr(n);
+  for (size_t i = 0; i < n; i++) {
+    J[i].resize(num_residuals, sizes[i]);
+    J_ptr[i] = J[i].data();
+  }
+
+  ASSERT_TRUE(
+      cost_function.Evaluate(params.data(), residuals.data(), J_ptr.data()));
+
+  J_local.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    if (sizes[i] == Sophus::SE3d::num_parameters) {
+      Eigen::Map<Sophus::SE3d const> const pose(params[i]);
+      J_local[i] = J[i] * pose.Dx_this_mul_exp_x_at_0();
+    } else if (sizes[i] == Groupd::num_parameters) {
+      Eigen::Map<Groupd const> const knot(params[i]);
+      J_local[i] = J[i] * knot.Dx_this_mul_exp_x_at_0();
+    } else {
+      J_local[i] = J[i];
+    }
+  }
+}
+
+// Compare residuals and local Jacobians of an analytic cost function with
+// the autodiff one at spline time u.
+template <class Groupd>
+void compareJacobians(const ceres::CostFunction& autodiff,
+                      const ceres::CostFunction& analytic,
+                      const std::vector<const double*>& params, double u) {
+  ASSERT_EQ(autodiff.num_residuals(), analytic.num_residuals());
+
+  Eigen::VectorXd res1, res2;
+  std::vector<Eigen::MatrixXd> J1, J2;
+
+  localJacobians<Groupd>(autodiff, params, res1, J1);
+  localJacobians<Groupd>(analytic, params, res2, J2);
+
+  EXPECT_TRUE(res1.isApprox(res2)) << "u " << u << "\nautodiff "
+                                   << res1.transpose() << "\nanalytic "
+                                   << res2.transpose();
+  for (size_t i = 0; i < params.size(); i++) {
+    // Knots with negligible influence have Jacobians close to zero, so
+    // compare relative to max(1, |J|).
+    EXPECT_LE((J1[i] - J2[i]).norm(), 1e-8 * std::max(1.0, J1[i].norm()))
+        << "block " << i << " u " << u << "\nautodiff\n"
+        << J1[i] << "\nanalytic\n"
+        << J2[i];
+  }
+}
@@ -0,0 +1,353 @@
+#include <iostream>
+
+#include "gtest/gtest.h"
+
+#include <ceres/ceres.h>
+
+#include <basalt/utils/eigen_utils.hpp>
+#include <ceres_calib_se3_residuals.h>
+#include <ceres_calib_split_residuals.h>
+#include <ceres_test_jacobians.h>
+
+// Cost function of several cameras against one cost function per camera:
+// residuals and knot Jacobians are stacked, the T_i_c Jacobian of a camera
+// is zero in the rows of the other cameras.
+template <class Groupd>
+void compareMultiCamera(const ceres::CostFunction& multi,
+                        const std::vector<const ceres::CostFunction*>& single,
+                        const std::vector<const double*>& knot_params,
+                        const std::vector<const double*>& ext_params) {
+  const size_t num_knots = knot_params.size();
+  const size_t num_cams = ext_params.size();
+
+  std::vector<const double*> params = knot_params;
+  params.insert(params.end(), ext_params.begin(), ext_params.end());
+  ASSERT_EQ(multi.parameter_block_sizes().size(), params.size());
+
+  Eigen::VectorXd res;
+  std::vector<Eigen::MatrixXd> J;
+  localJacobians<Groupd>(multi, params, res, J);
+
+  int row = 0;
+  for (size_t c = 0; c < num_cams; c++) {
+    std::vector<const double*> single_params = knot_params;
+    single_params.emplace_back(ext_params[c]);
+
+    Eigen::VectorXd res_c;
+    std::vector<Eigen::MatrixXd> J_c;
+    localJacobians<Groupd>(*single[c], single_params, res_c, J_c);
+
+    const int rows = res_c.size();
+    ASSERT_LE(row + rows, res.size());
+
+    EXPECT_TRUE(res.segment(row, rows).isApprox(res_c)) << "camera " << c;
+    for (size_t i = 0; i < num_knots; i++) {
+      EXPECT_TRUE(J[i].middleRows(row, rows).isApprox(J_c[i]))
+          << "camera " << c << " block " << i;
+    }
+    for (size_t k = 0; k < num_cams; k++) {
+      const Eigen::MatrixXd& J_ext = J[num_knots + k].middleRows(row, rows);
+      if (k == c) {
+        EXPECT_TRUE(J_ext.isApprox(J_c[num_knots])) << "camera " << c;
+      } else {
+        EXPECT_TRUE(J_ext.isZero()) << "camera " << c << " T_i_c " << k;
+      }
+    }
+
+    row += rows;
+  }
+  EXPECT_EQ(row, res.size());
+}
+
+// Cameras of different model types.
+std::vector<basalt::GenericCamera<double>> testCameras() {
+  std::vector<basalt::GenericCamera<double>> cams(2);
+
+  Eigen::Matrix<double, 6, 1> ds_param;
+  ds_param << 300, 310, 320, 240, -0.2, 0.6;
+  cams[0].variant = basalt::DoubleSphereCamera<double>(ds_param);
+
+  Eigen::Matrix<double, 6, 1> eucm_param;
+  eucm_param << 380, 380, 320, 240, 0.6, 1.1;
+  cams[1].variant = basalt::ExtendedUnifiedCamera<double>(eucm_param);
+
+  return cams;
+}
+
+// Camera close to the grid center looking at it at a flat angle, such that
+// part of the grid is behind the camera and can not be projected.
+Sophus::SE3d testCameraPose() {
+  return Sophus::SE3d(Sophus::SO3d::exp(Eigen::Vector3d(0, 1.5, 0)),
+                      Eigen::Vector3d(0.35, 0.35, -0.05));
+}
+
+// All grid corners, projections with noise as detections.
+basalt::CalibCornerData testCorners(const basalt::AprilGrid& aprilgrid,
+                                    const basalt::GenericCamera<double>& cam,
+                                    const Sophus::SE3d& T_w_c,
+                                    int& num_failed) {
+  basalt::CalibCornerData corners;
+  num_failed = 0;
+
+  for (size_t i = 0; i < aprilgrid.aprilgrid_corner_pos_3d.size(); i++) {
+    const Eigen::Vector4d p_c =
+        T_w_c.inverse().matrix() * aprilgrid.aprilgrid_corner_pos_3d[i];
+
+    Eigen::Vector2d proj;
+    if (!cam.project(p_c, proj)) {
+      proj.setZero();
+      num_failed++;
+    }
+
+    corners.corner_ids.emplace_back(i);
+    corners.corners.emplace_back(proj + Eigen::Vector2d::Random());
+  }
+
+  return corners;
+}
+
+// Projection of jets with double intrinsics against projection with the
+// intrinsics cast to jets.
+template <class CamT>
+void test_project_point_jet(const CamT& cam) {
+  using Jet = ceres::Jet<double, 3>;
+  using Vec4J = Eigen::Matrix<Jet, 4, 1>;
+  using Vec2J = Eigen::Matrix<Jet, 2, 1>;
+
+  const auto cam_jet = cam.template cast<Jet>();
+
+  int num_valid = 0;
+  for (int k = 0; k < 100; k++) {
+    Eigen::Vector4d p = Eigen::Vector4d::Random();
+    p[3] = 1;
+
+    Vec4J p_jet;
+    for (int i = 0; i < 4; i++) p_jet[i] = Jet(p[i]);
+    for (int i = 0; i < 3; i++) p_jet[i].v = Eigen::Vector3d::Random();
+
+    Vec2J proj1, proj2;
+    const bool success1 = cam_jet.project(p_jet, proj1);
+    const bool success2 = projectPoint(cam, p_jet, proj2);
+
+    ASSERT_EQ(success1, success2) << "p " << p.transpose();
+    if (!success1) continue;
+    num_valid++;
+
+    for (int i = 0; i < 2; i++) {
+      EXPECT_NEAR(proj1[i].a, proj2[i].a, 1e-9);
+      EXPECT_TRUE(proj1[i].v.isApprox(proj2[i].v, 1e-9))
+          << "p " << p.transpose() << "\n"
+          << proj1[i].v.transpose() << "\n"
+          << proj2[i].v.transpose();
+    }
+  }
+  EXPECT_GT(num_valid, 0);
+}
+
+// Second camera of a stereo pair with a baseline to the first.
+Sophus::SE3d testStereoExtrinsics(const Sophus::SE3d& T_i_c0) {
+  return T_i_c0 *
+         Sophus::SE3d(Sophus::SO3d::exp(0.05 * Eigen::Vector3d::Random()),
+                      Eigen::Vector3d(0.1, 0, 0));
+}
+
+// Both cameras of the stereo pair in one cost function against one per
+// camera, once for cameras of different models and once for two cameras of
+// the same model, instantiated for it.
+template <class Groupd, template <int, class> class CostFunctionT, int N>
+void test_reprojection_stereo(const basalt::AprilGrid& aprilgrid,
+                              const std::vector<const double*>& knot_params,
+                              const Sophus::SE3d& T_w_i,
+                              const Sophus::SE3d& T_i_c0, double u,
+                              double inv_dt) {
+  using Generic = CostFunctionT<N, basalt::GenericCamera<double>>;
+  using DsCam = basalt::DoubleSphereCamera<double>;
+
+  const Sophus::SE3d T_i_c1 = testStereoExtrinsics(T_i_c0);
+  const std::vector<const double*> ext_params = {T_i_c0.data(),
+                                                 T_i_c1.data()};
+
+  const std::vector<basalt::GenericCamera<double>> cams = testCameras();
+  const DsCam& ds = std::get<DsCam>(cams[0].variant);
+
+  int num_failed;
+  const basalt::CalibCornerData corners0 =
+      testCorners(aprilgrid, cams[0], T_w_i * T_i_c0, num_failed);
+  const basalt::CalibCornerData corners1 =
+      testCorners(aprilgrid, cams[1], T_w_i * T_i_c1, num_failed);
+  const basalt::CalibCornerData corners1_ds =
+      testCorners(aprilgrid, cams[0], T_w_i * T_i_c1, num_failed);
+
+  Generic single0(&corners0, &aprilgrid, cams[0], u, inv_dt);
+  Generic single1(&corners1, &aprilgrid, cams[1], u, inv_dt);
+  Generic stereo(&corners0, &aprilgrid, cams[0], u, inv_dt);
+  stereo.addCamera(&corners1, &aprilgrid, cams[1]);
+
+  compareMultiCamera<Groupd>(stereo, {&single0, &single1}, knot_params,
+                             ext_params);
+
+  CostFunctionT<N, DsCam> single1_ds(&corners1_ds, &aprilgrid, ds, u, inv_dt);
+  CostFunctionT<N, DsCam> stereo_ds(&corners0, &aprilgrid, ds, u, inv_dt);
+  stereo_ds.addCamera(&corners1_ds, &aprilgrid, ds);
+
+  compareMultiCamera<Groupd>(stereo_ds, {&single0, &single1_ds}, knot_params,
+                             ext_params);
+}
+
+template <int N>
+void test_reprojection_split_analytic(const basalt::AprilGrid& aprilgrid) {
+  using BlockSizesT =
+      typename ConcatBlockSizes<RepeatedBlockSizes<N, 4>,
+                                RepeatedBlockSizes<N, 3>, BlockSizes<7>>::type;
+
+  const double inv_dt = 1e9 / 2e7;
+
+  const Sophus::SE3d T_w_c = testCameraPose();
+  const Sophus::SE3d T_i_c =
+      Sophus::SE3d::exp(0.1 * Sophus::Vector6d::Random());
+  const Sophus::SE3d T_w_i = T_w_c * T_i_c.inverse();
+
+  Eigen::aligned_vector<Sophus::SO3d> rot_knots;
+  Eigen::aligned_vector<Eigen::Vector3d> trans_knots;
+  for (int i = 0; i < N; i++) {
+    rot_knots.emplace_back(T_w_i.so3() *
+                           Sophus::SO3d::exp(0.05 * Eigen::Vector3d::Random()));
+    trans_knots.emplace_back(T_w_i.translation() +
+                             0.02 * Eigen::Vector3d::Random());
+  }
+
+  std::vector<const double*> params;
+  for (int i = 0; i < N; i++) params.emplace_back(rot_knots[i].data());
+  for (int i = 0; i < N; i++) params.emplace_back(trans_knots[i].data());
+  params.emplace_back(T_i_c.data());
+
+  for (const auto& cam : testCameras()) {
+    int num_failed;
+    const basalt::CalibCornerData corners =
+        testCorners(aprilgrid, cam, T_w_c, num_failed);
+    EXPECT_GT(num_failed, 0);
+    EXPECT_LT(num_failed, int(corners.corner_ids.size()));
+
+    for (double u = 0; u < 1; u += 0.1) {
+      using Functor = CalibReprojectionCostFunctorSplit<N>;
+      std::unique_ptr<ceres::CostFunction> autodiff(
+          newAutoDiffCostFunction<ceres::DYNAMIC>(
+              new Functor(&corners, &aprilgrid, cam, u, inv_dt),
+              BlockSizesT(), corners.corner_ids.size() * 2));
+      CalibReprojectionAnalyticCostFunctionSplit<N> analytic(
+          &corners, &aprilgrid, cam, u, inv_dt);
+
+      compareJacobians<Sophus::SO3d>(*autodiff, analytic, params, u);
+
+      // Instantiated for the camera model as in addCornersMeasurement.
+      std::visit(
+          [&](const auto& cam_model) {
+            using CamT = std::decay_t<decltype(cam_model)>;
+            CalibReprojectionAnalyticCostFunctionSplit<N, CamT> analytic_model(
+                &corners, &aprilgrid, cam_model, u, inv_dt);
+
+            compareJacobians<Sophus::SO3d>(*autodiff, analytic_model, params,
+                                           u);
+          },
+          cam.variant);
+    }
+  }
+
+  const std::vector<const double*> knot_params(params.begin(),
+                                               params.end() - 1);
+  for (double u = 0; u < 1; u += 0.1) {
+    test_reprojection_stereo<Sophus::SO3d,
+                             CalibReprojectionAnalyticCostFunctionSplit, N>(
+        aprilgrid, knot_params, T_w_i, T_i_c, u, inv_dt);
+  }
+}
+
+template <int N>
+void test_reprojection_se3_analytic(const basalt::AprilGrid& aprilgrid) {
+  using BlockSizesT =
+      typename ConcatBlockSizes<RepeatedBlockSizes<N, 7>, BlockSizes<7>>::type;
+
+  const double inv_dt = 1e9 / 2e7;
+
+  const Sophus::SE3d T_w_c = testCameraPose();
+  const Sophus::SE3d T_i_c =
+      Sophus::SE3d::exp(0.1 * Sophus::Vector6d::Random());
+  const Sophus::SE3d T_w_i = T_w_c * T_i_c.inverse();
+
+  Eigen::aligned_vector<Sophus::SE3d> knots;
+  for (int i = 0; i < N; i++) {
+    knots.emplace_back(T_w_i *
+                       Sophus::SE3d::exp(0.03 * Sophus::Vector6d::Random()));
+  }
+
+  std::vector<const double*> params;
+  for (int i = 0; i < N; i++) params.emplace_back(knots[i].data());
+  params.emplace_back(T_i_c.data());
+
+  for (const auto& cam : testCameras()) {
+    int num_failed;
+    const basalt::CalibCornerData corners =
+        testCorners(aprilgrid, cam, T_w_c, num_failed);
+    EXPECT_GT(num_failed, 0);
+    EXPECT_LT(num_failed, int(corners.corner_ids.size()));
+
+    for (double u = 0; u < 1; u += 0.1) {
+      using Functor = CalibReprojectionCostFunctorSE3<N>;
+      std::unique_ptr<ceres::CostFunction> autodiff(
+          newAutoDiffCostFunction<ceres::DYNAMIC>(
+              new Functor(&corners, &aprilgrid, cam, u, inv_dt),
+              BlockSizesT(), corners.corner_ids.size() * 2));
+      CalibReprojectionAnalyticCostFunctionSE3<N> analytic(
+          &corners, &aprilgrid, cam, u, inv_dt);
+
+      compareJacobians<Sophus::SE3d>(*autodiff, analytic, params, u);
+
+      // Instantiated for the camera model as in addCornersMeasurement.
+      std::visit(
+          [&](const auto& cam_model) {
+            using CamT = std::decay_t<decltype(cam_model)>;
+            CalibReprojectionAnalyticCostFunctionSE3<N, CamT> analytic_model(
+                &corners, &aprilgrid, cam_model, u, inv_dt);
+
+            compareJacobians<Sophus::SE3d>(*autodiff, analytic_model, params,
+                                           u);
+          },
+          cam.variant);
+    }
+  }
+
+  const std::vector<const double*> knot_params(params.begin(),
+                                               params.end() - 1);
+  for (double u = 0; u < 1; u += 0.1) {
+    test_reprojection_stereo<Sophus::SE3d,
+                             CalibReprojectionAnalyticCostFunctionSE3, N>(
+        aprilgrid, knot_params, T_w_i, T_i_c, u, inv_dt);
+  }
+}
+
+TEST(SplineCeresTestSuite, CalibProjectPointJet) {
+  for (const auto& cam : testCameras()) {
+    std::visit([](const auto& cam) { test_project_point_jet(cam); },
+               cam.variant);
+  }
+
+  Eigen::Matrix<double, 4, 1> pinhole_param;
+  pinhole_param << 300, 310, 320, 240;
+  test_project_point_jet(basalt::PinholeCamera<double>(pinhole_param));
+}
+
+TEST(SplineCeresTestSuite, CalibAnalyticReprojectionSplit) {
+  const basalt::AprilGrid aprilgrid(APRILGRID_CONFIG);
+
+  test_reprojection_split_analytic<4>(aprilgrid);
+  test_reprojection_split_analytic<5>(aprilgrid);
+  test_reprojection_split_analytic<6>(aprilgrid);
+}
+
+TEST(SplineCeresTestSuite, CalibAnalyticReprojectionSE3) {
+  const basalt::AprilGrid aprilgrid(APRILGRID_CONFIG);
+
+  test_reprojection_se3_analytic<4>(aprilgrid);
+  test_reprojection_se3_analytic<5>(aprilgrid);
+  test_reprojection_se3_analytic<6>(aprilgrid);
+}
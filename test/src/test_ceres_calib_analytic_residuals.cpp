@@ -0,0 +1,465 @@
+#include <iostream>
+
+#include "gtest/gtest.h"
+
+#include <ceres/ceres.h>
+
+#include <basalt/utils/eigen_utils.hpp>
+#include <ceres_calib_se3_residuals.h>
+#include <ceres_calib_split_residuals.h>
+#include <ceres_knot_delta_callback.h>
+#include <ceres_test_jacobians.h>
+
+template <int N>
+void test_calib_split_analytic() {
+  using So3BlockSizes = RepeatedBlockSizes<N, Sophus::SO3d::num_parameters>;
+  using GyroBlockSizes =
+      typename ConcatBlockSizes<So3BlockSizes, BlockSizes<3>>::type;
+  using AccelBlockSizes =
+      typename ConcatBlockSizes<So3BlockSizes, RepeatedBlockSizes<N, 3>,
+                                BlockSizes<3, 3>>::type;
+
+  const double inv_dt = 1e9 / 2e7;
+
+  Eigen::aligned_vector<Sophus::SO3d> rot_knots;
+  Eigen::aligned_vector<Eigen::Vector3d> trans_knots;
+  for (int i = 0; i < N; i++) {
+    rot_knots.emplace_back(Sophus::SO3d::exp(Eigen::Vector3d::Random()));
+    trans_knots.emplace_back(Eigen::Vector3d::Random());
+  }
+  const Eigen::Vector3d g(0.1, -0.2, -9.81);
+  const Eigen::Vector3d gyro_bias = 0.01 * Eigen::Vector3d::Random();
+  const Eigen::Vector3d accel_bias = 0.1 * Eigen::Vector3d::Random();
+
+  std::vector<const double*> gyro_params, accel_params;
+  for (int i = 0; i < N; i++) gyro_params.emplace_back(rot_knots[i].data());
+  gyro_params.emplace_back(gyro_bias.data());
+
+  accel_params = std::vector<const double*>(gyro_params.begin(),
+                                            gyro_params.end() - 1);
+  for (int i = 0; i < N; i++) accel_params.emplace_back(trans_knots[i].data());
+  accel_params.emplace_back(g.data());
+  accel_params.emplace_back(accel_bias.data());
+
+  for (double u = 0; u < 1; u += 0.05) {
+    const Eigen::Vector3d meas = Eigen::Vector3d::Random();
+    const SplineCoeffs<N> coeffs(u, inv_dt, 2);
+
+    using GyroFunctor = CalibGyroCostFunctorSplit<N, Sophus::SO3, false>;
+    std::unique_ptr<ceres::CostFunction> gyro_autodiff(
+        newAutoDiffCostFunction<3>(new GyroFunctor(meas, u, inv_dt, 2.0),
+                                   GyroBlockSizes()));
+    CalibGyroAnalyticCostFunctionSplit<N> gyro(meas, u, inv_dt, 2.0);
+    CalibGyroAnalyticCostFunctionSplit<N> gyro_coeffs(meas, u, inv_dt, 2.0,
+                                                      &coeffs);
+
+    compareJacobians<Sophus::SO3d>(*gyro_autodiff, gyro, gyro_params, u);
+    compareJacobians<Sophus::SO3d>(*gyro_autodiff, gyro_coeffs, gyro_params,
+                                   u);
+
+    using AccelFunctor = CalibAccelerationCostFunctorSplit<N>;
+    std::unique_ptr<ceres::CostFunction> accel_autodiff(
+        newAutoDiffCostFunction<3>(new AccelFunctor(meas, u, inv_dt, 2.0),
+                                   AccelBlockSizes()));
+    CalibAccelerationAnalyticCostFunctionSplit<N> accel(meas, u, inv_dt, 2.0);
+    CalibAccelerationAnalyticCostFunctionSplit<N> accel_coeffs(
+        meas, u, inv_dt, 2.0, &coeffs);
+
+    compareJacobians<Sophus::SO3d>(*accel_autodiff, accel, accel_params, u);
+    compareJacobians<Sophus::SO3d>(*accel_autodiff, accel_coeffs,
+                                   accel_params, u);
+  }
+}
+
+template <int N>
+void test_calib_se3_analytic() {
+  using KnotBlockSizes = RepeatedBlockSizes<N, Sophus::SE3d::num_parameters>;
+  using GyroBlockSizes =
+      typename ConcatBlockSizes<KnotBlockSizes, BlockSizes<3>>::type;
+  using AccelBlockSizes =
+      typename ConcatBlockSizes<KnotBlockSizes, BlockSizes<3, 3>>::type;
+
+  const double inv_dt = 1e9 / 2e7;
+
+  Eigen::aligned_vector<Sophus::SE3d> knots;
+  for (int i = 0; i < N; i++) {
+    knots.emplace_back(Sophus::SE3d::exp(Sophus::Vector6d::Random()));
+  }
+  const Eigen::Vector3d g(0.1, -0.2, -9.81);
+  const Eigen::Vector3d gyro_bias = 0.01 * Eigen::Vector3d::Random();
+  const Eigen::Vector3d accel_bias = 0.1 * Eigen::Vector3d::Random();
+
+  std::vector<const double*> gyro_params, accel_params;
+  for (int i = 0; i < N; i++) {
+    gyro_params.emplace_back(knots[i].data());
+    accel_params.emplace_back(knots[i].data());
+  }
+  gyro_params.emplace_back(gyro_bias.data());
+  accel_params.emplace_back(g.data());
+  accel_params.emplace_back(accel_bias.data());
+
+  for (double u = 0; u < 1; u += 0.05) {
+    const Eigen::Vector3d meas = Eigen::Vector3d::Random();
+    const SplineCoeffs<N> coeffs(u, inv_dt, 2);
+
+    using GyroFunctor = CalibGyroCostFunctorSE3<N, false>;
+    std::unique_ptr<ceres::CostFunction> gyro_autodiff(
+        newAutoDiffCostFunction<3>(new GyroFunctor(meas, u, inv_dt, 2.0),
+                                   GyroBlockSizes()));
+    CalibGyroAnalyticCostFunctionSE3<N> gyro(meas, u, inv_dt, 2.0);
+    CalibGyroAnalyticCostFunctionSE3<N> gyro_coeffs(meas, u, inv_dt, 2.0,
+                                                    &coeffs);
+
+    compareJacobians<Sophus::SE3d>(*gyro_autodiff, gyro, gyro_params, u);
+    compareJacobians<Sophus::SE3d>(*gyro_autodiff, gyro_coeffs, gyro_params,
+                                   u);
+
+    using AccelFunctor = CalibAccelerationCostFunctorSE3<N, false>;
+    std::unique_ptr<ceres::CostFunction> accel_autodiff(
+        newAutoDiffCostFunction<3>(new AccelFunctor(meas, u, inv_dt, 2.0),
+                                   AccelBlockSizes()));
+    CalibAccelerationAnalyticCostFunctionSE3<N> accel(meas, u, inv_dt, 2.0);
+    CalibAccelerationAnalyticCostFunctionSE3<N> accel_coeffs(meas, u, inv_dt,
+                                                             2.0, &coeffs);
+
+    compareJacobians<Sophus::SE3d>(*accel_autodiff, accel, accel_params, u);
+    compareJacobians<Sophus::SE3d>(*accel_autodiff, accel_coeffs,
+                                   accel_params, u);
+  }
+}
+
+// The IMU residual is the gyro residual stacked on the accel residual.
+template <class Groupd>
+void compareImuResidual(const ceres::CostFunction& imu,
+                        const ceres::CostFunction& gyro,
+                        const ceres::CostFunction& accel,
+                        const std::vector<const double*>& imu_params,
+                        const std::vector<const double*>& gyro_params,
+                        const std::vector<const double*>& accel_params,
+                        double u) {
+  Eigen::Matrix<double, 6, 1> res;
+  Eigen::Vector3d res_gyro, res_accel;
+
+  ASSERT_TRUE(imu.Evaluate(imu_params.data(), res.data(), nullptr));
+  ASSERT_TRUE(gyro.Evaluate(gyro_params.data(), res_gyro.data(), nullptr));
+  ASSERT_TRUE(accel.Evaluate(accel_params.data(), res_accel.data(), nullptr));
+
+  EXPECT_TRUE(res.head<3>().isApprox(res_gyro)) << "u " << u;
+  EXPECT_TRUE(res.tail<3>().isApprox(res_accel)) << "u " << u;
+}
+
+template <int N>
+void test_calib_imu_split() {
+  using ImuBlockSizes = typename ConcatBlockSizes<
+      RepeatedBlockSizes<N, Sophus::SO3d::num_parameters>,
+      RepeatedBlockSizes<N, 3>, BlockSizes<3, 3, 3>>::type;
+
+  const double inv_dt = 1e9 / 2e7;
+
+  Eigen::aligned_vector<Sophus::SO3d> rot_knots;
+  Eigen::aligned_vector<Eigen::Vector3d> trans_knots;
+  for (int i = 0; i < N; i++) {
+    rot_knots.emplace_back(Sophus::SO3d::exp(Eigen::Vector3d::Random()));
+    trans_knots.emplace_back(Eigen::Vector3d::Random());
+  }
+  const Eigen::Vector3d g(0.1, -0.2, -9.81);
+  const Eigen::Vector3d gyro_bias = 0.01 * Eigen::Vector3d::Random();
+  const Eigen::Vector3d accel_bias = 0.1 * Eigen::Vector3d::Random();
+
+  std::vector<const double*> gyro_params, accel_params, imu_params;
+  for (int i = 0; i < N; i++) gyro_params.emplace_back(rot_knots[i].data());
+  gyro_params.emplace_back(gyro_bias.data());
+
+  accel_params = std::vector<const double*>(gyro_params.begin(),
+                                            gyro_params.end() - 1);
+  for (int i = 0; i < N; i++) accel_params.emplace_back(trans_knots[i].data());
+  accel_params.emplace_back(g.data());
+  accel_params.emplace_back(accel_bias.data());
+
+  imu_params = accel_params;
+  imu_params.emplace_back(gyro_bias.data());
+
+  for (double u = 0; u < 1; u += 0.05) {
+    const Eigen::Vector3d gyro_meas = Eigen::Vector3d::Random();
+    const Eigen::Vector3d accel_meas = Eigen::Vector3d::Random();
+    const SplineCoeffs<N> coeffs(u, inv_dt, 2);
+
+    std::unique_ptr<ceres::CostFunction> imu_autodiff(
+        newAutoDiffCostFunction<6>(
+            new CalibImuCostFunctorSplit<N>(gyro_meas, accel_meas, u, inv_dt,
+                                            2.0, 3.0),
+            ImuBlockSizes()));
+    CalibImuAnalyticCostFunctionSplit<N> imu(gyro_meas, accel_meas, u, inv_dt,
+                                             2.0, 3.0);
+    CalibImuAnalyticCostFunctionSplit<N> imu_coeffs(gyro_meas, accel_meas, u,
+                                                    inv_dt, 2.0, 3.0, &coeffs);
+
+    compareJacobians<Sophus::SO3d>(*imu_autodiff, imu, imu_params, u);
+    compareJacobians<Sophus::SO3d>(*imu_autodiff, imu_coeffs, imu_params, u);
+
+    CalibGyroAnalyticCostFunctionSplit<N> gyro(gyro_meas, u, inv_dt, 2.0);
+    CalibAccelerationAnalyticCostFunctionSplit<N> accel(accel_meas, u, inv_dt,
+                                                        3.0);
+    compareImuResidual<Sophus::SO3d>(imu, gyro, accel, imu_params,
+                                     gyro_params, accel_params, u);
+  }
+}
+
+template <int N>
+void test_calib_imu_se3() {
+  using ImuBlockSizes = typename ConcatBlockSizes<
+      RepeatedBlockSizes<N, Sophus::SE3d::num_parameters>,
+      BlockSizes<3, 3, 3>>::type;
+
+  const double inv_dt = 1e9 / 2e7;
+
+  Eigen::aligned_vector<Sophus::SE3d> knots;
+  for (int i = 0; i < N; i++) {
+    knots.emplace_back(Sophus::SE3d::exp(Sophus::Vector6d::Random()));
+  }
+  const Eigen::Vector3d g(0.1, -0.2, -9.81);
+  const Eigen::Vector3d gyro_bias = 0.01 * Eigen::Vector3d::Random();
+  const Eigen::Vector3d accel_bias = 0.1 * Eigen::Vector3d::Random();
+
+  std::vector<const double*> gyro_params, accel_params, imu_params;
+  for (int i = 0; i < N; i++) {
+    gyro_params.emplace_back(knots[i].data());
+    accel_params.emplace_back(knots[i].data());
+  }
+  gyro_params.emplace_back(gyro_bias.data());
+  accel_params.emplace_back(g.data());
+  accel_params.emplace_back(accel_bias.data());
+
+  imu_params = accel_params;
+  imu_params.emplace_back(gyro_bias.data());
+
+  for (double u = 0; u < 1; u += 0.05) {
+    const Eigen::Vector3d gyro_meas = Eigen::Vector3d::Random();
+    const Eigen::Vector3d accel_meas = Eigen::Vector3d::Random();
+    const SplineCoeffs<N> coeffs(u, inv_dt, 2);
+
+    std::unique_ptr<ceres::CostFunction> imu_autodiff(
+        newAutoDiffCostFunction<6>(
+            new CalibImuCostFunctorSE3<N>(gyro_meas, accel_meas, u, inv_dt,
+                                          2.0, 3.0),
+            ImuBlockSizes()));
+    CalibImuAnalyticCostFunctionSE3<N> imu(gyro_meas, accel_meas, u, inv_dt,
+                                           2.0, 3.0);
+    CalibImuAnalyticCostFunctionSE3<N> imu_coeffs(gyro_meas, accel_meas, u,
+                                                  inv_dt, 2.0, 3.0, &coeffs);
+
+    compareJacobians<Sophus::SE3d>(*imu_autodiff, imu, imu_params, u);
+    compareJacobians<Sophus::SE3d>(*imu_autodiff, imu_coeffs, imu_params, u);
+
+    CalibGyroAnalyticCostFunctionSE3<N> gyro(gyro_meas, u, inv_dt, 2.0);
+    CalibAccelerationAnalyticCostFunctionSE3<N> accel(accel_meas, u, inv_dt,
+                                                      3.0);
+    compareImuResidual<Sophus::SE3d>(imu, gyro, accel, imu_params,
+                                     gyro_params, accel_params, u);
+  }
+}
+
+// Residuals and Jacobians of cached, whose residuals read the knot
+// differences from the evaluation callback, and plain, which has the same
+// residuals computing them, at the current knots and after moving them.
+template <class Groupd>
+void compareKnotDeltaCallback(ceres::Problem& cached, ceres::Problem& plain,
+                              Eigen::aligned_vector<Groupd>& knots) {
+  for (int iter = 0; iter < 3; iter++) {
+    double cost1, cost2;
+    std::vector<double> res1, res2;
+    ceres::CRSMatrix J1, J2;
+
+    ASSERT_TRUE(plain.Evaluate(ceres::Problem::EvaluateOptions(), &cost1,
+                               &res1, nullptr, &J1));
+    ASSERT_TRUE(cached.Evaluate(ceres::Problem::EvaluateOptions(), &cost2,
+                                &res2, nullptr, &J2));
+
+    ASSERT_EQ(res1.size(), res2.size());
+    ASSERT_EQ(J1.values.size(), J2.values.size());
+
+    const Eigen::Map<const Eigen::VectorXd> r1(res1.data(), res1.size());
+    const Eigen::Map<const Eigen::VectorXd> r2(res2.data(), res2.size());
+    EXPECT_LE((r1 - r2).norm(), 1e-12 * r1.norm()) << "iter " << iter;
+
+    const Eigen::Map<const Eigen::VectorXd> v1(J1.values.data(),
+                                               J1.values.size());
+    const Eigen::Map<const Eigen::VectorXd> v2(J2.values.data(),
+                                               J2.values.size());
+    EXPECT_LE((v1 - v2).norm(), 1e-12 * v1.norm()) << "iter " << iter;
+
+    for (Groupd& knot : knots) {
+      knot *= Groupd::exp(0.1 * Groupd::Tangent::Random());
+    }
+  }
+}
+
+template <int N>
+void test_knot_delta_callback_split() {
+  const double inv_dt = 1e9 / 2e7;
+  const int num_knots = N + 3;
+
+  Eigen::aligned_vector<Sophus::SO3d> rot_knots;
+  Eigen::aligned_vector<Eigen::Vector3d> trans_knots;
+  for (int i = 0; i < num_knots; i++) {
+    rot_knots.emplace_back(Sophus::SO3d::exp(Eigen::Vector3d::Random()));
+    trans_knots.emplace_back(Eigen::Vector3d::Random());
+  }
+  Eigen::Vector3d g(0.1, -0.2, -9.81);
+  Eigen::Vector3d gyro_bias = 0.01 * Eigen::Vector3d::Random();
+  Eigen::Vector3d accel_bias = 0.1 * Eigen::Vector3d::Random();
+
+  KnotDeltaCallback<Sophus::SO3d> callback(rot_knots);
+
+  ceres::Problem::Options options;
+  options.evaluation_callback = &callback;
+  ceres::Problem cached(options), plain;
+
+  for (int s = 0; s + N <= num_knots; s++) {
+    std::vector<double*> gyro_params, accel_params, imu_params;
+    for (int i = 0; i < N; i++) {
+      gyro_params.emplace_back(rot_knots[s + i].data());
+    }
+    accel_params = gyro_params;
+    gyro_params.emplace_back(gyro_bias.data());
+
+    for (int i = 0; i < N; i++) {
+      accel_params.emplace_back(trans_knots[s + i].data());
+    }
+    accel_params.emplace_back(g.data());
+    accel_params.emplace_back(accel_bias.data());
+
+    imu_params = accel_params;
+    imu_params.emplace_back(gyro_bias.data());
+
+    for (double u : {0.1, 0.5, 0.9}) {
+      const Eigen::Vector3d gyro_meas = Eigen::Vector3d::Random();
+      const Eigen::Vector3d accel_meas = Eigen::Vector3d::Random();
+
+      for (ceres::Problem* problem : {&cached, &plain}) {
+        auto* gyro = new CalibGyroAnalyticCostFunctionSplit<N>(
+            gyro_meas, u, inv_dt, 2.0);
+        auto* accel = new CalibAccelerationAnalyticCostFunctionSplit<N>(
+            accel_meas, u, inv_dt, 3.0);
+        auto* imu = new CalibImuAnalyticCostFunctionSplit<N>(
+            gyro_meas, accel_meas, u, inv_dt, 2.0, 3.0);
+
+        if (problem == &cached) {
+          gyro->setKnotDeltas(callback.table(), s);
+          accel->setKnotDeltas(callback.table(), s);
+          imu->setKnotDeltas(callback.table(), s);
+
+          // The table is empty before the first evaluation, so the residual
+          // computes the differences itself.
+          const CalibImuAnalyticCostFunctionSplit<N> imu_local(
+              gyro_meas, accel_meas, u, inv_dt, 2.0, 3.0);
+          compareJacobians<Sophus::SO3d>(
+              imu_local, *imu, {imu_params.begin(), imu_params.end()}, u);
+        }
+
+        problem->AddResidualBlock(gyro, nullptr, gyro_params);
+        problem->AddResidualBlock(accel, nullptr, accel_params);
+        problem->AddResidualBlock(imu, nullptr, imu_params);
+      }
+    }
+  }
+
+  compareKnotDeltaCallback(cached, plain, rot_knots);
+}
+
+template <int N>
+void test_knot_delta_callback_se3() {
+  const double inv_dt = 1e9 / 2e7;
+  const int num_knots = N + 3;
+
+  Eigen::aligned_vector<Sophus::SE3d> knots;
+  for (int i = 0; i < num_knots; i++) {
+    knots.emplace_back(Sophus::SE3d::exp(Sophus::Vector6d::Random()));
+  }
+  Eigen::Vector3d g(0.1, -0.2, -9.81);
+  Eigen::Vector3d gyro_bias = 0.01 * Eigen::Vector3d::Random();
+  Eigen::Vector3d accel_bias = 0.1 * Eigen::Vector3d::Random();
+
+  KnotDeltaCallback<Sophus::SE3d> callback(knots);
+
+  ceres::Problem::Options options;
+  options.evaluation_callback = &callback;
+  ceres::Problem cached(options), plain;
+
+  for (int s = 0; s + N <= num_knots; s++) {
+    std::vector<double*> gyro_params, accel_params, imu_params;
+    for (int i = 0; i < N; i++) gyro_params.emplace_back(knots[s + i].data());
+    accel_params = gyro_params;
+    gyro_params.emplace_back(gyro_bias.data());
+
+    accel_params.emplace_back(g.data());
+    accel_params.emplace_back(accel_bias.data());
+
+    imu_params = accel_params;
+    imu_params.emplace_back(gyro_bias.data());
+
+    for (double u : {0.1, 0.5, 0.9}) {
+      const Eigen::Vector3d gyro_meas = Eigen::Vector3d::Random();
+      const Eigen::Vector3d accel_meas = Eigen::Vector3d::Random();
+
+      for (ceres::Problem* problem : {&cached, &plain}) {
+        auto* gyro = new CalibGyroAnalyticCostFunctionSE3<N>(gyro_meas, u,
+                                                             inv_dt, 2.0);
+        auto* accel = new CalibAccelerationAnalyticCostFunctionSE3<N>(
+            accel_meas, u, inv_dt, 3.0);
+        auto* imu = new CalibImuAnalyticCostFunctionSE3<N>(
+            gyro_meas, accel_meas, u, inv_dt, 2.0, 3.0);
+
+        if (problem == &cached) {
+          gyro->setKnotDeltas(callback.table(), s);
+          accel->setKnotDeltas(callback.table(), s);
+          imu->setKnotDeltas(callback.table(), s);
+
+          // The table is empty before the first evaluation, so the residual
+          // computes the differences itself.
+          const CalibImuAnalyticCostFunctionSE3<N> imu_local(
+              gyro_meas, accel_meas, u, inv_dt, 2.0, 3.0);
+          compareJacobians<Sophus::SE3d>(
+              imu_local, *imu, {imu_params.begin(), imu_params.end()}, u);
+        }
+
+        problem->AddResidualBlock(gyro, nullptr, gyro_params);
+        problem->AddResidualBlock(accel, nullptr, accel_params);
+        problem->AddResidualBlock(imu, nullptr, imu_params);
+      }
+    }
+  }
+
+  compareKnotDeltaCallback(cached, plain, knots);
+}
+
+TEST(SplineCeresTestSuite, CalibAnalyticResidualsSplit) {
+  test_calib_split_analytic<4>();
+  test_calib_split_analytic<5>();
+  test_calib_split_analytic<6>();
+}
+
+TEST(SplineCeresTestSuite, CalibAnalyticResidualsSE3) {
+  test_calib_se3_analytic<4>();
+  test_calib_se3_analytic<5>();
+  test_calib_se3_analytic<6>();
+}
+
+TEST(SplineCeresTestSuite, CalibImuResidualSplit) {
+  test_calib_imu_split<4>();
+  test_calib_imu_split<5>();
+  test_calib_imu_split<6>();
+}
+
+TEST(SplineCeresTestSuite, CalibImuResidualSE3) {
+  test_calib_imu_se3<4>();
+  test_calib_imu_se3<5>();
+  test_calib_imu_se3<6>();
+}
+
+TEST(SplineCeresTestSuite, CalibKnotDeltaCallback) {
+  test_knot_delta_callback_split<4>();
+  test_knot_delta_callback_split<5>();
+  test_knot_delta_callback_se3<4>();
+  test_knot_delta_callback_se3<5>();
+}
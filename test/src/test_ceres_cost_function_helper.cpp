@@ -0,0 +1,89 @@
+#include <iostream>
+
+#include "gtest/gtest.h"
+
+#include <ceres/ceres.h>
+
+#include <ceres_cost_function_helper.h>
+#include <ceres_lie_residuals.h>
+
+// Compare FixedSizeAutoDiffCostFunction with ceres::DynamicAutoDiffCostFunction
+// for the spline acceleration functor. If skip_block >= 0 that Jacobian is not
+// requested, as for a constant parameter block.
+template <int N, template <class> class GroupT, int Stride>
+void test_fixed_size_autodiff(int skip_block) {
+  using Groupd = GroupT<double>;
+  using Tangentd = typename Groupd::Tangent;
+  using FunctorT = LieGroupSplineAccelerationCostFunctor<N, GroupT, false>;
+
+  constexpr int kNumJacobian = Groupd::DoF * Groupd::num_parameters;
+
+  Eigen::aligned_vector<Groupd> knots;
+  std::vector<const double*> params;
+  for (int i = 0; i < N; i++) {
+    knots.emplace_back(Groupd::exp(Tangentd::Random()));
+  }
+  for (const auto& k : knots) params.emplace_back(k.data());
+
+  const Tangentd meas = Tangentd::Random();
+
+  ceres::DynamicAutoDiffCostFunction<FunctorT> dynamic(
+      new FunctorT(meas, 0.3, 2.0));
+  for (int i = 0; i < N; i++) {
+    dynamic.AddParameterBlock(Groupd::num_parameters);
+  }
+  dynamic.SetNumResiduals(Groupd::DoF);
+
+  std::unique_ptr<ceres::CostFunction> fixed(
+      newAutoDiffCostFunction<Groupd::DoF, Stride>(
+          new FunctorT(meas, 0.3, 2.0),
+          RepeatedBlockSizes<N, Groupd::num_parameters>()));
+
+  EXPECT_EQ(fixed->num_residuals(), Groupd::DoF);
+  EXPECT_EQ(fixed->parameter_block_sizes(),
+            dynamic.parameter_block_sizes());
+
+  std::vector<std::vector<double>> J1(N, std::vector<double>(kNumJacobian)),
+      J2(N, std::vector<double>(kNumJacobian, 42.0));
+  std::vector<double*> J1_ptr, J2_ptr;
+  for (int i = 0; i < N; i++) {
+    J1_ptr.emplace_back(i == skip_block ? nullptr : J1[i].data());
+    J2_ptr.emplace_back(i == skip_block ? nullptr : J2[i].data());
+  }
+
+  Tangentd r1, r2, r3;
+  ASSERT_TRUE(dynamic.Evaluate(params.data(), r1.data(), J1_ptr.data()));
+  ASSERT_TRUE(fixed->Evaluate(params.data(), r2.data(), J2_ptr.data()));
+  ASSERT_TRUE(fixed->Evaluate(params.data(), r3.data(), nullptr));
+
+  EXPECT_TRUE(r1.isApprox(r2));
+  EXPECT_TRUE(r1.isApprox(r3));
+
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < kNumJacobian; j++) {
+      if (i == skip_block) {
+        EXPECT_EQ(J2[i][j], 42.0);
+      } else {
+        EXPECT_NEAR(J1[i][j], J2[i][j], 1e-10);
+      }
+    }
+  }
+}
+
+TEST(SplineCeresTestSuite, FixedSizeAutoDiffSO3_4) {
+  test_fixed_size_autodiff<4, Sophus::SO3, 4>(-1);
+}
+
+TEST(SplineCeresTestSuite, FixedSizeAutoDiffSE3_5) {
+  test_fixed_size_autodiff<5, Sophus::SE3, 4>(-1);
+}
+
+TEST(SplineCeresTestSuite, FixedSizeAutoDiffStride) {
+  test_fixed_size_autodiff<4, Sophus::SE3, 3>(-1);
+  test_fixed_size_autodiff<4, Sophus::SE3, 7>(-1);
+}
+
+TEST(SplineCeresTestSuite, FixedSizeAutoDiffConstantBlock) {
+  test_fixed_size_autodiff<4, Sophus::SO3, 4>(0);
+  test_fixed_size_autodiff<5, Sophus::SE3, 4>(2);
+}
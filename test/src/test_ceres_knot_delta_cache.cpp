@@ -0,0 +1,98 @@
+#include <iostream>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include <basalt/utils/eigen_utils.hpp>
+#include <ceres_lie_spline.h>
+
+constexpr int N = 5;
+using Spline = CeresLieGroupSpline<N, Sophus::SE3>;
+
+// Queries of spline, single time and batched, match the uncached ones of ref.
+void expect_same_queries(const Spline& spline, const Spline& ref,
+                         double batch_tol) {
+  std::vector<int64_t> times_ns;
+  for (int64_t t_ns = 0; t_ns <= spline.maxTimeNs(); t_ns += 3e6) {
+    times_ns.emplace_back(t_ns);
+  }
+
+  const size_t n = times_ns.size();
+  Eigen::aligned_vector<Sophus::SE3d> value(n);
+  Eigen::aligned_vector<Sophus::Vector6d> vel(n), accel(n);
+  spline.evaluateBatch(times_ns.data(), n, value.data(), vel.data(),
+                       accel.data());
+
+  for (size_t i = 0; i < n; i++) {
+    const int64_t t_ns = times_ns[i];
+    const Sophus::SE3d ref_value = ref.getValue(t_ns);
+    const Sophus::Vector6d ref_vel = ref.getVel(t_ns);
+    const Sophus::Vector6d ref_accel = ref.getAccel(t_ns);
+
+    EXPECT_LT((ref_value.inverse() * spline.getValue(t_ns)).log().norm(),
+              1e-10)
+        << "t_ns " << t_ns;
+    EXPECT_LE((ref_vel - spline.getVel(t_ns)).norm(),
+              1e-10 * std::max(1.0, ref_vel.norm()))
+        << "t_ns " << t_ns;
+    EXPECT_LE((ref_accel - spline.getAccel(t_ns)).norm(),
+              1e-10 * std::max(1.0, ref_accel.norm()))
+        << "t_ns " << t_ns;
+
+    EXPECT_LT((ref_value.inverse() * value[i]).log().norm(), batch_tol)
+        << "t_ns " << t_ns;
+    EXPECT_LE((ref_vel - vel[i]).norm(),
+              batch_tol * std::max(1.0, ref_vel.norm()))
+        << "t_ns " << t_ns;
+    EXPECT_LE((ref_accel - accel[i]).norm(),
+              batch_tol * std::max(1.0, ref_accel.norm()))
+        << "t_ns " << t_ns;
+  }
+}
+
+void test_invalidation(bool float_queries) {
+  const int64_t dt_ns = 2e7;
+  const int num_knots = 30;
+
+  // Float queries only change evaluateBatch.
+  const double batch_tol = float_queries ? 1e-4 : 1e-10;
+
+  Spline gt(dt_ns);
+  gt.initRandom(num_knots);
+  for (int i = 1; i < num_knots; i++) {
+    gt.setKnot(i, gt.getKnot(i - 1) *
+                      Sophus::SE3d::exp(0.1 * Sophus::Vector6d::Random()));
+  }
+
+  Spline spline(dt_ns), ref(dt_ns);
+  spline.setKnotDeltaCache(true);
+  spline.setFloatQueries(float_queries);
+  spline.init(Sophus::SE3d(), num_knots);
+  ref.init(Sophus::SE3d(), num_knots);
+
+  // Fill the cache, then change knots in the middle and at both ends.
+  expect_same_queries(spline, ref, batch_tol);
+  for (int i : {0, num_knots / 2, num_knots - 1}) {
+    spline.setKnot(i, gt.getKnot(i));
+    ref.setKnot(i, gt.getKnot(i));
+    expect_same_queries(spline, ref, batch_tol);
+  }
+
+  for (int64_t t_ns = 0; t_ns < spline.maxTimeNs(); t_ns += 2e6) {
+    spline.addMeasurement(gt.getValue(t_ns), t_ns);
+  }
+  spline.optimize();
+
+  for (int i = 0; i < num_knots; i++) {
+    ref.setKnot(i, spline.getKnot(i));
+  }
+  expect_same_queries(spline, ref, batch_tol);
+}
+
+TEST(SplineCeresTestSuite, KnotDeltaCacheInvalidation) {
+  test_invalidation(false);
+}
+
+TEST(SplineCeresTestSuite, KnotDeltaCacheInvalidationFloat) {
+  test_invalidation(true);
+}
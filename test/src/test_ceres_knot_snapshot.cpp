@@ -0,0 +1,179 @@
+#include <atomic>
+#include <deque>
+#include <iostream>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include <basalt/utils/eigen_utils.hpp>
+#include <ceres_knot_snapshot.h>
+#include <ceres_lie_spline.h>
+
+TEST(SplineCeresTestSuite, KnotSnapshotsSlots) {
+  using Snapshots = KnotSnapshots<Sophus::SO3d>;
+
+  Snapshots snapshots;
+  Eigen::aligned_vector<Sophus::SO3d> knots(5);
+
+  // Readers keep their snapshot while newer ones are published.
+  knots[0] = Sophus::SO3d::exp(Eigen::Vector3d(0.1, 0, 0));
+  ASSERT_TRUE(snapshots.publish(knots, true));
+  Snapshots::Reader r0 = snapshots.read();
+
+  knots[0] = Sophus::SO3d::exp(Eigen::Vector3d(0.2, 0, 0));
+  ASSERT_TRUE(snapshots.publish(knots, true));
+  Snapshots::Reader r1 = snapshots.read();
+
+  EXPECT_EQ(r0->version, 0);
+  EXPECT_EQ(r1->version, 1);
+  EXPECT_EQ(r1->deltas.size(), knots.size() - 1);
+
+  // The third slot is free, then all slots are held.
+  knots[0] = Sophus::SO3d::exp(Eigen::Vector3d(0.3, 0, 0));
+  EXPECT_TRUE(snapshots.publish(knots, false));
+  Snapshots::Reader r2 = snapshots.read();
+  EXPECT_TRUE(r2->deltas.empty());
+
+  EXPECT_FALSE(snapshots.publish(knots, false));
+
+  EXPECT_NEAR(r0->knots[0].log()[0], 0.1, 1e-12);
+  EXPECT_NEAR(r1->knots[0].log()[0], 0.2, 1e-12);
+  EXPECT_NEAR(r2->knots[0].log()[0], 0.3, 1e-12);
+
+  // Releasing a reader frees its slot.
+  { Snapshots::Reader released = std::move(r0); }
+  EXPECT_TRUE(snapshots.publish(knots, false));
+  EXPECT_EQ(snapshots.read()->version, 3);
+  EXPECT_EQ(snapshots.numPublished(), 4);
+}
+
+TEST(SplineCeresTestSuite, KnotSnapshotsAddSlot) {
+  using Snapshots = KnotSnapshots<Sophus::SO3d>;
+
+  Snapshots snapshots;
+  Eigen::aligned_vector<Sophus::SO3d> knots(5);
+
+  // Empty snapshot before the first publication.
+  {
+    Snapshots::Reader empty = snapshots.read();
+    EXPECT_EQ(empty->version, -1);
+    EXPECT_TRUE(empty->knots.empty());
+  }
+
+  // Publications that must not be skipped add slots while readers hold all
+  // others.
+  std::deque<Snapshots::Reader> readers;
+  for (int i = 0; i < Snapshots::max_slots; i++) {
+    ASSERT_TRUE(snapshots.publish(knots, false, -1, true));
+    readers.emplace_back(snapshots.read());
+  }
+  EXPECT_EQ(snapshots.numSlots(), Snapshots::max_slots);
+  EXPECT_EQ(snapshots.numPublished(), Snapshots::max_slots);
+
+  EXPECT_FALSE(snapshots.publish(knots, false, -1, true));
+
+  readers.pop_front();
+  EXPECT_TRUE(snapshots.publish(knots, false));
+  EXPECT_EQ(snapshots.read()->version, Snapshots::max_slots);
+}
+
+TEST(SplineCeresTestSuite, KnotSnapshotsFinalPublication) {
+  constexpr int N = 5;
+  const int64_t dt_ns = 2e7;
+  const int num_knots = 20;
+
+  CeresLieGroupSpline<N, Sophus::SO3> spline(dt_ns);
+  spline.setKnotSnapshots(true);
+  spline.init(Sophus::SO3d(), num_knots);
+
+  for (int64_t t_ns = 0; t_ns < spline.maxTimeNs(); t_ns += 1e7) {
+    spline.addMeasurement(Sophus::SO3d::exp(Eigen::Vector3d(1e-9 * t_ns, 0, 0)),
+                          t_ns);
+  }
+
+  // Long-lived readers hold all slots but the current one.
+  const auto r0 = spline.readKnotSnapshot();
+  spline.publishKnots();
+  const auto r1 = spline.readKnotSnapshot();
+  spline.publishKnots();
+
+  spline.optimize();
+
+  const auto snapshot = spline.readKnotSnapshot();
+  for (int i = 0; i < num_knots; i++) {
+    EXPECT_TRUE(
+        snapshot->knots[i].params().isApprox(spline.getKnot(i).params()));
+  }
+  EXPECT_EQ(r0->knots[0].params(), Sophus::SO3d().params());
+  EXPECT_EQ(r1->knots[0].params(), Sophus::SO3d().params());
+}
+
+TEST(SplineCeresTestSuite, KnotSnapshotsConcurrentQueries) {
+  constexpr int N = 5;
+  const int64_t dt_ns = 2e7;
+  const int num_knots = 30;
+
+  CeresLieGroupSpline<N, Sophus::SE3> gt(dt_ns);
+  gt.initRandom(num_knots);
+  for (int i = 1; i < num_knots; i++) {
+    gt.setKnot(i, gt.getKnot(i - 1) *
+                      Sophus::SE3d::exp(0.1 * Sophus::Vector6d::Random()));
+  }
+
+  CeresLieGroupSpline<N, Sophus::SE3> spline(dt_ns);
+  spline.setKnotDeltaCache(true);
+  spline.setKnotSnapshots(true);
+  spline.init(Sophus::SE3d(), num_knots);
+
+  for (int64_t t_ns = 0; t_ns < spline.maxTimeNs(); t_ns += 2e6) {
+    spline.addMeasurement(gt.getValue(t_ns), t_ns);
+  }
+
+  std::atomic<bool> done(false);
+  std::atomic<int> num_reads(0);
+
+  std::thread reader([&] {
+    int64_t last_version = -1;
+    int last_iteration = -1;
+
+    while (!done.load()) {
+      {
+        const auto snapshot = spline.readKnotSnapshot();
+        EXPECT_GE(snapshot->version, last_version);
+        if (snapshot->version > last_version && snapshot->iteration >= 0) {
+          EXPECT_GT(snapshot->iteration, last_iteration);
+          last_iteration = snapshot->iteration;
+        }
+        last_version = snapshot->version;
+        EXPECT_EQ(snapshot->knots.size(), size_t(num_knots));
+        EXPECT_EQ(snapshot->deltas.size(), size_t(num_knots - 1));
+      }
+
+      const Sophus::SE3d pose = spline.getValue(spline.maxTimeNs() / 2);
+      EXPECT_TRUE(pose.matrix().allFinite());
+      num_reads++;
+    }
+  });
+
+  const ceres::Solver::Summary summary = spline.optimize();
+  done = true;
+  reader.join();
+
+  EXPECT_GT(num_reads.load(), 0);
+
+  // Initial state, accepted steps and the final knots.
+  const auto snapshot = spline.readKnotSnapshot();
+  EXPECT_GE(snapshot->version, summary.num_successful_steps);
+  for (int i = 0; i < num_knots; i++) {
+    EXPECT_TRUE(snapshot->knots[i].params().isApprox(
+        spline.getKnot(i).params()));
+  }
+
+  for (int64_t t_ns = 0; t_ns < spline.maxTimeNs(); t_ns += 1e7) {
+    EXPECT_LT((gt.getValue(t_ns).inverse() * spline.getValue(t_ns))
+                  .log()
+                  .norm(),
+              1e-6)
+        << "t_ns " << t_ns;
+  }
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+
+#include "gtest/gtest.h"
+
+#include <ceres/ceres.h>
+
+#include <basalt/utils/eigen_utils.hpp>
+#include <ceres_lie_residuals.h>
+#include <ceres_test_jacobians.h>
+
+template <int N, template <class> class GroupT, int DERIV>
+void test_analytic_residual() {
+  using Groupd = GroupT<double>;
+  using Tangentd = typename Groupd::Tangent;
+
+  static const int64_t dt_ns = 2e9;
+  double inv_dt = 1e9 / dt_ns;
+
+  Eigen::aligned_vector<Groupd> knots;
+  for (int i = 0; i < N; i++) {
+    knots.emplace_back(Groupd::exp(Tangentd::Random()));
+  }
+
+  std::vector<const double*> params;
+  for (int i = 0; i < N; i++) params.emplace_back(knots[i].data());
+
+  for (double u = 0; u < 1; u += 0.05) {
+    Groupd meas_value = Groupd::exp(0.1 * Tangentd::Random()) * knots[1];
+    Tangentd meas_deriv = Tangentd::Random();
+
+    std::unique_ptr<ceres::CostFunction> analytic, autodiff;
+
+    if constexpr (DERIV == 0) {
+      using FunctorT = LieGroupSplineValueCostFunctor<N, GroupT>;
+      auto* cf = new ceres::DynamicAutoDiffCostFunction<FunctorT>(
+          new FunctorT(meas_value, u));
+      for (int i = 0; i < N; i++) cf->AddParameterBlock(Groupd::num_parameters);
+      cf->SetNumResiduals(Groupd::DoF);
+      autodiff.reset(cf);
+
+      analytic.reset(
+          new LieGroupSplineValueAnalyticCostFunction<N, GroupT>(meas_value,
+                                                                 u));
+    } else if constexpr (DERIV == 1) {
+      using FunctorT = LieGroupSplineVelocityCostFunctor<N, GroupT, false>;
+      auto* cf = new ceres::DynamicAutoDiffCostFunction<FunctorT>(
+          new FunctorT(meas_deriv, u, inv_dt, 2.0));
+      for (int i = 0; i < N; i++) cf->AddParameterBlock(Groupd::num_parameters);
+      cf->SetNumResiduals(Groupd::DoF);
+      autodiff.reset(cf);
+
+      analytic.reset(new LieGroupSplineVelocityAnalyticCostFunction<N, GroupT>(
+          meas_deriv, u, inv_dt, 2.0));
+    } else {
+      using FunctorT =
+          LieGroupSplineAccelerationCostFunctor<N, GroupT, false>;
+      auto* cf = new ceres::DynamicAutoDiffCostFunction<FunctorT>(
+          new FunctorT(meas_deriv, u, inv_dt));
+      for (int i = 0; i < N; i++) cf->AddParameterBlock(Groupd::num_parameters);
+      cf->SetNumResiduals(Groupd::DoF);
+      autodiff.reset(cf);
+
+      analytic.reset(
+          new LieGroupSplineAccelerationAnalyticCostFunction<N, GroupT>(
+              meas_deriv, u, inv_dt));
+    }
+
+    compareJacobians<Groupd>(*autodiff, *analytic, params, u);
+  }
+}
+
+TEST(SplineCeresTestSuite, LieAnalyticResidualValueSO3) {
+  test_analytic_residual<4, Sophus::SO3, 0>();
+  test_analytic_residual<5, Sophus::SO3, 0>();
+  test_analytic_residual<6, Sophus::SO3, 0>();
+}
+
+TEST(SplineCeresTestSuite, LieAnalyticResidualVelocitySO3) {
+  test_analytic_residual<4, Sophus::SO3, 1>();
+  test_analytic_residual<5, Sophus::SO3, 1>();
+  test_analytic_residual<6, Sophus::SO3, 1>();
+}
+
+TEST(SplineCeresTestSuite, LieAnalyticResidualAccelerationSO3) {
+  test_analytic_residual<4, Sophus::SO3, 2>();
+  test_analytic_residual<5, Sophus::SO3, 2>();
+  test_analytic_residual<6, Sophus::SO3, 2>();
+}
+
+TEST(SplineCeresTestSuite, LieAnalyticResidualValueSE3) {
+  test_analytic_residual<4, Sophus::SE3, 0>();
+  test_analytic_residual<5, Sophus::SE3, 0>();
+  test_analytic_residual<6, Sophus::SE3, 0>();
+}
+
+TEST(SplineCeresTestSuite, LieAnalyticResidualVelocitySE3) {
+  test_analytic_residual<4, Sophus::SE3, 1>();
+  test_analytic_residual<5, Sophus::SE3, 1>();
+  test_analytic_residual<6, Sophus::SE3, 1>();
+}
+
+TEST(SplineCeresTestSuite, LieAnalyticResidualAccelerationSE3) {
+  test_analytic_residual<4, Sophus::SE3, 2>();
+  test_analytic_residual<5, Sophus::SE3, 2>();
+  test_analytic_residual<6, Sophus::SE3, 2>();
+}
@@ -0,0 +1,170 @@
+#include <iostream>
+
+#include "gtest/gtest.h"
+
+#include <basalt/utils/eigen_utils.hpp>
+#include <ceres_lie_spline_nonuniform.h>
+
+template <int N>
+void test_uniform_times() {
+  const int64_t dt_ns = 2e7;
+  const int64_t start_t_ns = 3e9;
+  const double inv_dt = 1e9 / dt_ns;
+
+  std::vector<int64_t> times_ns;
+  for (int i = 0; i <= 10; i++) times_ns.emplace_back(start_t_ns + i * dt_ns);
+
+  const NonUniformKnotTimes<N> knot_times(times_ns);
+  EXPECT_EQ(knot_times.numKnots(), size_t(10 + N - 1));
+
+  for (int64_t t_ns = knot_times.minTimeNs(); t_ns < knot_times.maxTimeNs();
+       t_ns += 3e6) {
+    const int64_t st_ns = t_ns - start_t_ns;
+    const int64_t s = knot_times.segment(t_ns);
+    EXPECT_EQ(s, st_ns / dt_ns);
+
+    const SplineCoeffs<N> c = knot_times.coeffs(s, t_ns);
+    const SplineCoeffs<N> c_ref(double(st_ns % dt_ns) / dt_ns, inv_dt);
+
+    EXPECT_TRUE(c.coeff.isApprox(c_ref.coeff, 1e-10)) << "t_ns " << t_ns;
+    EXPECT_TRUE(c.dcoeff.isApprox(c_ref.dcoeff, 1e-10)) << "t_ns " << t_ns;
+    EXPECT_TRUE(c.ddcoeff.isApprox(c_ref.ddcoeff, 1e-10)) << "t_ns " << t_ns;
+    EXPECT_TRUE(c.dddcoeff.isApprox(c_ref.dddcoeff, 1e-8)) << "t_ns " << t_ns;
+  }
+}
+
+TEST(SplineCeresTestSuite, NonUniformKnotTimesUniform) {
+  test_uniform_times<4>();
+  test_uniform_times<5>();
+  test_uniform_times<6>();
+}
+
+template <int N>
+void test_nonuniform_times() {
+  std::vector<int64_t> times_ns{0};
+  for (int i = 0; i < 10; i++) {
+    times_ns.emplace_back(times_ns.back() + 1e7 * (1 + (i * 7) % 5));
+  }
+
+  const NonUniformKnotTimes<N> knot_times(times_ns);
+
+  // Derivatives against central differences over h_ns.
+  const int64_t h_ns = 1e3;
+  const double h = 1e-9 * h_ns;
+
+  for (int64_t t_ns = h_ns; t_ns < knot_times.maxTimeNs() - h_ns;
+       t_ns += 7e5) {
+    const int64_t s = knot_times.segment(t_ns);
+    EXPECT_LE(knot_times.segmentStartNs(s), t_ns);
+    EXPECT_GT(knot_times.segmentStartNs(s + 1), t_ns);
+
+    // Stay in the segment, the derivatives jump at segment boundaries.
+    if (t_ns - h_ns < knot_times.segmentStartNs(s) ||
+        t_ns + h_ns >= knot_times.segmentStartNs(s + 1)) {
+      continue;
+    }
+
+    const SplineCoeffs<N> c = knot_times.coeffs(s, t_ns);
+    const SplineCoeffs<N> c_m = knot_times.coeffs(s, t_ns - h_ns);
+    const SplineCoeffs<N> c_p = knot_times.coeffs(s, t_ns + h_ns);
+
+    // The cumulative coefficient of the first knot is the partition of unity.
+    EXPECT_NEAR(c.coeff[0], 1, 1e-12);
+    EXPECT_NEAR(c.dcoeff[0], 0, 1e-9);
+
+    EXPECT_TRUE(c.dcoeff.isApprox((c_p.coeff - c_m.coeff) / (2 * h), 1e-5))
+        << "t_ns " << t_ns;
+    EXPECT_TRUE(c.ddcoeff.isApprox((c_p.dcoeff - c_m.dcoeff) / (2 * h), 1e-5))
+        << "t_ns " << t_ns;
+    EXPECT_TRUE(
+        c.dddcoeff.isApprox((c_p.ddcoeff - c_m.ddcoeff) / (2 * h), 1e-5))
+        << "t_ns " << t_ns;
+  }
+}
+
+TEST(SplineCeresTestSuite, NonUniformKnotTimesDerivatives) {
+  test_nonuniform_times<4>();
+  test_nonuniform_times<5>();
+  test_nonuniform_times<6>();
+}
+
+TEST(SplineCeresTestSuite, NonUniformSplineFitSE3) {
+  constexpr int N = 5;
+
+  const std::vector<int64_t> times_ns{0,         10000000,  20000000,
+                                      50000000,  130000000, 150000000,
+                                      160000000, 200000000};
+
+  CeresLieGroupSplineNonUniform<N, Sophus::SE3> gt(times_ns);
+  gt.initRandom();
+  for (size_t i = 1; i < gt.numKnots(); i++) {
+    gt.getKnot(i) = gt.getKnot(i - 1) *
+                    Sophus::SE3d::exp(0.2 * Sophus::Vector6d::Random());
+  }
+
+  CeresLieGroupSplineNonUniform<N, Sophus::SE3> spline(times_ns);
+  spline.init(Sophus::SE3d());
+
+  for (int64_t t_ns = 0; t_ns < spline.maxTimeNs(); t_ns += 1e6) {
+    spline.addMeasurement(gt.getValue(t_ns), t_ns);
+    spline.addVelMeasurement(gt.getVel(t_ns), t_ns);
+    spline.addAccelMeasurement(gt.getAccel(t_ns), t_ns);
+  }
+
+  spline.optimize();
+
+  for (int64_t t_ns = 0; t_ns < spline.maxTimeNs(); t_ns += 3e6) {
+    EXPECT_LT((gt.getValue(t_ns).inverse() * spline.getValue(t_ns))
+                  .log()
+                  .norm(),
+              1e-6)
+        << "t_ns " << t_ns;
+    EXPECT_TRUE(gt.getVel(t_ns).isApprox(spline.getVel(t_ns), 1e-6))
+        << "t_ns " << t_ns;
+  }
+}
+
+struct ImuSample {
+  int64_t timestamp_ns;
+  Eigen::Vector3d data;
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+TEST(SplineCeresTestSuite, KnotPlannerStaticPeriods) {
+  KnotPlannerOptions options;
+
+  // 200 Hz IMU: 2 s static, 1 s fast rotation, 2 s static.
+  const int64_t dt_imu_ns = 5e6;
+  const int64_t end_t_ns = 5e9;
+
+  Eigen::aligned_vector<ImuSample> gyro, accel;
+  for (int64_t t_ns = 0; t_ns <= end_t_ns; t_ns += dt_imu_ns) {
+    const bool moving = t_ns >= 2e9 && t_ns < 3e9;
+    gyro.push_back({t_ns, moving ? Eigen::Vector3d(0, 0, 3)
+                                 : Eigen::Vector3d::Zero()});
+    accel.push_back({t_ns, Eigen::Vector3d(0, 0, options.gravity_norm)});
+  }
+
+  const std::vector<int64_t> times_ns =
+      planKnotTimes(gyro, accel, 0, end_t_ns, options);
+
+  const NonUniformKnotTimes<4> knot_times(times_ns);
+  EXPECT_EQ(knot_times.minTimeNs(), 0);
+  EXPECT_GE(knot_times.maxTimeNs(), end_t_ns);
+
+  for (size_t s = 0; s < knot_times.numSegments(); s++) {
+    const int64_t start_ns = knot_times.segmentStartNs(s);
+    const int64_t dt_ns = knot_times.segmentStartNs(s + 1) - start_ns;
+
+    if (start_ns >= 2e9 && start_ns < 3e9) {
+      EXPECT_EQ(dt_ns, options.min_dt_ns) << "start_ns " << start_ns;
+    } else if (start_ns + options.max_dt_ns <= 2e9 ||
+               (start_ns >= 3e9 && start_ns + options.max_dt_ns <= end_t_ns)) {
+      EXPECT_EQ(dt_ns, options.max_dt_ns) << "start_ns " << start_ns;
+    }
+  }
+
+  // 100 segments for the motion and about 25 for the static periods, instead
+  // of 500 with uniform min_dt_ns.
+  EXPECT_LT(knot_times.numSegments(), 150u);
+}
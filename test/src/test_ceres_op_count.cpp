@@ -0,0 +1,104 @@
+#include <iostream>
+
+#include "gtest/gtest.h"
+
+#include <basalt/utils/eigen_utils.hpp>
+#include <ceres_op_count.h>
+#include <ceres_spline_helper_old.h>
+
+#include <sophus/se3.hpp>
+
+TEST(SplineCeresTestSuite, OpCountScalarCounts) {
+  OpCountScalar a(2), b(3), c(4);
+
+  OpCountScalar res;
+  OpCounts counts = countOps([&] { res = sqrt(a * b + c / 2.0 - 1.0); });
+
+  EXPECT_EQ(res.v, std::sqrt(2.0 * 3.0 + 4.0 / 2.0 - 1.0));
+  EXPECT_EQ(counts.mul, 1);
+  EXPECT_EQ(counts.add, 2);
+  EXPECT_EQ(counts.div, 1);
+  EXPECT_EQ(counts.func, 1);
+
+  // Negation and comparisons are free.
+  counts = countOps([&] { res = -a < b ? a : b; });
+  EXPECT_EQ(counts, OpCounts());
+}
+
+// Knots with the same non-zero difference between all neighbours, so every
+// segment takes the same branches in exp and log.
+template <int N, template <class> class GroupT>
+Eigen::aligned_vector<GroupT<OpCountScalar>> regular_knots() {
+  using Groupd = GroupT<double>;
+  using Tangentd = typename Groupd::Tangent;
+
+  Tangentd delta;
+  for (int i = 0; i < delta.size(); i++) delta[i] = 0.1 * (i + 1);
+
+  Eigen::aligned_vector<GroupT<OpCountScalar>> knots;
+  for (int i = 0; i < N; i++) {
+    knots.emplace_back(
+        Groupd::exp(double(i) * delta).template cast<OpCountScalar>());
+  }
+  return knots;
+}
+
+// Operations of evaluate_lie (recursive) and evaluate_lie_accel_old for the
+// value, velocity and acceleration of an order N spline.
+template <int N, template <class> class GroupT>
+std::pair<OpCounts, OpCounts> count_accel() {
+  using T = OpCountScalar;
+  using Group = GroupT<T>;
+  using Tangent = typename Group::Tangent;
+
+  const auto knots = regular_knots<N, GroupT>();
+  std::vector<const T*> vec;
+  for (const auto& k : knots) vec.emplace_back(k.data());
+
+  Group value1, value2;
+  Tangent vel1, vel2, accel1, accel2;
+
+  OpCounts recursive = countOps([&] {
+    CeresSplineHelper<N>::template evaluate_lie<T, GroupT>(
+        vec.data(), 0.3, 2.0, &value1, &vel1, &accel1);
+  });
+  OpCounts old = countOps([&] {
+    CeresSplineHelperOld<N>::template evaluate_lie_accel_old<T, GroupT>(
+        vec.data(), 0.3, 2.0, &value2, &vel2, &accel2);
+  });
+
+  // Both methods evaluate the same spline.
+  for (int i = 0; i < Group::num_parameters; i++) {
+    EXPECT_NEAR(value1.data()[i].v, value2.data()[i].v, 1e-10);
+  }
+  for (int i = 0; i < Group::DoF; i++) {
+    EXPECT_NEAR(vel1[i].v, vel2[i].v, 1e-10);
+    EXPECT_NEAR(accel1[i].v, accel2[i].v, 1e-10);
+  }
+
+  return {recursive, old};
+}
+
+template <template <class> class GroupT>
+void test_op_count_scaling() {
+  const auto c4 = count_accel<4, GroupT>();
+  const auto c5 = count_accel<5, GroupT>();
+  const auto c6 = count_accel<6, GroupT>();
+
+  // The recursion does the same work for each additional knot.
+  EXPECT_EQ(c5.first - c4.first, c6.first - c5.first);
+  EXPECT_GT(c4.first.mul, 0);
+
+  // The old method grows quadratically and needs more multiplications.
+  EXPECT_GT((c6.second - c5.second).mul, (c5.second - c4.second).mul);
+  EXPECT_LT(c4.first.mul, c4.second.mul);
+  EXPECT_LT(c6.first.mul, c6.second.mul);
+}
+
+TEST(SplineCeresTestSuite, OpCountScalingSO3) {
+  test_op_count_scaling<Sophus::SO3>();
+}
+
+TEST(SplineCeresTestSuite, OpCountScalingSE3) {
+  test_op_count_scaling<Sophus::SE3>();
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+
+#include "gtest/gtest.h"
+
+#include <ceres/ceres.h>
+
+#include <basalt/utils/eigen_utils.hpp>
+#include <ceres_lie_residuals.h>
+#include <ceres_segment_batch.h>
+
+// Evaluate the residuals and Jacobians of a batch and of the single sample
+// cost functions it contains and check that the batch stacks them in order.
+template <int N, template <class> class GroupT>
+void check_stacked(const ceres::CostFunction& batch,
+                   const std::vector<ceres::CostFunction*>& singles,
+                   const std::vector<const double*>& params) {
+  using Groupd = GroupT<double>;
+
+  constexpr int kNumJacobian = Groupd::DoF * Groupd::num_parameters;
+
+  const int num_residuals = batch.num_residuals();
+  ASSERT_EQ(num_residuals, int(singles.size()) * Groupd::DoF);
+
+  Eigen::VectorXd r_batch(num_residuals);
+  std::vector<Eigen::VectorXd> J_batch(
+      N, Eigen::VectorXd(num_residuals * Groupd::num_parameters));
+  std::vector<double*> J_batch_ptr;
+  for (auto& J : J_batch) J_batch_ptr.emplace_back(J.data());
+
+  ASSERT_TRUE(batch.Evaluate(params.data(), r_batch.data(),
+                             J_batch_ptr.data()));
+
+  for (size_t j = 0; j < singles.size(); j++) {
+    typename Groupd::Tangent r;
+    std::vector<Eigen::Matrix<double, kNumJacobian, 1>> J(N);
+    std::vector<double*> J_ptr;
+    for (auto& Ji : J) J_ptr.emplace_back(Ji.data());
+
+    ASSERT_TRUE(singles[j]->Evaluate(params.data(), r.data(), J_ptr.data()));
+
+    EXPECT_TRUE(r.isApprox(r_batch.segment<Groupd::DoF>(j * Groupd::DoF)));
+
+    for (int i = 0; i < N; i++) {
+      EXPECT_TRUE(
+          J[i].isApprox(J_batch[i].segment<kNumJacobian>(j * kNumJacobian)));
+    }
+  }
+}
+
+template <int N, template <class> class GroupT>
+void test_segment_batch() {
+  using Groupd = GroupT<double>;
+  using Tangentd = typename Groupd::Tangent;
+
+  using FunctorT = LieGroupSplineAccelerationCostFunctor<N, GroupT, false>;
+  using AnalyticT = LieGroupSplineAccelerationAnalyticCostFunction<N, GroupT>;
+  using Blocks = RepeatedBlockSizes<N, Groupd::num_parameters>;
+
+  const double inv_dt = 2.0;
+
+  Eigen::aligned_vector<Groupd> knots;
+  std::vector<const double*> params;
+  for (int i = 0; i < N; i++) {
+    knots.emplace_back(Groupd::exp(Tangentd::Random()));
+  }
+  for (const auto& k : knots) params.emplace_back(k.data());
+
+  SegmentBatchCostFunctor<FunctorT>* functor_batch =
+      new SegmentBatchCostFunctor<FunctorT>;
+  StackedCostFunction<Blocks> analytic_batch;
+
+  std::vector<std::unique_ptr<ceres::CostFunction>> singles, analytic_singles;
+
+  for (double u = 0.05; u < 1; u += 0.1) {
+    const Tangentd meas = Tangentd::Random();
+
+    functor_batch->add(FunctorT(meas, u, inv_dt));
+    singles.emplace_back(newAutoDiffCostFunction<Groupd::DoF>(
+        new FunctorT(meas, u, inv_dt), Blocks()));
+
+    analytic_batch.add(new AnalyticT(meas, u, inv_dt));
+    analytic_singles.emplace_back(new AnalyticT(meas, u, inv_dt));
+  }
+
+  const int num_residuals = functor_batch->numResiduals();
+  std::unique_ptr<ceres::CostFunction> autodiff_batch(
+      newAutoDiffCostFunction<ceres::DYNAMIC>(functor_batch, Blocks(),
+                                              num_residuals));
+
+  std::vector<ceres::CostFunction*> singles_ptr, analytic_singles_ptr;
+  for (const auto& c : singles) singles_ptr.emplace_back(c.get());
+  for (const auto& c : analytic_singles) {
+    analytic_singles_ptr.emplace_back(c.get());
+  }
+
+  check_stacked<N, GroupT>(*autodiff_batch, singles_ptr, params);
+  check_stacked<N, GroupT>(analytic_batch, analytic_singles_ptr, params);
+}
+
+TEST(SplineCeresTestSuite, SegmentBatchSO3_4) {
+  test_segment_batch<4, Sophus::SO3>();
+}
+
+TEST(SplineCeresTestSuite, SegmentBatchSE3_5) {
+  test_segment_batch<5, Sophus::SE3>();
+}
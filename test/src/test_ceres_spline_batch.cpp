@@ -0,0 +1,158 @@
+#include <iostream>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include <basalt/utils/eigen_utils.hpp>
+#include <ceres_calib_spline_se3.h>
+#include <ceres_calib_spline_split.h>
+#include <ceres_lie_spline.h>
+#include <ceres_spline_helper_simd.h>
+
+constexpr int N = 5;
+const int64_t dt_ns = 2e7;
+const int num_knots = 30;
+
+// Every segment boundary, samples in between and the last valid time. The
+// number of timestamps is odd, so it is not a multiple of the SIMD lanes, and
+// large enough for several TBB chunks of forEachSortedTime and
+// forEachSortedTimeLanes.
+std::vector<int64_t> batch_times(int64_t max_time_ns) {
+  std::vector<int64_t> times_ns;
+  for (int64_t t_ns = 0; t_ns <= max_time_ns; t_ns += dt_ns / 40) {
+    times_ns.emplace_back(t_ns);
+  }
+  times_ns.emplace_back(max_time_ns);
+
+  EXPECT_NE(times_ns.size() % (CeresSplineHelperSimd<N, double>::Lanes), 0u);
+  EXPECT_NE(times_ns.size() % (CeresSplineHelperSimd<N, float>::Lanes), 0u);
+  EXPECT_GT(times_ns.size(), 4 * 256u);
+
+  return times_ns;
+}
+
+template <class Derived1, class Derived2>
+void expect_near_rel(const Eigen::MatrixBase<Derived1>& a,
+                     const Eigen::MatrixBase<Derived2>& b, double tol,
+                     int64_t t_ns) {
+  EXPECT_LE((a - b).norm(), tol * std::max(1.0, a.norm()))
+      << "t_ns " << t_ns << "\n"
+      << a.transpose() << "\n"
+      << b.transpose();
+}
+
+template <template <class> class GroupT>
+void test_lie_batch(bool knot_delta_cache, bool float_queries, double tol) {
+  using Spline = CeresLieGroupSpline<N, GroupT>;
+  using Groupd = typename Spline::Groupd;
+  using Tangentd = typename Spline::Tangentd;
+
+  Spline spline(dt_ns);
+  spline.setKnotDeltaCache(knot_delta_cache);
+  spline.setFloatQueries(float_queries);
+  spline.initRandom(num_knots);
+  for (int i = 1; i < num_knots; i++) {
+    spline.setKnot(i, spline.getKnot(i - 1) *
+                          Groupd::exp(0.1 * Tangentd::Random()));
+  }
+
+  const std::vector<int64_t> times_ns = batch_times(spline.maxTimeNs());
+  const size_t n = times_ns.size();
+
+  Eigen::aligned_vector<Groupd> value(n);
+  Eigen::aligned_vector<Tangentd> vel(n), accel(n);
+  spline.evaluateBatch(times_ns.data(), n, value.data(), vel.data(),
+                       accel.data());
+
+  for (size_t i = 0; i < n; i++) {
+    const int64_t t_ns = times_ns[i];
+    EXPECT_LT((spline.getValue(t_ns).inverse() * value[i]).log().norm(), tol)
+        << "t_ns " << t_ns;
+    expect_near_rel(spline.getVel(t_ns), vel[i], tol, t_ns);
+    expect_near_rel(spline.getAccel(t_ns), accel[i], tol, t_ns);
+  }
+
+  // Outputs that are nullptr are skipped.
+  Eigen::aligned_vector<Tangentd> vel_only(n);
+  spline.evaluateBatch(times_ns.data(), n, nullptr, vel_only.data());
+  for (size_t i = 0; i < n; i++) {
+    EXPECT_EQ(vel_only[i], vel[i]) << "t_ns " << times_ns[i];
+  }
+}
+
+template <class Spline>
+void test_calib_batch(bool knot_delta_cache, bool float_queries, double tol) {
+  Spline spline(dt_ns);
+  spline.setKnotDeltaCache(knot_delta_cache);
+  spline.setFloatQueries(float_queries);
+  spline.init(Sophus::SE3d(), num_knots);
+  for (int i = 1; i < num_knots; i++) {
+    spline.setKnot(i, spline.getKnot(i - 1) *
+                          Sophus::SE3d::exp(0.1 * Sophus::Vector6d::Random()));
+  }
+
+  Eigen::Vector3d g(0, 0, -9.81);
+  spline.setG(g);
+
+  const std::vector<int64_t> times_ns = batch_times(spline.maxTimeNs());
+  const size_t n = times_ns.size();
+
+  Eigen::aligned_vector<Sophus::SE3d> pose(n);
+  Eigen::aligned_vector<Eigen::Vector3d> gyro(n), accel(n);
+  spline.evaluateBatch(times_ns.data(), n, pose.data(), gyro.data(),
+                       accel.data());
+
+  for (size_t i = 0; i < n; i++) {
+    const int64_t t_ns = times_ns[i];
+    EXPECT_LT((spline.getPose(t_ns).inverse() * pose[i]).log().norm(), tol)
+        << "t_ns " << t_ns;
+    expect_near_rel(spline.getGyro(t_ns), gyro[i], tol, t_ns);
+    expect_near_rel(spline.getAccel(t_ns), accel[i], tol, t_ns);
+  }
+
+  // Outputs that are nullptr are skipped.
+  Eigen::aligned_vector<Eigen::Vector3d> accel_only(n);
+  spline.evaluateBatch(times_ns.data(), n, nullptr, nullptr,
+                       accel_only.data());
+  for (size_t i = 0; i < n; i++) {
+    EXPECT_EQ(accel_only[i], accel[i]) << "t_ns " << times_ns[i];
+  }
+}
+
+TEST(SplineCeresTestSuite, EvaluateBatchSO3) {
+  test_lie_batch<Sophus::SO3>(false, false, 1e-10);
+}
+
+TEST(SplineCeresTestSuite, EvaluateBatchSE3) {
+  test_lie_batch<Sophus::SE3>(false, false, 1e-10);
+}
+
+TEST(SplineCeresTestSuite, EvaluateBatchCalibSplit) {
+  test_calib_batch<CeresCalibrationSplineSplit<N>>(false, false, 1e-10);
+}
+
+TEST(SplineCeresTestSuite, EvaluateBatchCalibSE3) {
+  test_calib_batch<CeresCalibrationSplineSe3<N>>(false, false, 1e-10);
+}
+
+// With the knot delta cache or float queries evaluateBatch takes the
+// CeresSplineHelperSimd path with padded lanes.
+TEST(SplineCeresTestSuite, EvaluateBatchSimdSO3) {
+  test_lie_batch<Sophus::SO3>(true, false, 1e-10);
+  test_lie_batch<Sophus::SO3>(false, true, 1e-5);
+}
+
+TEST(SplineCeresTestSuite, EvaluateBatchSimdSE3) {
+  test_lie_batch<Sophus::SE3>(true, false, 1e-10);
+  test_lie_batch<Sophus::SE3>(false, true, 1e-5);
+}
+
+TEST(SplineCeresTestSuite, EvaluateBatchSimdCalibSplit) {
+  test_calib_batch<CeresCalibrationSplineSplit<N>>(true, false, 1e-10);
+  test_calib_batch<CeresCalibrationSplineSplit<N>>(false, true, 1e-5);
+}
+
+TEST(SplineCeresTestSuite, EvaluateBatchSimdCalibSE3) {
+  test_calib_batch<CeresCalibrationSplineSe3<N>>(true, false, 1e-10);
+  test_calib_batch<CeresCalibrationSplineSe3<N>>(false, true, 1e-5);
+}
@@ -0,0 +1,232 @@
+#include <iostream>
+
+#include "gtest/gtest.h"
+
+#include <ceres/ceres.h>
+
+#include <basalt/utils/eigen_utils.hpp>
+#include <ceres_lie_residuals.h>
+#include <ceres_spline_coeff_table.h>
+
+// Residuals and Jacobians of two cost functions for the same parameters.
+template <int kNumResiduals, int kBlockSize>
+void expect_same_evaluation(const ceres::CostFunction& a,
+                            const ceres::CostFunction& b,
+                            const std::vector<const double*>& params) {
+  using Residual = Eigen::Matrix<double, kNumResiduals, 1>;
+  using Jacobian = Eigen::Matrix<double, kNumResiduals * kBlockSize, 1>;
+
+  const size_t n = params.size();
+
+  Residual r_a, r_b;
+  std::vector<Jacobian> J_a(n), J_b(n);
+  std::vector<double*> J_a_ptr, J_b_ptr;
+  for (size_t i = 0; i < n; i++) {
+    J_a_ptr.emplace_back(J_a[i].data());
+    J_b_ptr.emplace_back(J_b[i].data());
+  }
+
+  ASSERT_TRUE(a.Evaluate(params.data(), r_a.data(), J_a_ptr.data()));
+  ASSERT_TRUE(b.Evaluate(params.data(), r_b.data(), J_b_ptr.data()));
+
+  EXPECT_TRUE(r_a.isApprox(r_b)) << r_a.transpose() << "\n" << r_b.transpose();
+  for (size_t i = 0; i < n; i++) {
+    EXPECT_TRUE(J_a[i].isApprox(J_b[i])) << "block " << i;
+  }
+}
+
+template <int N>
+void test_table_rows() {
+  const int64_t dt_ns = 1e7;
+  const int64_t imu_dt_ns = 5e6;
+
+  SplineCoeffTable<N> table(dt_ns);
+
+  // A 200 Hz IMU on a 10 ms spline only has two offsets in a segment.
+  std::vector<const SplineCoeffs<N>*> rows;
+  for (int64_t t_ns = 1234; t_ns < 1e9; t_ns += imu_dt_ns) {
+    rows.emplace_back(table.row(t_ns % dt_ns));
+  }
+
+  EXPECT_EQ(table.size(), 2u);
+  EXPECT_EQ(rows[0], rows[2]);
+  EXPECT_EQ(rows[1], rows[3]);
+  EXPECT_NE(rows[0], rows[1]);
+  EXPECT_EQ(table.find(1234), rows[0]);
+  EXPECT_EQ(table.find(1235), nullptr);
+
+  // The row matches the coefficients computed from u.
+  const double u = 1234.0 / dt_ns;
+  const SplineCoeffs<N> coeffs(u, 1e9 / dt_ns);
+  EXPECT_EQ(rows[0]->coeff, coeffs.coeff);
+  EXPECT_EQ(rows[0]->dcoeff, coeffs.dcoeff);
+  EXPECT_EQ(rows[0]->ddcoeff, coeffs.ddcoeff);
+  EXPECT_EQ(rows[0]->dddcoeff, coeffs.dddcoeff);
+
+  // Irregular timestamps fall back once the table is full.
+  SplineCoeffTable<N> small_table(dt_ns, 3);
+  EXPECT_NE(small_table.row(1), nullptr);
+  EXPECT_NE(small_table.row(2), nullptr);
+  EXPECT_NE(small_table.row(3), nullptr);
+  EXPECT_EQ(small_table.row(4), nullptr);
+  EXPECT_NE(small_table.row(2), nullptr);
+}
+
+TEST(SplineCeresTestSuite, SplineCoeffTableRows) {
+  test_table_rows<4>();
+  test_table_rows<5>();
+  test_table_rows<6>();
+}
+
+template <int N, int DERIV>
+void test_euclidean_evaluate() {
+  const double inv_dt = 3.0;
+
+  Eigen::aligned_vector<Eigen::Vector3d> knots;
+  std::vector<const double*> params;
+  for (int i = 0; i < N; i++) knots.emplace_back(Eigen::Vector3d::Random());
+  for (const auto& k : knots) params.emplace_back(k.data());
+
+  for (double u = 0; u < 1; u += 0.05) {
+    Eigen::Vector3d res1, res2;
+
+    CeresSplineHelper<N>::template evaluate<double, 3, DERIV>(
+        params.data(), u, inv_dt, &res1);
+
+    SplineCoeffs<N> coeffs(u, inv_dt);
+    coeffs.template evaluate<double, 3, DERIV>(params.data(), &res2);
+
+    EXPECT_TRUE(res1.isApprox(res2, 1e-12) ||
+                (res1 - res2).norm() < 1e-12)
+        << "u " << u << "\n"
+        << res1.transpose() << "\n"
+        << res2.transpose();
+  }
+}
+
+TEST(SplineCeresTestSuite, SplineCoeffsEuclideanEvaluate) {
+  test_euclidean_evaluate<4, 0>();
+  test_euclidean_evaluate<4, 1>();
+  test_euclidean_evaluate<4, 2>();
+  test_euclidean_evaluate<5, 0>();
+  test_euclidean_evaluate<5, 2>();
+  test_euclidean_evaluate<6, 0>();
+  test_euclidean_evaluate<6, 2>();
+  test_euclidean_evaluate<8, 1>();
+}
+
+template <int N>
+void test_blending_polynomials() {
+  using Helper = CeresSplineHelper<N>;
+  const double inv_dt = 3.0;
+
+  for (double u = 0; u < 1; u += 0.05) {
+    const SplineCoeffs<N> coeffs(u, inv_dt);
+
+    for (int d = 0; d <= 3 && d < N; d++) {
+      typename Helper::VecN p;
+      if (d == 0) Helper::template baseCoeffsWithTime<0>(p, u);
+      if (d == 1) Helper::template baseCoeffsWithTime<1>(p, u);
+      if (d == 2) Helper::template baseCoeffsWithTime<2>(p, u);
+      if (d == 3) Helper::template baseCoeffsWithTime<3>(p, u);
+
+      const typename Helper::VecN expected =
+          std::pow(inv_dt, d) * Helper::cumulative_blending_matrix_ * p;
+
+      const typename Helper::VecN& c = d == 0   ? coeffs.coeff
+                                       : d == 1 ? coeffs.dcoeff
+                                       : d == 2 ? coeffs.ddcoeff
+                                                : coeffs.dddcoeff;
+
+      EXPECT_LT((c - expected).norm(), 1e-12 * (1 + expected.norm()))
+          << "N " << N << " d " << d << " u " << u << "\n"
+          << c.transpose() << "\n"
+          << expected.transpose();
+    }
+  }
+}
+
+TEST(SplineCeresTestSuite, SplineBlendingPolynomials) {
+  test_blending_polynomials<2>();
+  test_blending_polynomials<3>();
+  test_blending_polynomials<4>();
+  test_blending_polynomials<5>();
+  test_blending_polynomials<6>();
+  test_blending_polynomials<7>();
+  test_blending_polynomials<8>();
+}
+
+template <int N, template <class> class GroupT>
+void test_residuals_with_table() {
+  using Groupd = GroupT<double>;
+  using Tangentd = typename Groupd::Tangent;
+
+  using Blocks = RepeatedBlockSizes<N, Groupd::num_parameters>;
+
+  constexpr int DoF = Groupd::DoF;
+  constexpr int kBlockSize = Groupd::num_parameters;
+
+  const int64_t dt_ns = 2e8;
+  const double inv_dt = 1e9 / dt_ns;
+
+  Eigen::aligned_vector<Groupd> knots;
+  std::vector<const double*> params;
+  for (int i = 0; i < N; i++) {
+    knots.emplace_back(Groupd::exp(Tangentd::Random()));
+  }
+  for (const auto& k : knots) params.emplace_back(k.data());
+
+  SplineCoeffTable<N> table(dt_ns);
+
+  for (int64_t offset_ns = 0; offset_ns < dt_ns; offset_ns += 1e7) {
+    const double u = double(offset_ns) / double(dt_ns);
+    const SplineCoeffs<N>* coeffs = table.row(offset_ns);
+
+    const Groupd meas_value = Groupd::exp(0.1 * Tangentd::Random()) * knots[1];
+    const Tangentd meas = Tangentd::Random();
+
+    {
+      using FunctorT = LieGroupSplineValueCostFunctor<N, GroupT>;
+      std::unique_ptr<ceres::CostFunction> a(newAutoDiffCostFunction<DoF>(
+          new FunctorT(meas_value, u), Blocks()));
+      std::unique_ptr<ceres::CostFunction> b(newAutoDiffCostFunction<DoF>(
+          new FunctorT(meas_value, u, coeffs), Blocks()));
+      expect_same_evaluation<DoF, kBlockSize>(*a, *b, params);
+    }
+    {
+      using FunctorT = LieGroupSplineVelocityCostFunctor<N, GroupT, false>;
+      std::unique_ptr<ceres::CostFunction> a(newAutoDiffCostFunction<DoF>(
+          new FunctorT(meas, u, inv_dt, 2.0), Blocks()));
+      std::unique_ptr<ceres::CostFunction> b(newAutoDiffCostFunction<DoF>(
+          new FunctorT(meas, u, inv_dt, 2.0, coeffs), Blocks()));
+      expect_same_evaluation<DoF, kBlockSize>(*a, *b, params);
+    }
+    {
+      using FunctorT = LieGroupSplineAccelerationCostFunctor<N, GroupT, false>;
+      std::unique_ptr<ceres::CostFunction> a(newAutoDiffCostFunction<DoF>(
+          new FunctorT(meas, u, inv_dt), Blocks()));
+      std::unique_ptr<ceres::CostFunction> b(newAutoDiffCostFunction<DoF>(
+          new FunctorT(meas, u, inv_dt, coeffs), Blocks()));
+      expect_same_evaluation<DoF, kBlockSize>(*a, *b, params);
+    }
+    {
+      using CostT = LieGroupSplineAccelerationAnalyticCostFunction<N, GroupT>;
+      CostT a(meas, u, inv_dt), b(meas, u, inv_dt, coeffs);
+      expect_same_evaluation<DoF, kBlockSize>(a, b, params);
+    }
+  }
+
+  EXPECT_EQ(table.size(), 20u);
+}
+
+TEST(SplineCeresTestSuite, SplineCoeffTableResidualsSO3) {
+  test_residuals_with_table<4, Sophus::SO3>();
+  test_residuals_with_table<5, Sophus::SO3>();
+  test_residuals_with_table<6, Sophus::SO3>();
+}
+
+TEST(SplineCeresTestSuite, SplineCoeffTableResidualsSE3) {
+  test_residuals_with_table<4, Sophus::SE3>();
+  test_residuals_with_table<5, Sophus::SE3>();
+  test_residuals_with_table<6, Sophus::SE3>();
+}
@@ -0,0 +1,217 @@
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include <basalt/utils/eigen_utils.hpp>
+#include <ceres_lie_spline.h>
+#include <ceres_spline_file.h>
+
+template <int N, template <class> class GroupT>
+void test_save_and_map(const std::string& path) {
+  using Groupd = GroupT<double>;
+  using Tangentd = typename Groupd::Tangent;
+
+  const int64_t dt_ns = 2e7;
+  const int64_t start_t_ns = 1e9;
+  const int num_knots = 50;
+
+  CeresLieGroupSpline<N, GroupT> spline(dt_ns, start_t_ns);
+  spline.initRandom(num_knots);
+  for (int i = 1; i < num_knots; i++) {
+    spline.setKnot(i,
+                   spline.getKnot(i - 1) * Groupd::exp(0.1 * Tangentd::Random()));
+  }
+
+  ASSERT_TRUE(spline.save(path));
+
+  MappedSpline<N> mapped;
+  ASSERT_TRUE(mapped.open(path));
+
+  EXPECT_EQ(mapped.numKnots(), size_t(num_knots));
+  EXPECT_EQ(mapped.minTimeNs(), spline.minTimeNs());
+  EXPECT_EQ(mapped.maxTimeNs(), spline.maxTimeNs());
+  EXPECT_FALSE(mapped.hasCalib());
+
+  // The knots are in the file as they are in memory.
+  for (int i = 0; i < num_knots; i++) {
+    EXPECT_EQ(Eigen::Map<const Groupd>(mapped.knot(i)).params(),
+              spline.getKnot(i).params());
+  }
+
+  for (int64_t t_ns = spline.minTimeNs(); t_ns < spline.maxTimeNs();
+       t_ns += 3e6) {
+    const Sophus::SE3d pose = mapped.getPose(t_ns);
+    const Eigen::Vector3d rot_vel = mapped.getRotVel(t_ns);
+
+    if constexpr (Groupd::DoF == 3) {
+      EXPECT_TRUE(pose.so3().matrix().isApprox(spline.getValue(t_ns).matrix()));
+      EXPECT_TRUE(pose.translation().isZero());
+      EXPECT_TRUE(rot_vel.isApprox(spline.getVel(t_ns)));
+    } else {
+      EXPECT_TRUE(pose.matrix().isApprox(spline.getValue(t_ns).matrix()));
+      EXPECT_TRUE(rot_vel.isApprox(spline.getVel(t_ns).template tail<3>()));
+    }
+  }
+
+  // Wrong order.
+  MappedSpline<N + 1> mapped_wrong;
+  EXPECT_FALSE(mapped_wrong.open(path));
+}
+
+TEST(SplineCeresTestSuite, SplineFileSO3) {
+  test_save_and_map<5, Sophus::SO3>(testing::TempDir() + "spline_so3.spline");
+}
+
+TEST(SplineCeresTestSuite, SplineFileSE3) {
+  test_save_and_map<5, Sophus::SE3>(testing::TempDir() + "spline_se3.spline");
+}
+
+TEST(SplineCeresTestSuite, SplineFileSplitCalib) {
+  constexpr int N = 4;
+  const std::string path = testing::TempDir() + "spline_split.spline";
+
+  const int64_t dt_ns = 1e7;
+  const size_t num_knots = 20;
+
+  Eigen::aligned_vector<Sophus::SO3d> so3_knots;
+  Eigen::aligned_vector<Eigen::Vector3d> trans_knots;
+  for (size_t i = 0; i < num_knots; i++) {
+    so3_knots.emplace_back(Sophus::SO3d::exp(Eigen::Vector3d::Random()));
+    trans_knots.emplace_back(Eigen::Vector3d::Random());
+  }
+
+  SplineFileCalib calib;
+  calib.calib.T_i_c.emplace_back(Sophus::SE3d::exp(Sophus::Vector6d::Random()));
+  calib.g = Eigen::Vector3d(0, 0, -9.81);
+  calib.accel_bias = Eigen::Vector3d::Random();
+  calib.gyro_bias = Eigen::Vector3d::Random();
+
+  ASSERT_TRUE(writeSplineFile(
+      path, SplineFileGroup::SPLIT, N, 0, dt_ns, num_knots,
+      [&](size_t i, double* params) {
+        Eigen::Map<Sophus::SO3d>{params} = so3_knots[i];
+        Eigen::Map<Eigen::Vector3d>{params + 4} = trans_knots[i];
+      },
+      &calib));
+
+  MappedSpline<N> mapped;
+  ASSERT_TRUE(mapped.open(path));
+  EXPECT_EQ(mapped.group(), SplineFileGroup::SPLIT);
+
+  SplineFileCalib loaded;
+  ASSERT_TRUE(mapped.getCalib(&loaded));
+  ASSERT_EQ(loaded.calib.T_i_c.size(), 1u);
+  EXPECT_TRUE(loaded.calib.T_i_c[0].matrix().isApprox(
+      calib.calib.T_i_c[0].matrix()));
+  EXPECT_EQ(loaded.g, calib.g);
+  EXPECT_EQ(loaded.accel_bias, calib.accel_bias);
+  EXPECT_EQ(loaded.gyro_bias, calib.gyro_bias);
+
+  // Rotation and translation are separate splines.
+  const int64_t t_ns = 5 * dt_ns + dt_ns / 3;
+  const double u = double(dt_ns / 3) / dt_ns;
+  const double inv_dt = 1e9 / dt_ns;
+
+  std::vector<const double*> rot, trans;
+  for (int i = 0; i < N; i++) {
+    rot.emplace_back(so3_knots[5 + i].data());
+    trans.emplace_back(trans_knots[5 + i].data());
+  }
+
+  Sophus::SO3d rot_ref;
+  Eigen::Vector3d trans_ref;
+  CeresSplineHelper<N>::template evaluate_lie<double, Sophus::SO3>(
+      rot.data(), u, inv_dt, &rot_ref);
+  CeresSplineHelper<N>::template evaluate<double, 3, 0>(trans.data(), u,
+                                                        inv_dt, &trans_ref);
+
+  const Sophus::SE3d pose = mapped.getPose(t_ns);
+  EXPECT_TRUE(pose.so3().matrix().isApprox(rot_ref.matrix()));
+  EXPECT_TRUE(pose.translation().isApprox(trans_ref));
+}
+
+TEST(SplineCeresTestSuite, SplineFileInvalid) {
+  const std::string path = testing::TempDir() + "spline_invalid.spline";
+  {
+    std::ofstream os(path, std::ios::binary);
+    os << std::string(4096, 'x');
+  }
+
+  MappedSpline<4> mapped;
+  EXPECT_FALSE(mapped.open(path));
+  EXPECT_FALSE(mapped.open(path + ".missing"));
+}
+
+TEST(SplineCeresTestSuite, SplineFileCorruptedHeader) {
+  constexpr int N = 4;
+  const std::string path = testing::TempDir() + "spline_valid.spline";
+  ASSERT_TRUE(writeSplineFile(path, SplineFileGroup::SO3, N, 0, 1e7, 20,
+                              [](size_t, double* params) {
+                                Eigen::Map<Sophus::SO3d>{params} =
+                                    Sophus::SO3d();
+                              }));
+
+  std::string data;
+  {
+    std::ifstream is(path, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(is), {});
+  }
+
+  MappedSpline<N> mapped;
+  ASSERT_TRUE(mapped.open(path));
+
+  // Replace header fields of a copy of the file and open it.
+  const std::string corrupted_path =
+      testing::TempDir() + "spline_corrupted.spline";
+  auto corrupt = [](std::string corrupted, size_t offset, auto value) {
+    std::memcpy(&corrupted[offset], &value, sizeof(value));
+    return corrupted;
+  };
+  auto open_data = [&](const std::string& corrupted) {
+    {
+      std::ofstream os(corrupted_path, std::ios::binary);
+      os << corrupted;
+    }
+    return mapped.open(corrupted_path);
+  };
+  auto open_corrupted = [&](size_t offset, auto value) {
+    return open_data(corrupt(data, offset, value));
+  };
+
+  SplineFileHeader header;
+  std::memcpy(&header, data.data(), sizeof(header));
+
+  const uint64_t max = std::numeric_limits<uint64_t>::max();
+
+  EXPECT_FALSE(open_corrupted(offsetof(SplineFileHeader, dt_ns), int64_t(0)));
+  EXPECT_FALSE(
+      open_corrupted(offsetof(SplineFileHeader, dt_ns), int64_t(-1e7)));
+
+  // Unknown group with the knot size of SE3.
+  EXPECT_FALSE(open_data(
+      corrupt(corrupt(data, offsetof(SplineFileHeader, group), uint32_t(3)),
+              offsetof(SplineFileHeader, knot_size), uint32_t(7))));
+
+  // Misaligned and overlapping the header.
+  EXPECT_FALSE(open_corrupted(offsetof(SplineFileHeader, knots_offset),
+                              header.knots_offset - 4));
+  EXPECT_FALSE(
+      open_corrupted(offsetof(SplineFileHeader, knots_offset), uint64_t(0)));
+
+  // Sizes that wrap around to a small number of bytes: 32 bytes per knot.
+  EXPECT_FALSE(open_corrupted(offsetof(SplineFileHeader, num_knots),
+                              (uint64_t(1) << 59) + 20));
+  EXPECT_FALSE(
+      open_corrupted(offsetof(SplineFileHeader, calib_size), max - 100));
+  EXPECT_FALSE(
+      open_corrupted(offsetof(SplineFileHeader, calib_offset), max - 100));
+
+  // The unmodified header is still accepted.
+  EXPECT_TRUE(open_corrupted(offsetof(SplineFileHeader, dt_ns), int64_t(1e7)));
+}
@@ -0,0 +1,144 @@
+#include <iostream>
+
+#include "gtest/gtest.h"
+
+#include <basalt/utils/eigen_utils.hpp>
+#include <ceres_spline_helper_group.h>
+
+template <int N, template <class> class GroupT>
+void test_ceres_spline_helper_group(double scale) {
+  using Groupd = GroupT<double>;
+  using Tangentd = typename Groupd::Tangent;
+
+  static const int64_t dt_ns = 2e9;
+  double inv_dt = 1e9 / dt_ns;
+
+  Eigen::aligned_vector<Groupd> knots;
+
+  Groupd pose;
+  for (int i = 0; i < 3 * N; i++) {
+    pose *= Groupd::exp(scale * Tangentd::Random());
+    knots.emplace_back(pose);
+
+    // q and -q are the same rotation, both have to be handled.
+    if (i % 2) Eigen::Map<Eigen::Vector4d>(knots.back().data()) *= -1;
+  }
+
+  for (int i = 0; i < 2 * N; i++)
+    for (double u = 0; u < 1; u += 0.01) {
+      std::vector<const double*> vec;
+      for (int j = 0; j < N; j++) {
+        vec.emplace_back(knots[i + j].data());
+      }
+
+      Groupd pos1, pos2;
+      Tangentd vel1, accel1, vel2, accel2, vel3, accel3;
+
+      CeresSplineHelper<N>::template evaluate_lie<double, GroupT>(
+          &vec[0], u, inv_dt, &pos1, &vel1, &accel1);
+
+      CeresSplineHelperGroup<N>::template evaluate_lie<
+          LIE_VALUE | LIE_VEL | LIE_ACCEL, double, GroupT>(
+          &vec[0], u, inv_dt, &pos2, &vel2, &accel2);
+
+      CeresSplineHelperGroup<N>::template evaluate_lie<LIE_VEL, double,
+                                                       GroupT>(
+          &vec[0], u, inv_dt, nullptr, &vel3);
+
+      CeresSplineHelperGroup<N>::template evaluate_lie<LIE_ACCEL, double,
+                                                       GroupT>(
+          &vec[0], u, inv_dt, nullptr, nullptr, &accel3);
+
+      EXPECT_TRUE(pos1.matrix().isApprox(pos2.matrix()));
+      EXPECT_TRUE(vel1.isApprox(vel2, 1e-10));
+      EXPECT_TRUE(accel1.isApprox(accel2, 1e-10));
+      EXPECT_TRUE(vel1.isApprox(vel3, 1e-10));
+      EXPECT_TRUE(accel1.isApprox(accel3, 1e-10));
+    }
+}
+
+TEST(SplineCeresTestSuite, CeresSplineHelperGroupSO3_4) {
+  test_ceres_spline_helper_group<4, Sophus::SO3>(1.0);
+}
+
+TEST(SplineCeresTestSuite, CeresSplineHelperGroupSO3_5) {
+  test_ceres_spline_helper_group<5, Sophus::SO3>(1.0);
+}
+
+TEST(SplineCeresTestSuite, CeresSplineHelperGroupSO3_6) {
+  test_ceres_spline_helper_group<6, Sophus::SO3>(1.0);
+}
+
+TEST(SplineCeresTestSuite, CeresSplineHelperGroupSE3_4) {
+  test_ceres_spline_helper_group<4, Sophus::SE3>(1.0);
+}
+
+TEST(SplineCeresTestSuite, CeresSplineHelperGroupSE3_5) {
+  test_ceres_spline_helper_group<5, Sophus::SE3>(1.0);
+}
+
+TEST(SplineCeresTestSuite, CeresSplineHelperGroupSE3_6) {
+  test_ceres_spline_helper_group<6, Sophus::SE3>(1.0);
+}
+
+TEST(SplineCeresTestSuite, CeresSplineHelperGroupSmallAngleSO3) {
+  test_ceres_spline_helper_group<4, Sophus::SO3>(1e-3);
+}
+
+TEST(SplineCeresTestSuite, CeresSplineHelperGroupSmallAngleSE3) {
+  test_ceres_spline_helper_group<4, Sophus::SE3>(1e-3);
+}
+
+TEST(SplineCeresTestSuite, CeresSplineHelperGroupLinearAccelSE3) {
+  using Helper = CeresSplineHelperGroup<5>;
+
+  const double inv_dt = 2.0;
+
+  Eigen::aligned_vector<Sophus::SE3d> knots;
+  std::vector<const double*> vec;
+  for (int i = 0; i < 5; i++) {
+    knots.emplace_back(Sophus::SE3d::exp(Sophus::Vector6d::Random()));
+  }
+  for (const auto& k : knots) vec.emplace_back(k.data());
+
+  for (double u = 0.1; u < 0.9; u += 0.1) {
+    Sophus::SE3d T_w_i;
+    Sophus::Vector6d vel, accel;
+    Helper::evaluate_lie<LIE_VALUE | LIE_VEL | LIE_ACCEL, double,
+                         Sophus::SE3>(vec.data(), u, inv_dt, &T_w_i, &vel,
+                                      &accel);
+
+    // Translation column of T_w_i * (hat(vel)^2 + hat(accel)).
+    Eigen::Matrix4d vel_hat = Sophus::SE3d::hat(vel);
+    Eigen::Matrix4d accel_hat = Sophus::SE3d::hat(accel);
+    Eigen::Vector3d accel_w_ref =
+        (T_w_i.matrix() * (vel_hat * vel_hat + accel_hat))
+            .col(3)
+            .head<3>();
+
+    Eigen::Vector3d accel_w = Helper::linear_accel_world(T_w_i, vel, accel);
+    Eigen::Vector3d accel_i = Helper::linear_accel_body(vel, accel);
+
+    EXPECT_TRUE(accel_w.isApprox(accel_w_ref)) << accel_w.transpose() << "\n"
+                                               << accel_w_ref.transpose();
+    EXPECT_TRUE(accel_i.isApprox(T_w_i.so3().inverse() * accel_w_ref));
+
+    // Central difference of the translation.
+    const double du = 1e-4;
+    Sophus::SE3d T_prev, T_next;
+    Helper::evaluate_lie<LIE_VALUE, double, Sophus::SE3>(vec.data(), u - du,
+                                                         inv_dt, &T_prev);
+    Helper::evaluate_lie<LIE_VALUE, double, Sophus::SE3>(vec.data(), u + du,
+                                                         inv_dt, &T_next);
+
+    const double dt = du / inv_dt;
+    Eigen::Vector3d accel_w_num = (T_next.translation() -
+                                   2 * T_w_i.translation() +
+                                   T_prev.translation()) /
+                                  (dt * dt);
+
+    EXPECT_TRUE(accel_w.isApprox(accel_w_num, 1e-4))
+        << accel_w.transpose() << "\n"
+        << accel_w_num.transpose();
+  }
+}
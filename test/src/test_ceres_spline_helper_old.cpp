@@ -113,6 +113,14 @@ TEST(SplineCeresTestSuite, CeresSplineHelperOldSO3_6) {
   test_ceres_spline_helper_old_so3<6>();
 }
 
+TEST(SplineCeresTestSuite, CeresSplineHelperOldSO3_7) {
+  test_ceres_spline_helper_old_so3<7>();
+}
+
+TEST(SplineCeresTestSuite, CeresSplineHelperOldSO3_8) {
+  test_ceres_spline_helper_old_so3<8>();
+}
+
 TEST(SplineCeresTestSuite, CeresSplineHelperOldSE3_4) {
   test_ceres_spline_helper_old_se3<4>();
 }
@@ -124,3 +132,11 @@ TEST(SplineCeresTestSuite, CeresSplineHelperOldSE3_5) {
 TEST(SplineCeresTestSuite, CeresSplineHelperOldSE3_6) {
   test_ceres_spline_helper_old_se3<6>();
 }
+
+TEST(SplineCeresTestSuite, CeresSplineHelperOldSE3_7) {
+  test_ceres_spline_helper_old_se3<7>();
+}
+
+TEST(SplineCeresTestSuite, CeresSplineHelperOldSE3_8) {
+  test_ceres_spline_helper_old_se3<8>();
+}
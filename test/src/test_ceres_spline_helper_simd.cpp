@@ -0,0 +1,113 @@
+
+#include <iostream>
+
+#include "gtest/gtest.h"
+
+#include <ceres_spline_helper_simd.h>
+
+template <int N, template <class> class GroupT, class Scalar = double>
+void test_ceres_spline_helper_simd() {
+  using Groupd = GroupT<double>;
+  using Tangentd = typename Groupd::Tangent;
+
+  using Simd = CeresSplineHelperSimd<N, Scalar>;
+  constexpr int Lanes = Simd::Lanes;
+
+  // Float evaluation is compared to the double reference at the same u.
+  const double prec = std::is_same<Scalar, float>::value
+                          ? 1e-5
+                          : Eigen::NumTraits<double>::dummy_precision();
+
+  static const int64_t dt_ns = 2e9;
+  double inv_dt = 1e9 / dt_ns;
+
+  const int num_knots = 3 * N;
+
+  Eigen::aligned_vector<Groupd> knots;
+  Eigen::aligned_vector<Tangentd> deltas;
+
+  for (int i = 0; i < num_knots; i++) {
+    knots.emplace_back(Groupd::exp(Tangentd::Random()));
+  }
+  for (int i = 0; i < num_knots - 1; i++) {
+    deltas.emplace_back((knots[i].inverse() * knots[i + 1]).log());
+  }
+
+  typename Simd::template SoA<GroupT> soa;
+  soa.update(knots, deltas.data());
+
+  for (int iter = 0; iter < 100; iter++) {
+    int64_t s[Lanes];
+    typename Simd::Arr u;
+
+    for (int l = 0; l < Lanes; l++) {
+      s[l] = std::rand() % (num_knots - N + 1);
+      u[l] = double(std::rand()) / RAND_MAX;
+    }
+
+    typename Simd::template ValueArr<GroupT> value;
+    typename Simd::template TangentArr<GroupT> vel, accel;
+
+    Simd::template evaluate_lie<GroupT>(soa, s, u, inv_dt, &value, &vel,
+                                        &accel);
+
+    for (int l = 0; l < Lanes; l++) {
+      std::vector<const double*> vec;
+      for (int j = 0; j < N; j++) {
+        vec.emplace_back(knots[s[l] + j].data());
+      }
+
+      Groupd pos1;
+      Tangentd vel1, accel1;
+
+      CeresSplineHelper<N>::template evaluate_lie<double, GroupT>(
+          &vec[0], u[l], inv_dt, &pos1, &vel1, &accel1);
+
+      Eigen::Matrix<double, Groupd::num_parameters, 1> params =
+          value.row(l).transpose().template cast<double>();
+      Groupd pos2 = Eigen::Map<Groupd const>(params.data());
+      Tangentd vel2 = vel.row(l).transpose().template cast<double>();
+      Tangentd accel2 = accel.row(l).transpose().template cast<double>();
+
+      EXPECT_TRUE(pos1.matrix().isApprox(pos2.matrix(), prec));
+      EXPECT_TRUE(vel1.isApprox(vel2, prec));
+      EXPECT_TRUE(accel1.isApprox(accel2, prec));
+    }
+  }
+}
+
+TEST(SplineCeresTestSuite, CeresSplineHelperSimdSO3_4) {
+  test_ceres_spline_helper_simd<4, Sophus::SO3>();
+}
+
+TEST(SplineCeresTestSuite, CeresSplineHelperSimdSO3_5) {
+  test_ceres_spline_helper_simd<5, Sophus::SO3>();
+}
+
+TEST(SplineCeresTestSuite, CeresSplineHelperSimdSO3_6) {
+  test_ceres_spline_helper_simd<6, Sophus::SO3>();
+}
+
+TEST(SplineCeresTestSuite, CeresSplineHelperSimdSE3_4) {
+  test_ceres_spline_helper_simd<4, Sophus::SE3>();
+}
+
+TEST(SplineCeresTestSuite, CeresSplineHelperSimdSE3_5) {
+  test_ceres_spline_helper_simd<5, Sophus::SE3>();
+}
+
+TEST(SplineCeresTestSuite, CeresSplineHelperSimdSE3_6) {
+  test_ceres_spline_helper_simd<6, Sophus::SE3>();
+}
+
+TEST(SplineCeresTestSuite, CeresSplineHelperSimdFloatSO3) {
+  test_ceres_spline_helper_simd<4, Sophus::SO3, float>();
+  test_ceres_spline_helper_simd<5, Sophus::SO3, float>();
+  test_ceres_spline_helper_simd<6, Sophus::SO3, float>();
+}
+
+TEST(SplineCeresTestSuite, CeresSplineHelperSimdFloatSE3) {
+  test_ceres_spline_helper_simd<4, Sophus::SE3, float>();
+  test_ceres_spline_helper_simd<5, Sophus::SE3, float>();
+  test_ceres_spline_helper_simd<6, Sophus::SE3, float>();
+}
@@ -0,0 +1,172 @@
+#include <iostream>
+
+#include "gtest/gtest.h"
+
+#include <basalt/utils/eigen_utils.hpp>
+#include <ceres_lie_spline.h>
+#include <ceres_spline_subdivision.h>
+
+// Knot pointers of segment s.
+template <int N, class Knot>
+std::vector<const double*> segment_knots(const Eigen::aligned_vector<Knot>& k,
+                                         int s) {
+  std::vector<const double*> vec;
+  for (int i = 0; i < N; i++) vec.emplace_back(k[s + i].data());
+  return vec;
+}
+
+template <int N>
+void test_subdivide_euclidean() {
+  using Subdivision = CeresSplineSubdivision<N>;
+
+  const int num_knots = 3 * N;
+  const double inv_dt = 4.0;
+
+  Eigen::aligned_vector<Eigen::Vector3d> knots;
+  for (int i = 0; i < num_knots; i++) {
+    knots.emplace_back(Eigen::Vector3d::Random());
+  }
+
+  const auto fine = Subdivision::subdivide(knots);
+  EXPECT_EQ(fine.size(), Subdivision::numFineKnots(knots.size()));
+
+  // Weights of each fine knot sum to one.
+  for (size_t j = 0; j < fine.size(); j++) {
+    double sum = 0;
+    for (int i = 0; i < num_knots; i++) sum += Subdivision::weight(j, i);
+    EXPECT_NEAR(sum, 1, 1e-15);
+  }
+
+  // Time t in units of the coarse knot spacing.
+  for (double t = 0; t < num_knots - N + 1; t += 0.07) {
+    const int s = t;
+    const int s_fine = 2 * t;
+
+    const auto vec = segment_knots<N>(knots, s);
+    const auto vec_fine = segment_knots<N>(fine, s_fine);
+
+    Eigen::Vector3d pos1, pos2, vel1, vel2, accel1, accel2;
+
+    CeresSplineHelper<N>::template evaluate<double, 3, 0>(
+        vec.data(), t - s, inv_dt, &pos1);
+    CeresSplineHelper<N>::template evaluate<double, 3, 1>(
+        vec.data(), t - s, inv_dt, &vel1);
+    CeresSplineHelper<N>::template evaluate<double, 3, 2>(
+        vec.data(), t - s, inv_dt, &accel1);
+
+    CeresSplineHelper<N>::template evaluate<double, 3, 0>(
+        vec_fine.data(), 2 * t - s_fine, 2 * inv_dt, &pos2);
+    CeresSplineHelper<N>::template evaluate<double, 3, 1>(
+        vec_fine.data(), 2 * t - s_fine, 2 * inv_dt, &vel2);
+    CeresSplineHelper<N>::template evaluate<double, 3, 2>(
+        vec_fine.data(), 2 * t - s_fine, 2 * inv_dt, &accel2);
+
+    EXPECT_TRUE(pos1.isApprox(pos2, 1e-10)) << "t " << t;
+    EXPECT_TRUE(vel1.isApprox(vel2, 1e-10)) << "t " << t;
+    EXPECT_TRUE(accel1.isApprox(accel2, 1e-10)) << "t " << t;
+  }
+}
+
+TEST(SplineCeresTestSuite, SubdivideEuclidean) {
+  test_subdivide_euclidean<4>();
+  test_subdivide_euclidean<5>();
+  test_subdivide_euclidean<6>();
+}
+
+// Maximum error of the refined spline in the tangent space.
+template <int N, template <class> class GroupT>
+double subdivision_error(const Eigen::aligned_vector<GroupT<double>>& knots) {
+  using Groupd = GroupT<double>;
+  using Tangentd = typename Groupd::Tangent;
+
+  const double inv_dt = 4.0;
+
+  const auto fine = CeresSplineSubdivision<N>::subdivideLie(knots);
+
+  double max_error = 0;
+  for (double t = 0; t < knots.size() - N + 1; t += 0.07) {
+    const int s = t;
+    const int s_fine = 2 * t;
+
+    const auto vec = segment_knots<N>(knots, s);
+    const auto vec_fine = segment_knots<N>(fine, s_fine);
+
+    Groupd pos1, pos2;
+    Tangentd vel1, vel2;
+
+    CeresSplineHelper<N>::template evaluate_lie<double, GroupT>(
+        vec.data(), t - s, inv_dt, &pos1, &vel1);
+    CeresSplineHelper<N>::template evaluate_lie<double, GroupT>(
+        vec_fine.data(), 2 * t - s_fine, 2 * inv_dt, &pos2, &vel2);
+
+    max_error = std::max(max_error, (pos1.inverse() * pos2).log().norm());
+    max_error = std::max(max_error, (vel1 - vel2).norm() / inv_dt);
+  }
+
+  return max_error;
+}
+
+template <int N, template <class> class GroupT>
+void test_subdivide_lie() {
+  using Groupd = GroupT<double>;
+  using Tangentd = typename Groupd::Tangent;
+
+  const int num_knots = 3 * N;
+
+  // Knots on a one-parameter subgroup are refined exactly.
+  const Tangentd axis = Tangentd::Random();
+  Eigen::aligned_vector<Groupd> subgroup_knots;
+  for (int i = 0; i < num_knots; i++) {
+    subgroup_knots.emplace_back(Groupd::exp(
+        (i + 0.5 * Eigen::Matrix<double, 1, 1>::Random()[0]) * 0.3 * axis));
+  }
+
+  EXPECT_LT((subdivision_error<N, GroupT>(subgroup_knots)), 1e-9);
+
+  // General knots are fitted to the coarse curve.
+  Eigen::aligned_vector<Groupd> knots;
+  Groupd pose;
+  for (int i = 0; i < num_knots; i++) {
+    pose *= Groupd::exp(0.1 * Tangentd::Random());
+    knots.emplace_back(pose);
+  }
+
+  EXPECT_LT((subdivision_error<N, GroupT>(knots)), 5e-4);
+}
+
+TEST(SplineCeresTestSuite, SubdivideLieSO3) {
+  test_subdivide_lie<4, Sophus::SO3>();
+  test_subdivide_lie<5, Sophus::SO3>();
+  test_subdivide_lie<6, Sophus::SO3>();
+}
+
+TEST(SplineCeresTestSuite, SubdivideLieSE3) {
+  test_subdivide_lie<4, Sophus::SE3>();
+  test_subdivide_lie<5, Sophus::SE3>();
+  test_subdivide_lie<6, Sophus::SE3>();
+}
+
+TEST(SplineCeresTestSuite, SubdivideLieGroupSpline) {
+  const int64_t dt_ns = 2e8;
+  const int64_t start_t_ns = 1e9;
+
+  CeresLieGroupSpline<5, Sophus::SE3> coarse(dt_ns, start_t_ns);
+  coarse.initRandom(20);
+  for (int i = 1; i < 20; i++) {
+    coarse.setKnot(i, coarse.getKnot(i - 1) *
+                          Sophus::SE3d::exp(0.1 * Sophus::Vector6d::Random()));
+  }
+
+  CeresLieGroupSpline<5, Sophus::SE3> fine(dt_ns / 2, start_t_ns);
+  fine.initSubdivided(coarse);
+
+  EXPECT_EQ(fine.minTimeNs(), coarse.minTimeNs());
+  EXPECT_EQ(fine.maxTimeNs(), coarse.maxTimeNs());
+
+  for (int64_t t_ns = coarse.minTimeNs(); t_ns < coarse.maxTimeNs();
+       t_ns += 1e7) {
+    const Sophus::SE3d diff =
+        coarse.getValue(t_ns).inverse() * fine.getValue(t_ns);
+    EXPECT_LT(diff.log().norm(), 1e-3) << "t_ns " << t_ns;
+  }
+}
@@ -208,6 +208,14 @@ class SplineOptimization {
     }
   }
 
+  /// Use the knots of other without the perturbation of initSpline, e.g.
+  /// the refined knots of a coarser solution. The knot spacing of other must
+  /// match dt_ns.
+  void setSpline(const SplineT& other) {
+    BASALT_ASSERT(other.getDtNs() == dt_ns);
+    spline = other;
+  }
+
   const SplineT& getSpline() const { return spline; }
 
   Vector3 getG() const { return g; }
@@ -40,6 +40,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <Eigen/Dense>
 
+#include <basalt/camera/project_batch.hpp>
 #include <basalt/utils/sophus_utils.hpp>
 
 namespace basalt {
@@ -214,6 +215,81 @@ class DoubleSphereCamera {
     return is_valid;
   }
 
+  /// @brief Project a set of points and optionally compute Jacobians
+  ///
+  /// Vectorized version of \ref project for structure-of-arrays point
+  /// sets. Every step runs on whole columns of the point set.
+  ///
+  /// @param[in] p3d points to project
+  /// @param[out] proj results of projection
+  /// @param[out] valid if projection is valid
+  /// @param[out] d_proj_d_p3d if not nullptr computed Jacobians of projection
+  /// with respect to p3d
+  inline void projectBatch(
+      const PointsSoA<Scalar, 3>& p3d, PointsSoA<Scalar, 2>& proj,
+      ValidSoA& valid,
+      ProjJacobiansSoA<Scalar>* d_proj_d_p3d = nullptr) const {
+    using ArrX = Eigen::Array<Scalar, Eigen::Dynamic, 1>;
+
+    const Scalar& fx = param_[0];
+    const Scalar& fy = param_[1];
+    const Scalar& cx = param_[2];
+    const Scalar& cy = param_[3];
+
+    const Scalar& xi = param_[4];
+    const Scalar& alpha = param_[5];
+
+    const auto x = p3d.col(0);
+    const auto y = p3d.col(1);
+    const auto z = p3d.col(2);
+
+    const Scalar w1 = alpha > Scalar(0.5) ? (Scalar(1) - alpha) / alpha
+                                          : alpha / (Scalar(1) - alpha);
+    const Scalar w2 =
+        (w1 + xi) / sqrt(Scalar(2) * w1 * xi + xi * xi + Scalar(1));
+
+    const ArrX r2 = x.square() + y.square();
+    const ArrX d1 = (r2 + z.square()).sqrt();
+
+    valid = z > -w2 * d1;
+
+    const ArrX k = xi * d1 + z;
+    const ArrX d2 = (r2 + k.square()).sqrt();
+
+    const ArrX norm = alpha * d2 + (Scalar(1) - alpha) * k;
+
+    proj.resize(p3d.rows(), 2);
+    proj.col(0) = fx * x / norm + cx;
+    proj.col(1) = fy * y / norm + cy;
+
+    if (d_proj_d_p3d) {
+      const ArrX inv_norm = norm.inverse();
+      const ArrX inv_norm2 = inv_norm.square();
+      const ArrX inv_d1 = d1.inverse();
+      const ArrX inv_d2 = d2.inverse();
+
+      const ArrX tt2 = xi * z * inv_d1 + Scalar(1);
+
+      const ArrX d_norm_d_r2 = (xi * (Scalar(1) - alpha) * inv_d1 +
+                                alpha * (xi * k * inv_d1 + Scalar(1)) * inv_d2) *
+                               inv_norm2;
+
+      const ArrX tmp2 =
+          ((Scalar(1) - alpha) * tt2 + alpha * k * tt2 * inv_d2) * inv_norm2;
+
+      const ArrX xy_d_norm_d_r2 = x * y * d_norm_d_r2;
+
+      ProjJacobiansSoA<Scalar>& J = *d_proj_d_p3d;
+      J.resize(p3d.rows(), 6);
+      J.col(0) = fx * (inv_norm - x.square() * d_norm_d_r2);
+      J.col(1) = -fx * xy_d_norm_d_r2;
+      J.col(2) = -fx * x * tmp2;
+      J.col(3) = -fy * xy_d_norm_d_r2;
+      J.col(4) = fy * (inv_norm - y.square() * d_norm_d_r2);
+      J.col(5) = -fy * y * tmp2;
+    }
+  }
+
   /// @brief Unproject the point and optionally compute Jacobians
   ///
   /// The unprojection function is computed as follows: \f{align}{
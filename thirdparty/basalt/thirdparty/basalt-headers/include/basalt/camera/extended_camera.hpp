@@ -40,6 +40,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <Eigen/Dense>
 
+#include <basalt/camera/project_batch.hpp>
 #include <basalt/utils/sophus_utils.hpp>
 
 namespace basalt {
@@ -192,6 +193,64 @@ class ExtendedUnifiedCamera {
     return is_valid;
   }
 
+  /// @brief Project a set of points and optionally compute Jacobians
+  ///
+  /// Vectorized version of \ref project for structure-of-arrays point
+  /// sets. Every step runs on whole columns of the point set.
+  ///
+  /// @param[in] p3d points to project
+  /// @param[out] proj results of projection
+  /// @param[out] valid if projection is valid
+  /// @param[out] d_proj_d_p3d if not nullptr computed Jacobians of projection
+  /// with respect to p3d
+  inline void projectBatch(
+      const PointsSoA<Scalar, 3>& p3d, PointsSoA<Scalar, 2>& proj,
+      ValidSoA& valid,
+      ProjJacobiansSoA<Scalar>* d_proj_d_p3d = nullptr) const {
+    using ArrX = Eigen::Array<Scalar, Eigen::Dynamic, 1>;
+
+    const Scalar& fx = param_[0];
+    const Scalar& fy = param_[1];
+    const Scalar& cx = param_[2];
+    const Scalar& cy = param_[3];
+    const Scalar& alpha = param_[4];
+    const Scalar& beta = param_[5];
+
+    const auto x = p3d.col(0);
+    const auto y = p3d.col(1);
+    const auto z = p3d.col(2);
+
+    const ArrX r2 = x.square() + y.square();
+    const ArrX rho = (beta * r2 + z.square()).sqrt();
+
+    const ArrX norm = alpha * rho + (Scalar(1) - alpha) * z;
+
+    proj.resize(p3d.rows(), 2);
+    proj.col(0) = fx * x / norm + cx;
+    proj.col(1) = fy * y / norm + cy;
+
+    // Check if valid
+    const Scalar w = alpha > Scalar(0.5) ? (Scalar(1) - alpha) / alpha
+                                         : alpha / (Scalar(1) - alpha);
+    valid = z > -w * rho;
+
+    if (d_proj_d_p3d) {
+      const ArrX inv_denom = (norm.square() * rho).inverse();
+      const ArrX mid = -(alpha * beta) * x * y * inv_denom;
+      const ArrX add = norm * rho;
+      const ArrX addz = (alpha * z + (Scalar(1) - alpha) * rho) * inv_denom;
+
+      ProjJacobiansSoA<Scalar>& J = *d_proj_d_p3d;
+      J.resize(p3d.rows(), 6);
+      J.col(0) = fx * (add - alpha * beta * x.square()) * inv_denom;
+      J.col(1) = fx * mid;
+      J.col(2) = -fx * x * addz;
+      J.col(3) = fy * mid;
+      J.col(4) = fy * (add - alpha * beta * y.square()) * inv_denom;
+      J.col(5) = -fy * y * addz;
+    }
+  }
+
   /// @brief Unproject the point and optionally compute Jacobians
   ///
   /// The unprojection function is computed as follows: \f{align}{
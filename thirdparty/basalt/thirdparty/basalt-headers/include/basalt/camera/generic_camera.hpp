@@ -44,6 +44,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <basalt/camera/fov_camera.hpp>
 #include <basalt/camera/kannala_brandt_camera4.hpp>
 #include <basalt/camera/pinhole_camera.hpp>
+#include <basalt/camera/project_batch.hpp>
 #include <basalt/camera/unified_camera.hpp>
 
 #include <variant>
@@ -140,6 +141,27 @@ class GenericCamera {
     return res;
   }
 
+  /// @brief Project a set of points and optionally compute Jacobians
+  ///
+  /// Dispatches once to the projectBatch of the stored model, which is
+  /// vectorized for the double sphere, extended unified and pinhole models.
+  ///
+  /// @param[in] p3d points to project
+  /// @param[out] proj results of projection
+  /// @param[out] valid if projection is valid
+  /// @param[out] d_proj_d_p3d if not nullptr computed Jacobians of projection
+  /// with respect to p3d
+  inline void projectBatch(
+      const PointsSoA<Scalar, 3>& p3d, PointsSoA<Scalar, 2>& proj,
+      ValidSoA& valid,
+      ProjJacobiansSoA<Scalar>* d_proj_d_p3d = nullptr) const {
+    std::visit(
+        [&](const auto& cam) {
+          cam.projectBatch(p3d, proj, valid, d_proj_d_p3d);
+        },
+        variant);
+  }
+
   /// @brief Unproject a single point and optionally compute Jacobian
   ///
   /// **SLOW** function, as it requires vtable lookup for every unprojection.
@@ -38,6 +38,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
+#include <basalt/camera/project_batch.hpp>
 #include <basalt/utils/sophus_utils.hpp>
 
 namespace basalt {
@@ -151,6 +152,51 @@ class PinholeCamera {
     return is_valid;
   }
 
+  /// @brief Project a set of points and optionally compute Jacobians
+  ///
+  /// Vectorized version of \ref project for structure-of-arrays point
+  /// sets. Every step runs on whole columns of the point set.
+  ///
+  /// @param[in] p3d points to project
+  /// @param[out] proj results of projection
+  /// @param[out] valid if projection is valid
+  /// @param[out] d_proj_d_p3d if not nullptr computed Jacobians of projection
+  /// with respect to p3d
+  inline void projectBatch(
+      const PointsSoA<Scalar, 3>& p3d, PointsSoA<Scalar, 2>& proj,
+      ValidSoA& valid,
+      ProjJacobiansSoA<Scalar>* d_proj_d_p3d = nullptr) const {
+    using ArrX = Eigen::Array<Scalar, Eigen::Dynamic, 1>;
+
+    const Scalar& fx = param_[0];
+    const Scalar& fy = param_[1];
+    const Scalar& cx = param_[2];
+    const Scalar& cy = param_[3];
+
+    const auto x = p3d.col(0);
+    const auto y = p3d.col(1);
+    const auto z = p3d.col(2);
+
+    const ArrX inv_z = z.inverse();
+
+    proj.resize(p3d.rows(), 2);
+    proj.col(0) = fx * x * inv_z + cx;
+    proj.col(1) = fy * y * inv_z + cy;
+
+    valid = z >= Sophus::Constants<Scalar>::epsilonSqrt();
+
+    if (d_proj_d_p3d) {
+      ProjJacobiansSoA<Scalar>& J = *d_proj_d_p3d;
+      J.resize(p3d.rows(), 6);
+      J.col(0) = fx * inv_z;
+      J.col(1).setZero();
+      J.col(2) = -fx * x * inv_z.square();
+      J.col(3).setZero();
+      J.col(4) = fy * inv_z;
+      J.col(5) = -fy * y * inv_z.square();
+    }
+  }
+
   /// @brief Unproject the point and optionally compute Jacobians
   ///
   /// The unprojection function is computed as follows: \f{align}{
@@ -0,0 +1,105 @@
+/**
+BSD 3-Clause License
+
+This file is part of the Basalt project.
+https://gitlab.com/VladyslavUsenko/basalt-headers.git
+
+Copyright (c) 2019, Vladyslav Usenko and Nikolaus Demmel.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+@file
+@brief Structure-of-arrays point sets for batched projection.
+*/
+
+#pragma once
+
+#include <Eigen/Dense>
+
+namespace basalt {
+
+/// @brief Set of points in structure-of-arrays layout.
+///
+/// Row i holds point i, column c holds coordinate c of all points, such that
+/// the batched projections of the camera models operate on contiguous
+/// columns and compile to vector instructions.
+template <typename Scalar, int Dim>
+using PointsSoA = Eigen::Array<Scalar, Eigen::Dynamic, Dim>;
+
+/// @brief Jacobians of projections with respect to 3D points in
+/// structure-of-arrays layout.
+///
+/// Column 3 * r + c holds entry (r, c) of the 2x3 Jacobians of all points.
+template <typename Scalar>
+using ProjJacobiansSoA = Eigen::Array<Scalar, Eigen::Dynamic, 6>;
+
+/// Validity of the projections of a point set.
+using ValidSoA = Eigen::Array<bool, Eigen::Dynamic, 1>;
+
+/// @brief Project a set of points point by point
+///
+/// Implementation of projectBatch for camera models without a vectorized
+/// version.
+///
+/// @param[in] cam camera model
+/// @param[in] p3d points to project
+/// @param[out] proj results of projection
+/// @param[out] valid if projection is valid
+/// @param[out] d_proj_d_p3d if not nullptr computed Jacobians of projection
+/// with respect to p3d
+template <class CamT>
+inline void projectBatchPointwise(
+    const CamT& cam, const PointsSoA<typename CamT::Scalar, 3>& p3d,
+    PointsSoA<typename CamT::Scalar, 2>& proj, ValidSoA& valid,
+    ProjJacobiansSoA<typename CamT::Scalar>* d_proj_d_p3d = nullptr) {
+  using Scalar = typename CamT::Scalar;
+  using Vec2 = Eigen::Matrix<Scalar, 2, 1>;
+  using Vec4 = Eigen::Matrix<Scalar, 4, 1>;
+  using Mat24 = Eigen::Matrix<Scalar, 2, 4>;
+
+  const Eigen::Index n = p3d.rows();
+  proj.resize(n, 2);
+  valid.resize(n);
+  if (d_proj_d_p3d) d_proj_d_p3d->resize(n, 6);
+
+  for (Eigen::Index i = 0; i < n; i++) {
+    const Vec4 p(p3d(i, 0), p3d(i, 1), p3d(i, 2), Scalar(1));
+
+    Vec2 res;
+    Mat24 J;
+    valid[i] = cam.project(p, res, d_proj_d_p3d ? &J : nullptr);
+
+    proj.row(i) = res.transpose();
+    if (d_proj_d_p3d) {
+      for (int r = 0; r < 2; r++) {
+        for (int c = 0; c < 3; c++) (*d_proj_d_p3d)(i, 3 * r + c) = J(r, c);
+      }
+    }
+  }
+}
+
+}  // namespace basalt
@@ -38,6 +38,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
+#include <basalt/camera/project_batch.hpp>
 #include <basalt/utils/sophus_utils.hpp>
 
 namespace basalt {
@@ -184,6 +185,22 @@ class UnifiedCamera {
     return is_valid;
   }
 
+  /// @brief Project a set of points and optionally compute Jacobians
+  ///
+  /// Projects point by point with \ref project.
+  ///
+  /// @param[in] p3d points to project
+  /// @param[out] proj results of projection
+  /// @param[out] valid if projection is valid
+  /// @param[out] d_proj_d_p3d if not nullptr computed Jacobians of projection
+  /// with respect to p3d
+  inline void projectBatch(
+      const PointsSoA<Scalar, 3>& p3d, PointsSoA<Scalar, 2>& proj,
+      ValidSoA& valid,
+      ProjJacobiansSoA<Scalar>* d_proj_d_p3d = nullptr) const {
+    projectBatchPointwise(*this, p3d, proj, valid, d_proj_d_p3d);
+  }
+
   /// @brief Unproject the point and optionally compute Jacobians
   ///
   /// The unprojection function is computed as follows: \f{align}{
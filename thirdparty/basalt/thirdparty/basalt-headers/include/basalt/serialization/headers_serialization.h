@@ -40,6 +40,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <basalt/serialization/eigen_io.h>
 #include <basalt/calibration/calibration.hpp>
+#include <basalt/utils/ring_buffer.h>
 
 #include <cereal/archives/binary.hpp>
 #include <cereal/archives/json.hpp>
@@ -196,6 +197,22 @@ inline void load(Archive& ar, basalt::FovCamera<Scalar>& cam) {
   cam = basalt::FovCamera<Scalar>(intr);
 }
 
+/// Same format as std::deque, so splines saved with deque knots still load.
+template <class Archive, class T, class Alloc>
+inline void save(Archive& ar, const basalt::RingBuffer<T, Alloc>& buffer) {
+  ar(make_size_tag(static_cast<size_type>(buffer.size())));
+  for (const auto& v : buffer) ar(v);
+}
+
+template <class Archive, class T, class Alloc>
+inline void load(Archive& ar, basalt::RingBuffer<T, Alloc>& buffer) {
+  size_type size;
+  ar(make_size_tag(size));
+
+  buffer.resizeUninitialized(static_cast<size_t>(size));
+  for (auto& v : buffer) ar(v);
+}
+
 template <class Archive, class Scalar, int DIM, int ORDER>
 inline void save(Archive& ar,
                  const basalt::RdSpline<DIM, ORDER, Scalar>& spline) {
@@ -208,7 +225,7 @@ template <class Archive, class Scalar, int DIM, int ORDER>
 inline void load(Archive& ar, basalt::RdSpline<DIM, ORDER, Scalar>& spline) {
   int64_t start_t_ns;
   int64_t dt_ns;
-  Eigen::aligned_deque<Eigen::Matrix<Scalar, DIM, 1>> knots;
+  basalt::RingBuffer<Eigen::Matrix<Scalar, DIM, 1>> knots;
 
   ar(start_t_ns);
   ar(dt_ns);
@@ -40,6 +40,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <basalt/spline/spline_common.h>
 #include <basalt/utils/assert.h>
+#include <basalt/utils/ring_buffer.h>
 #include <basalt/utils/sophus_utils.hpp>
 
 #include <Eigen/Dense>
@@ -151,7 +152,7 @@ class RdSpline {
     }
 
     for (const auto& k : knots_) {
-      res.knots_.emplace_back(k.template cast<Scalar2>());
+      res.knots_.push_back(k.template cast<Scalar2>());
     }
 
     return res;
@@ -234,10 +235,10 @@ class RdSpline {
   /// @return const reference to the knot
   inline const VecD& getKnot(int i) const { return knots_[i]; }
 
-  /// @brief Return const reference to deque with knots
+  /// @brief Return const reference to the knot buffer
   ///
-  /// @return const reference to deque with knots
-  const Eigen::aligned_deque<VecD>& getKnots() const { return knots_; }
+  /// @return const reference to the ring buffer with knots
+  const RingBuffer<VecD>& getKnots() const { return knots_; }
 
   /// @brief Return time interval in nanoseconds
   ///
@@ -344,7 +345,7 @@ class RdSpline {
   static const MatN BASE_COEFFICIENTS;  ///< Base coefficients matrix.
                                         ///< See \ref computeBaseCoefficients.
 
-  Eigen::aligned_deque<VecD> knots_;    ///< Knots
+  RingBuffer<VecD> knots_;              ///< Knots
   int64_t dt_ns_{0};                    ///< Knot interval in nanoseconds
   int64_t start_t_ns_{0};               ///< Start time in nanoseconds
   std::array<_Scalar, _N> pow_inv_dt_;  ///< Array with inverse powers of dt
@@ -177,15 +177,15 @@ class Se3Spline {
   ///
   /// @return first knot of the spline
   inline SE3 knotsFront() const {
-    SE3 res(so3_spline_.knots_front(), pos_spline_.knots_front());
+    SE3 res(so3_spline_.knotsFront(), pos_spline_.knotsFront());
 
     return res;
   }
 
   /// @brief Remove first knot of the spline and increase the start time
   inline void knotsPopFront() {
-    so3_spline_.knots_pop_front();
-    pos_spline_.knots_pop_front();
+    so3_spline_.knotsPopFront();
+    pos_spline_.knotsPopFront();
 
     BASALT_ASSERT(so3_spline_.minTimeNs() == pos_spline_.minTimeNs());
     BASALT_ASSERT(so3_spline_.getKnots().size() ==
@@ -40,6 +40,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <basalt/spline/spline_common.h>
 #include <basalt/utils/assert.h>
+#include <basalt/utils/ring_buffer.h>
 #include <basalt/utils/sophus_utils.hpp>
 
 #include <Eigen/Dense>
@@ -192,10 +193,10 @@ class So3Spline {
   /// @return const reference to the knot
   inline const SO3& getKnot(int i) const { return knots_[i]; }
 
-  /// @brief Return const reference to deque with knots
+  /// @brief Return const reference to the knot buffer
   ///
-  /// @return const reference to deque with knots
-  const Eigen::aligned_deque<SO3>& getKnots() const { return knots_; }
+  /// @return const reference to the ring buffer with knots
+  const RingBuffer<SO3>& getKnots() const { return knots_; }
 
   /// @brief Return time interval in nanoseconds
   ///
@@ -771,7 +772,7 @@ class So3Spline {
   static const MatN BASE_COEFFICIENTS;  ///< Base coefficients matrix.
   ///< See \ref computeBaseCoefficients.
 
-  Eigen::aligned_deque<SO3> knots_;    ///< Knots
+  RingBuffer<SO3> knots_;              ///< Knots
   int64_t dt_ns_;                      ///< Knot interval in nanoseconds
   int64_t start_t_ns_;                 ///< Start time in nanoseconds
   std::array<_Scalar, 4> pow_inv_dt_;  ///< Array with inverse powers of dt
@@ -0,0 +1,257 @@
+/**
+BSD 3-Clause License
+
+This file is part of the Basalt project.
+https://gitlab.com/VladyslavUsenko/basalt-headers.git
+
+Copyright (c) 2019, Vladyslav Usenko and Nikolaus Demmel.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+@file
+@brief Double-ended queue in a contiguous power-of-two ring buffer.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <basalt/utils/assert.h>
+
+namespace basalt {
+
+/// @brief Double-ended queue stored in one contiguous ring buffer.
+///
+/// Replacement for std::deque in the spline knot containers. Elements live
+/// in a single array whose size is a power of two, element i is at
+/// (head + i) & mask. Sequential access walks contiguous memory (with at
+/// most one wrap-around), push and pop at both ends move the window without
+/// allocating once the capacity is reached, and copying the buffer into
+/// one of the same capacity is a single block copy without allocations.
+/// References are invalidated by push_back, push_front, resize and
+/// resizeUninitialized when the capacity grows.
+///
+/// @tparam T element type
+/// @tparam Alloc allocator, aligned for Eigen types by default
+template <class T, class Alloc = Eigen::aligned_allocator<T>>
+class RingBuffer {
+  template <class Buffer, class Value>
+  class Iterator;
+
+ public:
+  using value_type = T;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T&;
+  using const_reference = const T&;
+  using iterator = Iterator<RingBuffer, T>;
+  using const_iterator = Iterator<const RingBuffer, const T>;
+
+  /// Capacity of the first allocation.
+  static constexpr size_t min_capacity = 8;
+
+  RingBuffer() = default;
+
+  /// @brief Buffer with n value-initialized elements
+  explicit RingBuffer(size_t n) { resize(n); }
+
+  inline size_t size() const { return size_; }
+
+  inline bool empty() const { return size_ == 0; }
+
+  /// @brief Number of elements that fit without reallocation
+  inline size_t capacity() const { return data_.size(); }
+
+  inline T& operator[](size_t i) { return data_[(head_ + i) & mask_]; }
+
+  inline const T& operator[](size_t i) const {
+    return data_[(head_ + i) & mask_];
+  }
+
+  inline T& front() { return data_[head_]; }
+  inline const T& front() const { return data_[head_]; }
+
+  inline T& back() { return (*this)[size_ - 1]; }
+  inline const T& back() const { return (*this)[size_ - 1]; }
+
+  inline void push_back(const T& value) {
+    if (size_ == capacity()) grow(size_ + 1);
+    (*this)[size_] = value;
+    size_++;
+  }
+
+  inline void push_front(const T& value) {
+    if (size_ == capacity()) grow(size_ + 1);
+    head_ = (head_ - 1) & mask_;
+    data_[head_] = value;
+    size_++;
+  }
+
+  inline void pop_back() {
+    BASALT_ASSERT(size_ > 0);
+    size_--;
+  }
+
+  inline void pop_front() {
+    BASALT_ASSERT(size_ > 0);
+    head_ = (head_ + 1) & mask_;
+    size_--;
+  }
+
+  /// @brief Resize to n elements, new elements are assigned T()
+  ///
+  /// Same as std::deque::resize for types whose T() is a value, e.g. int.
+  /// For Eigen fixed-size types T() leaves the coefficients uninitialized, so
+  /// the new elements are unspecified. Use resizeUninitialized if the caller
+  /// overwrites them anyway.
+  void resize(size_t n) {
+    const size_t old_size = size_;
+    resizeUninitialized(n);
+    for (size_t i = old_size; i < n; i++) (*this)[i] = T();
+  }
+
+  /// @brief Resize to n elements without assigning the new ones
+  ///
+  /// New elements are the default-constructed slots of the storage after the
+  /// capacity grows, or hold the values of elements removed by pop_back,
+  /// pop_front or clear. The caller must assign them.
+  void resizeUninitialized(size_t n) {
+    if (n > capacity()) grow(n);
+    size_ = n;
+  }
+
+  /// @brief Make room for at least n elements
+  void reserve(size_t n) {
+    if (n > capacity()) grow(n);
+  }
+
+  void clear() {
+    head_ = 0;
+    size_ = 0;
+  }
+
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, size_); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size_); }
+
+ private:
+  /// Reallocate to the smallest power of two >= n and move the elements to
+  /// the start of the new array.
+  void grow(size_t n) {
+    size_t new_capacity = std::max(capacity(), min_capacity);
+    while (new_capacity < n) new_capacity *= 2;
+
+    std::vector<T, Alloc> data(new_capacity);
+    for (size_t i = 0; i < size_; i++) data[i] = std::move((*this)[i]);
+
+    data_.swap(data);
+    head_ = 0;
+    mask_ = new_capacity - 1;
+  }
+
+  /// Random access iterator over the elements in queue order.
+  template <class Buffer, class Value>
+  class Iterator {
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Value*;
+    using reference = Value&;
+
+    Iterator() = default;
+    Iterator(Buffer* buffer, size_t i) : buffer_(buffer), i_(i) {}
+
+    reference operator*() const { return (*buffer_)[i_]; }
+    pointer operator->() const { return &(*buffer_)[i_]; }
+    reference operator[](difference_type n) const {
+      return (*buffer_)[i_ + n];
+    }
+
+    Iterator& operator++() {
+      i_++;
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator res = *this;
+      i_++;
+      return res;
+    }
+    Iterator& operator--() {
+      i_--;
+      return *this;
+    }
+    Iterator operator--(int) {
+      Iterator res = *this;
+      i_--;
+      return res;
+    }
+
+    Iterator& operator+=(difference_type n) {
+      i_ += n;
+      return *this;
+    }
+    Iterator& operator-=(difference_type n) {
+      i_ -= n;
+      return *this;
+    }
+    Iterator operator+(difference_type n) const {
+      return Iterator(buffer_, i_ + n);
+    }
+    Iterator operator-(difference_type n) const {
+      return Iterator(buffer_, i_ - n);
+    }
+    difference_type operator-(const Iterator& other) const {
+      return difference_type(i_) - difference_type(other.i_);
+    }
+
+    bool operator==(const Iterator& other) const { return i_ == other.i_; }
+    bool operator!=(const Iterator& other) const { return i_ != other.i_; }
+    bool operator<(const Iterator& other) const { return i_ < other.i_; }
+    bool operator>(const Iterator& other) const { return i_ > other.i_; }
+    bool operator<=(const Iterator& other) const { return i_ <= other.i_; }
+    bool operator>=(const Iterator& other) const { return i_ >= other.i_; }
+
+   private:
+    Buffer* buffer_ = nullptr;
+    size_t i_ = 0;
+  };
+
+  std::vector<T, Alloc> data_;
+  size_t head_ = 0;
+  size_t size_ = 0;
+  size_t mask_ = 0;
+};
+
+}  // namespace basalt
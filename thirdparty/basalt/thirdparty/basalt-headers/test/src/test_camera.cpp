@@ -321,6 +321,109 @@ TEST(CameraTestCase, FovUnprojectJacobiansFloat) {
 
 ////////////////////////////////////////////////////////////////
 
+template <typename CamT>
+void testProjectBatch() {
+  Eigen::aligned_vector<CamT> test_cams = CamT::getTestProjections();
+
+  using Scalar = typename CamT::Scalar;
+  using Vec2 = typename CamT::Vec2;
+  using Vec4 = typename CamT::Vec4;
+  using Mat24 = typename CamT::Mat24;
+
+  // Grid of points including points that can not be projected.
+  basalt::PointsSoA<Scalar, 3> p3d(21 * 21 * 7, 3);
+  int n = 0;
+  for (int x = -10; x <= 10; x++) {
+    for (int y = -10; y <= 10; y++) {
+      for (int z = -1; z <= 5; z++) {
+        p3d.row(n++) << Scalar(0.1) * x, Scalar(0.1) * y, Scalar(z);
+      }
+    }
+  }
+
+  const Scalar eps = std::is_same<Scalar, float>::value ? 1e-4 : 1e-10;
+
+  for (const CamT &cam : test_cams) {
+    basalt::PointsSoA<Scalar, 2> proj, proj_no_J;
+    basalt::ValidSoA valid, valid_no_J;
+    basalt::ProjJacobiansSoA<Scalar> J;
+
+    cam.projectBatch(p3d, proj, valid, &J);
+    cam.projectBatch(p3d, proj_no_J, valid_no_J);
+
+    basalt::GenericCamera<Scalar> generic;
+    generic.variant = cam;
+
+    basalt::PointsSoA<Scalar, 2> proj_generic;
+    basalt::ValidSoA valid_generic;
+    generic.projectBatch(p3d, proj_generic, valid_generic);
+
+    ASSERT_EQ(proj.rows(), p3d.rows());
+    ASSERT_EQ(J.rows(), p3d.rows());
+
+    for (int i = 0; i < p3d.rows(); i++) {
+      const Vec4 p(p3d(i, 0), p3d(i, 1), p3d(i, 2), 1);
+
+      Vec2 res;
+      Mat24 J_p;
+      const bool success = cam.project(p, res, &J_p);
+
+      ASSERT_EQ(success, bool(valid[i])) << "p " << p.transpose();
+      ASSERT_EQ(success, bool(valid_no_J[i]));
+      ASSERT_EQ(success, bool(valid_generic[i]));
+      if (!success) continue;
+
+      // Entries of the Jacobians cancel terms of the order of the projection
+      // in single precision.
+      const Scalar scale = std::max(Scalar(1), res.norm());
+      EXPECT_LE((proj.row(i).matrix().transpose() - res).norm(), eps * scale)
+          << "p " << p.transpose();
+      EXPECT_LE((proj_no_J.row(i).matrix().transpose() - res).norm(),
+                eps * scale);
+      EXPECT_LE((proj_generic.row(i).matrix().transpose() - res).norm(),
+                eps * scale);
+
+      for (int r = 0; r < 2; r++) {
+        for (int c = 0; c < 3; c++) {
+          EXPECT_NEAR(J(i, 3 * r + c), J_p(r, c), eps * scale)
+              << "p " << p.transpose() << " r " << r << " c " << c;
+        }
+      }
+    }
+  }
+}
+
+TEST(CameraTestCase, PinholeProjectBatch) {
+  testProjectBatch<basalt::PinholeCamera<double>>();
+}
+TEST(CameraTestCase, PinholeProjectBatchFloat) {
+  testProjectBatch<basalt::PinholeCamera<float>>();
+}
+
+TEST(CameraTestCase, UnifiedProjectBatch) {
+  testProjectBatch<basalt::UnifiedCamera<double>>();
+}
+
+TEST(CameraTestCase, ExtendedUnifiedProjectBatch) {
+  testProjectBatch<basalt::ExtendedUnifiedCamera<double>>();
+}
+TEST(CameraTestCase, ExtendedUnifiedProjectBatchFloat) {
+  testProjectBatch<basalt::ExtendedUnifiedCamera<float>>();
+}
+
+TEST(CameraTestCase, KannalaBrandtProjectBatch) {
+  testProjectBatch<basalt::KannalaBrandtCamera4<double>>();
+}
+
+TEST(CameraTestCase, DoubleSphereProjectBatch) {
+  testProjectBatch<basalt::DoubleSphereCamera<double>>();
+}
+TEST(CameraTestCase, DoubleSphereProjectBatchFloat) {
+  testProjectBatch<basalt::DoubleSphereCamera<float>>();
+}
+
+////////////////////////////////////////////////////////////////
+
 template <typename CamT>
 void testStereographicProjectJacobian() {
   using Vec2 = typename CamT::Vec2;
@@ -0,0 +1,195 @@
+/**
+BSD 3-Clause License
+
+Copyright (c) 2019, Vladyslav Usenko and Nikolaus Demmel.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+  this list of conditions and the following disclaimer in the documentation
+  and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+  contributors may be used to endorse or promote products derived from
+  this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <deque>
+#include <random>
+#include <sstream>
+
+#include <basalt/serialization/headers_serialization.h>
+#include <basalt/spline/se3_spline.h>
+#include <basalt/utils/ring_buffer.h>
+
+#include "gtest/gtest.h"
+
+TEST(RingBufferTest, SameAsDeque) {
+  basalt::RingBuffer<int> buffer;
+  std::deque<int> deque;
+
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> op(0, 9);
+
+  for (int i = 0; i < 10000; i++) {
+    const int o = op(gen);
+    if (o < 2) {
+      buffer.push_front(i);
+      deque.push_front(i);
+    } else if (o < 5) {
+      buffer.push_back(i);
+      deque.push_back(i);
+    } else if (o < 8 && !deque.empty()) {
+      buffer.pop_front();
+      deque.pop_front();
+    } else if (o < 9 && !deque.empty()) {
+      buffer.pop_back();
+      deque.pop_back();
+    } else {
+      const size_t n = deque.size() + op(gen) - 4;
+      buffer.resize(n);
+      deque.resize(n);
+    }
+
+    ASSERT_EQ(buffer.size(), deque.size());
+    ASSERT_EQ(buffer.empty(), deque.empty());
+    ASSERT_EQ(buffer.capacity() & (buffer.capacity() - 1), 0u);
+    ASSERT_TRUE(std::equal(buffer.begin(), buffer.end(), deque.begin(),
+                           deque.end()));
+    if (!deque.empty()) {
+      ASSERT_EQ(buffer.front(), deque.front());
+      ASSERT_EQ(buffer.back(), deque.back());
+    }
+  }
+
+  // Copies keep the order and are independent.
+  basalt::RingBuffer<int> copy = buffer;
+  ASSERT_TRUE(
+      std::equal(copy.begin(), copy.end(), deque.begin(), deque.end()));
+  if (!copy.empty()) {
+    copy.front() += 1;
+    EXPECT_NE(copy.front(), buffer.front());
+  }
+}
+
+TEST(RingBufferTest, SlidingWindowSpline) {
+  static const int N = 5;
+  const int64_t dt_ns = 2e7;
+  const int num_knots = 40;
+  const int window_size = 10;
+
+  basalt::Se3Spline<N> spline(dt_ns);
+  spline.genRandomTrajectory(num_knots);
+
+  // Window moved over the spline, the knot buffer wraps around several times.
+  basalt::Se3Spline<N> window(dt_ns);
+  for (int i = 0; i < window_size; i++) {
+    window.knotsPushBack(spline.getKnot(i));
+  }
+
+  for (int i = window_size; i < num_knots; i++) {
+    window.knotsPushBack(spline.getKnot(i));
+    window.knotsPopFront();
+
+    ASSERT_EQ(window.numKnots(), size_t(window_size));
+    ASSERT_EQ(window.minTimeNs(), (i - window_size + 1) * dt_ns);
+
+    for (int64_t t_ns = window.minTimeNs(); t_ns < window.maxTimeNs();
+         t_ns += dt_ns / 3) {
+      EXPECT_TRUE(window.pose(t_ns).matrix().isApprox(
+          spline.pose(t_ns).matrix(), 1e-12));
+      EXPECT_TRUE(window.rotVelBody(t_ns).isApprox(spline.rotVelBody(t_ns)));
+      EXPECT_TRUE(
+          window.transAccelWorld(t_ns).isApprox(spline.transAccelWorld(t_ns)));
+    }
+  }
+}
+
+TEST(RingBufferTest, ResizeUninitialized) {
+  basalt::RingBuffer<int> buffer;
+  std::deque<int> deque;
+  for (int i = 0; i < 10; i++) {
+    buffer.push_back(i);
+    deque.push_back(i);
+  }
+  for (int i = 0; i < 3; i++) {
+    buffer.pop_front();
+    deque.pop_front();
+  }
+
+  // Within the capacity, across the wrap-around and with growing.
+  for (size_t n : {buffer.capacity() - 1, 4 * buffer.capacity() + 1}) {
+    const size_t old_size = buffer.size();
+    buffer.resizeUninitialized(n);
+    ASSERT_EQ(buffer.size(), n);
+    for (size_t i = old_size; i < n; i++) {
+      buffer[i] = int(i);
+      deque.push_back(int(i));
+    }
+    ASSERT_TRUE(std::equal(buffer.begin(), buffer.end(), deque.begin(),
+                           deque.end()));
+  }
+}
+
+TEST(RingBufferTest, SplineSerialization) {
+  basalt::RdSpline<3, 5> spline(2e7, 1e9);
+  spline.genRandomTrajectory(20);
+
+  // Shift the start of the buffer, the serialized knots are in spline order.
+  spline.knotsPopFront();
+  spline.knotsPopFront();
+
+  std::stringstream ss;
+  {
+    cereal::BinaryOutputArchive archive(ss);
+    archive(spline);
+  }
+
+  basalt::RdSpline<3, 5> loaded;
+  {
+    cereal::BinaryInputArchive archive(ss);
+    archive(loaded);
+  }
+
+  ASSERT_EQ(loaded.getKnots().size(), spline.getKnots().size());
+  EXPECT_EQ(loaded.minTimeNs(), spline.minTimeNs());
+  for (size_t i = 0; i < spline.getKnots().size(); i++) {
+    EXPECT_EQ(loaded.getKnot(i), spline.getKnot(i));
+  }
+
+  // Knots written as a std::deque load into the ring buffer.
+  Eigen::aligned_deque<Eigen::Vector3d> deque(spline.getKnots().begin(),
+                                              spline.getKnots().end());
+  std::stringstream ss_deque;
+  {
+    cereal::BinaryOutputArchive archive(ss_deque);
+    archive(spline.minTimeNs(), spline.getTimeIntervalNs(), deque);
+  }
+
+  basalt::RdSpline<3, 5> loaded_deque;
+  {
+    cereal::BinaryInputArchive archive(ss_deque);
+    archive(loaded_deque);
+  }
+
+  ASSERT_EQ(loaded_deque.getKnots().size(), deque.size());
+  for (size_t i = 0; i < deque.size(); i++) {
+    EXPECT_EQ(loaded_deque.getKnot(i), deque[i]);
+  }
+}